@@ -0,0 +1,974 @@
+/*
+ *  RaptorBench.cpp
+ */
+
+// Headless microbenchmarks for engine hot paths.  Nothing here opens a window, creates a GL context,
+// initializes audio, or touches the network, so it can run on a build machine.
+//
+// Build: compile this file with the engine sources (Core, Game, Graphics, Input, Libs, Net, Saitek, Sound,
+// UI, VR) and link the same libraries a game does.  Defining NO_PROFILER is recommended, so the numbers
+// don't include zone bookkeeping.
+//
+// Usage: RaptorBench [-o results.json] [-t seconds_per_case] [name_filter ...]
+// Results are written as JSON (to stdout unless -o is given); progress goes to stderr.
+
+#include "PlatformSpecific.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <stdint.h>
+#include "Clock.h"
+#include "Rand.h"
+#include "Math3D.h"
+#include "Pos.h"
+#include "Vec.h"
+#include "Packet.h"
+#include "PacketBuffer.h"
+#include "NetSchema.h"
+#include "Model.h"
+#include "ModelQueue.h"
+#include "GameData.h"
+#include "GameObject.h"
+#include "IMA.h"
+#include "IMACodec.h"
+
+
+// Results are folded in here so the optimizer can't discard the work being timed.
+static volatile uint64_t BenchSink = 0;
+
+#define BENCH_MESH_FILENAME "RaptorBench-mesh.obj"
+
+
+// ---------------------------------------------------------------------------
+
+
+class BenchCase
+{
+public:
+	std::string Name;
+	size_t BytesPerOp;
+	
+	BenchCase( std::string name, size_t bytes_per_op = 0 )
+	{
+		Name = name;
+		BytesPerOp = bytes_per_op;
+	}
+	
+	virtual ~BenchCase()
+	{
+	}
+	
+	virtual bool Setup( void )
+	{
+		return true;
+	}
+	
+	virtual void Run( size_t iterations ) = 0;
+	
+	virtual void Teardown( void )
+	{
+	}
+};
+
+
+class BenchResult
+{
+public:
+	std::string Name;
+	size_t Iterations, Samples, BytesPerOp;
+	double NSPerOp, MinNSPerOp, MaxNSPerOp;
+	
+	BenchResult( void )
+	{
+		Iterations = Samples = BytesPerOp = 0;
+		NSPerOp = MinNSPerOp = MaxNSPerOp = 0.;
+	}
+};
+
+
+static int64_t BenchTime( BenchCase *bench, size_t iterations )
+{
+	int64_t start = Clock::Now();
+	bench->Run( iterations );
+	return Clock::Now() - start;
+}
+
+
+// Pick an iteration count filling a sample, then report the median/min/max of repeated samples.
+static BenchResult BenchMeasure( BenchCase *bench, double seconds )
+{
+	const size_t min_samples = 3, max_samples = 15;
+	int64_t sample_ns = (int64_t)( seconds * CLOCK_NS_PER_SEC / max_samples );
+	
+	BenchResult result;
+	result.Name = bench->Name;
+	result.BytesPerOp = bench->BytesPerOp;
+	
+	size_t iterations = 1;
+	int64_t elapsed = BenchTime( bench, iterations );
+	while( elapsed < sample_ns )
+	{
+		double scale = elapsed ? std::min<double>( 100., sample_ns * 1.2 / elapsed ) : 100.;
+		iterations = std::max<size_t>( iterations + 1, (size_t)( iterations * scale ) );
+		elapsed = BenchTime( bench, iterations );
+	}
+	
+	std::vector<double> ns_per_op;
+	int64_t total_ns = 0;
+	while( (ns_per_op.size() < min_samples) || ((ns_per_op.size() < max_samples) && (total_ns < seconds * CLOCK_NS_PER_SEC)) )
+	{
+		elapsed = BenchTime( bench, iterations );
+		total_ns += elapsed;
+		ns_per_op.push_back( elapsed / (double) iterations );
+	}
+	
+	std::sort( ns_per_op.begin(), ns_per_op.end() );
+	result.Iterations = iterations;
+	result.Samples = ns_per_op.size();
+	result.NSPerOp = ns_per_op[ ns_per_op.size() / 2 ];
+	result.MinNSPerOp = ns_per_op.front();
+	result.MaxNSPerOp = ns_per_op.back();
+	return result;
+}
+
+
+static void BenchWriteJSON( FILE *out, const std::vector<BenchResult> &results, double seconds )
+{
+	fprintf( out, "{\n\t\"suite\": \"RaptorBench\",\n\t\"timestamp\": %lli,\n\t\"seconds_per_case\": %.3f,\n\t\"results\": [", (long long) time(NULL), seconds );
+	
+	for( std::vector<BenchResult>::const_iterator result_iter = results.begin(); result_iter != results.end(); result_iter ++ )
+	{
+		fprintf( out, "%s\n\t\t{ \"name\": \"%s\", \"iterations\": %i, \"samples\": %i, \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, \"max_ns_per_op\": %.3f",
+			(result_iter == results.begin()) ? "" : ",", result_iter->Name.c_str(), (int) result_iter->Iterations, (int) result_iter->Samples,
+			result_iter->NSPerOp, result_iter->MinNSPerOp, result_iter->MaxNSPerOp );
+		if( result_iter->BytesPerOp && result_iter->NSPerOp )
+			fprintf( out, ", \"bytes_per_op\": %i, \"mb_per_sec\": %.3f", (int) result_iter->BytesPerOp, result_iter->BytesPerOp * 1000. / result_iter->NSPerOp );
+		fprintf( out, " }" );
+	}
+	
+	fprintf( out, "\n\t]\n}\n" );
+}
+
+
+// ---------------------------------------------------------------------------
+// Net
+
+
+// Roughly what one object contributes to an update packet.
+static void BenchAddObject( Packet *packet, uint32_t id )
+{
+	packet->AddUInt( id );
+	packet->AddDouble( id * 1.5 );
+	packet->AddDouble( id * -2.25 );
+	packet->AddDouble( 1000. + id );
+	packet->AddFloat( 0.6f );
+	packet->AddFloat( 0.8f );
+	packet->AddFloat( 0.f );
+	packet->AddFloat( 0.f );
+	packet->AddFloat( 0.f );
+	packet->AddFloat( 1.f );
+	packet->AddUShort( id & 0xFFFF );
+	packet->AddString( "Bench" );
+}
+
+
+class PacketEncodeBench : public BenchCase
+{
+public:
+	Packet Built;
+	
+	PacketEncodeBench( void ) : BenchCase( "Packet.encode.64_objects" ), Built( PACKET_DEFAULT_TYPE )
+	{
+	}
+	
+	void Run( size_t iterations )
+	{
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			Built.Clear( PACKET_DEFAULT_TYPE );
+			Built.AddUInt( 64 );
+			for( uint32_t id = 1; id <= 64; id ++ )
+				BenchAddObject( &Built, id );
+		}
+		BytesPerOp = Built.Size();
+		BenchSink += Built.Size();
+	}
+};
+
+
+class PacketDecodeBench : public BenchCase
+{
+public:
+	Packet Built;
+	
+	PacketDecodeBench( void ) : BenchCase( "Packet.decode.64_objects" ), Built( PACKET_DEFAULT_TYPE )
+	{
+		Built.AddUInt( 64 );
+		for( uint32_t id = 1; id <= 64; id ++ )
+			BenchAddObject( &Built, id );
+		BytesPerOp = Built.Size();
+	}
+	
+	void Run( size_t iterations )
+	{
+		uint64_t sum = 0;
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			Built.Rewind();
+			uint32_t count = Built.NextUInt();
+			for( uint32_t obj = 0; obj < count; obj ++ )
+			{
+				sum += Built.NextUInt();
+				sum += (uint64_t)( Built.NextDouble() + Built.NextDouble() + Built.NextDouble() );
+				for( int f = 0; f < 6; f ++ )
+					sum += (uint64_t) Built.NextFloat();
+				sum += Built.NextUShort();
+				sum += strlen( Built.NextString() );
+			}
+		}
+		BenchSink += sum;
+	}
+};
+
+
+// Framing a stream of mixed-size packets that arrives split at arbitrary points.
+class PacketBufferBench : public BenchCase
+{
+public:
+	std::vector<uint8_t> Stream;
+	size_t ChunkSize;
+	
+	PacketBufferBench( std::string name, size_t chunk_size ) : BenchCase( name )
+	{
+		ChunkSize = chunk_size;
+	}
+	
+	bool Setup( void )
+	{
+		Rand::Seed( 1 );
+		for( int i = 0; i < 128; i ++ )
+		{
+			Packet packet( PACKET_DEFAULT_TYPE );
+			int objects = Rand::Int( 0, 24 );
+			for( int obj = 0; obj < objects; obj ++ )
+				BenchAddObject( &packet, obj );
+			Stream.insert( Stream.end(), packet.Data, packet.Data + packet.Size() );
+		}
+		BytesPerOp = Stream.size();
+		return true;
+	}
+	
+	void Run( size_t iterations )
+	{
+		PacketBuffer buffer;
+		uint64_t sum = 0;
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			for( size_t offset = 0; offset < Stream.size(); offset += ChunkSize )
+				buffer.AddData( &(Stream[ offset ]), std::min<size_t>( ChunkSize, Stream.size() - offset ) );
+			
+			while( Packet *packet = buffer.Pop() )
+			{
+				sum += packet->Size();
+				delete packet;
+			}
+		}
+		BenchSink += sum;
+	}
+};
+
+
+// A large object list like the initial game state, which is what packet compression is for.
+static void BenchBuildObjectList( Packet *packet )
+{
+	packet->AddUInt( 512 );
+	for( uint32_t id = 1; id <= 512; id ++ )
+		BenchAddObject( packet, id );
+}
+
+
+class PacketCompressBench : public BenchCase
+{
+public:
+	Packet Built;
+	
+	PacketCompressBench( void ) : BenchCase( "Packet.compress.512_objects" ), Built( PACKET_DEFAULT_TYPE )
+	{
+		BenchBuildObjectList( &Built );
+		BytesPerOp = Built.Size();
+	}
+	
+	void Run( size_t iterations )
+	{
+		uint64_t sum = 0;
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			Packet *compressed = Built.Compress();
+			if( compressed )
+			{
+				sum += compressed->Size();
+				delete compressed;
+			}
+		}
+		BenchSink += sum;
+	}
+};
+
+
+class PacketDecompressBench : public BenchCase
+{
+public:
+	Packet *Compressed;
+	
+	PacketDecompressBench( void ) : BenchCase( "Packet.decompress.512_objects" )
+	{
+		Compressed = NULL;
+	}
+	
+	bool Setup( void )
+	{
+		Packet built( PACKET_DEFAULT_TYPE );
+		BenchBuildObjectList( &built );
+		BytesPerOp = built.Size();
+		Compressed = built.Compress();
+		return Compressed;
+	}
+	
+	void Run( size_t iterations )
+	{
+		uint64_t sum = 0;
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			Packet packet( Compressed );
+			if( packet.Decompress() )
+				sum += packet.Size();
+		}
+		BenchSink += sum;
+	}
+	
+	void Teardown( void )
+	{
+		delete Compressed;
+		Compressed = NULL;
+	}
+};
+
+
+class SchemaBench : public BenchCase
+{
+public:
+	bool Reading;
+	int8_t Precision;
+	std::vector<GameObject> Objects;
+	Packet Built;
+	
+	SchemaBench( std::string name, bool reading, int8_t precision ) : BenchCase( name ), Built( PACKET_DEFAULT_TYPE )
+	{
+		Reading = reading;
+		Precision = precision;
+	}
+	
+	bool Setup( void )
+	{
+		Rand::Seed( 1 );
+		Objects.resize( 64 );
+		for( std::vector<GameObject>::iterator obj_iter = Objects.begin(); obj_iter != Objects.end(); obj_iter ++ )
+		{
+			obj_iter->SetPos( Rand::Double( -10000., 10000. ), Rand::Double( -10000., 10000. ), Rand::Double( -10000., 10000. ) );
+			obj_iter->Yaw( Rand::Double( 360. ) );
+			obj_iter->Pitch( Rand::Double( 360. ) );
+			obj_iter->MotionVector.Set( Rand::Double( -100., 100. ), Rand::Double( -100., 100. ), Rand::Double( -100., 100. ) );
+			obj_iter->RollRate = Rand::Double( -90., 90. );
+		}
+		
+		for( std::vector<GameObject>::const_iterator obj_iter = Objects.begin(); obj_iter != Objects.end(); obj_iter ++ )
+			GameObject::UpdateFields.Write( &*obj_iter, &Built, Precision );
+		BytesPerOp = Built.Size() - PACKET_HEADER_SIZE;
+		return true;
+	}
+	
+	void Run( size_t iterations )
+	{
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			if( Reading )
+			{
+				Built.Rewind();
+				for( std::vector<GameObject>::iterator obj_iter = Objects.begin(); obj_iter != Objects.end(); obj_iter ++ )
+					GameObject::UpdateFields.Read( &*obj_iter, &Built, Precision );
+			}
+			else
+			{
+				Built.Clear( PACKET_DEFAULT_TYPE );
+				for( std::vector<GameObject>::const_iterator obj_iter = Objects.begin(); obj_iter != Objects.end(); obj_iter ++ )
+					GameObject::UpdateFields.Write( &*obj_iter, &Built, Precision );
+			}
+		}
+		BenchSink += Built.Size() + (uint64_t) Objects.front().X;
+	}
+};
+
+
+// ---------------------------------------------------------------------------
+// Math
+
+
+class BlockMapIndexBench : public BenchCase
+{
+public:
+	std::vector<Vec3D> Points;
+	
+	BlockMapIndexBench( void ) : BenchCase( "Math3D.BlockMapIndex.1024" )
+	{
+	}
+	
+	bool Setup( void )
+	{
+		Rand::Seed( 1 );
+		for( int i = 0; i < 1024; i ++ )
+			Points.push_back( Vec3D( Rand::Double( -5000., 5000. ), Rand::Double( -5000., 5000. ), Rand::Double( -5000., 5000. ) ) );
+		return true;
+	}
+	
+	void Run( size_t iterations )
+	{
+		uint64_t sum = 0;
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			for( std::vector<Vec3D>::const_iterator pt_iter = Points.begin(); pt_iter != Points.end(); pt_iter ++ )
+				sum += Math3D::BlockMapIndex( pt_iter->X, pt_iter->Y, pt_iter->Z, 64. );
+		}
+		BenchSink += sum;
+	}
+};
+
+
+class BlocksInBench : public BenchCase
+{
+public:
+	enum { RADIUS, LINE, TRIANGLE };
+	int Shape;
+	std::set<uint64_t> Blocks;
+	
+	BlocksInBench( std::string name, int shape ) : BenchCase( name )
+	{
+		Shape = shape;
+	}
+	
+	void Run( size_t iterations )
+	{
+		uint64_t sum = 0;
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			Blocks.clear();
+			double offset = (i % 16) * 0.37;
+			if( Shape == RADIUS )
+				Math3D::BlocksInRadius( &Blocks, offset, -offset, 10., 8., 40. );
+			else if( Shape == LINE )
+				Math3D::BlocksInLine( &Blocks, offset, 0., -offset, 300. + offset, 170., 95., 8. );
+			else
+				Math3D::BlocksInTriangle( &Blocks, offset, 0., 0., 120., offset, 30., 40., 90., -offset, 8. );
+			sum += Blocks.size();
+		}
+		BenchSink += sum;
+	}
+};
+
+
+class RotateBench : public BenchCase
+{
+public:
+	enum { VEC_ROTATE_AROUND, POS_YAW_PITCH_ROLL, POS_ROTATE_AROUND };
+	int Kind;
+	
+	RotateBench( std::string name, int kind ) : BenchCase( name )
+	{
+		Kind = kind;
+	}
+	
+	void Run( size_t iterations )
+	{
+		Vec3D vec( 1., 2., 3. );
+		Vec3D axis( 0.3, -0.5, 0.8 );
+		axis.ScaleTo( 1. );
+		Pos3D pos;
+		
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			if( Kind == VEC_ROTATE_AROUND )
+				vec.RotateAround( &axis, 1.5 );
+			else if( Kind == POS_YAW_PITCH_ROLL )
+			{
+				pos.Yaw( 1.5 );
+				pos.Pitch( 0.5 );
+				pos.Roll( -1. );
+			}
+			else
+				pos.RotateAround( &axis, 1.5 );
+		}
+		
+		BenchSink += (uint64_t)( 1000. * (vec.X + pos.Fwd.X + 3.) );
+	}
+};
+
+
+// ---------------------------------------------------------------------------
+// Models
+
+
+// Write a UV sphere as an OBJ without material libraries, so loading needs no resource manager.
+static bool BenchWriteSphereOBJ( const char *filename, int segments, int rings, double radius )
+{
+	FILE *out = fopen( filename, "wb" );
+	if( ! out )
+	{
+		fprintf( stderr, "BenchWriteSphereOBJ: Couldn't write %s\n", filename );
+		return false;
+	}
+	
+	fprintf( out, "o Sphere\nusemtl Bench\n" );
+	for( int ring = 0; ring <= rings; ring ++ )
+	{
+		double lat = M_PI * ring / rings - M_PI / 2.;
+		for( int seg = 0; seg < segments; seg ++ )
+		{
+			double lon = 2. * M_PI * seg / segments;
+			fprintf( out, "v %.6f %.6f %.6f\n", radius * cos(lat) * cos(lon), radius * cos(lat) * sin(lon), radius * sin(lat) );
+		}
+	}
+	
+	for( int ring = 0; ring < rings; ring ++ )
+	{
+		for( int seg = 0; seg < segments; seg ++ )
+		{
+			int a = ring * segments + seg + 1;
+			int b = ring * segments + (seg + 1) % segments + 1;
+			int c = a + segments;
+			int d = b + segments;
+			fprintf( out, "f %i %i %i\nf %i %i %i\n", a, b, d, a, d, c );
+		}
+	}
+	
+	fclose( out );
+	return true;
+}
+
+
+class ModelLoadBench : public BenchCase
+{
+public:
+	int Segments, Rings;
+	bool Optimize;
+	
+	ModelLoadBench( std::string name, int segments, int rings, bool optimize ) : BenchCase( name )
+	{
+		Segments = segments;
+		Rings = rings;
+		Optimize = optimize;
+	}
+	
+	bool Setup( void )
+	{
+		return BenchWriteSphereOBJ( BENCH_MESH_FILENAME, Segments, Rings, 10. );
+	}
+	
+	void Run( size_t iterations )
+	{
+		uint64_t sum = 0;
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			Model model;
+			model.LoadOBJ( BENCH_MESH_FILENAME, false );
+			if( Optimize )
+				model.Optimize();
+			sum += model.Objects.size();
+		}
+		BenchSink += sum;
+	}
+	
+	void Teardown( void )
+	{
+		remove( BENCH_MESH_FILENAME );
+	}
+};
+
+
+class ModelCollideBench : public BenchCase
+{
+public:
+	Model Sphere1, Sphere2;
+	Pos3D Pos1, Pos2;
+	double Offset;
+	
+	ModelCollideBench( std::string name, double offset ) : BenchCase( name )
+	{
+		Offset = offset;
+	}
+	
+	bool Setup( void )
+	{
+		if( ! BenchWriteSphereOBJ( BENCH_MESH_FILENAME, 32, 16, 10. ) )
+			return false;
+		bool loaded = Sphere1.LoadOBJ( BENCH_MESH_FILENAME, false );
+		remove( BENCH_MESH_FILENAME );
+		if( ! loaded )
+			return false;
+		
+		// The second sphere is smaller, so an offset of 0 nests it inside without touching any faces.
+		Sphere2.BecomeCopy( &Sphere1 );
+		Sphere2.ScaleBy( 0.8 );
+		Pos2.SetPos( Offset, 0., 0. );
+		Pos2.Yaw( 30. );
+		return true;
+	}
+	
+	void Run( size_t iterations )
+	{
+		uint64_t sum = 0;
+		Pos3D at;
+		for( size_t i = 0; i < iterations; i ++ )
+			sum += Sphere1.CollidesWithModel( &Pos1, &at, NULL, NULL, 0., 0, &Sphere2, &Pos2, NULL, NULL, 0., 0 ) ? 1 : 0;
+		BenchSink += sum;
+	}
+};
+
+
+// Queues a field of instances spread across a few models and LOD levels, then clears for the next frame.
+class ModelQueueBench : public BenchCase
+{
+public:
+	Model Spheres[ 4 ];
+	std::vector<Pos3D> Positions;
+	ModelQueue Queue;
+	
+	ModelQueueBench( std::string name, size_t instances ) : BenchCase( name )
+	{
+		Positions.resize( instances );
+	}
+	
+	bool Setup( void )
+	{
+		if( ! BenchWriteSphereOBJ( BENCH_MESH_FILENAME, 32, 16, 10. ) )
+			return false;
+		bool loaded = Spheres[ 0 ].LoadOBJ( BENCH_MESH_FILENAME, false );
+		remove( BENCH_MESH_FILENAME );
+		if( ! loaded )
+			return false;
+		Spheres[ 0 ].MakeLODs();
+		for( int i = 1; i < 4; i ++ )
+			Spheres[ i ].BecomeInstance( &(Spheres[ 0 ]) );
+		
+		for( size_t i = 0; i < Positions.size(); i ++ )
+		{
+			Positions[ i ].SetPos( (i % 32) * 30., ((i / 32) % 32) * 30., (i / 1024) * 30. );
+			Positions[ i ].Yaw( i * 7. );
+		}
+		return true;
+	}
+	
+	void Run( size_t iterations )
+	{
+		uint64_t sum = 0;
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			for( size_t j = 0; j < Positions.size(); j ++ )
+				Queue.AddInstance( NULL, &(Spheres[ j % 4 ]), (j / 4) % 3, &(Positions[ j ]) );
+			sum += Queue.Groups.size();
+			Queue.Clear();
+		}
+		BenchSink += sum;
+	}
+};
+
+
+// ---------------------------------------------------------------------------
+// Game data
+
+
+#define BENCH_OBJECT_RADIUS 5.
+
+class BenchObject : public GameObject
+{
+public:
+	BenchObject( uint32_t id, uint32_t type_code ) : GameObject( id, type_code )
+	{
+	}
+	
+	bool CanCollideWithOwnType( void ) const
+	{
+		return true;
+	}
+	
+	bool CanCollideWithOtherTypes( void ) const
+	{
+		return true;
+	}
+	
+	bool WillCollide( const GameObject *other, double dt, std::string *this_object, std::string *other_object, Pos3D *loc, double *when ) const
+	{
+		return Math3D::MinimumDistance( this, &MotionVector, other, &(other->MotionVector), dt ) < BENCH_OBJECT_RADIUS * 2.;
+	}
+};
+
+
+// Objects spread so density stays the same at every count, like a larger battle rather than a more crowded one.
+class CheckCollisionsBench : public BenchCase
+{
+public:
+	GameData Data;
+	int Count;
+	
+	CheckCollisionsBench( std::string name, int count ) : BenchCase( name )
+	{
+		Count = count;
+	}
+	
+	bool Setup( void )
+	{
+		Rand::Seed( 1 );
+		double extent = 100. * pow( Count, 1. / 3. );
+		
+		// Inserted directly, as GameData::AddObject also does client-side setup that expects a running game.
+		for( int i = 1; i <= Count; i ++ )
+		{
+			BenchObject *obj = new BenchObject( i, (i % 4) ? 'BAst' : 'BShp' );
+			obj->Data = &Data;
+			obj->SetPos( Rand::Double( -extent, extent ), Rand::Double( -extent, extent ), Rand::Double( -extent, extent ) );
+			obj->MotionVector.Set( Rand::Double( -50., 50. ), Rand::Double( -50., 50. ), Rand::Double( -50., 50. ) );
+			Data.GameObjects[ obj->ID ] = obj;
+		}
+		return true;
+	}
+	
+	void Run( size_t iterations )
+	{
+		uint64_t sum = 0;
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			Data.CheckCollisions( 0.02 );
+			sum += Data.Collisions.size();
+		}
+		BenchSink += sum;
+	}
+	
+	void Teardown( void )
+	{
+		for( std::map<uint32_t,GameObject*>::iterator obj_iter = Data.GameObjects.begin(); obj_iter != Data.GameObjects.end(); obj_iter ++ )
+			delete obj_iter->second;
+		Data.GameObjects.clear();
+		Data.Collisions.clear();
+	}
+};
+
+
+// ---------------------------------------------------------------------------
+// Sound
+
+
+// One 20ms voice frame at 48kHz.
+#define BENCH_VOICE_SAMPLES 960
+
+static void BenchBuildVoice( int16_t *samples )
+{
+	Rand::Seed( 1 );
+	for( size_t i = 0; i < BENCH_VOICE_SAMPLES; i ++ )
+		samples[ i ] = (int16_t)( 8000. * sin( i * 0.07 ) + 3000. * sin( i * 0.31 ) + Rand::Int( -500, 500 ) );
+}
+
+
+class IMABench : public BenchCase
+{
+public:
+	enum { ENCODE_BUFFER, DECODE_BUFFER, CODEC_ENCODE, CODEC_DECODE };
+	int Kind;
+	int16_t Samples[ BENCH_VOICE_SAMPLES ];
+	uint8_t Encoded[ BENCH_VOICE_SAMPLES / 2 ];
+	IMACodec Codec;
+	
+	IMABench( std::string name, int kind ) : BenchCase( name, BENCH_VOICE_SAMPLES * sizeof(int16_t) )
+	{
+		Kind = kind;
+	}
+	
+	bool Setup( void )
+	{
+		BenchBuildVoice( Samples );
+		IMA::EncodeBuffer( Samples, Encoded, BENCH_VOICE_SAMPLES );
+		return true;
+	}
+	
+	void Run( size_t iterations )
+	{
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			if( Kind == ENCODE_BUFFER )
+				IMA::EncodeBuffer( Samples, Encoded, BENCH_VOICE_SAMPLES );
+			else if( Kind == DECODE_BUFFER )
+				IMA::DecodeBuffer( Encoded, Samples, BENCH_VOICE_SAMPLES );
+			else if( Kind == CODEC_ENCODE )
+				Codec.Encode( Samples, BENCH_VOICE_SAMPLES, Encoded );
+			else
+				Codec.Decode( Encoded, sizeof(Encoded), Samples, BENCH_VOICE_SAMPLES );
+		}
+		BenchSink += Encoded[ 7 ] + Samples[ 7 ];
+	}
+};
+
+
+// ---------------------------------------------------------------------------
+// Random numbers
+
+
+class RandBench : public BenchCase
+{
+public:
+	enum { UINT64, DOUBLE, FILL };
+	int Kind;
+	uint64_t Values[ 1024 ];
+	
+	RandBench( std::string name, int kind ) : BenchCase( name, sizeof(Values) )
+	{
+		Kind = kind;
+	}
+	
+	bool Setup( void )
+	{
+		Rand::Seed( 1 );
+		return true;
+	}
+	
+	void Run( size_t iterations )
+	{
+		uint64_t sum = 0;
+		for( size_t i = 0; i < iterations; i ++ )
+		{
+			if( Kind == UINT64 )
+			{
+				for( size_t n = 0; n < 1024; n ++ )
+					sum += Rand::UInt64();
+			}
+			else if( Kind == DOUBLE )
+			{
+				for( size_t n = 0; n < 1024; n ++ )
+					sum += (uint64_t)( Rand::Double() * 1000. );
+			}
+			else
+			{
+				Rand::Fill( Values, 1024 );
+				sum += Values[ i % 1024 ];
+			}
+		}
+		BenchSink += sum;
+	}
+};
+
+
+// ---------------------------------------------------------------------------
+
+
+int main( int argc, char **argv )
+{
+	const char *output_filename = NULL;
+	double seconds = 1.;
+	std::vector<std::string> filters;
+	
+	for( int i = 1; i < argc; i ++ )
+	{
+		if( (strcmp( argv[ i ], "-o" ) == 0) && (i + 1 < argc) )
+			output_filename = argv[ ++ i ];
+		else if( (strcmp( argv[ i ], "-t" ) == 0) && (i + 1 < argc) )
+			seconds = std::max<double>( 0.01, atof( argv[ ++ i ] ) );
+		else
+			filters.push_back( argv[ i ] );
+	}
+	
+	std::vector<BenchCase*> benches;
+	benches.push_back( new PacketEncodeBench() );
+	benches.push_back( new PacketDecodeBench() );
+	benches.push_back( new PacketBufferBench( "PacketBuffer.AddData.chunk_1400", 1400 ) );
+	benches.push_back( new PacketBufferBench( "PacketBuffer.AddData.chunk_7", 7 ) );
+	benches.push_back( new PacketCompressBench() );
+	benches.push_back( new PacketDecompressBench() );
+	benches.push_back( new SchemaBench( "NetSchema.write.64_objects", false, 0 ) );
+	benches.push_back( new SchemaBench( "NetSchema.read.64_objects", true, 0 ) );
+	benches.push_back( new BlockMapIndexBench() );
+	benches.push_back( new BlocksInBench( "Math3D.BlocksInRadius", BlocksInBench::RADIUS ) );
+	benches.push_back( new BlocksInBench( "Math3D.BlocksInLine", BlocksInBench::LINE ) );
+	benches.push_back( new BlocksInBench( "Math3D.BlocksInTriangle", BlocksInBench::TRIANGLE ) );
+	benches.push_back( new RotateBench( "Vec3D.RotateAround", RotateBench::VEC_ROTATE_AROUND ) );
+	benches.push_back( new RotateBench( "Pos3D.YawPitchRoll", RotateBench::POS_YAW_PITCH_ROLL ) );
+	benches.push_back( new RotateBench( "Pos3D.RotateAround", RotateBench::POS_ROTATE_AROUND ) );
+	benches.push_back( new ModelLoadBench( "Model.LoadOBJ.sphere_4k", 64, 32, false ) );
+	benches.push_back( new ModelLoadBench( "Model.LoadOBJ+Optimize.sphere_1k", 32, 16, true ) );
+	benches.push_back( new ModelCollideBench( "Model.CollidesWithModel.hit", 12. ) );
+	benches.push_back( new ModelCollideBench( "Model.CollidesWithModel.nested_miss", 0. ) );
+	benches.push_back( new ModelQueueBench( "ModelQueue.AddInstance.1k", 1000 ) );
+	benches.push_back( new CheckCollisionsBench( "GameData.CheckCollisions.100", 100 ) );
+	benches.push_back( new CheckCollisionsBench( "GameData.CheckCollisions.1k", 1000 ) );
+	benches.push_back( new CheckCollisionsBench( "GameData.CheckCollisions.10k", 10000 ) );
+	benches.push_back( new IMABench( "IMA.EncodeBuffer.960", IMABench::ENCODE_BUFFER ) );
+	benches.push_back( new IMABench( "IMA.DecodeBuffer.960", IMABench::DECODE_BUFFER ) );
+	benches.push_back( new IMABench( "IMACodec.Encode.960", IMABench::CODEC_ENCODE ) );
+	benches.push_back( new IMABench( "IMACodec.Decode.960", IMABench::CODEC_DECODE ) );
+	benches.push_back( new RandBench( "Rand.UInt64.1024", RandBench::UINT64 ) );
+	benches.push_back( new RandBench( "Rand.Double.1024", RandBench::DOUBLE ) );
+	benches.push_back( new RandBench( "Rand.Fill.1024", RandBench::FILL ) );
+	
+	std::vector<BenchResult> results;
+	int failed = 0;
+	
+	for( std::vector<BenchCase*>::iterator bench_iter = benches.begin(); bench_iter != benches.end(); bench_iter ++ )
+	{
+		BenchCase *bench = *bench_iter;
+		
+		bool selected = filters.empty();
+		for( std::vector<std::string>::const_iterator filter_iter = filters.begin(); filter_iter != filters.end(); filter_iter ++ )
+		{
+			if( bench->Name.find( *filter_iter ) != std::string::npos )
+				selected = true;
+		}
+		
+		if( selected )
+		{
+			if( bench->Setup() )
+			{
+				results.push_back( BenchMeasure( bench, seconds ) );
+				fprintf( stderr, "%-40s %14.1f ns/op\n", bench->Name.c_str(), results.back().NSPerOp );
+			}
+			else
+			{
+				fprintf( stderr, "%-40s setup failed\n", bench->Name.c_str() );
+				failed ++;
+			}
+			bench->Teardown();
+		}
+		
+		delete bench;
+	}
+	
+	FILE *out = stdout;
+	if( output_filename )
+	{
+		out = fopen( output_filename, "wb" );
+		if( ! out )
+		{
+			fprintf( stderr, "RaptorBench: Couldn't write %s\n", output_filename );
+			return 1;
+		}
+	}
+	
+	BenchWriteJSON( out, results, seconds );
+	
+	if( out != stdout )
+		fclose( out );
+	
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,574 @@
+/*
+ *  RaptorLoadTest.cpp
+ */
+
+// Headless load test for a running server: connects many simulated clients over TCP, and each logs in,
+// consumes what the server sends, and sends periodic UPDATE, PING, and VOICE packets.
+// Bots own no game objects, so their UPDATE packets list none; the server still parses and handles them.
+//
+// Build: compile this file with Libs (Clock, Endian, LZ, Mutex, Num, Rand, RandomEngine, Str), Net (Packet,
+// PacketBuffer), and Sound (IMA, IMACodec, VoiceCodec), linking only SDL and SDL_net.  No video, audio, or GL.
+//
+// Usage: RaptorLoadTest host[:port] game version [-n bots] [-t seconds] [-r connects_per_sec]
+//                       [-u updates_per_sec] [-p pings_per_sec] [-v voice_interval_sec] [-o results.json] [-z]
+// -z disables packet compression.  Results are written as JSON (to stdout unless -o is given).
+//
+// The server is a black box here, so its tick time is reported as the interval between UPDATE packets each
+// bot receives, and queue depth as how many complete packets were waiting in a bot's socket at once.
+
+#include "PlatformSpecific.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdint.h>
+
+#ifdef SDL2
+	#include <SDL2/SDL.h>
+	#include <SDL2/SDL_net.h>
+#else
+	#include <SDL/SDL.h>
+	#ifdef __APPLE__
+		#include <SDL_net/SDL_net.h>
+	#else
+		#include <SDL/SDL_net.h>
+	#endif
+#endif
+
+#include "RaptorDefs.h"
+#include "Packet.h"
+#include "PacketBuffer.h"
+#include "Clock.h"
+#include "Rand.h"
+#include "Num.h"
+#include "IMACodec.h"
+#include "VoiceCodec.h"
+
+
+#define LOADTEST_VOICE_RATE     22050
+#define LOADTEST_VOICE_SAMPLES  4410
+
+
+class LoadTestSettings
+{
+public:
+	std::string Host, Game, Version;
+	int Port;
+	int Bots;
+	double Seconds, ConnectRate, UpdateRate, PingRate, VoiceInterval;
+	bool Compress;
+	const char *OutputFilename;
+	
+	LoadTestSettings( void )
+	{
+		Port = 7000;
+		Bots = 100;
+		Seconds = 60.;
+		ConnectRate = 50.;
+		UpdateRate = 30.;
+		PingRate = 4.;
+		VoiceInterval = 5.;
+		Compress = true;
+		OutputFilename = NULL;
+	}
+};
+
+
+// ---------------------------------------------------------------------------
+
+
+class LoadTestBot
+{
+public:
+	int Index;
+	TCPsocket Socket;
+	SDLNet_SocketSet SocketSet;
+	bool Connected;
+	uint16_t PlayerID;
+	std::string DisconnectMessage;
+	PacketBuffer Buffer;
+	PacketCompressionStats DecompressStats;
+	
+	Clock ConnectedClock, UpdateClock, PingClock, VoiceClock, ReceivedUpdateClock;
+	double UpdateOffset, VoiceOffset;
+	bool ReceivedUpdate;
+	double ConnectedSeconds;
+	
+	uint64_t BytesSent, BytesReceived;
+	uint64_t UpdatesReceived, ObjectsAdded, VoiceReceived, VoiceSent;
+	std::map<uint8_t,Clock> SentPings;
+	std::vector<double> PingTimes, UpdateIntervals, Backlogs;
+	
+	
+	LoadTestBot( int index )
+	{
+		Index = index;
+		Socket = NULL;
+		SocketSet = NULL;
+		Connected = false;
+		PlayerID = 0;
+		Buffer.DecompressStats = &DecompressStats;
+		UpdateOffset = VoiceOffset = 0.;
+		ReceivedUpdate = false;
+		ConnectedSeconds = 0.;
+		BytesSent = BytesReceived = 0;
+		UpdatesReceived = ObjectsAdded = VoiceReceived = VoiceSent = 0;
+	}
+	
+	~LoadTestBot()
+	{
+		Close();
+	}
+	
+	
+	bool Connect( IPaddress *ip, SDLNet_SocketSet socket_set, const LoadTestSettings *settings )
+	{
+		if( !( Socket = SDLNet_TCP_Open( ip ) ) )
+		{
+			DisconnectMessage = std::string("SDLNet_TCP_Open: ") + std::string(SDLNet_GetError());
+			return false;
+		}
+		
+		SocketSet = socket_set;
+		SDLNet_TCP_AddSocket( SocketSet, Socket );
+		
+		Connected = true;
+		ConnectedClock.Reset();
+		
+		// Stagger each bot's timers so they don't all send on the same tick.
+		UpdateOffset = Rand::Double( 0., 1. / settings->UpdateRate );
+		VoiceOffset = Rand::Double( 0., settings->VoiceInterval );
+		UpdateClock.Reset();
+		PingClock.Reset();
+		VoiceClock.Reset();
+		
+		char name[ 32 ] = "";
+		snprintf( name, sizeof(name), "Bot%03i", Index );
+		
+		Packet login( Raptor::Packet::LOGIN );
+		login.AddString( settings->Game );
+		login.AddString( settings->Version );
+		login.AddString( name );
+		login.AddString( "" );
+		login.AddUChar( settings->Compress ? Raptor::Compression::LZ : Raptor::Compression::NONE );
+		login.AddUChar( Raptor::Protocol::VERSION );
+		return Send( &login );
+	}
+	
+	
+	void Close( void )
+	{
+		if( Connected )
+			ConnectedSeconds = ConnectedClock.ElapsedSeconds();
+		Connected = false;
+		
+		if( Socket )
+		{
+			if( SocketSet )
+				SDLNet_TCP_DelSocket( SocketSet, Socket );
+			SDLNet_TCP_Close( Socket );
+			Socket = NULL;
+		}
+	}
+	
+	
+	void Disconnect( const char *message )
+	{
+		if( ! Connected )
+			return;
+		
+		DisconnectMessage = message;
+		Close();
+	}
+	
+	
+	bool Send( Packet *packet )
+	{
+		if( ! Connected )
+			return false;
+		
+		int sent = 0;
+		while( sent < (int) packet->Size() )
+		{
+			int sent_now = SDLNet_TCP_Send( Socket, packet->Data + sent, packet->Size() - sent );
+			if( sent_now <= 0 )
+			{
+				Disconnect( (std::string("SDLNet_TCP_Send: ") + std::string(SDLNet_GetError())).c_str() );
+				return false;
+			}
+			sent += sent_now;
+			BytesSent += sent_now;
+		}
+		
+		return true;
+	}
+	
+	
+	void Receive( void )
+	{
+		char data[ PACKET_BUFFER_SIZE ] = "";
+		int size = SDLNet_TCP_Recv( Socket, data, PACKET_BUFFER_SIZE );
+		if( size <= 0 )
+		{
+			Disconnect( (size < 0) ? (std::string("SDLNet_TCP_Recv: ") + std::string(SDLNet_GetError())).c_str() : "Server closed the connection." );
+			return;
+		}
+		
+		BytesReceived += size;
+		Buffer.AddData( data, size );
+		
+		int backlog = 0;
+		while( Packet *packet = Buffer.Pop() )
+		{
+			backlog ++;
+			ProcessPacket( packet );
+			delete packet;
+		}
+		Backlogs.push_back( backlog );
+	}
+	
+	
+	void ProcessPacket( Packet *packet )
+	{
+		packet->Rewind();
+		PacketType type = packet->Type();
+		
+		if( type == Raptor::Packet::UPDATE )
+		{
+			UpdatesReceived ++;
+			if( ReceivedUpdate )
+				UpdateIntervals.push_back( ReceivedUpdateClock.ElapsedMilliseconds() );
+			ReceivedUpdateClock.Reset();
+			ReceivedUpdate = true;
+		}
+		
+		else if( type == Raptor::Packet::OBJECTS_ADD )
+			ObjectsAdded += packet->NextUInt();
+		
+		else if( type == Raptor::Packet::VOICE )
+			VoiceReceived ++;
+		
+		else if( type == Raptor::Packet::PING )
+		{
+			Packet pong( Raptor::Packet::PONG );
+			pong.AddUChar( packet->NextUChar() );
+			Send( &pong );
+		}
+		
+		else if( type == Raptor::Packet::PONG )
+		{
+			std::map<uint8_t,Clock>::iterator ping_iter = SentPings.find( packet->NextUChar() );
+			if( ping_iter != SentPings.end() )
+			{
+				PingTimes.push_back( ping_iter->second.ElapsedMilliseconds() );
+				SentPings.erase( ping_iter );
+			}
+		}
+		
+		else if( type == Raptor::Packet::LOGIN )
+			PlayerID = packet->NextUShort();
+		
+		else if( type == Raptor::Packet::DISCONNECT )
+			Disconnect( (std::string("Server: ") + std::string(packet->NextString())).c_str() );
+		
+		else if( type == Raptor::Packet::RECONNECT )
+			Disconnect( "Server asked clients to reconnect." );
+	}
+	
+	
+	void SendUpdates( const LoadTestSettings *settings, const IMACodec *voice_template, const uint8_t *voice_data, size_t voice_bytes )
+	{
+		if( !( Connected && PlayerID ) )
+			return;
+		
+		double update_elapsed = UpdateClock.ElapsedSeconds() - UpdateOffset;
+		if( update_elapsed >= 1. / settings->UpdateRate )
+		{
+			UpdateClock.Advance( update_elapsed );
+			UpdateOffset = 0.;
+			
+			Packet update( Raptor::Packet::UPDATE );
+			update.AddChar( 0 );
+			update.AddUInt( 0 );
+			Send( &update );
+		}
+		
+		double ping_elapsed = PingClock.ElapsedSeconds();
+		if( settings->PingRate && (ping_elapsed >= 1. / settings->PingRate) )
+		{
+			PingClock.Advance( ping_elapsed );
+			SendPing();
+		}
+		
+		double voice_elapsed = VoiceClock.ElapsedSeconds() - VoiceOffset;
+		if( settings->VoiceInterval && voice_data && (voice_elapsed >= settings->VoiceInterval) )
+		{
+			VoiceClock.Advance( voice_elapsed );
+			VoiceOffset = 0.;
+			
+			Packet voice( Raptor::Packet::VOICE );
+			voice.AddUShort( PlayerID );
+			voice.AddUInt( 0 );
+			voice.AddUChar( Raptor::VoiceChannel::ALL );
+			voice.AddUInt( VoiceCodec::PackRate( voice_template->ID, LOADTEST_VOICE_RATE ) );
+			voice.AddUInt( LOADTEST_VOICE_SAMPLES );
+			voice.AddData( voice_data, voice_bytes );
+			if( Send( &voice ) )
+				VoiceSent ++;
+		}
+	}
+	
+	
+	void SendPing( void )
+	{
+		for( int i = 0; i <= 255; i ++ )
+		{
+			if( SentPings.find( i ) == SentPings.end() )
+			{
+				SentPings[ i ].Reset();
+				
+				Packet ping( Raptor::Packet::PING );
+				ping.AddUChar( i );
+				Send( &ping );
+				return;
+			}
+		}
+	}
+	
+	
+	double Seconds( void ) const
+	{
+		return Connected ? ConnectedClock.ElapsedSeconds() : ConnectedSeconds;
+	}
+};
+
+
+// ---------------------------------------------------------------------------
+
+
+// Summarize as a JSON object, and print the same line to stderr.
+static std::string LoadTestDistribution( const char *name, std::vector<double> values )
+{
+	char cstr[ 1024 ] = "";
+	if( values.empty() )
+	{
+		snprintf( cstr, sizeof(cstr), "\"%s\": { \"count\": 0 }", name );
+		fprintf( stderr, "%-34s (none)\n", name );
+		return cstr;
+	}
+	
+	std::sort( values.begin(), values.end() );
+	size_t last = values.size() - 1;
+	double sum = 0.;
+	for( std::vector<double>::const_iterator value_iter = values.begin(); value_iter != values.end(); value_iter ++ )
+		sum += *value_iter;
+	
+	snprintf( cstr, sizeof(cstr), "\"%s\": { \"count\": %i, \"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f }",
+		name, (int) values.size(), sum / values.size(), values[ last / 2 ], values[ last * 95 / 100 ], values[ last * 99 / 100 ], values.back() );
+	fprintf( stderr, "%-34s n=%-8i mean %10.2f  50%% %10.2f  95%% %10.2f  99%% %10.2f  max %10.2f\n",
+		name, (int) values.size(), sum / values.size(), values[ last / 2 ], values[ last * 95 / 100 ], values[ last * 99 / 100 ], values.back() );
+	return cstr;
+}
+
+
+static bool LoadTestParseArgs( int argc, char **argv, LoadTestSettings *settings )
+{
+	std::vector<std::string> positional;
+	
+	for( int i = 1; i < argc; i ++ )
+	{
+		bool has_value = (i + 1 < argc);
+		if( (strcmp( argv[ i ], "-n" ) == 0) && has_value )
+			settings->Bots = std::max<int>( 1, atoi( argv[ ++ i ] ) );
+		else if( (strcmp( argv[ i ], "-t" ) == 0) && has_value )
+			settings->Seconds = atof( argv[ ++ i ] );
+		else if( (strcmp( argv[ i ], "-r" ) == 0) && has_value )
+			settings->ConnectRate = std::max<double>( 0.1, atof( argv[ ++ i ] ) );
+		else if( (strcmp( argv[ i ], "-u" ) == 0) && has_value )
+			settings->UpdateRate = std::max<double>( 0.1, atof( argv[ ++ i ] ) );
+		else if( (strcmp( argv[ i ], "-p" ) == 0) && has_value )
+			settings->PingRate = std::max<double>( 0., atof( argv[ ++ i ] ) );
+		else if( (strcmp( argv[ i ], "-v" ) == 0) && has_value )
+			settings->VoiceInterval = std::max<double>( 0., atof( argv[ ++ i ] ) );
+		else if( (strcmp( argv[ i ], "-o" ) == 0) && has_value )
+			settings->OutputFilename = argv[ ++ i ];
+		else if( strcmp( argv[ i ], "-z" ) == 0 )
+			settings->Compress = false;
+		else
+			positional.push_back( argv[ i ] );
+	}
+	
+	if( positional.size() != 3 )
+	{
+		fprintf( stderr, "Usage: %s host[:port] game version [-n bots] [-t seconds] [-r connects_per_sec] [-u updates_per_sec] [-p pings_per_sec] [-v voice_interval_sec] [-o results.json] [-z]\n", argv[ 0 ] );
+		return false;
+	}
+	
+	settings->Host = positional[ 0 ];
+	size_t colon = settings->Host.rfind( ':' );
+	if( colon != std::string::npos )
+	{
+		settings->Port = atoi( settings->Host.c_str() + colon + 1 );
+		settings->Host.erase( colon );
+	}
+	settings->Game = positional[ 1 ];
+	settings->Version = positional[ 2 ];
+	return true;
+}
+
+
+int main( int argc, char **argv )
+{
+	LoadTestSettings settings;
+	if( ! LoadTestParseArgs( argc, argv, &settings ) )
+		return 2;
+	
+	if( SDLNet_Init() < 0 )
+	{
+		fprintf( stderr, "SDLNet_Init: %s\n", SDLNet_GetError() );
+		return 1;
+	}
+	
+	IPaddress ip;
+	if( SDLNet_ResolveHost( &ip, settings.Host.c_str(), settings.Port ) < 0 )
+	{
+		fprintf( stderr, "SDLNet_ResolveHost: %s\n", SDLNet_GetError() );
+		SDLNet_Quit();
+		return 1;
+	}
+	
+	// Every bot sends the same encoded clip: a tone with some noise, so the codec has real work to do.
+	IMACodec codec;
+	std::vector<int16_t> voice_samples( LOADTEST_VOICE_SAMPLES );
+	std::vector<uint8_t> voice_data( codec.MaxEncodedBytes( LOADTEST_VOICE_SAMPLES ) );
+	for( size_t i = 0; i < voice_samples.size(); i ++ )
+		voice_samples[ i ] = (int16_t)( 6000. * sin( i * 0.05 ) + Rand::Int( -800, 800 ) );
+	size_t voice_bytes = codec.Encode( &(voice_samples[ 0 ]), voice_samples.size(), &(voice_data[ 0 ]) );
+	
+	std::vector<LoadTestBot*> bots;
+	SDLNet_SocketSet socket_set = SDLNet_AllocSocketSet( settings.Bots );
+	int failed_connects = 0;
+	
+	Clock run_clock, report_clock;
+	while( run_clock.ElapsedSeconds() < settings.Seconds )
+	{
+		// Ramp up gradually, like players arriving, rather than all at once.
+		while( ((int) bots.size() < settings.Bots) && (bots.size() < run_clock.ElapsedSeconds() * settings.ConnectRate + 1.) )
+		{
+			LoadTestBot *bot = new LoadTestBot( bots.size() + 1 );
+			bots.push_back( bot );
+			if( ! bot->Connect( &ip, socket_set, &settings ) )
+			{
+				failed_connects ++;
+				fprintf( stderr, "Bot%03i: %s\n", bot->Index, bot->DisconnectMessage.c_str() );
+			}
+		}
+		
+		if( SDLNet_CheckSockets( socket_set, 1 ) > 0 )
+		{
+			for( std::vector<LoadTestBot*>::iterator bot_iter = bots.begin(); bot_iter != bots.end(); bot_iter ++ )
+			{
+				LoadTestBot *bot = *bot_iter;
+				if( bot->Connected && SDLNet_SocketReady( bot->Socket ) )
+				{
+					bot->Receive();
+					if( ! bot->Connected )
+						fprintf( stderr, "Bot%03i disconnected: %s\n", bot->Index, bot->DisconnectMessage.c_str() );
+				}
+			}
+		}
+		
+		int connected = 0;
+		uint64_t bytes_in = 0, bytes_out = 0;
+		for( std::vector<LoadTestBot*>::iterator bot_iter = bots.begin(); bot_iter != bots.end(); bot_iter ++ )
+		{
+			(*bot_iter)->SendUpdates( &settings, &codec, voice_bytes ? &(voice_data[ 0 ]) : NULL, voice_bytes );
+			if( (*bot_iter)->Connected )
+				connected ++;
+			bytes_in += (*bot_iter)->BytesReceived;
+			bytes_out += (*bot_iter)->BytesSent;
+		}
+		
+		if( report_clock.ElapsedSeconds() >= 5. )
+		{
+			report_clock.Reset();
+			fprintf( stderr, "%5.0fs: %i/%i bots connected, %.1f MB in, %.1f MB out\n", run_clock.ElapsedSeconds(), connected, (int) bots.size(), bytes_in / 1048576., bytes_out / 1048576. );
+		}
+	}
+	
+	// Gather results before disconnecting, so bandwidth covers only the run.
+	std::vector<double> ping_times, update_intervals, backlogs, in_rates, out_rates;
+	uint64_t bytes_in = 0, bytes_out = 0, raw_in = 0, updates = 0, objects = 0, voice_sent = 0, voice_received = 0;
+	int connected = 0;
+	for( std::vector<LoadTestBot*>::iterator bot_iter = bots.begin(); bot_iter != bots.end(); bot_iter ++ )
+	{
+		LoadTestBot *bot = *bot_iter;
+		ping_times.insert( ping_times.end(), bot->PingTimes.begin(), bot->PingTimes.end() );
+		update_intervals.insert( update_intervals.end(), bot->UpdateIntervals.begin(), bot->UpdateIntervals.end() );
+		backlogs.insert( backlogs.end(), bot->Backlogs.begin(), bot->Backlogs.end() );
+		
+		double seconds = bot->Seconds();
+		if( seconds > 0. )
+		{
+			in_rates.push_back( bot->BytesReceived / seconds );
+			out_rates.push_back( bot->BytesSent / seconds );
+		}
+		
+		bytes_in += bot->BytesReceived;
+		bytes_out += bot->BytesSent;
+		raw_in += bot->BytesReceived + bot->DecompressStats.RawBytes - bot->DecompressStats.PackedBytes;
+		updates += bot->UpdatesReceived;
+		objects += bot->ObjectsAdded;
+		voice_sent += bot->VoiceSent;
+		voice_received += bot->VoiceReceived;
+		if( bot->Connected )
+			connected ++;
+	}
+	
+	fprintf( stderr, "\n%i bots, %i still connected, %i failed to connect, %.0f seconds\n", (int) bots.size(), connected, failed_connects, run_clock.ElapsedSeconds() );
+	
+	std::string json = "{\n\t\"suite\": \"RaptorLoadTest\",\n";
+	char cstr[ 1024 ] = "";
+	snprintf( cstr, sizeof(cstr), "\t\"timestamp\": %lli,\n\t\"host\": \"%s:%i\",\n\t\"bots\": %i,\n\t\"connected\": %i,\n\t\"failed_connects\": %i,\n\t\"seconds\": %.3f,\n\t\"compression\": %s,\n",
+		(long long) time(NULL), settings.Host.c_str(), settings.Port, (int) bots.size(), connected, failed_connects, run_clock.ElapsedSeconds(), settings.Compress ? "true" : "false" );
+	json += cstr;
+	snprintf( cstr, sizeof(cstr), "\t\"bytes_in\": %.0f,\n\t\"bytes_in_uncompressed\": %.0f,\n\t\"bytes_out\": %.0f,\n\t\"updates_received\": %.0f,\n\t\"objects_added\": %.0f,\n\t\"voice_sent\": %.0f,\n\t\"voice_received\": %.0f,\n",
+		(double) bytes_in, (double) raw_in, (double) bytes_out, (double) updates, (double) objects, (double) voice_sent, (double) voice_received );
+	json += cstr;
+	json += std::string("\t") + LoadTestDistribution( "ping_ms", ping_times ) + std::string(",\n");
+	json += std::string("\t") + LoadTestDistribution( "update_interval_ms", update_intervals ) + std::string(",\n");
+	json += std::string("\t") + LoadTestDistribution( "receive_backlog_packets", backlogs ) + std::string(",\n");
+	json += std::string("\t") + LoadTestDistribution( "client_in_bytes_per_sec", in_rates ) + std::string(",\n");
+	json += std::string("\t") + LoadTestDistribution( "client_out_bytes_per_sec", out_rates ) + std::string("\n}\n");
+	
+	for( std::vector<LoadTestBot*>::iterator bot_iter = bots.begin(); bot_iter != bots.end(); bot_iter ++ )
+	{
+		Packet disconnect( Raptor::Packet::DISCONNECT );
+		disconnect.AddString( "Load test finished." );
+		(*bot_iter)->Send( &disconnect );
+		delete *bot_iter;
+	}
+	bots.clear();
+	
+	SDLNet_FreeSocketSet( socket_set );
+	SDLNet_Quit();
+	
+	FILE *out = settings.OutputFilename ? fopen( settings.OutputFilename, "wb" ) : stdout;
+	if( ! out )
+	{
+		fprintf( stderr, "RaptorLoadTest: Couldn't write %s\n", settings.OutputFilename );
+		return 1;
+	}
+	fputs( json.c_str(), out );
+	if( out != stdout )
+		fclose( out );
+	
+	return 0;
+}
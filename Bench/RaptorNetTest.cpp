@@ -0,0 +1,209 @@
+/*
+ *  RaptorNetTest.cpp
+ */
+
+// Headless self-test for bit-packed object updates: round-trips BitWriter/BitReader fields and overflow,
+// checks that orientation survives each precision at least as well as the unpacked 16-bit/8-bit/float
+// components it replaced, and that GameObject::UpdateFields reads back what it wrote inside a Packet.
+//
+// Build: compile this file with the engine sources (as for RaptorBench) and link the same libraries a game does.
+//
+// Usage: RaptorNetTest
+// Prints each check and returns non-zero if any failed.
+
+#include "PlatformSpecific.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <stdint.h>
+#include "Rand.h"
+#include "Vec.h"
+#include "Pos.h"
+#include "Packet.h"
+#include "BitStream.h"
+#include "NetSchema.h"
+#include "GameObject.h"
+
+
+static int Failed = 0;
+
+
+static void Check( bool ok, const char *what )
+{
+	fprintf( stderr, "%-60s %s\n", what, ok ? "ok" : "FAILED" );
+	if( ! ok )
+		Failed ++;
+}
+
+
+static double MaxError( const Vec3D *a, const Vec3D *b )
+{
+	return std::max<double>( fabs( a->X - b->X ), std::max<double>( fabs( a->Y - b->Y ), fabs( a->Z - b->Z ) ) );
+}
+
+
+static int OrientationBits( int8_t precision )
+{
+	for( std::vector< NetField<GameObject> >::const_iterator field_iter = GameObject::UpdateFields.Fields.begin(); field_iter != GameObject::UpdateFields.Fields.end(); field_iter ++ )
+	{
+		if( field_iter->Kind == NetFieldKind::ORIENTATION )
+			return field_iter->BitsAt( precision );
+	}
+	return 0;
+}
+
+
+static void RandomOrientation( Pos3D *pos )
+{
+	pos->Fwd.Set( 1., 0., 0. );
+	pos->Up.Set( 0., 0., 1. );
+	pos->Right.Set( 0., -1., 0. );
+	pos->Yaw( Rand::Double( 360. ) );
+	pos->Pitch( Rand::Double( 360. ) );
+	pos->Roll( Rand::Double( 360. ) );
+}
+
+
+static void CheckFields( void )
+{
+	uint8_t buffer[ 64 ];
+	Vec3D unit( 0.6, -0.48, 0.64 );
+	
+	BitWriter writer( buffer, sizeof(buffer) );
+	writer.WriteBits( 5, 3 );
+	writer.WriteBool( true );
+	writer.WriteBits( 0xABCDE, 20 );
+	writer.WriteBits( 0xFFFFFFFF, 32 );
+	writer.WriteFloat( 1.5f );
+	writer.WriteDouble( -1234.5678 );
+	writer.WriteRanged( 0.25, -1., 1., 10 );
+	writer.WriteUnitVector( &unit, 16 );
+	writer.Finish();
+	Check( ! writer.Overflow, "BitWriter fields fit" );
+	Check( writer.Bytes() == (3 + 1 + 20 + 32 + 32 + 64 + 10 + 32 + 7) / 8, "BitWriter byte count" );
+	
+	BitReader reader( buffer, writer.Bytes() );
+	Check( reader.ReadBits( 3 ) == 5, "ReadBits 3" );
+	Check( reader.ReadBool(), "ReadBool" );
+	Check( reader.ReadBits( 20 ) == 0xABCDE, "ReadBits 20" );
+	Check( reader.ReadBits( 32 ) == 0xFFFFFFFF, "ReadBits 32" );
+	Check( reader.ReadFloat() == 1.5f, "ReadFloat" );
+	Check( reader.ReadDouble() == -1234.5678, "ReadDouble" );
+	Check( fabs( reader.ReadRanged( -1., 1., 10 ) - 0.25 ) <= 1. / 1023., "ReadRanged 10 bits" );
+	Vec3D unit_read;
+	reader.ReadUnitVector( &unit_read, 16 );
+	Check( MaxError( &unit, &unit_read ) < 0.0001, "ReadUnitVector 16 bits" );
+	Check( ! reader.Overflow && (reader.Bytes() == writer.Bytes()), "BitReader consumed every byte" );
+	Check( reader.ReadBits( 8 ) == 0 && reader.Overflow, "BitReader flags reading past the end" );
+	
+	uint8_t small[ 2 ];
+	BitWriter small_writer( small, sizeof(small) );
+	small_writer.WriteBits( 0xFFFF, 16 );
+	Check( ! small_writer.Overflow, "BitWriter fills its buffer exactly" );
+	small_writer.WriteBool( true );
+	Check( small_writer.Overflow && (small_writer.Bytes() == 2), "BitWriter flags writing past the end" );
+}
+
+
+// Largest per-component error of the old unpacked format at each precision, for Fwd and Up:
+// precision < 0 sent Fwd as 16-bit and Up as 8-bit, 0 sent Fwd as float and Up as 16-bit, and > 0 sent both as float.
+static void CheckOrientation( int8_t precision, double fwd_limit, double up_limit )
+{
+	int bits = OrientationBits( precision );
+	double fwd_error = 0., up_error = 0.;
+	bool overflow = false;
+	
+	Rand::Seed( 1 );
+	for( int i = 0; i < 1000; i ++ )
+	{
+		Pos3D pos;
+		RandomOrientation( &pos );
+		
+		uint8_t buffer[ 16 ];
+		BitWriter writer( buffer, sizeof(buffer) );
+		writer.WriteOrientation( &(pos.Fwd), &(pos.Up), bits );
+		writer.Finish();
+		
+		Vec3D fwd, up;
+		BitReader reader( buffer, writer.Bytes() );
+		reader.ReadOrientation( &fwd, &up, bits );
+		
+		fwd_error = std::max<double>( fwd_error, MaxError( &(pos.Fwd), &fwd ) );
+		up_error = std::max<double>( up_error, MaxError( &(pos.Up), &up ) );
+		overflow = overflow || writer.Overflow || reader.Overflow || (writer.Bytes() != (size_t)( 2 + bits * 3 + 7 ) / 8);
+	}
+	
+	char what[ 128 ] = "";
+	snprintf( what, sizeof(what), "Orientation at precision %i (%i bits) size", precision, bits );
+	Check( bits && ! overflow, what );
+	snprintf( what, sizeof(what), "Orientation at precision %i Fwd error %.3g", precision, fwd_error );
+	Check( fwd_error <= fwd_limit, what );
+	snprintf( what, sizeof(what), "Orientation at precision %i Up error %.3g", precision, up_error );
+	Check( up_error <= up_limit, what );
+}
+
+
+static void CheckSchema( int8_t precision )
+{
+	Rand::Seed( 2 );
+	GameObject written[ 8 ];
+	for( size_t i = 0; i < 8; i ++ )
+	{
+		written[ i ].SetPos( Rand::Double( -10000., 10000. ), Rand::Double( -10000., 10000. ), Rand::Double( -10000., 10000. ) );
+		RandomOrientation( &(written[ i ]) );
+		written[ i ].MotionVector.Set( Rand::Double( -100., 100. ), Rand::Double( -100., 100. ), Rand::Double( -100., 100. ) );
+		written[ i ].RollRate = Rand::Double( -90., 90. );
+	}
+	
+	// Regular Packet fields on both sides of the bit-packed sections must stay aligned.
+	Packet packet( PACKET_DEFAULT_TYPE );
+	packet.AddUInt( 0x12345678 );
+	for( size_t i = 0; i < 8; i ++ )
+	{
+		GameObject::UpdateFields.Write( &(written[ i ]), &packet, precision );
+		packet.AddUChar( i );
+	}
+	packet.AddUInt( 0x9ABCDEF0 );
+	
+	packet.Rewind();
+	bool aligned = (packet.NextUInt() == 0x12345678);
+	bool exact = true;
+	double orientation_error = 0.;
+	for( size_t i = 0; i < 8; i ++ )
+	{
+		GameObject read;
+		GameObject::UpdateFields.Read( &read, &packet, precision );
+		aligned = aligned && (packet.NextUChar() == i);
+		
+		exact = exact && (read.X == written[ i ].X) && (read.Y == written[ i ].Y) && (read.Z == written[ i ].Z);
+		exact = exact && (read.MotionVector.X == (float) written[ i ].MotionVector.X);
+		exact = exact && (read.RollRate == ((precision >= 0) ? (float) written[ i ].RollRate : 0.));
+		orientation_error = std::max<double>( orientation_error, MaxError( &(read.Fwd), &(written[ i ].Fwd) ) );
+	}
+	aligned = aligned && (packet.NextUInt() == 0x9ABCDEF0) && ! packet.Remaining();
+	
+	char what[ 128 ] = "";
+	snprintf( what, sizeof(what), "UpdateFields at precision %i stays aligned", precision );
+	Check( aligned, what );
+	snprintf( what, sizeof(what), "UpdateFields at precision %i round-trips", precision );
+	Check( exact && (orientation_error < 0.0001), what );
+}
+
+
+int main( int argc, char **argv )
+{
+	CheckFields();
+	
+	CheckOrientation( -1, 1. / 32767., 1. / 127. );
+	CheckOrientation( 0, pow( 2., -25. ), 1. / 32767. );
+	CheckOrientation( 1, pow( 2., -25. ), pow( 2., -25. ) );
+	
+	CheckSchema( -1 );
+	CheckSchema( 0 );
+	CheckSchema( 1 );
+	
+	fprintf( stderr, "%i failed.\n", Failed );
+	return Failed ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+/*
+ *  RaptorSoundTest.cpp
+ */
+
+// Headless self-test for SoundOut virtual voice handles: checks that an inaudible voice stays valid without
+// a channel, that stale handles are rejected after their slot is freed and reused by a newer generation,
+// that louder voices take channels from quieter ones when every mixer channel is busy,
+// that the channel-returning PlayAt/SetPos API still deals in mixer channels, and that pooled PCM is reused.
+//
+// Build: compile this file with the engine sources (as for the client), linking SDL, SDL_mixer, and the rest.
+// Run with SDL_AUDIODRIVER=dummy where there is no sound device.
+//
+// Usage: RaptorSoundTest
+// Prints each check and returns non-zero if any failed.
+
+#include "PlatformSpecific.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include <stdint.h>
+
+#include "RaptorGame.h"
+#include "SoundOut.h"
+#include "SoundOutHandle.h"
+
+
+static int Failed = 0;
+
+
+static void Check( bool ok, const char *what )
+{
+	fprintf( stderr, "%-60s %s\n", what, ok ? "ok" : "FAILED" );
+	if( ! ok )
+		Failed ++;
+}
+
+
+int main( int argc, char **argv )
+{
+	Raptor::Game = new RaptorGame( "RaptorSoundTest", "0" );
+	SoundOut *snd = &(Raptor::Game->Snd);
+	snd->Initialize( 2, 22050, 16, 1024, 8 );
+	if( ! snd->Initialized )
+	{
+		fprintf( stderr, "RaptorSoundTest: Unable to initialize audio.\n" );
+		return -1;
+	}
+	
+	// One second of silence, so nothing finishes while we look at it.
+	std::vector<int16_t> silence( 22050, 0 );
+	Mix_Chunk *chunk = snd->AllocatePCM( &(silence[ 0 ]), silence.size(), 22050 );
+	Check( chunk, "AllocatePCM" );
+	if( ! chunk )
+		return -1;
+	
+	SoundOutHandle near_voice = snd->PlayVoiceAt( chunk, 0., 0., 0. );
+	Check( near_voice.Valid(), "PlayVoiceAt near is valid" );
+	Check( snd->VoiceChannel( near_voice ) >= 0, "PlayVoiceAt near has a channel" );
+	Check( snd->GetVoice( near_voice ), "GetVoice near" );
+	Check( snd->SetVoicePos( near_voice, 1., 2., 3. ), "SetVoicePos near" );
+	
+	SoundOutHandle far_voice = snd->PlayVoiceAt( chunk, 1e9, 0., 0. );
+	Check( far_voice.Valid(), "PlayVoiceAt far is valid" );
+	Check( snd->VoiceChannel( far_voice ) == -1, "PlayVoiceAt far is virtual" );
+	Check( far_voice.Index() != near_voice.Index(), "Voices use different slots" );
+	
+	snd->StopSounds();
+	Check( ! snd->GetVoice( near_voice ), "GetVoice stale handle" );
+	Check( ! snd->SetVoicePos( near_voice, 0., 0., 0. ), "SetVoicePos stale handle" );
+	Check( snd->VoiceChannel( near_voice ) == -1, "VoiceChannel stale handle" );
+	Check( ! snd->SetVoicePos( far_voice, 0., 0., 0. ), "SetVoicePos stale virtual handle" );
+	
+	// Freed slots are reused, so the new handle shares an index with a stale one but not its generation.
+	SoundOutHandle reused = snd->PlayVoiceAt( chunk, 0., 0., 0. );
+	Check( reused.Valid(), "PlayVoiceAt after StopSounds is valid" );
+	Check( (reused.Index() == near_voice.Index()) || (reused.Index() == far_voice.Index()), "Freed slot is reused" );
+	Check( (reused != near_voice) && (reused != far_voice), "Reused slot has a new generation" );
+	SoundOutHandle stale = (reused.Index() == near_voice.Index()) ? near_voice : far_voice;
+	Check( ! snd->SetVoicePos( stale, 5., 5., 5. ), "SetVoicePos stale handle after reuse" );
+	Check( snd->GetVoice( reused ) && (snd->GetVoice( reused )->X == 0.), "Stale SetVoicePos left new voice alone" );
+	Check( snd->SetVoicePos( reused, 1., 2., 3. ), "SetVoicePos reused handle" );
+	
+	bool generations_differ = true;
+	SoundOutHandle previous = reused;
+	for( int i = 0; i < 100; i ++ )
+	{
+		snd->StopSounds();
+		SoundOutHandle handle = snd->PlayVoiceAt( chunk, 0., 0., 0. );
+		if( (! handle.Valid()) || (handle == previous) || snd->GetVoice( previous ) )
+			generations_differ = false;
+		previous = handle;
+	}
+	Check( generations_differ, "Each reuse gets a new generation" );
+	snd->StopSounds();
+	
+	// Fill every mixer channel, then make sure louder voices take channels from the quietest ones.
+	std::vector<SoundOutHandle> crowd;
+	for( int i = 0; i < snd->Channels; i ++ )
+		crowd.push_back( snd->PlayVoiceAt( chunk, 200. + 10. * i, 0., 0. ) );
+	bool all_real = true;
+	for( size_t i = 0; i < crowd.size(); i ++ )
+		all_real = all_real && (snd->VoiceChannel( crowd[ i ] ) >= 0);
+	Check( all_real, "Voices up to the channel count are all real" );
+	Check( (int) snd->ActivePans.size() == snd->Channels, "ActivePans lists every real channel" );
+	
+	SoundOutHandle loud = snd->PlayVoiceAt( chunk, 0., 0., 0. );
+	Check( snd->VoiceChannel( loud ) >= 0, "Louder voice steals a channel when full" );
+	Check( crowd.back().Valid() && snd->GetVoice( crowd.back() ) && (snd->VoiceChannel( crowd.back() ) == -1), "Quietest voice becomes virtual" );
+	Check( snd->ActivePans[ snd->VoiceChannel( loud ) ].X == 0., "ActivePans follows the stolen channel" );
+	
+	SoundOutHandle quiet = snd->PlayVoiceAt( chunk, 500., 0., 0. );
+	Check( snd->GetVoice( quiet ) && (snd->VoiceChannel( quiet ) == -1), "Quieter voice stays virtual when full" );
+	
+	// Moving a virtual voice closer promotes it on the next update, at the expense of the now-quietest voice.
+	Check( snd->SetVoicePos( crowd.back(), 10., 0., 0. ), "SetVoicePos virtual voice" );
+	Clock::NewFrame();
+	snd->Update();
+	Check( snd->VoiceChannel( crowd.back() ) >= 0, "Update promotes the virtual voice" );
+	Check( snd->VoiceChannel( crowd[ crowd.size() - 2 ] ) == -1, "Update demotes the next quietest voice" );
+	Check( snd->VoiceChannel( quiet ) == -1, "Update leaves the quietest voice virtual" );
+	Check( (snd->VoicesReal == snd->Channels) && (snd->VoicesVirtual == 2), "Update counts real and virtual voices" );
+	snd->StopSounds();
+	Check( snd->ActivePans.empty(), "StopSounds clears ActivePans" );
+	
+	int channel = snd->PlayAt( chunk, 0., 0., 0. );
+	Check( (channel >= 0) && (channel < snd->Channels), "PlayAt returns a mixer channel" );
+	Check( snd->IsPlaying( channel ), "PlayAt channel is playing" );
+	Check( snd->SetPos( channel, 1., 2., 3. ) == channel, "SetPos on playing channel" );
+	Check( snd->SetPos( -1, 0., 0., 0. ) == -1, "SetPos on channel -1" );
+	Check( snd->SetPos( snd->Channels + 5, 0., 0., 0. ) == -1, "SetPos on invalid channel" );
+	Check( snd->PlayAt( chunk, 1e9, 0., 0. ) == -1, "PlayAt inaudible returns no channel" );
+	snd->StopSounds();
+	
+	// Pooled PCM goes back to SoundOut and is reused; AllocatePCM chunks are ours to Mix_FreeChunk.
+	SoundOutPCM *pooled = snd->AllocatePooledPCM( &(silence[ 0 ]), silence.size(), 22050 );
+	Check( pooled && pooled->Chunk.alen && ! pooled->Chunk.allocated, "AllocatePooledPCM" );
+	snd->FreePooledPCM( pooled );
+	SoundOutPCM *pooled_again = snd->AllocatePooledPCM( &(silence[ 0 ]), silence.size(), 22050 );
+	Check( pooled_again == pooled, "FreePooledPCM returns the buffer to the pool" );
+	snd->FreePooledPCM( pooled_again );
+	Mix_FreeChunk( chunk );
+	
+	fprintf( stderr, "%i failed.\n", Failed );
+	return Failed ? 1 : 0;
+}
@@ -61,6 +61,16 @@
 #endif
 
 
+// Per-thread storage for plain data (no constructors); older Apple GCC for PowerPC has no TLS support.
+#if defined(_MSC_VER)
+	#define THREAD_LOCAL __declspec(thread)
+#elif defined(APPLE_POWERPC)
+	#define THREAD_LOCAL
+#else
+	#define THREAD_LOCAL __thread
+#endif
+
+
 #ifdef SDL2
 	typedef int SDLKey;
 	#define SDL_BUTTON_WHEELUP   254
@@ -56,6 +56,24 @@ namespace Raptor
 		};
 	}
 	
+	namespace Protocol
+	{
+		enum
+		{
+			// Bump whenever the engine's wire format changes.  Clients before 2 sent unpacked object updates.
+			VERSION = 2
+		};
+	}
+	
+	namespace Compression
+	{
+		enum
+		{
+			NONE = 0x00,
+			LZ   = 0x01
+		};
+	}
+	
 	namespace VoiceChannel
 	{
 		enum
@@ -7,7 +7,7 @@
 #include "PlatformSpecific.h"
 
 #include <cstdio>
-#include "IMA.h"
+#include "VoiceCodec.h"
 
 #ifdef WIN32
 #include <tchar.h>
@@ -128,6 +128,7 @@ bool Raptor::PreMain( int bits )
 #include "Rand.h"
 #include "Num.h"
 #include "Notification.h"
+#include "Profiler.h"
 
 
 RaptorGame::RaptorGame( std::string game, std::string version, RaptorServer *server )
@@ -141,6 +142,7 @@ RaptorGame::RaptorGame( std::string game, std::string version, RaptorServer *ser
 	
 	// This arbitrary large value allows us to use Data.AddObject for client-side non-networked objects, if we want to.
 	Data.GameObjectIDs.Clear( 0x10000000 );
+	Data.ClientSide = true;
 	
 	UIScale = 1.f;
 	MaxFPS = 0.;
@@ -164,6 +166,8 @@ void RaptorGame::SetServer( RaptorServer *server )
 	if( Server )
 	{
 		Server->Console = &Console;
+		Server->HostConsole = &Console;
+		Server->HostState = &State;
 		Server->Port = DefaultPort;
 	}
 }
@@ -282,6 +286,8 @@ void RaptorGame::Initialize( int argc, char **argv )
 		Server->NetRate = Cfg.SettingAsDouble( "sv_netrate", 30. );
 		Server->Announce = Cfg.SettingAsBool( "sv_announce", true );
 		Server->Data.ThreadCount = Cfg.SettingAsInt("sv_threads");
+		Server->Data.AntiJitter = Cfg.SettingAsDouble( "net_anti_jitter", 0.999 );
+		Server->ChatSeparator = ChatSeparator;
 		Server->Data.SetProperty( "screensaver_connect", Cfg.SettingAsString( "screensaver_connect", "false" ) );
 	}
 	
@@ -363,10 +369,14 @@ void RaptorGame::Run( void )
 	Clock GameClock;
 	Clock NetClock;
 	
+	Profiler::SetThreadName( "Main" );
+	
 	while( Layers.Layers.size() )
 	{
 		// Process network input buffer.
+		ProfileZone net_in_zone( "Net.ProcessIn" );
 		Net.ProcessIn();
+		net_in_zone.End();
 		
 		// Calculate the time elapsed for the frame.
 		double elapsed = GameClock.ElapsedSeconds();
@@ -378,6 +388,12 @@ void RaptorGame::Run( void )
 			FrameTime = elapsed;
 			GameClock.Advance( FrameTime );
 			
+			// Sample the time once, so per-object animation and effect timers don't each read the clock.
+			Clock::NewFrame();
+			
+			ProfileZone frame_zone( "Frame" );
+			ProfileZone input_zone( "Input" );
+			
 			// Keep the list of joysticks up-to-date.
 			Joy.FindJoysticks();
 			
@@ -423,12 +439,16 @@ void RaptorGame::Run( void )
 				}
 			}
 			
+			input_zone.End();
+			
 			// Update active panning sounds and continue music playlist if applicable.
+			ProfileZone sound_zone( "Sound" );
 			Snd.MasterVolume = Cfg.SettingAsDouble( "s_volume", 0.5 );
 			Snd.SoundVolume = Cfg.SettingAsDouble( "s_effect_volume", 0.5 );
 			Snd.MusicVolume = Cfg.SettingAsDouble( "s_music_volume", 1. );
 			Snd.VoiceVolume = Cfg.SettingAsDouble( "s_voice_volume", 1. );
 			Snd.Update( &Cam );
+			sound_zone.End();
 			
 			// Honor the maxfps variable.
 			MaxFPS = Cfg.SettingAsDouble("maxfps");
@@ -438,6 +458,7 @@ void RaptorGame::Run( void )
 				Net.Reconnect( Cfg.SettingAsString("name").c_str(), Cfg.SettingAsString("password").c_str() );
 			
 			// Draw to all viewports.
+			ProfileZone draw_zone( "Draw" );
 			bool vr_enable = Cfg.SettingAsBool("vr_enable");
 			if( vr_enable && ! Head.Initialized )
 				Head.Initialize();
@@ -502,19 +523,37 @@ void RaptorGame::Run( void )
 				Gfx.SwapBuffers();
 			}
 			
+			draw_zone.End();
+			
 			// Update!  (Extrapolate object motion, etc.)
+			ProfileZone update_zone( "Update" );
 			Update( FrameTime );
+			update_zone.End();
 			
 			// If we're disconnected, make sure we clean up variables after the thread finishes.
+			ProfileZone net_zone( "Net" );
 			Net.Cleanup();
 			
 			// Send periodic updates to server.
 			Net.NetRate = Raptor::Game->Cfg.SettingAsDouble( "netrate", 30. );
 			Net.SendUpdates();
+			
+			// The listen server doesn't read our config, so hand it net_anti_jitter whenever that changes.
+			// Only this thread writes it, but the server thread reads it during updates.
+			double anti_jitter = Cfg.SettingAsDouble( "net_anti_jitter", 0.999 );
+			if( Server && (Server->Data.AntiJitter != anti_jitter) )
+			{
+				Server->Data.Lock.Lock();
+				Server->Data.AntiJitter = anti_jitter;
+				Server->Data.Lock.Unlock();
+			}
 		}
 		
-		// Let the thread rest a bit.
-		SDL_Delay( 1 );
+		// Sleep until the next frame is due, or rest a bit if uncapped.
+		if( GameClock.ElapsedSeconds() < 0. )
+			GameClock.SleepUntil( 0. );
+		else if( ! MaxFPS )
+			SDL_Delay( 1 );
 	}
 	
 	// Save our settings.
@@ -538,6 +577,8 @@ void RaptorGame::Run( void )
 void RaptorGame::Draw( void )
 {
 	// Clear the framebuffer and draw all layers.
+	Gfx.ModelsDrawn = 0;
+	Gfx.ModelsCulled = 0;
 	Gfx.Clear();
 	Layers.Draw();
 	
@@ -571,6 +612,31 @@ void RaptorGame::Draw( void )
 		Console.MessageFont->DrawText( fps_str, Gfx.W - 2, Gfx.H - 1, Font::ALIGN_BOTTOM_RIGHT, 1.f,1.f,1.f,1.f,  UIScale );
 	}
 	
+	// Draw render and model queue statistics from their last flush.
+	if( Cfg.SettingAsBool("showdraws") )
+	{
+		char draws_str[ 256 ] = "";
+		snprintf( draws_str, sizeof(draws_str), "%u draws, %u shaders, %u textures, %u depth masks\n%u model draws, %u instances, %u shaders, %u materials\n%u models drawn, %u culled", Queue.Draws, Queue.ShaderChanges, Queue.TextureChanges, Queue.DepthMaskChanges, Instances.DrawCalls, Instances.Instances, Instances.ShaderChanges, Instances.MaterialChanges, Gfx.ModelsDrawn, Gfx.ModelsCulled );
+		
+		Gfx.Setup2D();
+		Console.MessageFont->DrawText( draws_str, 1, Gfx.H,     Font::ALIGN_BOTTOM_LEFT, 0.f,0.f,0.f,0.8f, UIScale );
+		Console.MessageFont->DrawText( draws_str, 0, Gfx.H - 1, Font::ALIGN_BOTTOM_LEFT, 1.f,1.f,1.f,1.f,  UIScale );
+	}
+	
+	// Draw profiler zone percentiles, refreshed a few times per second.
+	if( Profiler::Enabled && Cfg.SettingAsBool("showprofile") )
+	{
+		if( ProfileText.empty() || (ProfileClock.ElapsedSeconds() >= 0.5) )
+		{
+			ProfileText = Profiler::Summary();
+			ProfileClock.Reset();
+		}
+		
+		Gfx.Setup2D();
+		Console.MessageFont->DrawText( ProfileText, Gfx.W - 1, 1, Font::ALIGN_TOP_RIGHT, 0.f,0.f,0.f,0.8f, UIScale );
+		Console.MessageFont->DrawText( ProfileText, Gfx.W - 2, 0, Font::ALIGN_TOP_RIGHT, 1.f,1.f,1.f,1.f,  UIScale );
+	}
+	
 	// Draw console and mouse cursor last.
 	Console.Draw();
 	Mouse.Draw();
@@ -585,6 +651,8 @@ void RaptorGame::Setup( int argc, char **argv )
 void RaptorGame::Update( double dt )
 {
 	Gfx.LightQuality = Cfg.SettingAsInt( "g_shader_light_quality", 4 );
+	Data.AntiJitter = Cfg.SettingAsDouble( "net_anti_jitter", 0.999 );
+	Data.ThreadCount = Cfg.SettingAsInt("sv_threads");
 	Data.Update( dt );
 }
 
@@ -729,6 +797,9 @@ bool RaptorGame::ProcessPacket( Packet *packet )
 		uint32_t sample_rate = packet->NextUInt();
 		uint32_t samples     = packet->NextUInt();
 		
+		uint8_t codec_id = VoiceCodec::UnpackCodec( sample_rate );
+		sample_rate = VoiceCodec::UnpackRate( sample_rate );
+		
 		if( ! (sample_rate && samples) )
 		{
 			packet->Rewind();
@@ -743,19 +814,21 @@ bool RaptorGame::ProcessPacket( Packet *packet )
 		uint8_t  bytes_per_frame = channels * bytes_per_sample;
 		uint32_t pcm_bytes = samples * bytes_per_frame;
 		
+		VoiceCodec *codec = Snd.GetVoiceDecoder( codec_id );
+		if( ! codec )
+			return true;
+		
 		int16_t *pcm = (int16_t*) malloc( pcm_bytes );
-		//memset( pcm, 0, pcm_bytes );
 		
-		int16_t ima_prev = 0;
-		int8_t ima_index = 0;
-		for( size_t i = 0; i < samples; i += 2 )
+		// Decode the whole payload in one block directly from the packet data.
+		codec->Reset();
+		size_t decoded_bytes = codec->Decode( packet->Data + packet->Offset, std::max<int>( 0, packet->Remaining() ), pcm, samples );
+		if( ! decoded_bytes )
 		{
-			uint8_t ima_byte = packet->NextUChar();
-			
-			pcm[ i ] = IMA::Decode( (ima_byte & 0xF0) >> 4, &ima_prev, &ima_index );
-			if( (i + 1) < samples )
-				pcm[ i + 1 ] = IMA::Decode( ima_byte & 0x0F, &ima_prev, &ima_index );
+			free( pcm );
+			return true;
 		}
+		packet->Skip( decoded_bytes );
 		
 		double packet_volume = 1.;
 		if( packet->Remaining() )
@@ -790,7 +863,7 @@ bool RaptorGame::ProcessPacket( Packet *packet )
 			Snd.VoiceBuffers[ player_id ] = buffer;
 		}
 		
-		if( ! buffer->Filled )
+		if( ! buffer->ReadyBytes() )
 		{
 			buffer->SampleRate     = sample_rate;
 			buffer->Channels       = channels;
@@ -1163,6 +1236,9 @@ void RaptorGame::Host( void )
 		Server->NetRate = Cfg.SettingAsDouble( "sv_netrate", 30. );
 		Server->Announce = Cfg.SettingAsBool( "sv_announce", true );
 		Server->Data.ThreadCount = Cfg.SettingAsInt("sv_threads");
+		Server->Data.Lock.Lock();
+		Server->Data.AntiJitter = Cfg.SettingAsDouble( "net_anti_jitter", 0.999 );
+		Server->Data.Lock.Unlock();
 		
 		Server->Start( Cfg.SettingAsString( "name", Raptor::Server->Game.c_str() ) );
 		
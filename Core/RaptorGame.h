@@ -23,6 +23,8 @@ class RaptorGame;
 #include "RaptorDefs.h"
 #include "Graphics.h"
 #include "ShaderManager.h"
+#include "ModelQueue.h"
+#include "RenderQueue.h"
 #include "Camera.h"
 #include "SoundOut.h"
 #include "Microphone.h"
@@ -62,6 +64,8 @@ public:
 	ClientConsole Console;
 	TextConsole Msg;
 	ResourceManager Res;
+	ModelQueue Instances;
+	RenderQueue Queue;
 	NetClient Net;
 	ClientConfig Cfg;
 	float UIScale;
@@ -86,6 +90,9 @@ public:
 	std::string WaitText;
 	Font *WaitFont;
 	
+	std::string ProfileText;
+	Clock ProfileClock;
+	
 	RaptorServer *Server;
 	
 	
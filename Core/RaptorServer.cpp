@@ -5,9 +5,9 @@
 #define GAMESERVER_CPP
 
 #include "RaptorServer.h"
-#include "RaptorGame.h"
 
 #include <cstddef>
+#include <cstring>
 #include <cmath>
 #include <string>
 #include <map>
@@ -20,7 +20,10 @@
 #include "Rand.h"
 #include "Str.h"
 #include "Num.h"
+#include "Endian.h"
 #include "IMA.h"
+#include "Profiler.h"
+#include "ServerPool.h"
 
 
 namespace Raptor
@@ -36,6 +39,7 @@ RaptorServer::RaptorServer( std::string game, std::string version )
 	Version = version;
 	
 	Thread = NULL;
+	Pool = NULL;
 	Port = 7000;
 	MaxFPS = 60.;
 	NetRate = 30.;
@@ -44,9 +48,18 @@ RaptorServer::RaptorServer( std::string game, std::string version )
 	AnnounceInterval = 3.;
 	
 	Console = NULL;
+	ChatSeparator = ": ";
+	HostConsole = NULL;
+	HostState = NULL;
 	
 	FrameTime = 0.;
+	Idle = false;
 	State = Raptor::State::DISCONNECTED;
+	
+	VoiceRoutesDirty = true;
+	
+	Net.Server = this;
+	Data.Server = this;
 }
 
 
@@ -55,6 +68,9 @@ RaptorServer::~RaptorServer()
 	if( IsRunning() )
 		StopAndWait( 5. );
 	
+	if( Pool )
+		Pool->Remove( this );
+	
 	if( Thread )
 	{
 		#if SDL_VERSION_ATLEAST(2,0,0)
@@ -84,6 +100,19 @@ bool RaptorServer::Start( std::string name )
 	
 	State = Raptor::State::CONNECTING;
 	
+	// Pooled servers start listening here, then the pool's workers run their frames.
+	if( Pool )
+	{
+		Data.GameTime.Reset();
+		if( ! Listen() )
+		{
+			Finish( false );
+			return false;
+		}
+		Pool->Run( this );
+		return true;
+	}
+	
 	#if SDL_VERSION_ATLEAST(2,0,0)
 		Thread = SDL_CreateThread( RaptorServerThread, "RaptorServer", this );
 	#else
@@ -145,6 +174,8 @@ void RaptorServer::StopAndWait( double max_wait_seconds )
 	}
 	
 	Data.Clear();
+	VoiceRoutes.clear();
+	VoiceRoutesDirty = true;
 	Stopped();
 }
 
@@ -165,6 +196,246 @@ void RaptorServer::ConsolePrint( std::string text, uint32_t type )
 }
 
 
+// Server console commands (without the "sv" prefix), shared by the client console and dedicated servers.
+bool RaptorServer::Command( std::string cmd, std::vector<std::string> *params )
+{
+	if( HandleCommand( cmd, params ) )
+		return true;
+	
+	std::vector<std::string> elements;
+	if( params )
+		elements = *params;
+	
+	if( cmd == "set" )
+	{
+		if( elements.size() >= 2 )
+		{
+			SetProperty( elements.at(0), elements.at(1) );
+			
+			Packet info = Packet( Raptor::Packet::INFO );
+			info.AddUShort( 1 );
+			info.AddString( elements.at(0) );
+			info.AddString( elements.at(1) );
+			Net.SendAll( &info );
+		}
+		else
+			ConsolePrint( "Usage: sv set <variable> <value>", TextConsole::MSG_ERROR );
+	}
+	else if( cmd == "unset" )
+	{
+		if( elements.size() >= 1 )
+		{
+			// FIXME: Remove the variable on clients instead of just setting to an empty string.
+			Packet info = Packet( Raptor::Packet::INFO );
+			info.AddUShort( 1 );
+			info.AddString( elements.at(0) );
+			info.AddString( "" );
+			Net.SendAll( &info );
+			
+			Data.Lock.Lock();
+			
+			std::map<std::string, std::string>::iterator setting_iter = Data.Properties.find( elements.at(0) );
+			if( setting_iter != Data.Properties.end() )
+				Data.Properties.erase( setting_iter );
+			else
+				ConsolePrint( elements.at(0) + " is not defined." );
+			
+			Data.Lock.Unlock();
+		}
+		else
+			ConsolePrint( "Usage: sv unset <variable>", TextConsole::MSG_ERROR );
+	}
+	else if( cmd == "show" )
+	{
+		if( elements.size() >= 1 )
+		{
+			int count = 0;
+			const char *cstr = elements.at(0).c_str();
+			int len = strlen(cstr);
+			
+			Data.Lock.Lock();
+			
+			for( std::map<std::string, std::string>::iterator property_iter = Data.Properties.begin(); property_iter != Data.Properties.end(); property_iter ++ )
+			{
+				if( strncmp( property_iter->first.c_str(), cstr, len ) == 0 )
+				{
+					ConsolePrint( property_iter->first + ": " + property_iter->second );
+					count ++;
+				}
+			}
+			
+			Data.Lock.Unlock();
+			
+			if( ! count )
+				ConsolePrint( elements.at(0) + " is not defined." );
+		}
+		else
+		{
+			Data.Lock.Lock();
+			
+			for( std::map<std::string, std::string>::iterator setting_iter = Data.Properties.begin(); setting_iter != Data.Properties.end(); setting_iter ++ )
+				ConsolePrint( setting_iter->first + ": " + setting_iter->second );
+			
+			Data.Lock.Unlock();
+		}
+	}
+	else if( cmd == "port" )
+	{
+		if( elements.size() >= 1 )
+			Port = atoi( elements.at(0).c_str() );
+		else
+			ConsolePrint( std::string("Server port: ") + Num::ToString( Port ) );
+	}
+	else if( cmd == "netrate" )
+	{
+		if( elements.size() >= 1 )
+		{
+			NetRate = atof( elements.at(0).c_str() );
+			Net.SetNetRate( NetRate );
+		}
+		else
+			ConsolePrint( std::string("Server netrate: ") + Num::ToString( (int)( Net.NetRate + 0.5 ) ) );
+	}
+	else if( cmd == "maxfps" )
+	{
+		if( elements.size() >= 1 )
+			MaxFPS = atof( elements.at(0).c_str() );
+		else
+			ConsolePrint( std::string("Server maxfps: ") + Num::ToString( (int)( MaxFPS + 0.5 ) ) );
+	}
+	else if( cmd == "threads" )
+	{
+		if( elements.size() >= 1 )
+			Data.ThreadCount = atoi( elements.at(0).c_str() );
+		else
+			ConsolePrint( std::string("Complex collision threads: ") + Num::ToString(Data.ThreadCount) );
+	}
+	else if( cmd == "announce" )
+	{
+		if( elements.size() >= 1 )
+			Announce = Str::AsBool( elements.at(0) );
+		else
+			ConsolePrint( std::string("Server LAN announce: ") + (Announce ? "true" : "false") );
+	}
+	else if( cmd == "restart" )
+	{
+		Start( Data.PropertyAsString("name") );
+	}
+	else if( cmd == "status" )
+	{
+		char cstr[ 1024 ] = "";
+		
+		ConsolePrint( Game + " " + Version );
+		snprintf( cstr, sizeof(cstr), "Architecture: %i-bit %s Endian", (int) sizeof(void*) * 8, Endian::Big() ? "Big" : "Little" );
+		ConsolePrint( cstr );
+		
+		snprintf( cstr, sizeof(cstr), "Players: %i", (int) Data.Players.size() );
+		ConsolePrint( cstr );
+		snprintf( cstr, sizeof(cstr), "Objects: %i", (int) Data.GameObjects.size() );
+		ConsolePrint( cstr );
+		snprintf( cstr, sizeof(cstr), "Server FPS: %.0f", 1. / FrameTime );
+		ConsolePrint( cstr );
+		
+		PacketCompressionStats compressed;
+		Net.Lock.Lock();
+		for( std::list<ConnectedClient*>::const_iterator client_iter = Net.Clients.begin(); client_iter != Net.Clients.end(); client_iter ++ )
+		{
+			compressed.Packets     += (*client_iter)->CompressStats.Packets;
+			compressed.RawBytes    += (*client_iter)->CompressStats.RawBytes;
+			compressed.PackedBytes += (*client_iter)->CompressStats.PackedBytes;
+			compressed.Seconds     += (*client_iter)->CompressStats.Seconds;
+		}
+		Net.Lock.Unlock();
+		if( compressed.Packets )
+			ConsolePrint( compressed.Status( "compressed" ) );
+	}
+	else if( cmd == "who" )
+	{
+		if( Data.Players.size() )
+		{
+			for( std::map<uint16_t,Player*>::const_iterator player_iter = Data.Players.begin(); player_iter != Data.Players.end(); player_iter ++ )
+			{
+				std::string name = player_iter->second->Name;
+				std::string version = player_iter->second->PropertyAsString( "version", Version.c_str(), Version.c_str() );
+				if( version != Version )
+					name += std::string(" [v") + version + std::string("]");
+				ConsolePrint( name );
+			}
+		}
+		else
+			ConsolePrint( "No players connected.", TextConsole::MSG_ERROR );
+	}
+	else if( cmd == "say" )
+	{
+		if( elements.size() >= 1 )
+		{
+			Packet message = Packet( Raptor::Packet::MESSAGE );
+			message.AddString( (std::string("Server") + ChatSeparator + Str::Join( elements, " " )).c_str() );
+			message.AddUInt( TextConsole::MSG_CHAT );
+			ProcessPacket( &message, NULL );
+		}
+		else
+			ConsolePrint( "Usage: sv say <message>", TextConsole::MSG_ERROR );
+	}
+	else if( cmd == "state" )
+	{
+		if( elements.size() >= 1 )
+		{
+			int new_state = State;
+			if( ((elements.at(0) == "+=") || (elements.at(0) == "+")) && (elements.size() >= 2) )
+				new_state += atoi( elements.at(1).c_str() );
+			else if( ((elements.at(0) == "-=") || (elements.at(0) == "-")) && (elements.size() >= 2) )
+				new_state -= atoi( elements.at(1).c_str() );
+			else if( (elements.at(0) == "++") || (elements.at(0) == "+") )
+				new_state ++;
+			else if( (elements.at(0) == "--") || (elements.at(0) == "-") )
+				new_state --;
+			else
+				new_state = atoi( elements.at(0).c_str() );
+			
+			if( new_state >= Raptor::State::CONNECTED )
+			{
+				char cstr[ 1024 ] = "";
+				snprintf( cstr, sizeof(cstr), "Changing server from state %i to %i.", State, new_state );
+				ConsolePrint( cstr );
+				
+				ChangeState( new_state );
+			}
+			else
+				ConsolePrint( "Invalid state requested: " + Num::ToString(new_state), TextConsole::MSG_ERROR );
+		}
+		else
+		{
+			char cstr[ 1024 ] = "";
+			snprintf( cstr, sizeof(cstr), "Current server state: %i", State );
+			ConsolePrint( cstr );
+		}
+	}
+	else if( Data.HasProperty(cmd) )
+	{
+		if( elements.size() >= 1 )
+		{
+			SetProperty( cmd, elements.at(0) );
+			
+			Packet info = Packet( Raptor::Packet::INFO );
+			info.AddUShort( 1 );
+			info.AddString( cmd );
+			info.AddString( elements.at(0) );
+			Net.SendAll( &info );
+		}
+		else
+			ConsolePrint( cmd + ": " + Data.PropertyAsString(cmd) );
+	}
+	else
+	{
+		ConsolePrint( "Unknown sv command: " + cmd, TextConsole::MSG_ERROR );
+		return false;
+	}
+	
+	return true;
+}
+
+
 // ---------------------------------------------------------------------------
 
 
@@ -245,17 +516,32 @@ bool RaptorServer::ProcessPacket( Packet *packet, ConnectedClient *from_client )
 		if( (! from_player) || (from_player->ID != player_id) )
 			return true;
 		
-		std::string match_team = (channel == Raptor::VoiceChannel::TEAM) ? from_player->PropertyAsString("team") : "";
+		if( VoiceRoutesDirty )
+			RebuildVoiceRoutes();
 		
-		for( std::map<uint16_t,Player*>::const_iterator player_iter = Data.Players.begin(); player_iter != Data.Players.end(); player_iter ++ )
+		// Relay one shared copy to everyone on the channel, rather than copying and searching clients per recipient.
+		const std::vector<uint16_t> *recipients = NULL;
+		// A sender without a team reaches everyone on the team channel, as it always has.
+		std::string team = (channel == Raptor::VoiceChannel::TEAM) ? from_player->PropertyAsString("team") : "";
+		if( team.length() )
 		{
-			if( (player_iter->second == from_player) && ! Data.PropertyAsBool("echo") )
-				continue;
-			if( match_team.length() && (player_iter->second->PropertyAsString("team") != match_team) )
-				continue;
-			Net.SendToPlayer( packet, player_iter->first );
+			std::map< std::string, std::vector<uint16_t> >::const_iterator route_iter = VoiceRoutes.find( team );
+			if( route_iter == VoiceRoutes.end() )
+			{
+				// The team changed without going through SetPlayerProperty, so regroup once before giving up.
+				RebuildVoiceRoutes();
+				route_iter = VoiceRoutes.find( team );
+			}
+			
+			// Never let team voice fall through to everyone.
+			if( route_iter == VoiceRoutes.end() )
+				return true;
+			
+			recipients = &(route_iter->second);
 		}
 		
+		Net.SendToPlayers( packet, recipients, Data.PropertyAsBool("echo") ? 0 : from_player->ID );
+		
 		return true;
 	}
 	
@@ -274,6 +560,10 @@ bool RaptorServer::ProcessPacket( Packet *packet, ConnectedClient *from_client )
 			std::string property_name = packet->NextString();
 			std::string property_value = packet->NextString();
 			
+			// Game-specific SetPlayerProperty may apply this without the base class seeing a team change.
+			if( property_name == "team" )
+				VoiceRoutesDirty = true;
+			
 			// Set property and retransmit if changed (unless intercepted by game-specific code).
 			SetPlayerProperty( player, property_name, property_value );
 		}
@@ -337,7 +627,7 @@ bool RaptorServer::ProcessPacket( Packet *packet, ConnectedClient *from_client )
 			Net.SendAll( packet );
 		
 		// Dedicated servers print chat to console.
-		if( Console != &(Raptor::Game->Console) )
+		if( Console != HostConsole )
 			ConsolePrint( msg, msg_type );
 	}
 	
@@ -367,7 +657,7 @@ void RaptorServer::AcceptedClient( ConnectedClient *client )
 	
 	Player *player = Data.GetPlayer( client->PlayerID );
 	
-	Raptor::Server->Data.Lock.Lock();
+	Data.Lock.Lock();
 	
 	// Send list of server properties to the new client.
 	Packet info( Raptor::Packet::INFO );
@@ -381,8 +671,8 @@ void RaptorServer::AcceptedClient( ConnectedClient *client )
 	
 	// Send list of all players to the new client.
 	Packet player_list( Raptor::Packet::PLAYER_LIST );
-	player_list.AddUShort( Raptor::Server->Data.Players.size() );
-	for( std::map<uint16_t,Player*>::iterator player_iter = Raptor::Server->Data.Players.begin(); player_iter != Raptor::Server->Data.Players.end(); player_iter ++ )
+	player_list.AddUShort( Data.Players.size() );
+	for( std::map<uint16_t,Player*>::iterator player_iter = Data.Players.begin(); player_iter != Data.Players.end(); player_iter ++ )
 	{
 		player_list.AddUShort( player_iter->second->ID );
 		player_list.AddString( player_iter->second->Name );
@@ -390,7 +680,7 @@ void RaptorServer::AcceptedClient( ConnectedClient *client )
 	client->Send( &player_list );
 	
 	// Send all existing players' properties to the new client.
-	for( std::map<uint16_t,Player*>::iterator player_iter = Raptor::Server->Data.Players.begin(); player_iter != Raptor::Server->Data.Players.end(); player_iter ++ )
+	for( std::map<uint16_t,Player*>::iterator player_iter = Data.Players.begin(); player_iter != Data.Players.end(); player_iter ++ )
 	{
 		Packet player_properties( Raptor::Packet::PLAYER_PROPERTIES );
 		player_properties.AddUShort( player_iter->second->ID );
@@ -442,6 +732,7 @@ void RaptorServer::AcceptedClient( ConnectedClient *client )
 	
 	// The client is now synchronized, so it should receive updates.
 	client->Synchronized = true;
+	VoiceRoutesDirty = true;
 	client->NetClock.Reset();
 	
 	if( player ) // FIXME: Don't display this message on resync.
@@ -450,7 +741,7 @@ void RaptorServer::AcceptedClient( ConnectedClient *client )
 		Packet message( Raptor::Packet::MESSAGE );
 		std::string join_message = player->Name + std::string(" has joined the game (v") + client->Version + std::string(").");
 		message.AddString( join_message.c_str() );
-		if( (Raptor::Game->State >= Raptor::State::CONNECTING) && (((client->IP & 0xFF000000) >> 24) == 127) )
+		if( HostState && (*HostState >= Raptor::State::CONNECTING) && (((client->IP & 0xFF000000) >> 24) == 127) )
 		{
 			// Self-hosted game prints localhost join messages to console, but not to messages.
 			ConsolePrint( join_message );
@@ -459,13 +750,13 @@ void RaptorServer::AcceptedClient( ConnectedClient *client )
 		else
 		{
 			// Show join messages on dedicated server console (player hosted servers will see the message packet).
-			if( Console != &(Raptor::Game->Console) )
+			if( Console != HostConsole )
 				ConsolePrint( join_message );
 			Net.SendAll( &message );
 		}
 	}
 	
-	Raptor::Server->Data.Lock.Unlock();
+	Data.Lock.Unlock();
 }
 
 
@@ -486,6 +777,7 @@ void RaptorServer::DroppedClient( ConnectedClient *client )
 	Net.Lock.Unlock();
 	
 	Player *player = Data.GetPlayer( client->DropPlayerID );
+	VoiceRoutesDirty = true;
 	
 	// Tell other clients about the removed player.
 	Packet player_remove( Raptor::Packet::PLAYER_REMOVE );
@@ -496,7 +788,7 @@ void RaptorServer::DroppedClient( ConnectedClient *client )
 	{
 		// Show leave messages on dedicated server console (player hosted servers will see the message packet).
 		std::string leave_message = player->Name + std::string(" has left the game.");
-		if( Console != &(Raptor::Game->Console) )
+		if( Console != HostConsole )
 			ConsolePrint( leave_message );
 		
 		// Tell other players to display a message about the removed player.
@@ -576,6 +868,9 @@ bool RaptorServer::SetPlayerProperty( Player *player, std::string name, std::str
 		else
 			player->Properties[ name ] = value;
 		
+		if( name == "team" )
+			VoiceRoutesDirty = true;
+		
 		Packet player_properties( Raptor::Packet::PLAYER_PROPERTIES );
 		player_properties.AddUShort( player->ID );
 		player_properties.AddUInt( 1 );
@@ -593,6 +888,24 @@ bool RaptorServer::SetPlayerProperty( Player *player, std::string name, std::str
 // ---------------------------------------------------------------------------
 
 
+void RaptorServer::RebuildVoiceRoutes( void )
+{
+	// Group player IDs by team; each list is in ascending order because Players is a map.
+	VoiceRoutes.clear();
+	for( std::map<uint16_t,Player*>::const_iterator player_iter = Data.Players.begin(); player_iter != Data.Players.end(); player_iter ++ )
+	{
+		std::string team = player_iter->second->PropertyAsString("team");
+		if( team.length() )
+			VoiceRoutes[ team ].push_back( player_iter->first );
+	}
+	
+	VoiceRoutesDirty = false;
+}
+
+
+// ---------------------------------------------------------------------------
+
+
 void RaptorServer::ChangeState( int state )
 {
 	State = state;
@@ -605,123 +918,174 @@ void RaptorServer::SetProperty( std::string name, std::string value )
 }
 
 
-// ---------------------------------------------------------------------------
-
-
-int RaptorServer::RaptorServerThread( void *game_server )
+bool RaptorServer::Listen( void )
 {
-	RaptorServer *server = (RaptorServer*) game_server;
-	Rand::Seed( time(NULL) );
+	Net.Initialize( Port );
 	
-	#ifdef WIN32
-		SYSTEM_INFO system_info;
-		GetSystemInfo( &system_info );
-		if( system_info.dwNumberOfProcessors >= 3 )
-			SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL );
-	#endif
+	if( ! Net.Listening )
+		return false;
 	
-	server->Net.Initialize( server->Port );
+	Started();
+	if( State == Raptor::State::CONNECTING )
+		State = Raptor::State::CONNECTED;
 	
 	char cstr[ 1024 ] = "";
+	snprintf( cstr, 1024, "%s server started on port %i.", Game.c_str(), Port );
+	ConsolePrint( cstr );
+	
+	Announcer.Initialize();
+	
+	GameClock.Reset();
+	AnnounceClock.Reset();
+	IdleClock.Reset();
+	Idle = false;
+	return true;
+}
+
+
+// One pass of the server loop: process network input, then run a frame if one is due.
+void RaptorServer::Tick( void )
+{
+	IdleClock.Reset();
 	
-	if( server->Net.Listening )
+	// Process network input buffers.
+	ProfileZone net_in_zone( "Net.ProcessIn" );
+	Net.ProcessIn();
+	net_in_zone.End();
+	
+	// Calculate the time elapsed for the "frame".
+	double elapsed = GameClock.ElapsedSeconds();
+	if( MaxFPS && (elapsed > 0.) && (elapsed < 1. / MaxFPS) )
+		elapsed = 1. / MaxFPS;
+	
+	if( elapsed > 0. )
 	{
-		server->Started();
-		if( server->State == Raptor::State::CONNECTING )
-			server->State = Raptor::State::CONNECTED;
+		FrameTime = elapsed;
+		GameClock.Advance( elapsed );
+		Clock::NewFrame();
 		
-		snprintf( cstr, 1024, "%s server started on port %i.", server->Game.c_str(), server->Port );
-		server->ConsolePrint( cstr );
+		ProfileZone frame_zone( "Frame" );
 		
-		NetUDP ServerAnnouncer;
-		ServerAnnouncer.Initialize();
+		// Update location.
+		ProfileZone update_zone( "Update" );
+		Update( FrameTime );
+		update_zone.End();
 		
-		server->GameClock.Reset();
-		server->AnnounceClock.Reset();
-		bool sleep_longer = false;
+		// Drop disconnected clients from the list.
+		Net.RemoveDisconnectedClients();
 		
-		while( server->Net.Listening )
+		// Send periodic updates to clients.
+		ProfileZone send_zone( "Net.SendUpdates" );
+		Net.SendUpdates();
+		send_zone.End();
+		
+		// Send periodic server announcements over UDP broadcast.
+		if( Announce && AnnouncePort
+		&& (AnnounceClock.ElapsedSeconds() > AnnounceInterval) )
 		{
-			// Process network input buffers.
-			server->Net.ProcessIn();
+			AnnounceClock.Reset();
+			
+			Packet info( Raptor::Packet::INFO );
 			
-			// Calculate the time elapsed for the "frame".
-			double elapsed = server->GameClock.ElapsedSeconds();
-			if( server->MaxFPS && (elapsed > 0.) && (elapsed < 1. / server->MaxFPS) )
-				elapsed = 1. / server->MaxFPS;
+			Data.Lock.Lock();
 			
-			if( elapsed > 0. )
+			// Properties.
+			info.AddUShort( 5 + Data.Properties.size() );
+			info.AddString( "game" );
+			info.AddString( Game );
+			info.AddString( "version" );
+			info.AddString( Version );
+			info.AddString( "port" );
+			info.AddString( Num::ToString( Port ) );
+			info.AddString( "state" );
+			info.AddString( Num::ToString( State ) );
+			info.AddString( "uptime" );
+			info.AddString( Num::ToString( Data.GameTime.ElapsedSeconds(), 1 ) );
+			for( std::map<std::string,std::string>::iterator property_iter = Data.Properties.begin(); property_iter != Data.Properties.end(); property_iter ++ )
 			{
-				server->FrameTime = elapsed;
-				server->GameClock.Advance( elapsed );
-				
-				// Update location.
-				server->Update( server->FrameTime );
-				
-				// Drop disconnected clients from the list.
-				server->Net.RemoveDisconnectedClients();
-				
-				// Send periodic updates to clients.
-				server->Net.SendUpdates();
-				
-				// Send periodic server announcements over UDP broadcast.
-				if( server->Announce && server->AnnouncePort
-				&& (server->AnnounceClock.ElapsedSeconds() > server->AnnounceInterval) )
-				{
-					server->AnnounceClock.Reset();
-					
-					Packet info( Raptor::Packet::INFO );
-					
-					server->Data.Lock.Lock();
-					
-					// Properties.
-					info.AddUShort( 5 + server->Data.Properties.size() );
-					info.AddString( "game" );
-					info.AddString( server->Game );
-					info.AddString( "version" );
-					info.AddString( server->Version );
-					info.AddString( "port" );
-					info.AddString( Num::ToString( server->Port ) );
-					info.AddString( "state" );
-					info.AddString( Num::ToString( server->State ) );
-					info.AddString( "uptime" );
-					info.AddString( Num::ToString( server->Data.GameTime.ElapsedSeconds(), 1 ) );
-					for( std::map<std::string,std::string>::iterator property_iter = server->Data.Properties.begin(); property_iter != server->Data.Properties.end(); property_iter ++ )
-					{
-						info.AddString( property_iter->first.c_str() );
-						info.AddString( property_iter->second.c_str() );
-					}
-					
-					// Players.
-					info.AddUShort( server->Data.Players.size() );
-					for( std::map<uint16_t,Player*>::iterator player_iter = server->Data.Players.begin(); player_iter != server->Data.Players.end(); player_iter ++ )
-						info.AddString( player_iter->second->Name.c_str() );
-					
-					server->Data.Lock.Unlock();
-					
-					ServerAnnouncer.Broadcast( &info, server->AnnouncePort );
-				}
-				
-				// Don't work very hard if nobody is connected.
-				server->Net.Lock.Lock();
-				sleep_longer = (server->Net.Clients.size() < 1);
-				server->Net.Lock.Unlock();
+				info.AddString( property_iter->first.c_str() );
+				info.AddString( property_iter->second.c_str() );
 			}
 			
-			// Let the thread rest a bit.
-			SDL_Delay( sleep_longer ? 100 : 1 );
+			// Players.
+			info.AddUShort( Data.Players.size() );
+			for( std::map<uint16_t,Player*>::iterator player_iter = Data.Players.begin(); player_iter != Data.Players.end(); player_iter ++ )
+				info.AddString( player_iter->second->Name.c_str() );
+			
+			Data.Lock.Unlock();
+			
+			Announcer.Broadcast( &info, AnnouncePort );
 		}
 		
-		snprintf( cstr, 1024, "%s server stopped.", server->Game.c_str() );
-		server->ConsolePrint( cstr );
+		// Don't work very hard if nobody is connected.
+		Net.Lock.Lock();
+		Idle = (Net.Clients.size() < 1);
+		Net.Lock.Unlock();
+	}
+}
+
+
+// Used by ServerPool workers, which can't sleep on behalf of one server.
+bool RaptorServer::TickDue( void )
+{
+	if( Idle )
+		return (IdleClock.ElapsedSeconds() >= 0.1);
+	return (GameClock.ElapsedSeconds() >= 0.);
+}
+
+
+void RaptorServer::Finish( bool started )
+{
+	char cstr[ 1024 ] = "";
+	
+	if( started )
+	{
+		snprintf( cstr, 1024, "%s server stopped.", Game.c_str() );
+		ConsolePrint( cstr );
 	}
 	else
 	{
-		snprintf( cstr, 1024, "%s server failed to start.", server->Game.c_str() );
-		server->ConsolePrint( cstr, TextConsole::MSG_ERROR );
+		snprintf( cstr, 1024, "%s server failed to start.", Game.c_str() );
+		ConsolePrint( cstr, TextConsole::MSG_ERROR );
+	}
+	
+	State = Raptor::State::DISCONNECTED;
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+int RaptorServer::RaptorServerThread( void *game_server )
+{
+	RaptorServer *server = (RaptorServer*) game_server;
+	Rand::Seed( time(NULL) );
+	Profiler::SetThreadName( "Server" );
+	
+	#ifdef WIN32
+		SYSTEM_INFO system_info;
+		GetSystemInfo( &system_info );
+		if( system_info.dwNumberOfProcessors >= 3 )
+			SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL );
+	#endif
+	
+	bool started = server->Listen();
+	
+	while( server->Net.Listening )
+	{
+		server->Tick();
+		
+		// Don't work very hard if nobody is connected; otherwise sleep until the next tick is due.
+		if( server->Idle )
+			SDL_Delay( 100 );
+		else if( server->GameClock.ElapsedSeconds() < 0. )
+			server->GameClock.SleepUntil( 0. );
+		else if( ! server->MaxFPS )
+			SDL_Delay( 1 );
 	}
 	
+	Profiler::ThreadDone();
 	server->Thread = NULL;
-	server->State = Raptor::State::DISCONNECTED;
+	server->Finish( started );
 	return 0;
 }
@@ -4,10 +4,13 @@
 
 #pragma once
 class RaptorServer;
+class ServerPool;
 
 #include "PlatformSpecific.h"
 
 #include <string>
+#include <map>
+#include <vector>
 
 #ifdef SDL2
 	#include <SDL2/SDL.h>
@@ -18,11 +21,17 @@ class RaptorServer;
 #endif
 
 #include "NetServer.h"
+#include "NetUDP.h"
 #include "Packet.h"
 #include "GameData.h"
 #include "TextConsole.h"
 
 
+// Dedicated servers can be built without the client by defining NO_CLIENT and compiling only
+// Core/RaptorServer, ServerPool, Net/* (except NetClient), Game/*, Libs/* (except ClientConfig and ResourceManager),
+// Graphics/Animation, Color, Effect, Model, ParticleSystem, and Sound/IMA, IMACodec, VoiceCodec.
+// That links against SDL and SDL_net only; use ServerConsole for commands instead of RaptorGame.
+// To host several games in one process, add each server to a ServerPool before starting it.
 class RaptorServer
 {
 public:
@@ -31,21 +40,33 @@ public:
 	
 	NetServer Net;
 	SDL_Thread *Thread;
+	ServerPool *Pool;
 	TextConsole *Console;
+	std::string ChatSeparator;
 	int Port;
 	double MaxFPS;
 	double NetRate;
 	Clock GameClock;
 	Clock AnnounceClock;
+	NetUDP Announcer;
 	bool Announce;
 	int AnnouncePort;
 	double AnnounceInterval;
 	
 	double FrameTime;
+	bool Idle;
+	Clock IdleClock;
 	
 	volatile int State;
 	GameData Data;
 	
+	std::map< std::string, std::vector<uint16_t> > VoiceRoutes;
+	bool VoiceRoutesDirty;
+	
+	// Set by a client hosting this server in the same process; NULL for dedicated servers.
+	TextConsole *HostConsole;
+	const volatile int *HostState;
+	
 	
 	RaptorServer( std::string game, std::string version );
 	virtual ~RaptorServer();
@@ -54,8 +75,14 @@ public:
 	void StopAndWait( double max_wait_seconds = 3. );
 	bool IsRunning( void );
 	
+	bool Listen( void );
+	void Tick( void );
+	bool TickDue( void );
+	void Finish( bool started );
+	
 	void ConsoleStart( void );
 	void ConsolePrint( std::string text, uint32_t type = 0 );
+	bool Command( std::string cmd, std::vector<std::string> *params = NULL );
 	
 	virtual void Update( double dt );
 	
@@ -70,6 +97,8 @@ public:
 	virtual void SendUpdate( ConnectedClient *client );
 	virtual bool SetPlayerProperty( Player *player, std::string name, std::string value, bool force = false );
 	
+	void RebuildVoiceRoutes( void );
+	
 	virtual void ChangeState( int state );
 	virtual void SetProperty( std::string name, std::string value );
 	
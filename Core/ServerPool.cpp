@@ -0,0 +1,284 @@
+/*
+ *  ServerPool.cpp
+ */
+
+#include "ServerPool.h"
+
+#include <cstddef>
+#include <time.h>
+#include <algorithm>
+#include "RaptorDefs.h"
+#include "File.h"
+#include "Rand.h"
+#include "Profiler.h"
+
+
+ServerPool::ServerPool( void )
+{
+	Running = false;
+}
+
+
+ServerPool::~ServerPool()
+{
+	// Stop servers while the workers are still around to finish them.
+	Lock.Lock();
+	std::list<RaptorServer*> servers = Servers;
+	Lock.Unlock();
+	for( std::list<RaptorServer*>::iterator server_iter = servers.begin(); server_iter != servers.end(); server_iter ++ )
+	{
+		if( (*server_iter)->IsRunning() )
+			(*server_iter)->StopAndWait();
+		Remove( *server_iter );
+	}
+	
+	Stop();
+	
+	for( std::map<std::string,Model*>::iterator model_iter = Models.begin(); model_iter != Models.end(); model_iter ++ )
+		delete model_iter->second;
+	Models.clear();
+}
+
+
+bool ServerPool::Start( int threads )
+{
+	if( Running )
+		return true;
+	
+	if( ! Reactor.Start() )
+		return false;
+	
+	Running = true;
+	
+	for( int i = 0; i < threads; i ++ )
+	{
+		#if SDL_VERSION_ATLEAST(2,0,0)
+			SDL_Thread *thread = SDL_CreateThread( ServerPoolThread, "ServerPool", this );
+		#else
+			SDL_Thread *thread = SDL_CreateThread( ServerPoolThread, this );
+		#endif
+		if( thread )
+			Threads.push_back( thread );
+		else
+			fprintf( stderr, "ServerPool::Start: SDL_CreateThread: %s\n", SDL_GetError() );
+	}
+	
+	if( Threads.empty() )
+	{
+		Stop();
+		return false;
+	}
+	
+	return true;
+}
+
+
+void ServerPool::Stop( void )
+{
+	Running = false;
+	
+	for( std::vector<SDL_Thread*>::iterator thread_iter = Threads.begin(); thread_iter != Threads.end(); thread_iter ++ )
+		SDL_WaitThread( *thread_iter, NULL );
+	Threads.clear();
+	
+	// Nothing is left to run the remaining servers, so shut them down here.
+	Lock.Lock();
+	std::list<RaptorServer*> active;
+	active.swap( Active );
+	Busy.clear();
+	Lock.Unlock();
+	for( std::list<RaptorServer*>::iterator server_iter = active.begin(); server_iter != active.end(); server_iter ++ )
+	{
+		(*server_iter)->Net.Disconnect();
+		(*server_iter)->Finish( true );
+	}
+	
+	Reactor.Stop();
+}
+
+
+// Call before starting the server; it will then run on this pool's workers and reactor.
+void ServerPool::Add( RaptorServer *server )
+{
+	Lock.Lock();
+	
+	if( std::find( Servers.begin(), Servers.end(), server ) == Servers.end() )
+		Servers.push_back( server );
+	server->Pool = this;
+	server->Net.Reactor = &Reactor;
+	
+	Lock.Unlock();
+}
+
+
+// Waits for any tick in progress, and stops the server if the pool was still running it.
+void ServerPool::Remove( RaptorServer *server )
+{
+	bool was_active = false;
+	
+	for( ;; )
+	{
+		Lock.Lock();
+		if( ! Busy.count( server ) )
+		{
+			was_active = (std::find( Active.begin(), Active.end(), server ) != Active.end());
+			Active.remove( server );
+			Servers.remove( server );
+			Lock.Unlock();
+			break;
+		}
+		Lock.Unlock();
+		SDL_Delay( 1 );
+	}
+	
+	if( was_active )
+	{
+		server->Net.Disconnect();
+		server->Finish( true );
+	}
+	
+	if( server->Pool == this )
+	{
+		server->Pool = NULL;
+		server->Net.Reactor = NULL;
+	}
+}
+
+
+// Called by RaptorServer::Start once the server is listening.
+void ServerPool::Run( RaptorServer *server )
+{
+	if( ! Running )
+		fprintf( stderr, "ServerPool::Run: Pool has not been started.\n" );
+	
+	Lock.Lock();
+	
+	if( std::find( Active.begin(), Active.end(), server ) == Active.end() )
+		Active.push_back( server );
+	
+	Lock.Unlock();
+}
+
+
+std::string ServerPool::Find( const std::string &name ) const
+{
+	// Leading slash specifies an absolute path within game directory (ignore SearchPath).
+	if( name[ 0 ] == '/' )
+		return name.substr( 1 );
+	
+	for( std::deque<std::string>::const_iterator path_iter = SearchPath.begin(); path_iter != SearchPath.end(); path_iter ++ )
+	{
+		std::string path = *path_iter + "/" + name;
+		if( File::Exists(path.c_str()) )
+			return path;
+	}
+	
+	return name;
+}
+
+
+// Loaded once without textures and never modified afterwards, so every instance can share it.
+const Model *ServerPool::GetModel( const std::string &name, double scale )
+{
+	if( name.empty() )
+		return NULL;
+	
+	ModelsLock.Lock();
+	
+	Model *model = NULL;
+	std::map<std::string,Model*>::iterator found = Models.find( name );
+	if( found != Models.end() )
+		model = found->second;
+	else
+	{
+		std::string filename = Find( name );
+		
+		model = new Model();
+		if( ! model->LoadOBJ( filename, false ) )
+			fprintf( stderr, "ServerPool::GetModel: Couldn't load %s\n", filename.c_str() );
+		
+		if( scale != 1. )
+			model->ScaleBy( scale );
+		
+		// Even if it's empty (file not found), keep it to prevent multiple lookups.
+		Models[ name ] = model;
+	}
+	
+	ModelsLock.Unlock();
+	
+	return model;
+}
+
+
+// Pick a server that needs a tick (or needs to finish) and isn't already on another worker.
+RaptorServer *ServerPool::NextServer( void )
+{
+	RaptorServer *server = NULL;
+	
+	Lock.Lock();
+	
+	for( std::list<RaptorServer*>::iterator server_iter = Active.begin(); server_iter != Active.end(); server_iter ++ )
+	{
+		if( Busy.count( *server_iter ) )
+			continue;
+		
+		if( (! (*server_iter)->Net.Listening) || (*server_iter)->TickDue() )
+		{
+			server = *server_iter;
+			
+			// Move it to the back so busy servers can't starve the others.
+			Active.erase( server_iter );
+			Active.push_back( server );
+			Busy.insert( server );
+			break;
+		}
+	}
+	
+	Lock.Unlock();
+	
+	return server;
+}
+
+
+// -----------------------------------------------------------------------------
+
+
+int ServerPool::ServerPoolThread( void *pool )
+{
+	ServerPool *server_pool = (ServerPool*) pool;
+	Rand::Seed( time(NULL) );
+	Profiler::SetThreadName( "ServerPool" );
+	
+	while( server_pool->Running )
+	{
+		RaptorServer *server = server_pool->NextServer();
+		if( ! server )
+		{
+			SDL_Delay( 1 );
+			continue;
+		}
+		
+		if( server->Net.Listening )
+		{
+			server->Tick();
+			
+			server_pool->Lock.Lock();
+			server_pool->Busy.erase( server );
+			server_pool->Lock.Unlock();
+		}
+		else
+		{
+			// Stopped by StopAndWait; take it out of rotation before it reports DISCONNECTED.
+			server_pool->Lock.Lock();
+			server_pool->Active.remove( server );
+			server_pool->Busy.erase( server );
+			server_pool->Lock.Unlock();
+			
+			server->Finish( true );
+		}
+	}
+	
+	Profiler::ThreadDone();
+	
+	return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ *  ServerPool.h
+ */
+
+#pragma once
+class ServerPool;
+
+#include "PlatformSpecific.h"
+
+#include <string>
+#include <list>
+#include <set>
+#include <map>
+#include <deque>
+#include <vector>
+
+#ifdef SDL2
+	#include <SDL2/SDL.h>
+	#include <SDL2/SDL_thread.h>
+#else
+	#include <SDL/SDL.h>
+	#include <SDL/SDL_thread.h>
+#endif
+
+#include "RaptorServer.h"
+#include "NetReactor.h"
+#include "Model.h"
+#include "Mutex.h"
+
+
+// Hosts several RaptorServer instances in one process.  Instead of a game thread per server and
+// network threads per client, a fixed set of workers runs whichever server's tick is due next,
+// and one NetReactor handles every socket.  Each server still has its own GameData and runs on
+// only one worker at a time.  Models from GetModel are loaded once and shared read-only, so give
+// each object its own copy with BecomeInstance before moving or colliding it.  The pool must
+// outlive the servers added to it.
+class ServerPool
+{
+public:
+	NetReactor Reactor;
+	std::vector<SDL_Thread*> Threads;
+	volatile bool Running;
+	std::deque<std::string> SearchPath;
+	
+	
+	ServerPool( void );
+	virtual ~ServerPool();
+	
+	bool Start( int threads = 2 );
+	void Stop( void );
+	
+	void Add( RaptorServer *server );
+	void Remove( RaptorServer *server );
+	void Run( RaptorServer *server );
+	
+	std::string Find( const std::string &name ) const;
+	const Model *GetModel( const std::string &name, double scale = 1. );
+	
+	static int ServerPoolThread( void *pool );
+
+private:
+	Mutex Lock;
+	std::list<RaptorServer*> Servers, Active;
+	std::set<RaptorServer*> Busy;
+	Mutex ModelsLock;
+	std::map<std::string,Model*> Models;
+	
+	RaptorServer *NextServer( void );
+};
@@ -6,8 +6,8 @@
 
 #include <cstddef>
 #include <cfloat>
-#include "Camera.h"
-#include "RaptorGame.h"
+#include "Str.h"
+#include "Profiler.h"
 
 
 GameData::GameData( void )
@@ -18,6 +18,8 @@ GameData::GameData( void )
 	MaxFrameTime = 0.5;  // Assume dropping below 2 FPS is a momentary hiccup.
 	TimeScale = 1.;
 	ThreadCount = 0;
+	ClientSide = false;
+	Server = NULL;
 }
 
 
@@ -42,7 +44,7 @@ uint32_t GameData::AddObject( GameObject *obj )
 	{
 		GameObjects[ obj_id ] = obj;
 		
-		if( this == &(Raptor::Game->Data) )
+		if( ClientSide )
 			obj->ClientInit();
 	}
 	
@@ -115,6 +117,7 @@ void GameData::ClearObjects( void )
 	ObjectIDsToRemove.clear();
 	Collisions.clear();
 	Effects.clear();
+	Particles.Clear();
 }
 
 
@@ -140,6 +143,8 @@ void GameData::Clear( void )
 
 void GameData::CheckCollisions( double dt )
 {
+	PROFILE_ZONE( "CheckCollisions" );
+	
 	Collisions.clear();
 	
 	std::map< uint32_t, std::list<GameObject*> > moving_can_hit_own_type;
@@ -341,8 +346,6 @@ void GameData::CheckCollisions( double dt )
 
 void GameData::Update( double dt )
 {
-	AntiJitter = Raptor::Game->Cfg.SettingAsDouble("net_anti_jitter",0.999);
-	
 	for( std::map<uint32_t,GameObject*>::iterator obj_iter = GameObjects.begin(); obj_iter != GameObjects.end(); obj_iter ++ )
 		obj_iter->second->Update( dt );  // NOTE: Do not multiply by TimeScale here; dt will be scaled by the game's Update method.
 	
@@ -358,10 +361,10 @@ void GameData::Update( double dt )
 		effect_iter = effect_next;
 	}
 	
+	Particles.Update( dt );
+	
 	TimeScale = PropertyAsDouble("time_scale",1.);
 	MaxFrameTime = 0.5 * TimeScale;
-	
-	ThreadCount = Raptor::Game->Cfg.SettingAsInt("sv_threads");
 }
 
 
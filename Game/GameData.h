@@ -6,6 +6,7 @@
 class GameData;
 class Collision;
 class CollisionDataSet;
+class RaptorServer;
 
 #include "PlatformSpecific.h"
 
@@ -18,6 +19,7 @@ class CollisionDataSet;
 #include "Player.h"
 #include "Mutex.h"
 #include "Effect.h"
+#include "ParticleSystem.h"
 #include "Clock.h"
 
 
@@ -32,12 +34,15 @@ public:
 	std::map<uint16_t,Player*> Players;
 	
 	Clock GameTime;
+	bool ClientSide;
+	RaptorServer *Server;  // The server instance that owns this data, or NULL on the client.
 	
 	int ThreadCount;
 	std::list<Collision> Collisions;
 	std::set<uint32_t> ObjectIDsToRemove;
 	
 	std::list<Effect> Effects;
+	ParticleSystem Particles;  // Pooled alternative to Effects for plain billboards; both are updated each frame.
 	
 	std::map<std::string,std::string> Properties;
 	
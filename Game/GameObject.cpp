@@ -8,7 +8,30 @@
 #include <cmath>
 #include <cfloat>
 #include "Num.h"
-#include "RaptorGame.h"
+#include "RaptorDefs.h"
+#include "RaptorServer.h"
+#ifndef NO_CLIENT
+	#include "RaptorGame.h"
+#endif
+
+
+// Position stays full double precision; orientation is a smallest-three quaternion (17/27/28 bits per component by precision),
+// which keeps Fwd and Up at least as precise as the 16-bit and float components they replaced.
+static NetSchema<GameObject> BuildUpdateFields( void )
+{
+	NetSchema<GameObject> fields;
+	fields.Double( &GameObject::X );
+	fields.Double( &GameObject::Y );
+	fields.Double( &GameObject::Z );
+	fields.Orientation( &GameObject::Fwd, &GameObject::Up, 17, 27, 28 );
+	fields.Vector( &GameObject::MotionVector );
+	fields.Float( &GameObject::RollRate, 0 );
+	fields.Float( &GameObject::PitchRate, 0 );
+	fields.Float( &GameObject::YawRate, 0 );
+	return fields;
+}
+
+const NetSchema<GameObject> GameObject::UpdateFields = BuildUpdateFields();
 
 
 GameObject::GameObject( uint32_t id, uint32_t type_code, uint16_t player_id ) : Pos3D()
@@ -52,7 +75,7 @@ GameObject::~GameObject()
 
 bool GameObject::ClientSide( void ) const
 {
-	return (Data == &(Raptor::Game->Data));
+	return (Data && Data->ClientSide);
 }
 
 
@@ -137,48 +160,7 @@ void GameObject::ReadFromInitPacket( Packet *packet, int8_t precision )
 
 void GameObject::AddToUpdatePacket( Packet *packet, int8_t precision )
 {
-	packet->AddDouble( X );
-	packet->AddDouble( Y );
-	packet->AddDouble( Z );
-	if( precision >= 0 )
-	{
-		packet->AddFloat( Fwd.X );
-		packet->AddFloat( Fwd.Y );
-		packet->AddFloat( Fwd.Z );
-	}
-	else
-	{
-		packet->AddShort( Num::UnitFloatTo16(Fwd.X) );
-		packet->AddShort( Num::UnitFloatTo16(Fwd.Y) );
-		packet->AddShort( Num::UnitFloatTo16(Fwd.Z) );
-	}
-	if( precision >= 1 )
-	{
-		packet->AddFloat( Up.X );
-		packet->AddFloat( Up.Y );
-		packet->AddFloat( Up.Z );
-	}
-	else if( precision >= 0 )
-	{
-		packet->AddShort( Num::UnitFloatTo16(Up.X) );
-		packet->AddShort( Num::UnitFloatTo16(Up.Y) );
-		packet->AddShort( Num::UnitFloatTo16(Up.Z) );
-	}
-	else
-	{
-		packet->AddChar( Num::UnitFloatTo8(Up.X) );
-		packet->AddChar( Num::UnitFloatTo8(Up.Y) );
-		packet->AddChar( Num::UnitFloatTo8(Up.Z) );
-	}
-	packet->AddFloat( MotionVector.X );
-	packet->AddFloat( MotionVector.Y );
-	packet->AddFloat( MotionVector.Z );
-	if( precision >= 0 )
-	{
-		packet->AddFloat( RollRate );
-		packet->AddFloat( PitchRate );
-		packet->AddFloat( YawRate );
-	}
+	UpdateFields.Write( this, packet, precision );
 }
 
 
@@ -190,48 +172,7 @@ void GameObject::ReadFromUpdatePacket( Packet *packet, int8_t precision )
 	PrevPitchRate = PitchRate;
 	PrevYawRate   = YawRate;
 	
-	X = packet->NextDouble();
-	Y = packet->NextDouble();
-	Z = packet->NextDouble();
-	if( precision >= 0 )
-	{
-		Fwd.X = packet->NextFloat();
-		Fwd.Y = packet->NextFloat();
-		Fwd.Z = packet->NextFloat();
-	}
-	else
-	{
-		Fwd.X = Num::UnitFloatFrom16( packet->NextShort() );
-		Fwd.Y = Num::UnitFloatFrom16( packet->NextShort() );
-		Fwd.Z = Num::UnitFloatFrom16( packet->NextShort() );
-	}
-	if( precision >= 1 )
-	{
-		Up.X = packet->NextFloat();
-		Up.Y = packet->NextFloat();
-		Up.Z = packet->NextFloat();
-	}
-	else if( precision >= 0 )
-	{
-		Up.X = Num::UnitFloatFrom16( packet->NextShort() );
-		Up.Y = Num::UnitFloatFrom16( packet->NextShort() );
-		Up.Z = Num::UnitFloatFrom16( packet->NextShort() );
-	}
-	else
-	{
-		Up.X = Num::UnitFloatFrom8( packet->NextChar() );
-		Up.Y = Num::UnitFloatFrom8( packet->NextChar() );
-		Up.Z = Num::UnitFloatFrom8( packet->NextChar() );
-	}
-	MotionVector.X = packet->NextFloat();
-	MotionVector.Y = packet->NextFloat();
-	MotionVector.Z = packet->NextFloat();
-	if( precision >= 0 )
-	{
-		RollRate  = packet->NextFloat();
-		PitchRate = packet->NextFloat();
-		YawRate   = packet->NextFloat();
-	}
+	UpdateFields.Read( this, packet, precision );
 	FixVectors();
 	
 	// Remove jitter from delayed position updates by moving object forward to predicted position.
@@ -376,15 +317,18 @@ void GameObject::SendUpdate( int8_t precision )
 	update.AddChar( precision );
 	update.AddUInt( 1 );
 	update.AddUInt( ID );
+#ifndef NO_CLIENT
 	if( ClientSide() )
 	{
 		AddToUpdatePacketFromClient( &update, precision );
 		Raptor::Game->Net.Send( &update );
 	}
 	else
+#endif
 	{
 		AddToUpdatePacketFromServer( &update, precision );
-		Raptor::Server->Net.SendAll( &update );
+		RaptorServer *server = (Data && Data->Server) ? Data->Server : Raptor::Server;
+		server->Net.SendAll( &update );
 	}
 }
 
@@ -398,3 +342,16 @@ Shader *GameObject::WantShader( void ) const
 {
 	return NULL;
 }
+
+
+GLuint GameObject::WantTexture( void ) const
+{
+	// Non-zero means RenderQueue binds this texture before Draw, so Draw need not bind it again.
+	return 0;
+}
+
+
+bool GameObject::IsTranslucent( void ) const
+{
+	return false;
+}
@@ -11,6 +11,7 @@ class GameObject;
 #include "Pos.h"
 #include "Clock.h"
 #include "Packet.h"
+#include "NetSchema.h"
 #include "GameData.h"
 #include "Player.h"
 #include "Shader.h"
@@ -34,6 +35,8 @@ public:
 	double PrevRollRate, PrevPitchRate, PrevYawRate;
 	double SmoothRadius;
 	
+	static const NetSchema<GameObject> UpdateFields;
+	
 	
 	GameObject( uint32_t id = 0, uint32_t type_code = '    ', uint16_t player_id = 0 );
 	GameObject( const GameObject &other );
@@ -71,6 +74,8 @@ public:
 	
 	virtual void Draw( void );
 	virtual Shader *WantShader( void ) const;
+	virtual GLuint WantTexture( void ) const;
+	virtual bool IsTranslucent( void ) const;
 	
 private:
 	uint32_t TypeCode;
@@ -5,7 +5,10 @@
 #include "Player.h"
 
 #include "Str.h"
-#include "RaptorGame.h"
+#include "RaptorDefs.h"
+#ifndef NO_CLIENT
+	#include "RaptorGame.h"
+#endif
 #include <cstdlib>
 #include <cstring>
 
@@ -117,12 +120,14 @@ std::vector<int> Player::PropertyAsInts( std::string name ) const
 
 bool Player::PlayingVoice( void ) const
 {
+#ifndef NO_CLIENT
 	std::map<uint16_t,PlaybackBuffer*>::const_iterator voice_buffer = Raptor::Game->Snd.VoiceBuffers.find( ID );
 	if( (voice_buffer != Raptor::Game->Snd.VoiceBuffers.end()) && (voice_buffer->second->AudioChannel >= 0) )
 		return true;
 	
 	if( (ID == Raptor::Game->PlayerID) && Raptor::Game->Mic.Transmitting )
 		return true;
+#endif
 	
 	return false;
 }
@@ -130,12 +135,14 @@ bool Player::PlayingVoice( void ) const
 
 uint8_t Player::VoiceChannel( void ) const
 {
+#ifndef NO_CLIENT
 	std::map<uint16_t,PlaybackBuffer*>::const_iterator voice_buffer = Raptor::Game->Snd.VoiceBuffers.find( ID );
 	if( (voice_buffer != Raptor::Game->Snd.VoiceBuffers.end()) && (voice_buffer->second->AudioChannel >= 0) )
 		return voice_buffer->second->VoiceChannel;
 	
 	if( ID == Raptor::Game->PlayerID )
 		return Raptor::Game->Mic.Transmitting;
+#endif
 	
 	return Raptor::VoiceChannel::NONE;
 }
@@ -4,11 +4,14 @@
 
 #include "Animation.h"
 
+#include <cstring>
 #include <fstream>
 #include <algorithm>
 #include <math.h>
 #include "Str.h"
-#include "RaptorGame.h"
+#ifndef NO_CLIENT
+	#include "RaptorGame.h"
+#endif
 
 
 Animation::Animation( void )
@@ -75,11 +78,13 @@ void Animation::Load( std::string filename )
 				// We alternate between textures and times.
 				else if( count % 2 )
 				{
+#ifndef NO_CLIENT
 					if( buffer[ 0 ] != '*' )
 						// Unless it's a framebuffer texture, look in same dir as ani file.
 						texture = Raptor::Game->Res.GetTexture( subdir + std::string(buffer) );
 					else
 						texture = Raptor::Game->Res.GetTexture( std::string(buffer) );
+#endif
 				}
 				else
 					AddFrame( texture, atof(buffer) );
@@ -100,7 +105,12 @@ void Animation::Load( std::string filename )
 		Speed = 1.;
 		MostRecentFrame = 0;
 		
+#ifdef NO_CLIENT
+		// Dedicated servers keep frame timing without loading textures.
+		AddFrame( 0, 1. );
+#else
 		AddFrame( Raptor::Game->Res.GetTexture(filename), 1. );
+#endif
 	}
 	
 	LoadedTime.Reset();
@@ -113,7 +123,9 @@ void Animation::Reload( void )
 	int old_play_count = PlayCount;
 	double old_speed = Speed;
 	
+#ifndef NO_CLIENT
 	BecomeInstance( Raptor::Game->Res.GetAnimation(Name) );
+#endif
 	
 	Timer = old_timer;
 	PlayCount = old_play_count;
@@ -172,8 +184,10 @@ void Animation::Start( void )
 
 GLuint Animation::CurrentFrame( void )
 {
-	if( LoadedTime.ElapsedSeconds() > Raptor::Game->Res.ResetTime.ElapsedSeconds() )
+#ifndef NO_CLIENT
+	if( LoadedTime.Before( &(Raptor::Game->Res.ResetTime) ) )
 		Reload();
+#endif
 	
 	size_t count = FrameTimes.size();
 	if( count && Frames.size() )
@@ -189,7 +203,7 @@ GLuint Animation::CurrentFrame( void )
 		if( loop_time )
 		{
 			// Figure out where we are in the cycle and return that frame.
-			double time_in_animation = fmod( Timer.ElapsedSeconds(), loop_time );
+			double time_in_animation = fmod( Timer.FrameSeconds(), loop_time );
 			for( size_t i = 0; i < count; i ++ )
 			{
 				time_in_animation -= FrameTimes.at( i ) / Speed;
@@ -206,7 +220,9 @@ GLuint Animation::CurrentFrame( void )
 			std::vector<GLuint>::const_iterator frame_iter = std::find( Frames.begin(), Frames.end(), MostRecentFrame );
 			if( frame_iter != Frames.end() )
 			{
+#ifndef NO_CLIENT
 				if( (! Raptor::Game->Gfx.DrawTo) || (Raptor::Game->Gfx.DrawTo != Raptor::Game->Head.EyeR) ) // Make sure both eyes see the same frame in VR.
+#endif
 				{
 					frame_iter ++;
 					MostRecentFrame = (frame_iter != Frames.end()) ? *frame_iter : *(Frames.begin());
@@ -229,8 +245,10 @@ GLuint Animation::CurrentFrame( void )
 GLuint Animation::FrameAt( double secs )
 {
 	// NOTE: This is the only reason this function isn't const.
-	if( LoadedTime.ElapsedSeconds() > Raptor::Game->Res.ResetTime.ElapsedSeconds() )
+#ifndef NO_CLIENT
+	if( LoadedTime.Before( &(Raptor::Game->Res.ResetTime) ) )
 		Reload();
+#endif
 	
 	double loop_time = LoopTime();
 	if( loop_time )
@@ -275,7 +293,7 @@ bool Animation::Finished( void ) const
 	if( PlayCount <= 0 )
 		return false;
 	
-	if( Timer.ElapsedSeconds() >= (LoopTime() * (double) PlayCount) )
+	if( Timer.FrameSeconds() >= (LoopTime() * (double) PlayCount) )
 		return true;
 	
 	return false;
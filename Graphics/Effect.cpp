@@ -7,7 +7,9 @@
 #include <cmath>
 #include "Math2D.h"
 #include "SoundOut.h"
-#include "RaptorGame.h"
+#ifndef NO_CLIENT
+	#include "RaptorGame.h"
+#endif
 
 
 Effect::Effect( Animation *anim, double size, Mix_Chunk *sound, double loudness, const Pos3D *pos, const Vec3D *motion_vec, double rotation_speed, double speed_scale, double seconds_to_live )
@@ -17,8 +19,13 @@ Effect::Effect( Animation *anim, double size, Mix_Chunk *sound, double loudness,
 	Anim.Speed = speed_scale;
 	
 	AudioChannel = -1;
+#ifndef NO_CLIENT
 	if( sound )
-		AudioChannel = Raptor::Game->Snd.PlayPanned( sound, X, Y, Z, loudness );
+	{
+		AudioVoice = Raptor::Game->Snd.PlayVoiceAt( sound, X, Y, Z, loudness );
+		AudioChannel = Raptor::Game->Snd.VoiceChannel( AudioVoice );
+	}
+#endif
 	
 	Size = size;
 	Width = size;
@@ -44,8 +51,13 @@ Effect::Effect( Animation *anim, double length, double width, Mix_Chunk *sound,
 	Anim.Speed = speed_scale;
 	
 	AudioChannel = -1;
+#ifndef NO_CLIENT
 	if( sound )
-		AudioChannel = Raptor::Game->Snd.PlayPanned( sound, X, Y, Z, loudness );
+	{
+		AudioVoice = Raptor::Game->Snd.PlayVoiceAt( sound, X, Y, Z, loudness );
+		AudioChannel = Raptor::Game->Snd.VoiceChannel( AudioVoice );
+	}
+#endif
 	
 	Size = length;
 	Width = width;
@@ -79,15 +91,22 @@ void Effect::Update( double dt )
 	UpdateAudioPos();
 	
 	// Don't start the animation until Lifetime.CountUpToSecs is complete.
-	if( Lifetime.Progress() < 1. )
+	if( Lifetime.FrameProgress() < 1. )
 		Anim.Start();
 }
 
 
 void Effect::UpdateAudioPos( void )
 {
-	if( AudioChannel != -1 )
-		AudioChannel = Raptor::Game->Snd.SetPos( AudioChannel, X, Y, Z );
+#ifndef NO_CLIENT
+	// AudioChannel follows the voice, which may be virtual (-1) for a while and then get a different channel.
+	if( AudioVoice.Valid() )
+	{
+		if( ! Raptor::Game->Snd.SetVoicePos( AudioVoice, X, Y, Z ) )
+			AudioVoice = SoundOutHandle();
+		AudioChannel = Raptor::Game->Snd.VoiceChannel( AudioVoice );
+	}
+#endif
 }
 
 
@@ -95,20 +114,34 @@ bool Effect::Finished( void )
 {
 	if( Anim.Finished() )
 		return true;
-	if( (SecondsToLive > 0.) && (Lifetime.ElapsedSeconds() > SecondsToLive + Lifetime.CountUpToSecs) )
+	if( (SecondsToLive > 0.) && (Lifetime.FrameSeconds() > SecondsToLive + Lifetime.CountUpToSecs) )
 		return true;
 	return false;
 }
 
 
+#ifndef NO_CLIENT
 void Effect::Draw( void )
 {
 	// Allow using Lifetime.CountUpToSecs to queue a future effect.
-	if( Lifetime.Progress() < 1. )
+	if( Lifetime.FrameProgress() < 1. )
 		return;
 	
 	glEnable( GL_TEXTURE_2D );
 	glBindTexture( GL_TEXTURE_2D, Anim.CurrentFrame() );
+	
+	glBegin( GL_QUADS );
+		DrawQuad();
+	glEnd();
+	
+	glDisable( GL_TEXTURE_2D );
+	glColor4f( 1.f, 1.f, 1.f, 1.f );
+}
+
+
+void Effect::DrawQuad( void )
+{
+	// Called between glBegin(GL_QUADS) and glEnd, so effects sharing a texture can be drawn together.
 	glColor4f( Red, Green, Blue, Alpha );
 	
 	// Calculate corners.
@@ -121,26 +154,20 @@ void Effect::Draw( void )
 	br.RotateAround( &(Raptor::Game->Cam.Fwd), Rotation + 180. );
 	bl.RotateAround( &(Raptor::Game->Cam.Fwd), Rotation + 180. );
 	
-	glBegin( GL_QUADS );
-		
-		// Top-left
-		glTexCoord2i( 0, 0 );
-		glVertex3d( X + tl.X, Y + tl.Y, Z + tl.Z );
-		
-		// Bottom-left
-		glTexCoord2i( 0, 1 );
-		glVertex3d( X + bl.X, Y + bl.Y, Z + bl.Z );
-		
-		// Bottom-right
-		glTexCoord2i( 1, 1 );
-		glVertex3d( X + br.X, Y + br.Y, Z + br.Z );
-		
-		// Top-right
-		glTexCoord2i( 1, 0 );
-		glVertex3d( X + tr.X, Y + tr.Y, Z + tr.Z );
-		
-	glEnd();
+	// Top-left
+	glTexCoord2i( 0, 0 );
+	glVertex3d( X + tl.X, Y + tl.Y, Z + tl.Z );
 	
-	glDisable( GL_TEXTURE_2D );
-	glColor4f( 1.f, 1.f, 1.f, 1.f );
+	// Bottom-left
+	glTexCoord2i( 0, 1 );
+	glVertex3d( X + bl.X, Y + bl.Y, Z + bl.Z );
+	
+	// Bottom-right
+	glTexCoord2i( 1, 1 );
+	glVertex3d( X + br.X, Y + br.Y, Z + br.Z );
+	
+	// Top-right
+	glTexCoord2i( 1, 0 );
+	glVertex3d( X + tr.X, Y + tr.Y, Z + tr.Z );
 }
+#endif
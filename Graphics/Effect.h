@@ -4,12 +4,18 @@
 
 #pragma once
 class Effect;
+struct Mix_Chunk;
 
 #include "PlatformSpecific.h"
 #include "Pos.h"
 #include <cstddef>
 #include "Animation.h"
-#include "SoundOut.h"
+#include "SoundOutHandle.h"
+
+#ifndef NO_CLIENT
+	// Game code has long relied on Effect.h for SoundOut; dedicated servers have no audio.
+	#include "SoundOut.h"
+#endif
 
 class Effect : public Pos3D
 {
@@ -21,6 +27,7 @@ public:
 	Animation Anim;
 	float Red, Green, Blue, Alpha;
 	int AudioChannel;
+	SoundOutHandle AudioVoice;
 	Clock Lifetime;
 	double SecondsToLive;
 	
@@ -32,4 +39,5 @@ public:
 	void UpdateAudioPos( void );
 	bool Finished( void );
 	void Draw( void );
+	void DrawQuad( void );
 };
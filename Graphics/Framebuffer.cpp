@@ -47,7 +47,7 @@ Framebuffer::~Framebuffer()
 
 void Framebuffer::Clear( void )
 {
-	if( Initialized && (LoadedTime.ElapsedSeconds() > Raptor::Game->Res.ResetTime.ElapsedSeconds()) )
+	if( Initialized && LoadedTime.Before( &(Raptor::Game->Res.ResetTime) ) )
 	{
 		// No OpenGL cleanup if we already lost the context.
 		FramebufferHandle = 0;
@@ -221,7 +221,7 @@ void Framebuffer::Reload( void )
 
 bool Framebuffer::Select( void )
 {
-	if( Initialized && (LoadedTime.ElapsedSeconds() > Raptor::Game->Res.ResetTime.ElapsedSeconds()) )
+	if( Initialized && LoadedTime.Before( &(Raptor::Game->Res.ResetTime) ) )
 		Reload();
 	
 	if( Initialized )
@@ -284,6 +284,8 @@ void Framebuffer::Setup2D( double y1, double y2 )
 
 void Framebuffer::Setup2D( double x1, double y1, double x2, double y2 )
 {
+	Raptor::Game->Gfx.FrustumValid = false;
+	
 	glDisable( GL_DEPTH_TEST );
 	glMatrixMode( GL_PROJECTION );
 	glLoadIdentity();
@@ -329,4 +331,6 @@ void Framebuffer::Setup3D( double fov_w, double cam_x, double cam_y, double cam_
 	glMatrixMode( GL_MODELVIEW );
 	glLoadIdentity();
 	gluLookAt( cam_x, cam_y, cam_z,  cam_look_x, cam_look_y, cam_look_z,  cam_up_x, cam_up_y, cam_up_z );
+	
+	Raptor::Game->Gfx.SetFrustum( fov_w / aspect_ratio, aspect_ratio, H, cam_x, cam_y, cam_z, cam_look_x, cam_look_y, cam_look_z, cam_up_x, cam_up_y, cam_up_z );
 }
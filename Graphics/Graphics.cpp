@@ -32,9 +32,19 @@ Graphics::Graphics( void )
 	FSAA = 0;
 	AF = 16;
 	Framebuffers = true;
+	VertexBuffers = true;
 	LightQuality = 4;
 	GlowMaps = true;
 	
+	Culling = true;
+	FrustumValid = false;
+	FrustumSinW = FrustumSinH = 0.;
+	FrustumCosW = FrustumCosH = 1.;
+	FrustumPixels = 0.;
+	LODScale = 1.;
+	ModelsDrawn = 0;
+	ModelsCulled = 0;
+	
 	Screen = NULL;
 	DrawTo = NULL;
 }
@@ -52,6 +62,14 @@ Graphics::~Graphics()
 	}
 	
 	Initialized = false;
+	
+	for( std::map< std::pair<int,uint32_t>, PrimitiveMesh* >::iterator mesh_iter = SphereMeshes.begin(); mesh_iter != SphereMeshes.end(); mesh_iter ++ )
+		delete mesh_iter->second;
+	SphereMeshes.clear();
+	
+	for( std::map< int, PrimitiveMesh* >::iterator mesh_iter = CircleMeshes.begin(); mesh_iter != CircleMeshes.end(); mesh_iter ++ )
+		delete mesh_iter->second;
+	CircleMeshes.clear();
 }
 
 
@@ -385,7 +403,10 @@ void Graphics::Restart( void )
 	ZFar = Raptor::Game->Cfg.SettingAsDouble( "g_zfar", 15000 );
 	VSync = Raptor::Game->Cfg.SettingAsBool( "g_vsync", false );
 	Framebuffers = Raptor::Game->Cfg.SettingAsBool( "g_framebuffers", true );
+	VertexBuffers = Raptor::Game->Cfg.SettingAsBool( "g_vbo", true );
 	GlowMaps = Raptor::Game->Cfg.SettingAsBool( "g_shader_glowmap", true );
+	Culling = Raptor::Game->Cfg.SettingAsBool( "g_culling", true );
+	LODScale = Raptor::Game->Cfg.SettingAsDouble( "g_lod", 1. );
 	
 	SetMode( x, y, bpp, fullscreen, fsaa, af, zbits );
 }
@@ -489,6 +510,8 @@ void Graphics::Setup2D( double y1, double y2 )
 
 void Graphics::Setup2D( double x1, double y1, double x2, double y2 )
 {
+	FrustumValid = false;
+	
 	if( DrawTo )
 	{
 		DrawTo->Setup2D( x1, y1, x2, y2 );
@@ -547,6 +570,66 @@ void Graphics::Setup3D( double fov_w, double cam_x, double cam_y, double cam_z,
 	glMatrixMode( GL_MODELVIEW );
 	glLoadIdentity();
 	gluLookAt( cam_x, cam_y, cam_z,  cam_look_x, cam_look_y, cam_look_z,  cam_up_x, cam_up_y, cam_up_z );
+	
+	SetFrustum( fov_w / aspect_ratio, aspect_ratio, H, cam_x, cam_y, cam_z, cam_look_x, cam_look_y, cam_look_z, cam_up_x, cam_up_y, cam_up_z );
+}
+
+
+void Graphics::SetFrustum( double fov_h, double aspect_ratio, double pixels_h, double cam_x, double cam_y, double cam_z, double cam_look_x, double cam_look_y, double cam_look_z, double cam_up_x, double cam_up_y, double cam_up_z )
+{
+	// Keep an orthonormal copy of the view for culling; the up vector passed to gluLookAt need not be perpendicular.
+	FrustumCam.SetPos( cam_x, cam_y, cam_z );
+	FrustumCam.Fwd.Set( cam_look_x - cam_x, cam_look_y - cam_y, cam_look_z - cam_z );
+	FrustumCam.Fwd.ScaleTo( 1. );
+	Vec3D up( cam_up_x, cam_up_y, cam_up_z );
+	FrustumCam.Right = FrustumCam.Fwd.Cross( &up );
+	FrustumCam.Right.ScaleTo( 1. );
+	FrustumCam.Up = FrustumCam.Right.Cross( &(FrustumCam.Fwd) );
+	
+	double half_h = Num::DegToRad( fov_h / 2. );
+	double half_w = atan( tan(half_h) * aspect_ratio );
+	FrustumSinW = sin( half_w );
+	FrustumCosW = cos( half_w );
+	FrustumSinH = sin( half_h );
+	FrustumCosH = cos( half_h );
+	FrustumPixels = (pixels_h / 2.) / tan( half_h );
+	FrustumValid = true;
+}
+
+
+bool Graphics::SphereInFrustum( const Pos3D *center, double radius ) const
+{
+	if( ! (Culling && FrustumValid) )
+		return true;
+	
+	Vec3D vec( center->X - FrustumCam.X, center->Y - FrustumCam.Y, center->Z - FrustumCam.Z );
+	double z = vec.Dot( &(FrustumCam.Fwd) );
+	if( (z + radius < ZNear) || (z - radius > ZFar) )
+		return false;
+	
+	// Distance outside each side plane; the planes are symmetric, so test against the nearer side.
+	double x = fabs( vec.Dot( &(FrustumCam.Right) ) );
+	if( x * FrustumCosW - z * FrustumSinW > radius )
+		return false;
+	double y = fabs( vec.Dot( &(FrustumCam.Up) ) );
+	if( y * FrustumCosH - z * FrustumSinH > radius )
+		return false;
+	
+	return true;
+}
+
+
+double Graphics::PixelRadius( const Pos3D *center, double radius ) const
+{
+	// Approximate projected radius of a sphere in pixels, or -1 if unknown (no 3D view, or we're inside it).
+	if( ! FrustumValid )
+		return -1.;
+	
+	double dist = center->Dist( &FrustumCam );
+	if( dist <= radius )
+		return -1.;
+	
+	return radius / dist * FrustumPixels;
 }
 
 
@@ -669,30 +752,15 @@ void Graphics::DrawCircle2D( double x, double y, double r, int res, GLuint textu
 
 void Graphics::DrawCircle2D( double x, double y, double r, int res, GLuint texture, float red, float green, float blue, float alpha )
 {
+	PrimitiveMesh *mesh = CircleMesh( res );
+	if( ! mesh )
+		return;
+	
 	glEnable( GL_TEXTURE_2D );
 	glBindTexture( GL_TEXTURE_2D, texture );
 	glColor4f( red, green, blue, alpha );
 	
-	glBegin( GL_TRIANGLE_FAN );
-		
-		glTexCoord2d( 0.5, 0.5 );
-		glVertex2d( x, y );
-		
-		for( int i = 0; i <= res; i ++ )
-		{
-			double percent = ((double) i) / (double) res;
-			double unit_x = cos( percent * 2. * M_PI );
-			double unit_y = sin( percent * 2. * M_PI );
-			double px = x + unit_x * r;
-			double py = y + unit_y * r;
-			double tx = (unit_x + 1.) / 2.;
-			double ty = (unit_y + 1.) / 2.;
-			
-			glTexCoord2d( tx, ty );
-			glVertex2d( px, py );
-		}
-		
-	glEnd();
+	mesh->Draw( GL_TRIANGLE_FAN, 0, mesh->VertexCount, true, false, x, y, 0., r, r, 1. );
 	
 	glDisable( GL_TEXTURE_2D );
 }
@@ -709,23 +777,15 @@ void Graphics::DrawCircleOutline2D( double x, double y, double r, int res, float
 
 void Graphics::DrawCircleOutline2D( double x, double y, double r, int res, float line_width, float red, float green, float blue, float alpha )
 {
+	PrimitiveMesh *mesh = CircleMesh( res );
+	if( ! mesh )
+		return;
+	
 	glColor4f( red, green, blue, alpha );
 	glLineWidth( line_width );
 	
-	glBegin( GL_LINE_STRIP );
-		
-		for( int i = 0; i <= res; i ++ )
-		{
-			double percent = ((double) i) / (double) res;
-			double unit_x = cos( percent * 2. * M_PI );
-			double unit_y = sin( percent * 2. * M_PI );
-			double px = x + unit_x * r;
-			double py = y + unit_y * r;
-			
-			glVertex2d( px, py );
-		}
-		
-	glEnd();
+	// Skip the fan's center vertex; the rest is the closed edge.
+	mesh->Draw( GL_LINE_STRIP, 1, mesh->VertexCount - 1, false, false, x, y, 0., r, r, 1. );
 }
 
 
@@ -761,117 +821,15 @@ void Graphics::DrawSphere3D( double x, double y, double z, double r, int res, GL
 
 void Graphics::DrawSphere3D( double x, double y, double z, double r, int res, GLuint texture, uint32_t texture_mode, float red, float green, float blue, float alpha )
 {
-	int res_vertical = res;
-	int res_around = res * 2;
-	double step_vertical = 1. / (double) res_vertical;
-	double step_around = 1. / (double) res_around;
+	PrimitiveMesh *mesh = SphereMesh( res, texture_mode );
+	if( ! mesh )
+		return;
 	
 	glEnable( GL_TEXTURE_2D );
 	glBindTexture( GL_TEXTURE_2D, texture );
 	glColor4f( red, green, blue, alpha );
 	
-	glBegin( GL_QUADS );
-		
-		for( int i = 0; i < res_vertical; i ++ )
-		{
-			double percent_vertical = ((double) i) / (double) res_vertical;
-			double z1 = r * cos( percent_vertical * M_PI );
-			double r1 = r * sin( percent_vertical * M_PI );
-			double z2 = r * cos( (percent_vertical + step_vertical) * M_PI );
-			double r2 = r * sin( (percent_vertical + step_vertical) * M_PI );
-			
-			for( int j = 0; j < res_around; j ++ )
-			{
-				double percent_around = ((double) j) / (double) res_around;
-				double x1 = cos( percent_around * 2. * M_PI );
-				double y1 = sin( percent_around * 2. * M_PI );
-				double x2 = cos( (percent_around + step_around) * 2. * M_PI );
-				double y2 = sin( (percent_around + step_around) * 2. * M_PI );
-				
-				// Texture coordinates.
-				double tc[ 4 ][ 2 ];
-				tc[ 0 ][ 0 ] = percent_around;
-				tc[ 0 ][ 1 ] = percent_vertical;
-				tc[ 1 ][ 0 ] = percent_around;
-				tc[ 1 ][ 1 ] = percent_vertical + step_vertical;
-				tc[ 2 ][ 0 ] = percent_around + step_around;
-				tc[ 2 ][ 1 ] = percent_vertical + step_vertical;
-				tc[ 3 ][ 0 ] = percent_around + step_around;
-				tc[ 3 ][ 1 ] = percent_vertical;
-				
-				// Experimental texture coordinate distortions.
-				if( texture_mode & TEXTURE_MODE_Y_ASIN )
-				{
-					// Scale traversal of Y values to the radius of the current ring.
-					tc[ 0 ][ 1 ] = asin( percent_vertical * 2. - 1. ) / M_PI + 0.5;
-					tc[ 1 ][ 1 ] = asin( (percent_vertical + step_vertical) * 2. - 1. ) / M_PI + 0.5;
-					tc[ 2 ][ 1 ] = tc[ 1 ][ 1 ];
-					tc[ 3 ][ 1 ] = tc[ 0 ][ 1 ];
-				}
-				if( texture_mode & TEXTURE_MODE_X_DIV_R )
-				{
-					// Remove corners of texture by reducing the X distance traversed at top and bottom.
-					double r1scale = r1 / r;
-					tc[ 0 ][ 0 ] = percent_around * r1scale + (1. - r1scale) / 2.;
-					tc[ 3 ][ 0 ] = tc[ 0 ][ 0 ] + r1scale * step_around;
-					double r2scale = r2 / r;
-					tc[ 1 ][ 0 ] = percent_around * r2scale + (1. - r2scale) / 2.;
-					tc[ 2 ][ 0 ] = tc[ 1 ][ 0 ] + r2scale * step_around;
-				}
-				
-				// Calculate vertices.
-				double px[ 4 ] = { x + r1*x1, x + r2*x1, x + r2*x2, x + r1*x2 };
-				double py[ 4 ] = { y + r1*y1, y + r2*y1, y + r2*y2, y + r1*y2 };
-				double pz[ 2 ] = { z + z1, z + z2 };
-				
-				#define SMOOTH 1
-				#if SMOOTH
-					// Calculate per-vertex normals.
-					Vec3D normals[ 4 ] = { Vec3D(r1*x1,r1*y1,z1), Vec3D(r2*x1,r2*y1,z2), Vec3D(r2*x2,r2*y2,z2), Vec3D(r1*x2,r1*y2,z1) };
-					for( int k = 0; k < 4; k ++ )
-						normals[ k ].ScaleTo( 1. );
-				#else
-					// Set face normal vector.
-					Vec3D normal = Vec3D( px[1] - px[0], py[1] - py[0], pz[1] - pz[0] ).Cross( Vec3D( px[3] - px[0], py[3] - py[0], 0. ) );
-					if( i == 0 )
-						normal = Vec3D( px[3] - px[2], py[3] - py[2], pz[1] - pz[0] ).Cross( Vec3D( px[1] - px[2], py[1] - py[2], 0. ) );
-					normal.ScaleTo( 1. );
-					glNormal3d( normal.X, normal.Y, normal.Z );
-				#endif
-				
-				// Top-left
-				#if SMOOTH
-					glNormal3d( normals[ 0 ].X, normals[ 0 ].Y, normals[ 0 ].Z );
-				#endif
-				glTexCoord2d( tc[ 0 ][ 0 ], tc[ 0 ][ 1 ] );
-				glVertex3d( px[ 0 ], py[ 0 ], pz[ 0 ] );
-				
-				// Bottom-left
-				#if SMOOTH
-					glNormal3d( normals[ 1 ].X, normals[ 1 ].Y, normals[ 1 ].Z );
-				#endif
-				glTexCoord2d( tc[ 1 ][ 0 ], tc[ 1 ][ 1 ] );
-				glVertex3d( px[ 1 ], py[ 1 ], pz[ 1 ] );
-				
-				// Bottom-right
-				#if SMOOTH
-					glNormal3d( normals[ 2 ].X, normals[ 2 ].Y, normals[ 2 ].Z );
-				#endif
-				glTexCoord2d( tc[ 2 ][ 0 ], tc[ 2 ][ 1 ] );
-				glVertex3d( px[ 2 ], py[ 2 ], pz[ 1 ] );
-				
-				// Top-right
-				#if SMOOTH
-					glNormal3d( normals[ 3 ].X, normals[ 3 ].Y, normals[ 3 ].Z );
-				#endif
-				glTexCoord2d( tc[ 3 ][ 0 ], tc[ 3 ][ 1 ] );
-				glVertex3d( px[ 3 ], py[ 3 ], pz[ 0 ] );
-				
-				#undef SMOOTH
-			}
-		}
-		
-	glEnd();
+	mesh->Draw( GL_QUADS, 0, mesh->VertexCount, true, true, x, y, z, r, r, r );
 	
 	glDisable( GL_TEXTURE_2D );
 }
@@ -939,6 +897,42 @@ void Graphics::DrawBox3D( const Pos3D *corner, const Vec3D *fwd, const Vec3D *up
 // ---------------------------------------------------------------------------
 
 
+PrimitiveMesh *Graphics::SphereMesh( int res, uint32_t texture_mode )
+{
+	if( res < 1 )
+		return NULL;
+	
+	std::pair<int,uint32_t> key( res, texture_mode );
+	std::map< std::pair<int,uint32_t>, PrimitiveMesh* >::iterator mesh_iter = SphereMeshes.find( key );
+	if( mesh_iter != SphereMeshes.end() )
+		return mesh_iter->second;
+	
+	PrimitiveMesh *mesh = new PrimitiveMesh();
+	mesh->MakeSphere( res, texture_mode );
+	SphereMeshes[ key ] = mesh;
+	return mesh;
+}
+
+
+PrimitiveMesh *Graphics::CircleMesh( int res )
+{
+	if( res < 1 )
+		return NULL;
+	
+	std::map< int, PrimitiveMesh* >::iterator mesh_iter = CircleMeshes.find( res );
+	if( mesh_iter != CircleMeshes.end() )
+		return mesh_iter->second;
+	
+	PrimitiveMesh *mesh = new PrimitiveMesh();
+	mesh->MakeCircle( res );
+	CircleMeshes[ res ] = mesh;
+	return mesh;
+}
+
+
+// ---------------------------------------------------------------------------
+
+
 GLuint Graphics::MakeTexture( SDL_Surface *surface, GLint texture_filter, GLint texture_wrap, GLfloat *texcoord )
 {
 	int w = surface->w;
@@ -20,9 +20,12 @@ class Graphics;
 #endif
 
 #include <string>
+#include <map>
 #include "RaptorGL.h"
+#include "Pos.h"
 #include "Camera.h"
 #include "Framebuffer.h"
+#include "PrimitiveMesh.h"
 
 
 class Graphics
@@ -36,11 +39,19 @@ public:
 	bool Initialized;
 	int W, H, RealW, RealH, DesktopW, DesktopH, BPP, LightQuality;
 	float AspectRatio;
-	bool Fullscreen, VSync, Framebuffers, GlowMaps;
+	bool Fullscreen, VSync, Framebuffers, VertexBuffers, GlowMaps;
 	int FSAA, AF, ZBits;
 	double ZNear, ZFar;
 	Framebuffer *DrawTo;
 	
+	bool Culling, FrustumValid;
+	Pos3D FrustumCam;
+	double FrustumSinW, FrustumCosW, FrustumSinH, FrustumCosH, FrustumPixels, LODScale;
+	unsigned int ModelsDrawn, ModelsCulled;
+	
+	std::map< std::pair<int,uint32_t>, PrimitiveMesh* > SphereMeshes;
+	std::map< int, PrimitiveMesh* > CircleMeshes;
+	
 	Graphics( void );
 	~Graphics();
 	
@@ -68,6 +79,10 @@ public:
 	void Setup3D( double fov_w, double cam_x, double cam_y, double cam_z, double yaw, double pitch );
 	void Setup3D( double fov_w, double cam_x, double cam_y, double cam_z, double cam_look_x, double cam_look_y, double cam_look_z, double cam_up_x, double cam_up_y, double cam_up_z, double aspect_ratio = 0. );
 	
+	void SetFrustum( double fov_h, double aspect_ratio, double pixels_h, double cam_x, double cam_y, double cam_z, double cam_look_x, double cam_look_y, double cam_look_z, double cam_up_x, double cam_up_y, double cam_up_z );
+	bool SphereInFrustum( const Pos3D *center, double radius ) const;
+	double PixelRadius( const Pos3D *center, double radius ) const;
+	
 	void DrawRect2D( int x1, int y1, int x2, int y2, GLuint texture = 0 );
 	void DrawRect2D( double x1, double y1, double x2, double y2, GLuint texture = 0 );
 	void DrawRect2D( int x1, int y1, int x2, int y2, GLuint texture, float r, float g, float b, float a );
@@ -91,6 +106,9 @@ public:
 	
 	void DrawBox3D( const Pos3D *corner, const Vec3D *fwd, const Vec3D *up, const Vec3D *right, float line_width, float r, float g, float b, float a );
 	
+	PrimitiveMesh *SphereMesh( int res, uint32_t texture_mode );
+	PrimitiveMesh *CircleMesh( int res );
+	
 	GLuint MakeTexture( SDL_Surface *surface, GLint texture_filter = GL_LINEAR_MIPMAP_LINEAR, GLint texture_wrap = GL_REPEAT, GLfloat *texcoord = NULL );
 	
 	enum
@@ -5,6 +5,7 @@
 #include "Model.h"
 
 #include <cstddef>
+#include <cstring>
 #include <cmath>
 #include <cfloat>
 #include <fstream>
@@ -16,7 +17,9 @@
 #include "File.h"
 #include "Math2D.h"
 #include "Math3D.h"
-#include "RaptorGame.h"
+#ifndef NO_CLIENT
+	#include "RaptorGame.h"
+#endif
 
 #define MODEL_EPSILON (0.001)
 
@@ -397,8 +400,10 @@ bool Model::IncludeOBJ( std::string filename, bool get_textures )
 							
 							if( File::Exists( filename_here.c_str() ) )
 								mtl_filename = filename_here;
+#ifndef NO_CLIENT
 							else
 								mtl_filename = Raptor::Game->Res.Find( mtl_filename );
+#endif
 						}
 						
 						if( mtl_filename != filename )
@@ -417,6 +422,7 @@ bool Model::IncludeOBJ( std::string filename, bool get_textures )
 				}
 				else if( (elements.at( 0 ) == "map_Kd") || (elements.at( 0 ) == "map_bump") || (elements.at( 0 ) == "map_glow") )
 				{
+#ifndef NO_CLIENT
 					if( get_textures && (elements.size() >= 2) )
 					{
 						std::string tex_filename = elements.at( 1 );
@@ -452,6 +458,7 @@ bool Model::IncludeOBJ( std::string filename, bool get_textures )
 						else
 							Materials[ mtl ]->Texture.BecomeInstance( Raptor::Game->Res.GetAnimation( tex_filename ) );
 					}
+#endif
 				}
 				else if( elements.at( 0 ) == "bump_scale" )
 				{
@@ -582,7 +589,7 @@ void Model::ApplySmoothGroups( void )
 					}
 					
 					std::map<KeyVec3D,double> unique;
-					
+
 #ifdef MODEL_SMOOTH_ACROSS_OBJECTS
 					for( std::map<std::string,ModelObject*>::const_iterator obj_iter2 = obj_iter; obj_iter2 != Objects.end(); obj_iter2 ++ )  // NOTE: Because of cache miss, we know nothing before obj_iter matches.
 					{
@@ -691,6 +698,28 @@ void Model::MakeMaterialArrays( void )
 			}
 		}
 	}
+	
+	// Any LODs were made from the old geometry.
+	ClearLODs();
+}
+
+
+void Model::ReloadBuffers( void )
+{
+	for( std::map<std::string,ModelMaterial*>::iterator mtl_iter = Materials.begin(); mtl_iter != Materials.end(); mtl_iter ++ )
+	{
+		mtl_iter->second->Arrays.ReloadBuffer();
+		if( mtl_iter->second->LODs )
+		{
+			for( std::vector<ModelArrays*>::iterator lod_iter = mtl_iter->second->LODs->Arrays.begin(); lod_iter != mtl_iter->second->LODs->Arrays.end(); lod_iter ++ )
+				(*lod_iter)->ReloadBuffer();
+		}
+	}
+	for( std::map<std::string,ModelObject*>::iterator obj_iter = Objects.begin(); obj_iter != Objects.end(); obj_iter ++ )
+	{
+		for( std::map<std::string,ModelArrays*>::iterator array_iter = obj_iter->second->Arrays.begin(); array_iter != obj_iter->second->Arrays.end(); array_iter ++ )
+			array_iter->second->ReloadBuffer();
+	}
 }
 
 
@@ -733,14 +762,71 @@ void Model::Optimize( double vertex_tolerance, double normal_tolerance, double d
 }
 
 
-void Model::Draw( const Pos3D *pos, const std::set<std::string> *object_names, const Color *wireframe, double exploded, int explosion_seed, double fwd_scale, double up_scale, double right_scale )
+void Model::MakeLODs( int levels )
+{
+	// Each level re-optimizes the previous one with looser tolerances, merging nearly-coplanar triangles.
+	double radius = GetMaxRadius();
+	
+	for( std::map<std::string,ModelMaterial*>::iterator mtl_iter = Materials.begin(); mtl_iter != Materials.end(); mtl_iter ++ )
+	{
+		mtl_iter->second->ClearLODs();
+		ModelLODs *lods = new ModelLODs();
+		ModelArrays *prev = &(mtl_iter->second->Arrays);
+		
+		for( int level = 1; level <= levels; level ++ )
+		{
+			double scale = pow( 2., level );
+			ModelArrays *lod = new ModelArrays();
+			lod->BecomeCopy( prev );
+			lod->Optimize( radius * 0.002 * scale, 0.1 * scale, 0.001 * scale * scale );
+			
+			// Stop when a level no longer saves enough triangles to be worth drawing.
+			if( lod->VertexCount > prev->VertexCount * 9 / 10 )
+			{
+				delete lod;
+				break;
+			}
+			
+			lods->Arrays.push_back( lod );
+			prev = lod;
+		}
+		
+		if( lods->Arrays.size() )
+			mtl_iter->second->LODs = lods;
+		else
+			lods->Release();
+	}
+}
+
+
+void Model::ClearLODs( void )
+{
+	for( std::map<std::string,ModelMaterial*>::iterator mtl_iter = Materials.begin(); mtl_iter != Materials.end(); mtl_iter ++ )
+		mtl_iter->second->ClearLODs();
+}
+
+
+#ifndef NO_CLIENT
+int Model::LODLevel( double pixel_radius ) const
+{
+	if( (pixel_radius < 0.) || (Raptor::Game->Gfx.LODScale <= 0.) )
+		return 0;
+	
+	int level = 0;
+	for( double threshold = MODEL_LOD_PIXELS * Raptor::Game->Gfx.LODScale; (pixel_radius < threshold) && (level < 8); threshold /= 2. )
+		level ++;
+	return level;
+}
+
+
+void Model::Draw( const Pos3D *pos, const std::set<std::string> *object_names, const Color *wireframe, double exploded, int explosion_seed, double fwd_scale, double up_scale, double right_scale, bool cull )
 {
 	bool use_shaders = Raptor::Game->ShaderMgr.Active();
 	GLint tangent_loc = -1, bitangent_loc = -1;
 	if( use_shaders )
 	{
-		tangent_loc   = Raptor::Game->ShaderMgr.AttribLoc( "BumpTangent"   );
-		bitangent_loc = Raptor::Game->ShaderMgr.AttribLoc( "BumpBitangent" );
+		tangent_loc   = Raptor::Game->ShaderMgr.AttribLoc( Shader::VAR_BUMP_TANGENT   );
+		bitangent_loc = Raptor::Game->ShaderMgr.AttribLoc( Shader::VAR_BUMP_BITANGENT );
 	}
 	bool use_bumpmap = (tangent_loc >= 0) && (bitangent_loc >= 0) && (Raptor::Game->Gfx.LightQuality >= 3);
 	
@@ -748,6 +834,15 @@ void Model::Draw( const Pos3D *pos, const std::set<std::string> *object_names, c
 	if( ! pos )
 		pos = &zero;
 	
+	// Bounding sphere around the model origin; exploding pieces are culled individually below.
+	double radius = GetMaxRadius() * std::max<double>( fabs(fwd_scale), std::max<double>( fabs(up_scale), fabs(right_scale) ) );
+	if( cull && (exploded == 0.) && ! Raptor::Game->Gfx.SphereInFrustum( pos, radius ) )
+	{
+		Raptor::Game->Gfx.ModelsCulled ++;
+		return;
+	}
+	Raptor::Game->Gfx.ModelsDrawn ++;
+	
 	glEnableClientState( GL_VERTEX_ARRAY );
 	
 	if( ! wireframe )
@@ -764,13 +859,13 @@ void Model::Draw( const Pos3D *pos, const std::set<std::string> *object_names, c
 		
 		if( use_shaders )
 		{
-			Raptor::Game->ShaderMgr.Set3f( "AmbientColor", wireframe->Red, wireframe->Green, wireframe->Blue );
-			Raptor::Game->ShaderMgr.Set3f( "DiffuseColor", 0., 0., 0. );
-			Raptor::Game->ShaderMgr.Set3f( "SpecularColor", 0., 0., 0. );
-			Raptor::Game->ShaderMgr.Set1f( "Alpha", wireframe->Alpha );
-			Raptor::Game->ShaderMgr.Set1f( "Shininess", 0. );
-			Raptor::Game->ShaderMgr.Set1f( "BumpScale", 0. );
-			Raptor::Game->ShaderMgr.Set1f( "GlowScale", 0. );
+			Raptor::Game->ShaderMgr.Set3f( Shader::VAR_AMBIENT_COLOR, wireframe->Red, wireframe->Green, wireframe->Blue );
+			Raptor::Game->ShaderMgr.Set3f( Shader::VAR_DIFFUSE_COLOR, 0., 0., 0. );
+			Raptor::Game->ShaderMgr.Set3f( Shader::VAR_SPECULAR_COLOR, 0., 0., 0. );
+			Raptor::Game->ShaderMgr.Set1f( Shader::VAR_ALPHA, wireframe->Alpha );
+			Raptor::Game->ShaderMgr.Set1f( Shader::VAR_SHININESS, 0. );
+			Raptor::Game->ShaderMgr.Set1f( Shader::VAR_BUMP_SCALE, 0. );
+			Raptor::Game->ShaderMgr.Set1f( Shader::VAR_GLOW_SCALE, 0. );
 		}
 	}
 	
@@ -785,16 +880,27 @@ void Model::Draw( const Pos3D *pos, const std::set<std::string> *object_names, c
 			Vec3D y_vec( pos->Fwd.Y * fwd_scale, pos->Up.Y * up_scale, pos->Right.Y * right_scale );
 			Vec3D z_vec( pos->Fwd.Z * fwd_scale, pos->Up.Z * up_scale, pos->Right.Z * right_scale );
 			
-			Raptor::Game->ShaderMgr.Set3f( "Pos", pos->X, pos->Y, pos->Z );
-			Raptor::Game->ShaderMgr.Set3f( "XVec", x_vec.X, x_vec.Y, x_vec.Z );
-			Raptor::Game->ShaderMgr.Set3f( "YVec", y_vec.X, y_vec.Y, y_vec.Z );
-			Raptor::Game->ShaderMgr.Set3f( "ZVec", z_vec.X, z_vec.Y, z_vec.Z );
+			Raptor::Game->ShaderMgr.Set3f( Shader::VAR_POS, pos->X, pos->Y, pos->Z );
+			Raptor::Game->ShaderMgr.Set3f( Shader::VAR_XVEC, x_vec.X, x_vec.Y, x_vec.Z );
+			Raptor::Game->ShaderMgr.Set3f( Shader::VAR_YVEC, y_vec.X, y_vec.Y, y_vec.Z );
+			Raptor::Game->ShaderMgr.Set3f( Shader::VAR_ZVEC, z_vec.X, z_vec.Y, z_vec.Z );
 		}
 		
+		int lod = cull ? LODLevel( Raptor::Game->Gfx.PixelRadius( pos, radius ) ) : 0;
+		
 		for( std::map<std::string,ModelMaterial*>::iterator mtl_iter = Materials.begin(); mtl_iter != Materials.end(); mtl_iter ++ )
 		{
 			if( mtl_iter->second->Arrays.VertexCount )
 			{
+				// Shaders transform model-space vertices, so they can come from a static vertex buffer.
+				ModelArrays *arrays = mtl_iter->second->LODArrays( lod );
+				bool buffered = use_shaders && arrays->BindBuffer();
+				GLsizei stride = buffered ? MODELARRAYS_VBO_STRIDE : 0;
+				const GLvoid *normals    = buffered ? MODELARRAYS_VBO_NORMAL    : (const GLvoid*) arrays->NormalArray;
+				const GLvoid *tex_coords = buffered ? MODELARRAYS_VBO_TEXCOORD  : (const GLvoid*) arrays->TexCoordArray;
+				const GLvoid *tangents   = buffered ? MODELARRAYS_VBO_TANGENT   : (const GLvoid*) arrays->TangentArray;
+				const GLvoid *bitangents = buffered ? MODELARRAYS_VBO_BITANGENT : (const GLvoid*) arrays->BitangentArray;
+				
 				if( use_shaders )
 				{
 					// FIXME: Pull this out of the loop, or enable different shader per material?
@@ -803,72 +909,36 @@ void Model::Draw( const Pos3D *pos, const std::set<std::string> *object_names, c
 					if( bitangent_loc >= 0 )
 						glEnableVertexAttribArray( bitangent_loc );
 					
-					glVertexPointer( 3, GL_DOUBLE, 0, mtl_iter->second->Arrays.VertexArray );
+					if( buffered )
+						glVertexPointer( 3, GL_FLOAT, stride, MODELARRAYS_VBO_VERTEX );
+					else
+						glVertexPointer( 3, GL_DOUBLE, 0, arrays->VertexArray );
 					
 					if( ! wireframe )
 					{
-						Raptor::Game->ShaderMgr.Set3f( "AmbientColor",  mtl_iter->second->Ambient.Red,  mtl_iter->second->Ambient.Green,  mtl_iter->second->Ambient.Blue );
-						Raptor::Game->ShaderMgr.Set3f( "DiffuseColor",  mtl_iter->second->Diffuse.Red,  mtl_iter->second->Diffuse.Green,  mtl_iter->second->Diffuse.Blue );
-						Raptor::Game->ShaderMgr.Set3f( "SpecularColor", mtl_iter->second->Specular.Red, mtl_iter->second->Specular.Green, mtl_iter->second->Specular.Blue );
-						Raptor::Game->ShaderMgr.Set1f( "Alpha", mtl_iter->second->Ambient.Alpha );
-						Raptor::Game->ShaderMgr.Set1f( "Shininess", mtl_iter->second->Shininess );
-						
-						Raptor::Game->ShaderMgr.Set1i( "Texture", 0 );
-						Raptor::Game->ShaderMgr.Set1i( "BumpMap", 1 );
-						Raptor::Game->ShaderMgr.Set1i( "GlowMap", 2 );
-						
-						glActiveTexture( GL_TEXTURE0 + 1 ); // BumpMap
-						
-						if( use_bumpmap && mtl_iter->second->BumpMap.Frames.size() )
-						{
-							glBindTexture( GL_TEXTURE_2D, mtl_iter->second->BumpMap.CurrentFrame() );
-							glVertexAttribPointer( tangent_loc,   3, GL_FLOAT, GL_TRUE, 0, mtl_iter->second->Arrays.TangentArray );
-							glVertexAttribPointer( bitangent_loc, 3, GL_FLOAT, GL_TRUE, 0, mtl_iter->second->Arrays.BitangentArray );
-							Raptor::Game->ShaderMgr.Set1f( "BumpScale", mtl_iter->second->BumpScale );
-						}
-						else
-						{
-							glBindTexture( GL_TEXTURE_2D, 0 );
-							if( tangent_loc >= 0 )
-								glVertexAttribPointer( tangent_loc,   3, GL_FLOAT, GL_TRUE, 0, mtl_iter->second->Arrays.NormalArray );
-							if( bitangent_loc >= 0 )
-								glVertexAttribPointer( bitangent_loc, 3, GL_FLOAT, GL_TRUE, 0, mtl_iter->second->Arrays.NormalArray );
-							Raptor::Game->ShaderMgr.Set1f( "BumpScale", 0. );
-						}
-						
-						glActiveTexture( GL_TEXTURE0 + 2 ); // GlowMap
-						
-						if( Raptor::Game->Gfx.GlowMaps && mtl_iter->second->GlowMap.Frames.size() )
-						{
-							glBindTexture( GL_TEXTURE_2D, mtl_iter->second->GlowMap.CurrentFrame() );
-							Raptor::Game->ShaderMgr.Set1f( "GlowScale", mtl_iter->second->GlowScale );
-						}
-						else
-						{
-							glBindTexture( GL_TEXTURE_2D, 0 );
-							Raptor::Game->ShaderMgr.Set1f( "GlowScale", 0. );
-						}
-						
-						glActiveTexture( GL_TEXTURE0 + 0 ); // Texture
+						mtl_iter->second->SetShaderVars( stride, normals, tangents, bitangents, tangent_loc, bitangent_loc, use_bumpmap );
 					}
 				}
 				else
 				{
 					// Calculate worldspace coordinates on the CPU (slow for complex models).
-					mtl_iter->second->Arrays.MakeWorldSpace( pos, fwd_scale, up_scale, right_scale );
+					arrays->MakeWorldSpace( pos, fwd_scale, up_scale, right_scale );
 					
-					glVertexPointer( 3, GL_DOUBLE, 0, mtl_iter->second->Arrays.WorldSpaceVertexArray );
+					glVertexPointer( 3, GL_DOUBLE, 0, arrays->WorldSpaceVertexArray );
 				}
 				
 				if( ! wireframe )
 				{
 					glBindTexture( GL_TEXTURE_2D, mtl_iter->second->Texture.CurrentFrame() );
 					
-					glTexCoordPointer( 2, GL_FLOAT, 0, mtl_iter->second->Arrays.TexCoordArray );
-					glNormalPointer( GL_FLOAT, 0, mtl_iter->second->Arrays.NormalArray );
+					glTexCoordPointer( 2, GL_FLOAT, stride, tex_coords );
+					glNormalPointer( GL_FLOAT, stride, normals );
 				}
 				
-				glDrawArrays( GL_TRIANGLES, 0, mtl_iter->second->Arrays.VertexCount );
+				glDrawArrays( GL_TRIANGLES, 0, arrays->VertexCount );
+				
+				if( buffered )
+					glBindBuffer( GL_ARRAY_BUFFER, 0 );
 				
 				// FIXME: Pull this out of the loop, or enable different shader per material?
 				if( tangent_loc >= 0 )
@@ -922,6 +992,16 @@ void Model::Draw( const Pos3D *pos, const std::set<std::string> *object_names, c
 				draw_pos.Right.RotateAround( &worldspace_rotation_axis, piece_exploded * explosion_rotation_rate );
 			}
 			
+			// Skip pieces that have left the view.
+			Pos3D piece_center( &draw_pos );
+			Pos3D center_point = obj_iter->second->GetCenterPoint();
+			piece_center.MoveAlong( &(draw_pos.Fwd),   center_point.X * fwd_scale   );
+			piece_center.MoveAlong( &(draw_pos.Up),    center_point.Y * up_scale    );
+			piece_center.MoveAlong( &(draw_pos.Right), center_point.Z * right_scale );
+			double piece_radius = obj_iter->second->GetMaxRadius() * std::max<double>( fabs(fwd_scale), std::max<double>( fabs(up_scale), fabs(right_scale) ) );
+			if( cull && ! Raptor::Game->Gfx.SphereInFrustum( &piece_center, piece_radius ) )
+				continue;
+			
 			if( use_shaders )
 			{
 				// In model space, X = fwd, Y = up, Z = right.
@@ -929,16 +1009,24 @@ void Model::Draw( const Pos3D *pos, const std::set<std::string> *object_names, c
 				y_vec.Set( draw_pos.Fwd.Y * fwd_scale, draw_pos.Up.Y * up_scale, draw_pos.Right.Y * right_scale );
 				z_vec.Set( draw_pos.Fwd.Z * fwd_scale, draw_pos.Up.Z * up_scale, draw_pos.Right.Z * right_scale );
 				
-				Raptor::Game->ShaderMgr.Set3f( "Pos", draw_pos.X, draw_pos.Y, draw_pos.Z );
-				Raptor::Game->ShaderMgr.Set3f( "XVec", x_vec.X, x_vec.Y, x_vec.Z );
-				Raptor::Game->ShaderMgr.Set3f( "YVec", y_vec.X, y_vec.Y, y_vec.Z );
-				Raptor::Game->ShaderMgr.Set3f( "ZVec", z_vec.X, z_vec.Y, z_vec.Z );
+				Raptor::Game->ShaderMgr.Set3f( Shader::VAR_POS, draw_pos.X, draw_pos.Y, draw_pos.Z );
+				Raptor::Game->ShaderMgr.Set3f( Shader::VAR_XVEC, x_vec.X, x_vec.Y, x_vec.Z );
+				Raptor::Game->ShaderMgr.Set3f( Shader::VAR_YVEC, y_vec.X, y_vec.Y, y_vec.Z );
+				Raptor::Game->ShaderMgr.Set3f( Shader::VAR_ZVEC, z_vec.X, z_vec.Y, z_vec.Z );
 			}
 			
 			for( std::map<std::string,ModelArrays*>::iterator array_iter = obj_iter->second->Arrays.begin(); array_iter != obj_iter->second->Arrays.end(); array_iter ++ )
 			{
 				if( array_iter->second->VertexCount )
 				{
+					ModelArrays *arrays = array_iter->second;
+					bool buffered = use_shaders && arrays->BindBuffer();
+					GLsizei stride = buffered ? MODELARRAYS_VBO_STRIDE : 0;
+					const GLvoid *normals    = buffered ? MODELARRAYS_VBO_NORMAL    : (const GLvoid*) arrays->NormalArray;
+					const GLvoid *tex_coords = buffered ? MODELARRAYS_VBO_TEXCOORD  : (const GLvoid*) arrays->TexCoordArray;
+					const GLvoid *tangents   = buffered ? MODELARRAYS_VBO_TANGENT   : (const GLvoid*) arrays->TangentArray;
+					const GLvoid *bitangents = buffered ? MODELARRAYS_VBO_BITANGENT : (const GLvoid*) arrays->BitangentArray;
+					
 					if( use_shaders )
 					{
 						// FIXME: Pull this out of the loop, or enable different shader per material?
@@ -953,52 +1041,13 @@ void Model::Draw( const Pos3D *pos, const std::set<std::string> *object_names, c
 								Materials[ array_iter->first ] = new ModelMaterial();
 							ModelMaterial *mtl = Materials[ array_iter->first ];
 							
-							Raptor::Game->ShaderMgr.Set3f( "AmbientColor",  mtl->Ambient.Red,  mtl->Ambient.Green,  mtl->Ambient.Blue );
-							Raptor::Game->ShaderMgr.Set3f( "DiffuseColor",  mtl->Diffuse.Red,  mtl->Diffuse.Green,  mtl->Diffuse.Blue );
-							Raptor::Game->ShaderMgr.Set3f( "SpecularColor", mtl->Specular.Red, mtl->Specular.Green, mtl->Specular.Blue );
-							Raptor::Game->ShaderMgr.Set1f( "Alpha", mtl->Ambient.Alpha );
-							Raptor::Game->ShaderMgr.Set1f( "Shininess", mtl->Shininess );
-							
-							Raptor::Game->ShaderMgr.Set1i( "Texture", 0 );
-							Raptor::Game->ShaderMgr.Set1i( "BumpMap", 1 );
-							Raptor::Game->ShaderMgr.Set1i( "GlowMap", 2 );
-							
-							glActiveTexture( GL_TEXTURE0 + 1 ); // BumpMap
-							
-							if( use_bumpmap && mtl->BumpMap.Frames.size() )
-							{
-								glBindTexture( GL_TEXTURE_2D, mtl->BumpMap.CurrentFrame() );
-								glVertexAttribPointer( tangent_loc,   3, GL_FLOAT, GL_TRUE, 0, array_iter->second->TangentArray );
-								glVertexAttribPointer( bitangent_loc, 3, GL_FLOAT, GL_TRUE, 0, array_iter->second->BitangentArray );
-								Raptor::Game->ShaderMgr.Set1f( "BumpScale", mtl->BumpScale );
-							}
-							else
-							{
-								glBindTexture( GL_TEXTURE_2D, 0 );
-								if( tangent_loc >= 0 )
-									glVertexAttribPointer( tangent_loc,   3, GL_FLOAT, GL_TRUE, 0, array_iter->second->NormalArray );
-								if( bitangent_loc >= 0 )
-									glVertexAttribPointer( bitangent_loc, 3, GL_FLOAT, GL_TRUE, 0, array_iter->second->NormalArray );
-								Raptor::Game->ShaderMgr.Set1f( "BumpScale", 0. );
-							}
-							
-							glActiveTexture( GL_TEXTURE0 + 2 ); // GlowMap
-							
-							if( Raptor::Game->Gfx.GlowMaps && mtl->GlowMap.Frames.size() )
-							{
-								glBindTexture( GL_TEXTURE_2D, mtl->GlowMap.CurrentFrame() );
-								Raptor::Game->ShaderMgr.Set1f( "GlowScale", mtl->GlowScale );
-							}
-							else
-							{
-								glBindTexture( GL_TEXTURE_2D, 0 );
-								Raptor::Game->ShaderMgr.Set1f( "GlowScale", 0. );
-							}
-							
-							glActiveTexture( GL_TEXTURE0 + 0 ); // Texture
+							mtl->SetShaderVars( stride, normals, tangents, bitangents, tangent_loc, bitangent_loc, use_bumpmap );
 						}
 						
-						glVertexPointer( 3, GL_DOUBLE, 0, array_iter->second->VertexArray );
+						if( buffered )
+							glVertexPointer( 3, GL_FLOAT, stride, MODELARRAYS_VBO_VERTEX );
+						else
+							glVertexPointer( 3, GL_DOUBLE, 0, arrays->VertexArray );
 					}
 					else
 					{
@@ -1014,11 +1063,14 @@ void Model::Draw( const Pos3D *pos, const std::set<std::string> *object_names, c
 							Materials[ array_iter->first ] = new ModelMaterial();
 						glBindTexture( GL_TEXTURE_2D, Materials[ array_iter->first ]->Texture.CurrentFrame() );
 						
-						glTexCoordPointer( 2, GL_FLOAT, 0, array_iter->second->TexCoordArray );
-						glNormalPointer( GL_FLOAT, 0, array_iter->second->NormalArray );
+						glTexCoordPointer( 2, GL_FLOAT, stride, tex_coords );
+						glNormalPointer( GL_FLOAT, stride, normals );
 					}
 					
-					glDrawArrays( GL_TRIANGLES, 0, array_iter->second->VertexCount );
+					glDrawArrays( GL_TRIANGLES, 0, arrays->VertexCount );
+					
+					if( buffered )
+						glBindBuffer( GL_ARRAY_BUFFER, 0 );
 					
 					// FIXME: Pull this out of the loop, or enable different shader per material?
 					if( tangent_loc >= 0 )
@@ -1042,19 +1094,23 @@ void Model::Draw( const Pos3D *pos, const std::set<std::string> *object_names, c
 	glDisableClientState( GL_VERTEX_ARRAY );
 	
 	if( use_shaders )
-	{
-		Raptor::Game->ShaderMgr.Set3f( "Pos", 0., 0., 0. );
-		Raptor::Game->ShaderMgr.Set3f( "XVec", 1., 0., 0. );
-		Raptor::Game->ShaderMgr.Set3f( "YVec", 0., 1., 0. );
-		Raptor::Game->ShaderMgr.Set3f( "ZVec", 0., 0., 1. );
-		Raptor::Game->ShaderMgr.Set3f( "AmbientColor", 1., 1., 1. );
-		Raptor::Game->ShaderMgr.Set3f( "DiffuseColor", 0., 0., 0. );
-		Raptor::Game->ShaderMgr.Set3f( "SpecularColor", 0., 0., 0. );
-		Raptor::Game->ShaderMgr.Set1f( "Alpha", 1. );
-		Raptor::Game->ShaderMgr.Set1f( "Shininess", 0. );
-		Raptor::Game->ShaderMgr.Set1f( "BumpScale", 0. );
-		Raptor::Game->ShaderMgr.Set1f( "GlowScale", 0. );
-	}
+		ResetShaderVars();
+}
+
+
+void Model::ResetShaderVars( void )
+{
+	Raptor::Game->ShaderMgr.Set3f( Shader::VAR_POS, 0., 0., 0. );
+	Raptor::Game->ShaderMgr.Set3f( Shader::VAR_XVEC, 1., 0., 0. );
+	Raptor::Game->ShaderMgr.Set3f( Shader::VAR_YVEC, 0., 1., 0. );
+	Raptor::Game->ShaderMgr.Set3f( Shader::VAR_ZVEC, 0., 0., 1. );
+	Raptor::Game->ShaderMgr.Set3f( Shader::VAR_AMBIENT_COLOR, 1., 1., 1. );
+	Raptor::Game->ShaderMgr.Set3f( Shader::VAR_DIFFUSE_COLOR, 0., 0., 0. );
+	Raptor::Game->ShaderMgr.Set3f( Shader::VAR_SPECULAR_COLOR, 0., 0., 0. );
+	Raptor::Game->ShaderMgr.Set1f( Shader::VAR_ALPHA, 1. );
+	Raptor::Game->ShaderMgr.Set1f( Shader::VAR_SHININESS, 0. );
+	Raptor::Game->ShaderMgr.Set1f( Shader::VAR_BUMP_SCALE, 0. );
+	Raptor::Game->ShaderMgr.Set1f( Shader::VAR_GLOW_SCALE, 0. );
 }
 
 
@@ -1064,6 +1120,12 @@ void Model::DrawAt( const Pos3D *pos, double scale, double fwd_scale, double up_
 }
 
 
+void Model::DrawCulledAt( const Pos3D *pos, double scale, double fwd_scale, double up_scale, double right_scale )
+{
+	Draw( pos, NULL, NULL, 0., 0, scale * fwd_scale, scale * up_scale, scale * right_scale, true );
+}
+
+
 void Model::DrawObjectsAt( const std::list<std::string> *object_names, const Pos3D *pos, double scale, double fwd_scale, double up_scale, double right_scale )
 {
 	std::set<std::string> object_name_set;
@@ -1086,6 +1148,7 @@ void Model::DrawWireframeAt( const Pos3D *pos, Color color, double scale, double
 {
 	Draw( pos, NULL, &color, 0., 0, scale * fwd_scale, scale * up_scale, scale * right_scale );
 }
+#endif
 
 
 static void Model_SetHit( const std::vector< std::pair<ModelArrays*,std::string> > *arrays, const GLdouble *face, std::string *hit )
@@ -1472,6 +1535,7 @@ void Model::Move( double fwd, double up, double right )
 				array_iter->second->VertexArray[ i*3 + 1 ] += up;
 				array_iter->second->VertexArray[ i*3 + 2 ] += right;
 			}
+			array_iter->second->BufferDirty = true;
 		}
 		
 		obj_iter->second->CenterPoint.Move( fwd, up, right );
@@ -1516,6 +1580,7 @@ void Model::ScaleBy( double fwd_scale, double up_scale, double right_scale )
 				array_iter->second->VertexArray[ i*3 + 1 ] *= up_scale;
 				array_iter->second->VertexArray[ i*3 + 2 ] *= right_scale;
 			}
+			array_iter->second->BufferDirty = true;
 		}
 		
 		for( std::vector<Vec3D>::iterator point_iter = obj_iter->second->Points.begin(); point_iter != obj_iter->second->Points.end(); point_iter ++ )
@@ -1562,7 +1627,7 @@ void Model::ScaleTo( double length, double height, double width )
 double Model::GetLength( void )
 {
 	if( Length <= 0. )
-	{	
+	{
 		double front = 0., rear = 0.;
 		bool found_front = false, found_rear = false;
 		
@@ -1809,6 +1874,8 @@ ModelArrays::ModelArrays( void )
 	SmoothGroups = NULL;
 	Allocated = false;
 	AllocatedWorldSpace = false;
+	Buffer = NULL;
+	BufferDirty = true;
 }
 
 
@@ -1824,6 +1891,8 @@ ModelArrays::ModelArrays( const ModelArrays &other )
 	SmoothGroups = NULL;
 	Allocated = false;
 	AllocatedWorldSpace = false;
+	Buffer = NULL;
+	BufferDirty = true;
 	
 	BecomeInstance( &other );
 }
@@ -1841,6 +1910,8 @@ ModelArrays::ModelArrays( const ModelArrays *other )
 	SmoothGroups = NULL;
 	Allocated = false;
 	AllocatedWorldSpace = false;
+	Buffer = NULL;
+	BufferDirty = true;
 	
 	BecomeInstance( other );
 }
@@ -1855,6 +1926,7 @@ ModelArrays::~ModelArrays()
 void ModelArrays::Clear( void )
 {
 	VertexCount = 0;
+	BufferDirty = true;
 	
 	if( Allocated )
 	{
@@ -1880,6 +1952,11 @@ void ModelArrays::Clear( void )
 	BitangentArray = NULL;
 	SmoothGroups = NULL;
 	
+	// Instances still drawing our old data keep the buffer alive until they let go of it too.
+	if( Buffer )
+		Buffer->Release();
+	Buffer = NULL;
+	
 	// Each instance is always responsible for its own WorldSpaceVertexArray.
 	if( AllocatedWorldSpace && WorldSpaceVertexArray )
 		free( WorldSpaceVertexArray );
@@ -1992,12 +2069,18 @@ void ModelArrays::BecomeInstance( const ModelArrays *other )
 		TangentArray   = other->TangentArray;
 		BitangentArray = other->BitangentArray;
 		SmoothGroups   = other->SmoothGroups;
+		
+		// Draw from the same vertex buffer as the source, rather than uploading another copy.
+		Buffer = other->SharedBuffer()->Retain();
+		BufferDirty = false;
 	}
 }
 
 
 void ModelArrays::Resize( size_t vertex_count )
 {
+	BufferDirty = true;
+	
 	if( vertex_count == VertexCount )
 		;
 	else if( vertex_count )
@@ -2028,6 +2111,8 @@ void ModelArrays::Resize( size_t vertex_count )
 
 void ModelArrays::AddFaces( std::vector<ModelFace> &faces )
 {
+	BufferDirty = true;
+	
 	std::vector<Vec3D> vertices;
 	std::vector<Vec2D> tex_coords;
 	std::vector<Vec3D> normals;
@@ -2133,6 +2218,8 @@ void ModelArrays::AddFaces( std::vector<ModelFace> &faces )
 
 void ModelArrays::RemoveFace( size_t face_index )
 {
+	BufferDirty = true;
+	
 	size_t first_vertex = face_index * 3;
 	if( (first_vertex + 2) >= VertexCount )
 		return;
@@ -2211,6 +2298,8 @@ void ModelArrays::RemoveFace( size_t face_index )
 
 void ModelArrays::CalculateNormals( size_t start_vertex )
 {
+	BufferDirty = true;
+	
 	if( ! Allocated )
 		BecomeCopy( this );
 	
@@ -2242,6 +2331,8 @@ void ModelArrays::CalculateNormals( size_t start_vertex )
 
 void ModelArrays::ReverseNormals( size_t start_vertex )
 {
+	BufferDirty = true;
+	
 	if( ! Allocated )
 		BecomeCopy( this );
 	
@@ -2259,6 +2350,8 @@ void ModelArrays::ReverseNormals( size_t start_vertex )
 
 void ModelArrays::SmoothNormals( size_t start_vertex )
 {
+	BufferDirty = true;
+	
 	if( ! Allocated )
 		BecomeCopy( this );
 	
@@ -2306,6 +2399,8 @@ void ModelArrays::SmoothNormals( size_t start_vertex )
 
 void ModelArrays::CalculateTangents( size_t start_vertex )
 {
+	BufferDirty = true;
+	
 	// Remain perpendicular to the normal along curved surfaces.
 	Pos3D tbn;
 	
@@ -2357,6 +2452,8 @@ void ModelArrays::CalculateTangents( size_t start_vertex )
 
 void ModelArrays::Optimize( double vertex_tolerance, double normal_tolerance, double dot_tolerance )
 {
+	BufferDirty = true;
+	
 	// 1. For each (unused) triangle, find others that share an edge and are on the same plane (within reason).
 	// 2. Continue recurisvely off every found triangle.
 	// 3. Any edge that is NOT shared with any other triangle of the group is on the outer edge of the shape.
@@ -2461,6 +2558,167 @@ bool ModelArrays::HasWorldSpaceVertex( const GLdouble *vertex ) const
 }
 
 
+ModelBuffer *ModelArrays::SharedBuffer( void ) const
+{
+	if( ! Buffer )
+		Buffer = new ModelBuffer();
+	
+	// Changes made before sharing belong to the shared buffer, so they don't make us stop sharing it.
+	if( BufferDirty )
+	{
+		Buffer->Dirty = true;
+		BufferDirty = false;
+	}
+	
+	return Buffer;
+}
+
+
+#ifndef NO_CLIENT
+bool ModelArrays::BindBuffer( void )
+{
+	// Upload static geometry once as interleaved floats; the double arrays stay CPU-side for collision.
+	if( ! (VertexCount && VertexArray && Raptor::Game->Gfx.VertexBuffers) )
+		return false;
+#ifndef NO_GLEW
+	// Without GLEW the entry points are linked directly, so only check them when they are loaded at runtime.
+	if( ! glGenBuffers )
+		return false;
+#endif
+
+	// Our data changed since it was shared, so stop drawing from the buffer other instances still use.
+	if( Buffer && BufferDirty && (Buffer->References > 1) )
+	{
+		Buffer->Release();
+		Buffer = NULL;
+	}
+	
+	ModelBuffer *buffer = SharedBuffer();
+	
+	// Buffers created before a context reset are already gone.
+	if( buffer->Name && buffer->Time.Before( &(Raptor::Game->Res.ResetTime) ) )
+		buffer->Name = 0;
+	
+	if( ! buffer->Name )
+	{
+		glGenBuffers( 1, &(buffer->Name) );
+		buffer->Time.Reset();
+		buffer->Dirty = true;
+		if( ! buffer->Name )
+			return false;
+	}
+	
+	glBindBuffer( GL_ARRAY_BUFFER, buffer->Name );
+	
+	if( buffer->Dirty )
+	{
+		std::vector<GLfloat> interleaved( VertexCount * MODELARRAYS_VBO_FLOATS, 0.f );
+		for( size_t i = 0; i < VertexCount; i ++ )
+		{
+			GLfloat *vertex = &(interleaved[ i * MODELARRAYS_VBO_FLOATS ]);
+			vertex[ 0 ] = VertexArray[ i*3     ];
+			vertex[ 1 ] = VertexArray[ i*3 + 1 ];
+			vertex[ 2 ] = VertexArray[ i*3 + 2 ];
+			if( NormalArray )
+				memcpy( vertex + 3, NormalArray + i*3, 3 * sizeof(GLfloat) );
+			if( TexCoordArray )
+				memcpy( vertex + 6, TexCoordArray + i*2, 2 * sizeof(GLfloat) );
+			if( TangentArray )
+				memcpy( vertex + 8, TangentArray + i*3, 3 * sizeof(GLfloat) );
+			if( BitangentArray )
+				memcpy( vertex + 11, BitangentArray + i*3, 3 * sizeof(GLfloat) );
+		}
+		
+		glBufferData( GL_ARRAY_BUFFER, interleaved.size() * sizeof(GLfloat), &(interleaved[ 0 ]), GL_STATIC_DRAW );
+		buffer->Dirty = false;
+	}
+	
+	return true;
+}
+#endif
+
+
+void ModelArrays::ReloadBuffer( void )
+{
+	// Called after the context is recreated, so the old handle is not ours to delete.
+	// The buffer is uploaded again the next time these arrays are drawn.
+	if( Buffer )
+	{
+		Buffer->Name = 0;
+		Buffer->Dirty = true;
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+ModelBuffer::ModelBuffer( void )
+{
+	Name = 0;
+	Dirty = true;
+	References = 1;
+}
+
+
+ModelBuffer::~ModelBuffer()
+{
+#ifndef NO_CLIENT
+	// No OpenGL cleanup if we already lost the context.
+	if( Name && ! Time.Before( &(Raptor::Game->Res.ResetTime) ) )
+		glDeleteBuffers( 1, &Name );
+#endif
+	Name = 0;
+}
+
+
+ModelBuffer *ModelBuffer::Retain( void )
+{
+	References ++;
+	return this;
+}
+
+
+void ModelBuffer::Release( void )
+{
+	References --;
+	if( References <= 0 )
+		delete this;
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+ModelLODs::ModelLODs( void )
+{
+	References = 1;
+}
+
+
+ModelLODs::~ModelLODs()
+{
+	for( std::vector<ModelArrays*>::iterator lod_iter = Arrays.begin(); lod_iter != Arrays.end(); lod_iter ++ )
+		delete *lod_iter;
+	Arrays.clear();
+}
+
+
+ModelLODs *ModelLODs::Retain( void )
+{
+	References ++;
+	return this;
+}
+
+
+void ModelLODs::Release( void )
+{
+	References --;
+	if( References <= 0 )
+		delete this;
+}
+
+
 // ---------------------------------------------------------------------------
 
 
@@ -3015,7 +3273,7 @@ void ModelObject::Recalc( void )
 	MaxRadius = 0.;
 	double max_triangle_edge_squared = 0.;
 	size_t vertex_count = 0;
-
+	
 	MinFwd = FLT_MAX;
 	MinUp = FLT_MAX;
 	MinRight = FLT_MAX;
@@ -3223,23 +3481,35 @@ ModelMaterial::ModelMaterial( void )
 	Shininess = 1.f;
 	BumpScale = 0.f;
 	GlowScale = 0.f;
+	LODs = NULL;
 }
 
 
 ModelMaterial::ModelMaterial( const ModelMaterial &other )
 {
+	LODs = NULL;
 	BecomeInstance( &other );
 }
 
 
 ModelMaterial::ModelMaterial( const ModelMaterial *other )
 {
+	LODs = NULL;
 	BecomeInstance( other );
 }
 
 
 ModelMaterial::~ModelMaterial()
 {
+	ClearLODs();
+}
+
+
+ModelMaterial &ModelMaterial::operator = ( const ModelMaterial &other )
+{
+	if( &other != this )
+		BecomeInstance( &other );
+	return *this;
 }
 
 
@@ -3255,9 +3525,84 @@ void ModelMaterial::BecomeInstance( const ModelMaterial *other )
 	BumpScale = other->BumpScale;
 	GlowScale = other->GlowScale;
 	Arrays.BecomeInstance( &(other->Arrays) );
+	
+	// Share the LOD arrays, so they outlive the source clearing or deleting its own.
+	ModelLODs *lods = other->LODs ? other->LODs->Retain() : NULL;
+	ClearLODs();
+	LODs = lods;
 }
 
 
+void ModelMaterial::ClearLODs( void )
+{
+	if( LODs )
+		LODs->Release();
+	LODs = NULL;
+}
+
+
+ModelArrays *ModelMaterial::LODArrays( int level )
+{
+	// Level 0 is the full-detail arrays; requests beyond the coarsest LOD get the coarsest.
+	if( (level <= 0) || ! LODs || LODs->Arrays.empty() )
+		return &Arrays;
+	if( (size_t) level > LODs->Arrays.size() )
+		level = LODs->Arrays.size();
+	return LODs->Arrays[ level - 1 ];
+}
+
+
+#ifndef NO_CLIENT
+// Sets this material's shader uniforms, bump/glow textures, and tangent attributes; the caller binds the diffuse texture.
+void ModelMaterial::SetShaderVars( GLsizei stride, const GLvoid *normals, const GLvoid *tangents, const GLvoid *bitangents, GLint tangent_loc, GLint bitangent_loc, bool use_bumpmap )
+{
+	Raptor::Game->ShaderMgr.Set3f( Shader::VAR_AMBIENT_COLOR,  Ambient.Red,  Ambient.Green,  Ambient.Blue );
+	Raptor::Game->ShaderMgr.Set3f( Shader::VAR_DIFFUSE_COLOR,  Diffuse.Red,  Diffuse.Green,  Diffuse.Blue );
+	Raptor::Game->ShaderMgr.Set3f( Shader::VAR_SPECULAR_COLOR, Specular.Red, Specular.Green, Specular.Blue );
+	Raptor::Game->ShaderMgr.Set1f( Shader::VAR_ALPHA, Ambient.Alpha );
+	Raptor::Game->ShaderMgr.Set1f( Shader::VAR_SHININESS, Shininess );
+	
+	Raptor::Game->ShaderMgr.Set1i( Shader::VAR_TEXTURE, 0 );
+	Raptor::Game->ShaderMgr.Set1i( Shader::VAR_BUMP_MAP, 1 );
+	Raptor::Game->ShaderMgr.Set1i( Shader::VAR_GLOW_MAP, 2 );
+	
+	glActiveTexture( GL_TEXTURE0 + 1 ); // BumpMap
+	
+	if( use_bumpmap && BumpMap.Frames.size() )
+	{
+		glBindTexture( GL_TEXTURE_2D, BumpMap.CurrentFrame() );
+		glVertexAttribPointer( tangent_loc,   3, GL_FLOAT, GL_TRUE, stride, tangents );
+		glVertexAttribPointer( bitangent_loc, 3, GL_FLOAT, GL_TRUE, stride, bitangents );
+		Raptor::Game->ShaderMgr.Set1f( Shader::VAR_BUMP_SCALE, BumpScale );
+	}
+	else
+	{
+		glBindTexture( GL_TEXTURE_2D, 0 );
+		if( tangent_loc >= 0 )
+			glVertexAttribPointer( tangent_loc,   3, GL_FLOAT, GL_TRUE, stride, normals );
+		if( bitangent_loc >= 0 )
+			glVertexAttribPointer( bitangent_loc, 3, GL_FLOAT, GL_TRUE, stride, normals );
+		Raptor::Game->ShaderMgr.Set1f( Shader::VAR_BUMP_SCALE, 0. );
+	}
+	
+	glActiveTexture( GL_TEXTURE0 + 2 ); // GlowMap
+	
+	if( Raptor::Game->Gfx.GlowMaps && GlowMap.Frames.size() )
+	{
+		glBindTexture( GL_TEXTURE_2D, GlowMap.CurrentFrame() );
+		Raptor::Game->ShaderMgr.Set1f( Shader::VAR_GLOW_SCALE, GlowScale );
+	}
+	else
+	{
+		glBindTexture( GL_TEXTURE_2D, 0 );
+		Raptor::Game->ShaderMgr.Set1f( Shader::VAR_GLOW_SCALE, 0. );
+	}
+	
+	glActiveTexture( GL_TEXTURE0 + 0 ); // Texture
+}
+#endif
+
+
 void ModelMaterial::CalculateNormals( void )
 {
 	Arrays.CalculateNormals();
@@ -6,6 +6,8 @@
 class Model;
 class ModelFace;
 class ModelArrays;
+class ModelBuffer;
+class ModelLODs;
 class ModelVertex;   // Temporarily used while optimizing.
 class ModelTriangle; //
 class ModelEdge;     //
@@ -28,6 +30,19 @@ class ModelMaterial;
 #include "Color.h"
 #include "Rand.h"
 #include "Randomizer.h"
+#include "Clock.h"
+
+// Interleaved float layout of ModelArrays vertex buffers: position, normal, texcoord, tangent, bitangent.
+#define MODELARRAYS_VBO_FLOATS 14
+#define MODELARRAYS_VBO_STRIDE (MODELARRAYS_VBO_FLOATS * sizeof(GLfloat))
+#define MODELARRAYS_VBO_VERTEX ((const GLvoid*)( 0 ))
+#define MODELARRAYS_VBO_NORMAL ((const GLvoid*)( 3 * sizeof(GLfloat) ))
+#define MODELARRAYS_VBO_TEXCOORD ((const GLvoid*)( 6 * sizeof(GLfloat) ))
+#define MODELARRAYS_VBO_TANGENT ((const GLvoid*)( 8 * sizeof(GLfloat) ))
+#define MODELARRAYS_VBO_BITANGENT ((const GLvoid*)( 11 * sizeof(GLfloat) ))
+
+// Models whose bounding sphere projects smaller than this many pixels use coarser LODs (halving per level).
+#define MODEL_LOD_PIXELS 64.
 
 
 class Model
@@ -52,13 +67,20 @@ public:
 	bool IncludeOBJ( std::string filename, bool get_textures = true );
 	void ApplySmoothGroups( void );
 	void MakeMaterialArrays( void );
+	void ReloadBuffers( void );
 	void CalculateNormals( void );
 	void ReverseNormals( void );
 	void SmoothNormals( void );
 	void Optimize( double vertex_tolerance = 0., double normal_tolerance = 0.001, double dot_tolerance = 0.0001 );
+	void MakeLODs( int levels = 2 );
+	void ClearLODs( void );
+	int LODLevel( double pixel_radius ) const;
 	
-	void Draw( const Pos3D *pos = NULL, const std::set<std::string> *object_names = NULL, const Color *wireframe = NULL, double exploded = 0., int explosion_seed = 0, double fwd_scale = 1., double up_scale = 1., double right_scale = 1. );
+	// Only pass cull=true when pos is in world space under the camera set by Setup3D; that enables frustum culling and LOD.
+	void Draw( const Pos3D *pos = NULL, const std::set<std::string> *object_names = NULL, const Color *wireframe = NULL, double exploded = 0., int explosion_seed = 0, double fwd_scale = 1., double up_scale = 1., double right_scale = 1., bool cull = false );
 	void DrawAt( const Pos3D *pos, double scale = 1., double fwd_scale = 1., double up_scale = 1., double right_scale = 1. );
+	void DrawCulledAt( const Pos3D *pos, double scale = 1., double fwd_scale = 1., double up_scale = 1., double right_scale = 1. );
+	static void ResetShaderVars( void );
 	void DrawObjectsAt( const std::list<std::string> *object_names, const Pos3D *pos, double scale = 1., double fwd_scale = 1., double up_scale = 1., double right_scale = 1. );
 	void DrawWireframeAt( const Pos3D *pos, Color color, double scale = 1., double fwd_scale = 1., double up_scale = 1., double right_scale = 1. );
 	
@@ -113,6 +135,8 @@ public:
 	GLfloat *TangentArray, *BitangentArray;
 	int *SmoothGroups;
 	bool Allocated, AllocatedWorldSpace;
+	mutable ModelBuffer *Buffer;
+	mutable bool BufferDirty;
 	
 	ModelArrays( void );
 	ModelArrays( const ModelArrays &other );
@@ -133,6 +157,43 @@ public:
 	void Optimize( double vertex_tolerance = 0.0001, double normal_tolerance = 0.1, double dot_tolerance = 0.001 );
 	void MakeWorldSpace( const Pos3D *pos, double fwd_scale = 1., double up_scale = 1., double right_scale = 1. );
 	bool HasWorldSpaceVertex( const GLdouble *vertex ) const;
+	bool BindBuffer( void );
+	void ReloadBuffer( void );
+
+private:
+	ModelBuffer *SharedBuffer( void ) const;
+};
+
+
+// Vertex buffer shared by ModelArrays instances of the same data; the last reference deletes it.
+class ModelBuffer
+{
+public:
+	GLuint Name;
+	bool Dirty;
+	Clock Time;
+	int References;
+	
+	ModelBuffer( void );
+	~ModelBuffer();
+	
+	ModelBuffer *Retain( void );
+	void Release( void );
+};
+
+
+// LOD arrays are read-only once built, so material instances share them and the last reference deletes them.
+class ModelLODs
+{
+public:
+	std::vector<ModelArrays*> Arrays;
+	int References;
+	
+	ModelLODs( void );
+	~ModelLODs();
+	
+	ModelLODs *Retain( void );
+	void Release( void );
 };
 
 
@@ -221,7 +282,7 @@ public:
 	double GetExplosionRotationRate( int seed = 0, Randomizer *randomizer = &GlobalRandomizer ) const;
 	
 	static Randomizer GlobalRandomizer;
-	
+
 private:
 	bool NeedsRecalc;
 };
@@ -234,13 +295,19 @@ public:
 	Color Ambient, Diffuse, Specular;
 	float Shininess, BumpScale, GlowScale;
 	ModelArrays Arrays;
+	ModelLODs *LODs;
 	
 	ModelMaterial( void );
 	ModelMaterial( const ModelMaterial &other );
 	ModelMaterial( const ModelMaterial *other );
 	virtual ~ModelMaterial();
 	
+	ModelMaterial &operator = ( const ModelMaterial &other );
+	
 	void BecomeInstance( const ModelMaterial *other );
+	void ClearLODs( void );
+	ModelArrays *LODArrays( int level );
+	void SetShaderVars( GLsizei stride, const GLvoid *normals, const GLvoid *tangents, const GLvoid *bitangents, GLint tangent_loc, GLint bitangent_loc, bool use_bumpmap );
 	void CalculateNormals( void );
 	void ReverseNormals( void );
 	void SmoothNormals( void );
@@ -0,0 +1,331 @@
+/*
+ *  ModelQueue.cpp
+ */
+
+#include "ModelQueue.h"
+
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include "RaptorGame.h"
+
+
+ModelQueue::ModelQueue( void )
+{
+	InstanceBuffer = 0;
+	Instances = 0;
+	DrawCalls = 0;
+	ShaderChanges = 0;
+	MaterialChanges = 0;
+}
+
+
+ModelQueue::~ModelQueue()
+{
+	// No OpenGL cleanup if we already lost the context.
+	if( InstanceBuffer && ! BufferTime.Before( &(Raptor::Game->Res.ResetTime) ) )
+		glDeleteBuffers( 1, &InstanceBuffer );
+	InstanceBuffer = 0;
+}
+
+
+void ModelQueue::Add( Model *model, const Pos3D *pos, double scale, double fwd_scale, double up_scale, double right_scale )
+{
+	if( ! model )
+		return;
+	
+	// Without shaders the model is transformed on the CPU, so there is nothing to batch.
+	// Builds without GLEW may lack instancing entry points, so they also draw each model right away.
+	Shader *shader = Raptor::Game->ShaderMgr.Active() ? Raptor::Game->ShaderMgr.Selected : NULL;
+#ifdef NO_GLEW
+	shader = NULL;
+#endif
+	if( ! shader )
+	{
+		model->DrawCulledAt( pos, scale, fwd_scale, up_scale, right_scale );
+		return;
+	}
+	
+	fwd_scale   *= scale;
+	up_scale    *= scale;
+	right_scale *= scale;
+	
+	double radius = model->GetMaxRadius() * std::max<double>( fabs(fwd_scale), std::max<double>( fabs(up_scale), fabs(right_scale) ) );
+	if( ! Raptor::Game->Gfx.SphereInFrustum( pos, radius ) )
+	{
+		Raptor::Game->Gfx.ModelsCulled ++;
+		return;
+	}
+	Raptor::Game->Gfx.ModelsDrawn ++;
+	
+	AddInstance( shader, model, model->LODLevel( Raptor::Game->Gfx.PixelRadius( pos, radius ) ), pos, fwd_scale, up_scale, right_scale );
+}
+
+
+void ModelQueue::AddInstance( Shader *shader, Model *model, int lod, const Pos3D *pos, double fwd_scale, double up_scale, double right_scale )
+{
+	// Only LOD levels the model actually has get their own group.
+	if( lod > 0 )
+	{
+		size_t levels = 0;
+		for( std::map<std::string,ModelMaterial*>::const_iterator mtl_iter = model->Materials.begin(); mtl_iter != model->Materials.end(); mtl_iter ++ )
+		{
+			if( mtl_iter->second->LODs )
+				levels = std::max<size_t>( levels, mtl_iter->second->LODs->Arrays.size() );
+		}
+		lod = std::min<int>( lod, levels );
+	}
+	
+	std::vector<GLfloat> *transforms = &(Groups[ ModelQueueGroup( shader, model, lod ) ]);
+	size_t index = transforms->size();
+	transforms->resize( index + MODELQUEUE_INSTANCE_FLOATS );
+	GLfloat *instance = &((*transforms)[ index ]);
+	
+	// In model space, X = fwd, Y = up, Z = right.
+	instance[  0 ] = pos->X;
+	instance[  1 ] = pos->Y;
+	instance[  2 ] = pos->Z;
+	instance[  3 ] = pos->Fwd.X * fwd_scale;
+	instance[  4 ] = pos->Up.X * up_scale;
+	instance[  5 ] = pos->Right.X * right_scale;
+	instance[  6 ] = pos->Fwd.Y * fwd_scale;
+	instance[  7 ] = pos->Up.Y * up_scale;
+	instance[  8 ] = pos->Right.Y * right_scale;
+	instance[  9 ] = pos->Fwd.Z * fwd_scale;
+	instance[ 10 ] = pos->Up.Z * up_scale;
+	instance[ 11 ] = pos->Right.Z * right_scale;
+}
+
+
+void ModelQueue::Draw( void )
+{
+	Instances = 0;
+	DrawCalls = 0;
+	ShaderChanges = 0;
+	MaterialChanges = 0;
+	
+	if( ! Raptor::Game->ShaderMgr.Initialized )
+	{
+		Clear();
+		return;
+	}
+	
+	// Each group remembers its shader, so flushing works even if shaders were stopped since queueing.
+	Shader *prev_shader = Raptor::Game->ShaderMgr.Selected;
+	bool prev_active = Raptor::Game->ShaderMgr.Active();
+	bool active = prev_active;
+	bool instancing = Instancing();
+	
+	// Groups are sorted by shader first, so each shader is selected at most once.
+	std::map< ModelQueueGroup, std::vector<GLfloat> >::iterator group_iter = Groups.begin();
+	while( group_iter != Groups.end() )
+	{
+		if( group_iter->second.empty() )
+		{
+			// Unused since last frame; the model may have been freed, so forget it.
+			Groups.erase( group_iter ++ );
+			continue;
+		}
+		
+		if( (group_iter->first.ShaderPtr != Raptor::Game->ShaderMgr.Selected) || ! active )
+		{
+			Raptor::Game->ShaderMgr.Selected = group_iter->first.ShaderPtr;
+			Raptor::Game->ShaderMgr.ResumeShaders();
+			active = true;
+			ShaderChanges ++;
+		}
+		
+		DrawGroup( group_iter->first.ModelPtr, group_iter->first.LOD, &(group_iter->second), instancing );
+		
+		// Keep the allocation for next frame.
+		group_iter->second.clear();
+		group_iter ++;
+	}
+	
+	if( (Raptor::Game->ShaderMgr.Selected != prev_shader) || (active != prev_active) )
+	{
+		Raptor::Game->ShaderMgr.Selected = prev_shader;
+		if( prev_active )
+			Raptor::Game->ShaderMgr.ResumeShaders();
+		else
+			Raptor::Game->ShaderMgr.StopShaders();
+	}
+}
+
+
+void ModelQueue::Clear( void )
+{
+	for( std::map< ModelQueueGroup, std::vector<GLfloat> >::iterator group_iter = Groups.begin(); group_iter != Groups.end(); group_iter ++ )
+		group_iter->second.clear();
+}
+
+
+bool ModelQueue::Instancing( void )
+{
+#ifndef NO_GLEW
+	// Instanced draws and attribute divisors are both core in OpenGL 3.3.
+	return Raptor::Game->Gfx.VertexBuffers && GLEW_VERSION_3_3 && Raptor::Game->Cfg.SettingAsBool( "g_instancing", true );
+#else
+	return false;
+#endif
+}
+
+
+bool ModelQueue::BindInstanceBuffer( const std::vector<GLfloat> *transforms )
+{
+	// Buffers created before a context reset are already gone.
+	if( InstanceBuffer && BufferTime.Before( &(Raptor::Game->Res.ResetTime) ) )
+		InstanceBuffer = 0;
+	
+	if( ! InstanceBuffer )
+	{
+		glGenBuffers( 1, &InstanceBuffer );
+		BufferTime.Reset();
+		if( ! InstanceBuffer )
+			return false;
+	}
+	
+	glBindBuffer( GL_ARRAY_BUFFER, InstanceBuffer );
+	glBufferData( GL_ARRAY_BUFFER, transforms->size() * sizeof(GLfloat), &((*transforms)[ 0 ]), GL_STREAM_DRAW );
+	return true;
+}
+
+
+void ModelQueue::DrawGroup( Model *model, int lod, const std::vector<GLfloat> *transforms, bool instancing )
+{
+	GLsizei instances = transforms->size() / MODELQUEUE_INSTANCE_FLOATS;
+	Instances += instances;
+	
+	GLint tangent_loc   = Raptor::Game->ShaderMgr.AttribLoc( Shader::VAR_BUMP_TANGENT   );
+	GLint bitangent_loc = Raptor::Game->ShaderMgr.AttribLoc( Shader::VAR_BUMP_BITANGENT );
+	bool use_bumpmap = (tangent_loc >= 0) && (bitangent_loc >= 0) && (Raptor::Game->Gfx.LightQuality >= 3);
+	
+	// Shaders without per-instance attributes get the uniform path below.
+	GLint instance_locs[ 4 ] = { -1, -1, -1, -1 };
+	bool instanced = instancing && (instances > 1);
+	for( int i = 0; instanced && (i < 4); i ++ )
+	{
+		instance_locs[ i ] = Raptor::Game->ShaderMgr.AttribLoc( (ShaderVarID)( Shader::VAR_INSTANCE_POS + i ) );
+		if( instance_locs[ i ] < 0 )
+			instanced = false;
+	}
+
+#ifndef NO_GLEW
+	if( instanced && BindInstanceBuffer( transforms ) )
+	{
+		for( int i = 0; i < 4; i ++ )
+		{
+			glEnableVertexAttribArray( instance_locs[ i ] );
+			glVertexAttribPointer( instance_locs[ i ], 3, GL_FLOAT, GL_FALSE, MODELQUEUE_INSTANCE_STRIDE, (const GLvoid*)( i * 3 * sizeof(GLfloat) ) );
+			glVertexAttribDivisor( instance_locs[ i ], 1 );
+		}
+		glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	}
+	else
+#endif
+		instanced = false;
+	
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	glEnableClientState( GL_NORMAL_ARRAY );
+	glEnable( GL_TEXTURE_2D );
+	glColor4f( 1.f, 1.f, 1.f, 1.f );
+	
+	if( tangent_loc >= 0 )
+		glEnableVertexAttribArray( tangent_loc );
+	if( bitangent_loc >= 0 )
+		glEnableVertexAttribArray( bitangent_loc );
+	
+	for( std::map<std::string,ModelMaterial*>::iterator mtl_iter = model->Materials.begin(); mtl_iter != model->Materials.end(); mtl_iter ++ )
+	{
+		if( ! mtl_iter->second->Arrays.VertexCount )
+			continue;
+		ModelArrays *arrays = mtl_iter->second->LODArrays( lod );
+		
+		bool buffered = arrays->BindBuffer();
+		GLsizei stride = buffered ? MODELARRAYS_VBO_STRIDE : 0;
+		const GLvoid *normals    = buffered ? MODELARRAYS_VBO_NORMAL    : (const GLvoid*) arrays->NormalArray;
+		const GLvoid *tex_coords = buffered ? MODELARRAYS_VBO_TEXCOORD  : (const GLvoid*) arrays->TexCoordArray;
+		const GLvoid *tangents   = buffered ? MODELARRAYS_VBO_TANGENT   : (const GLvoid*) arrays->TangentArray;
+		const GLvoid *bitangents = buffered ? MODELARRAYS_VBO_BITANGENT : (const GLvoid*) arrays->BitangentArray;
+		
+		if( buffered )
+			glVertexPointer( 3, GL_FLOAT, stride, MODELARRAYS_VBO_VERTEX );
+		else
+			glVertexPointer( 3, GL_DOUBLE, 0, arrays->VertexArray );
+		glTexCoordPointer( 2, GL_FLOAT, stride, tex_coords );
+		glNormalPointer( GL_FLOAT, stride, normals );
+		
+		mtl_iter->second->SetShaderVars( stride, normals, tangents, bitangents, tangent_loc, bitangent_loc, use_bumpmap );
+		glBindTexture( GL_TEXTURE_2D, mtl_iter->second->Texture.CurrentFrame() );
+		MaterialChanges ++;
+
+#ifndef NO_GLEW
+		if( instanced )
+		{
+			glDrawArraysInstanced( GL_TRIANGLES, 0, arrays->VertexCount, instances );
+			DrawCalls ++;
+		}
+		else
+#endif
+		{
+			for( GLsizei i = 0; i < instances; i ++ )
+			{
+				const GLfloat *instance = &((*transforms)[ i * MODELQUEUE_INSTANCE_FLOATS ]);
+				Raptor::Game->ShaderMgr.Set3f( Shader::VAR_POS,  instance[ 0 ], instance[  1 ], instance[  2 ] );
+				Raptor::Game->ShaderMgr.Set3f( Shader::VAR_XVEC, instance[ 3 ], instance[  4 ], instance[  5 ] );
+				Raptor::Game->ShaderMgr.Set3f( Shader::VAR_YVEC, instance[ 6 ], instance[  7 ], instance[  8 ] );
+				Raptor::Game->ShaderMgr.Set3f( Shader::VAR_ZVEC, instance[ 9 ], instance[ 10 ], instance[ 11 ] );
+				glDrawArrays( GL_TRIANGLES, 0, arrays->VertexCount );
+				DrawCalls ++;
+			}
+		}
+		
+		if( buffered )
+			glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	}
+	
+	if( tangent_loc >= 0 )
+		glDisableVertexAttribArray( tangent_loc );
+	if( bitangent_loc >= 0 )
+		glDisableVertexAttribArray( bitangent_loc );
+
+#ifndef NO_GLEW
+	if( instanced )
+	{
+		for( int i = 0; i < 4; i ++ )
+		{
+			glVertexAttribDivisor( instance_locs[ i ], 0 );
+			glDisableVertexAttribArray( instance_locs[ i ] );
+		}
+	}
+#endif
+
+	glDisableClientState( GL_NORMAL_ARRAY );
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+	glDisable( GL_TEXTURE_2D );
+	
+	Model::ResetShaderVars();
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+ModelQueueGroup::ModelQueueGroup( Shader *shader, Model *model, int lod )
+{
+	ShaderPtr = shader;
+	ModelPtr = model;
+	LOD = lod;
+}
+
+
+bool ModelQueueGroup::operator < ( const ModelQueueGroup &other ) const
+{
+	if( ShaderPtr != other.ShaderPtr )
+		return ShaderPtr < other.ShaderPtr;
+	if( ModelPtr != other.ModelPtr )
+		return ModelPtr < other.ModelPtr;
+	return LOD < other.LOD;
+}
@@ -0,0 +1,67 @@
+/*
+ *  ModelQueue.h
+ */
+
+#pragma once
+class ModelQueue;
+class ModelQueueGroup;
+
+#include "PlatformSpecific.h"
+
+#include <map>
+#include <vector>
+#include "RaptorGL.h"
+#include "Model.h"
+#include "Shader.h"
+#include "Pos.h"
+#include "Clock.h"
+
+
+// Per instance: Pos, XVec, YVec, ZVec (same values Model::Draw sends as uniforms).
+#define MODELQUEUE_INSTANCE_FLOATS 12
+#define MODELQUEUE_INSTANCE_STRIDE (MODELQUEUE_INSTANCE_FLOATS * sizeof(GLfloat))
+
+
+class ModelQueueGroup
+{
+public:
+	Shader *ShaderPtr;
+	Model *ModelPtr;
+	int LOD;
+	
+	ModelQueueGroup( Shader *shader, Model *model, int lod );
+	bool operator < ( const ModelQueueGroup &other ) const;
+};
+
+
+// Collects whole-model draws during a frame and submits them grouped by (shader, model, LOD),
+// so material state is set once per group and each material is drawn with one instanced call.
+// Shaders opt in to instancing by declaring the per-instance attributes and using them in place
+// of the usual uniforms, for example:
+//   attribute vec3 InstancePos, InstanceXVec, InstanceYVec, InstanceZVec;
+//   vec3 world = InstancePos + InstanceXVec * gl_Vertex.x + InstanceYVec * gl_Vertex.y + InstanceZVec * gl_Vertex.z;
+// Otherwise each instance sets the usual uniforms but material state is still shared.
+// Positions must be in world space under the camera set by Setup3D, since queued models are frustum-culled.
+class ModelQueue
+{
+public:
+	std::map< ModelQueueGroup, std::vector<GLfloat> > Groups;
+	GLuint InstanceBuffer;
+	Clock BufferTime;
+	
+	unsigned int Instances, DrawCalls, ShaderChanges, MaterialChanges;
+	
+	ModelQueue( void );
+	virtual ~ModelQueue();
+	
+	void Add( Model *model, const Pos3D *pos, double scale = 1., double fwd_scale = 1., double up_scale = 1., double right_scale = 1. );
+	void AddInstance( Shader *shader, Model *model, int lod, const Pos3D *pos, double fwd_scale = 1., double up_scale = 1., double right_scale = 1. );
+	void Draw( void );
+	void Clear( void );
+	
+	bool Instancing( void );
+
+private:
+	bool BindInstanceBuffer( const std::vector<GLfloat> *transforms );
+	void DrawGroup( Model *model, int lod, const std::vector<GLfloat> *transforms, bool instancing );
+};
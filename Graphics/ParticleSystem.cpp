@@ -0,0 +1,492 @@
+/*
+ *  ParticleSystem.cpp
+ */
+
+#include "ParticleSystem.h"
+
+#include <cmath>
+#include <algorithm>
+#include "Num.h"
+#include "Effect.h"
+#ifndef NO_CLIENT
+	#include "RaptorGame.h"
+#endif
+
+
+// Per vertex: texcoord 2, color 4; positions are kept in a separate double array, like Effect::DrawQuad's glVertex3d.
+#define PARTICLE_VERTEX_FLOATS 6
+#define PARTICLE_VERTEX_STRIDE (PARTICLE_VERTEX_FLOATS * sizeof(GLfloat))
+
+// Emitters left empty this long are freed, so animations that stop appearing don't keep their arrays.
+#define PARTICLE_EMITTER_IDLE_SECS 10.
+
+
+ParticleEmitter::ParticleEmitter( const Animation *anim )
+{
+	Anim.BecomeInstance( anim );
+	FastFrame = 0;
+	IdleSince = 0.;
+	
+	// Cumulative frame end times (at speed 1) so each particle's frame is a binary search.
+	double total = 0.;
+	for( std::vector<double>::const_iterator time_iter = Anim.FrameTimes.begin(); time_iter != Anim.FrameTimes.end(); time_iter ++ )
+	{
+		total += *time_iter;
+		FrameEnds.push_back( total );
+	}
+}
+
+
+ParticleEmitter::~ParticleEmitter()
+{
+}
+
+
+bool ParticleEmitter::Matches( const Animation *anim ) const
+{
+	return (anim->Name == Anim.Name) && (anim->PlayCount == Anim.PlayCount) && (anim->Frames == Anim.Frames) && (anim->FrameTimes == Anim.FrameTimes);
+}
+
+
+size_t ParticleEmitter::Count( void ) const
+{
+	return X.size();
+}
+
+
+void ParticleEmitter::Add( const Pos3D *pos, const Vec3D *motion_vec, double rotation_speed, double length, double width, double speed_scale, double seconds_to_live, SoundOutHandle audio_voice )
+{
+	X.push_back( pos->X );
+	Y.push_back( pos->Y );
+	Z.push_back( pos->Z );
+	MotionX.push_back( motion_vec ? motion_vec->X : 0. );
+	MotionY.push_back( motion_vec ? motion_vec->Y : 0. );
+	MotionZ.push_back( motion_vec ? motion_vec->Z : 0. );
+	Rotation.push_back( 0. );
+	RotationSpeed.push_back( rotation_speed );
+	Size.push_back( length );
+	Width.push_back( width );
+	Red.push_back( 1.f );
+	Green.push_back( 1.f );
+	Blue.push_back( 1.f );
+	Alpha.push_back( 1.f );
+	Born.push_back( Clock::Now() / (double) CLOCK_NS_PER_SEC );
+	Delay.push_back( 0. );
+	SecondsToLive.push_back( seconds_to_live );
+	Speed.push_back( speed_scale );
+	AudioVoice.push_back( audio_voice );
+}
+
+
+void ParticleEmitter::Add( const Effect *effect )
+{
+	Add( effect, &(effect->MotionVector), effect->RotationSpeed, effect->Size, effect->Width, effect->Anim.Speed, effect->SecondsToLive, effect->AudioVoice );
+	
+	// Effects may have been adjusted after construction.
+	Rotation.back() = effect->Rotation;
+	Red.back() = effect->Red;
+	Green.back() = effect->Green;
+	Blue.back() = effect->Blue;
+	Alpha.back() = effect->Alpha;
+	Born.back() = effect->Lifetime.TimeNS / (double) CLOCK_NS_PER_SEC;
+	Delay.back() = effect->Lifetime.CountUpToSecs;
+}
+
+
+void ParticleEmitter::Remove( size_t index )
+{
+	size_t last = X.size() - 1;
+	if( index != last )
+	{
+		X[ index ] = X[ last ];
+		Y[ index ] = Y[ last ];
+		Z[ index ] = Z[ last ];
+		MotionX[ index ] = MotionX[ last ];
+		MotionY[ index ] = MotionY[ last ];
+		MotionZ[ index ] = MotionZ[ last ];
+		Rotation[ index ] = Rotation[ last ];
+		RotationSpeed[ index ] = RotationSpeed[ last ];
+		Size[ index ] = Size[ last ];
+		Width[ index ] = Width[ last ];
+		Red[ index ] = Red[ last ];
+		Green[ index ] = Green[ last ];
+		Blue[ index ] = Blue[ last ];
+		Alpha[ index ] = Alpha[ last ];
+		Born[ index ] = Born[ last ];
+		Delay[ index ] = Delay[ last ];
+		SecondsToLive[ index ] = SecondsToLive[ last ];
+		Speed[ index ] = Speed[ last ];
+		AudioVoice[ index ] = AudioVoice[ last ];
+	}
+	
+	X.pop_back();
+	Y.pop_back();
+	Z.pop_back();
+	MotionX.pop_back();
+	MotionY.pop_back();
+	MotionZ.pop_back();
+	Rotation.pop_back();
+	RotationSpeed.pop_back();
+	Size.pop_back();
+	Width.pop_back();
+	Red.pop_back();
+	Green.pop_back();
+	Blue.pop_back();
+	Alpha.pop_back();
+	Born.pop_back();
+	Delay.pop_back();
+	SecondsToLive.pop_back();
+	Speed.pop_back();
+	AudioVoice.pop_back();
+}
+
+
+void ParticleEmitter::Clear( void )
+{
+	// Keep capacity so the next burst doesn't allocate.
+	X.clear();
+	Y.clear();
+	Z.clear();
+	MotionX.clear();
+	MotionY.clear();
+	MotionZ.clear();
+	Rotation.clear();
+	RotationSpeed.clear();
+	Size.clear();
+	Width.clear();
+	Red.clear();
+	Green.clear();
+	Blue.clear();
+	Alpha.clear();
+	Born.clear();
+	Delay.clear();
+	SecondsToLive.clear();
+	Speed.clear();
+	AudioVoice.clear();
+}
+
+
+bool ParticleEmitter::Finished( size_t index, double now ) const
+{
+	// Same rules as Effect::Finished, with the animation starting once Delay has passed.
+	double age = now - Born[ index ];
+	if( (SecondsToLive[ index ] > 0.) && (age > SecondsToLive[ index ] + Delay[ index ]) )
+		return true;
+	if( (Anim.PlayCount > 0) && FrameEnds.size() && (age > Delay[ index ]) && ((age - Delay[ index ]) * Speed[ index ] >= FrameEnds.back() * Anim.PlayCount) )
+		return true;
+	return false;
+}
+
+
+size_t ParticleEmitter::FrameIndex( size_t index, double now ) const
+{
+	size_t count = std::min<size_t>( Anim.Frames.size(), FrameEnds.size() );
+	if( count <= 1 )
+		return 0;
+	
+	double loop_time = FrameEnds.back();
+	if( ! loop_time )
+		return FastFrame % count;
+	
+	double time_in_animation = (now - Born[ index ] - Delay[ index ]) * Speed[ index ];
+	if( time_in_animation <= 0. )
+		return 0;
+	if( (Anim.PlayCount > 0) && (time_in_animation >= loop_time * Anim.PlayCount) )
+		return count - 1;
+	
+	time_in_animation = fmod( time_in_animation, loop_time );
+	size_t frame = std::upper_bound( FrameEnds.begin(), FrameEnds.end(), time_in_animation ) - FrameEnds.begin();
+	return std::min<size_t>( frame, count - 1 );
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+bool ParticleSort::operator < ( const ParticleSort &other ) const
+{
+	// Far-to-near, so blended billboards draw back to front.
+	return Dist > other.Dist;
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+ParticleSystem::ParticleSystem( void )
+{
+	DrawCalls = 0;
+}
+
+
+ParticleSystem::~ParticleSystem()
+{
+	for( std::vector<ParticleEmitter*>::iterator emitter_iter = Emitters.begin(); emitter_iter != Emitters.end(); emitter_iter ++ )
+		delete *emitter_iter;
+	Emitters.clear();
+}
+
+
+ParticleEmitter *ParticleSystem::GetEmitter( const Animation *anim )
+{
+	for( std::vector<ParticleEmitter*>::iterator emitter_iter = Emitters.begin(); emitter_iter != Emitters.end(); emitter_iter ++ )
+	{
+		if( (*emitter_iter)->Matches( anim ) )
+			return *emitter_iter;
+	}
+	
+	ParticleEmitter *emitter = new ParticleEmitter( anim );
+	Emitters.push_back( emitter );
+	return emitter;
+}
+
+
+void ParticleSystem::Add( const Effect &effect )
+{
+	GetEmitter( &(effect.Anim) )->Add( &effect );
+}
+
+
+void ParticleSystem::Add( const Animation *anim, double size, Mix_Chunk *sound, double loudness, const Pos3D *pos, const Vec3D *motion_vec, double rotation_speed, double speed_scale, double seconds_to_live )
+{
+	Add( anim, size, size, sound, loudness, pos, motion_vec, rotation_speed, speed_scale, seconds_to_live );
+}
+
+
+void ParticleSystem::Add( const Animation *anim, double length, double width, Mix_Chunk *sound, double loudness, const Pos3D *pos, const Vec3D *motion_vec, double rotation_speed, double speed_scale, double seconds_to_live )
+{
+	// Same parameters as the Effect constructors, without building a temporary Effect and copying its Animation.
+	static const Animation no_animation;
+	SoundOutHandle audio_voice;
+#ifndef NO_CLIENT
+	if( sound )
+		audio_voice = Raptor::Game->Snd.PlayVoiceAt( sound, pos->X, pos->Y, pos->Z, loudness );
+#endif
+	GetEmitter( anim ? anim : &no_animation )->Add( pos, motion_vec, rotation_speed, length, width, speed_scale, seconds_to_live, audio_voice );
+}
+
+
+void ParticleSystem::Clear( void )
+{
+	for( std::vector<ParticleEmitter*>::iterator emitter_iter = Emitters.begin(); emitter_iter != Emitters.end(); emitter_iter ++ )
+		delete *emitter_iter;
+	Emitters.clear();
+	Batches.clear();
+}
+
+
+size_t ParticleSystem::Count( void ) const
+{
+	size_t count = 0;
+	for( std::vector<ParticleEmitter*>::const_iterator emitter_iter = Emitters.begin(); emitter_iter != Emitters.end(); emitter_iter ++ )
+		count += (*emitter_iter)->Count();
+	return count;
+}
+
+
+void ParticleSystem::Update( double dt )
+{
+	double now = Clock::FrameNow() / (double) CLOCK_NS_PER_SEC;
+	
+	for( size_t index = 0; index < Emitters.size(); index ++ )
+	{
+		ParticleEmitter *emitter = Emitters[ index ];
+		size_t count = emitter->Count();
+		if( ! count )
+		{
+			// Empty emitters keep their capacity for a while in case the same animation comes back.
+			if( ! emitter->IdleSince )
+				emitter->IdleSince = now;
+			else if( now - emitter->IdleSince > PARTICLE_EMITTER_IDLE_SECS )
+			{
+				delete emitter;
+				Emitters[ index ] = Emitters.back();
+				Emitters.pop_back();
+				index --;
+			}
+			continue;
+		}
+		emitter->IdleSince = 0.;
+		
+		double *x = &(emitter->X[ 0 ]), *y = &(emitter->Y[ 0 ]), *z = &(emitter->Z[ 0 ]);
+		const double *dx = &(emitter->MotionX[ 0 ]), *dy = &(emitter->MotionY[ 0 ]), *dz = &(emitter->MotionZ[ 0 ]);
+		double *rotation = &(emitter->Rotation[ 0 ]);
+		const double *rotation_speed = &(emitter->RotationSpeed[ 0 ]);
+		
+		for( size_t i = 0; i < count; i ++ )
+		{
+			x[ i ] += dx[ i ] * dt;
+			y[ i ] += dy[ i ] * dt;
+			z[ i ] += dz[ i ] * dt;
+			rotation[ i ] += rotation_speed[ i ] * dt;
+		}
+		
+#ifndef NO_CLIENT
+		for( size_t i = 0; i < count; i ++ )
+		{
+			if( emitter->AudioVoice[ i ].Valid() && ! Raptor::Game->Snd.SetVoicePos( emitter->AudioVoice[ i ], x[ i ], y[ i ], z[ i ] ) )
+				emitter->AudioVoice[ i ] = SoundOutHandle();
+		}
+#endif
+		
+		// Walk backwards so swap-removal never skips a particle.
+		for( size_t i = count; i > 0; i -- )
+		{
+			if( emitter->Finished( i - 1, now ) )
+				emitter->Remove( i - 1 );
+		}
+	}
+}
+
+
+#ifndef NO_CLIENT
+void ParticleSystem::Prepare( void )
+{
+	DrawCalls = 0;
+	Batches.clear();
+	
+	double now = Clock::FrameNow() / (double) CLOCK_NS_PER_SEC;
+	const Camera *cam = &(Raptor::Game->Cam);
+	Pos3D center;
+	
+	// Gather visible particles and sort them back to front.
+	Sorted.clear();
+	for( std::vector<ParticleEmitter*>::iterator emitter_iter = Emitters.begin(); emitter_iter != Emitters.end(); emitter_iter ++ )
+	{
+		ParticleEmitter *emitter = *emitter_iter;
+		size_t count = emitter->Count();
+		if( ! count )
+			continue;
+		
+		// Reload frames after a GL context reset.
+		emitter->Anim.CurrentFrame();
+		
+		// Animations with zero frame time play one frame per draw; both VR eyes see the same frame.
+		if( (! Raptor::Game->Gfx.DrawTo) || (Raptor::Game->Gfx.DrawTo != Raptor::Game->Head.EyeR) )
+			emitter->FastFrame ++;
+		
+		for( size_t i = 0; i < count; i ++ )
+		{
+			// Allow using Lifetime.CountUpToSecs to queue a future effect.
+			if( now - emitter->Born[ i ] < emitter->Delay[ i ] )
+				continue;
+			
+			center.X = emitter->X[ i ];
+			center.Y = emitter->Y[ i ];
+			center.Z = emitter->Z[ i ];
+			if( ! Raptor::Game->Gfx.SphereInFrustum( &center, std::max<double>( emitter->Size[ i ], emitter->Width[ i ] ) * 0.71 ) )
+				continue;
+			
+			ParticleSort item;
+			item.Dist = cam->Dist( &center );
+			item.Emitter = emitter;
+			item.Index = i;
+			Sorted.push_back( item );
+		}
+	}
+	
+	if( Sorted.empty() )
+		return;
+	
+	std::sort( Sorted.begin(), Sorted.end() );
+	
+	// Camera-facing corners: rotating a vector in the view plane around Fwd by r gives v*cos(r) + (Fwd x v)*sin(r).
+	Vec3D fwd_up = cam->Fwd.Cross( cam->Up );
+	Vec3D fwd_right = cam->Fwd.Cross( cam->Right );
+	
+	// Fill one array in back-to-front order, starting a new batch whenever the texture changes.
+	Vertices.resize( Sorted.size() * 4 * PARTICLE_VERTEX_FLOATS );
+	Positions.resize( Sorted.size() * 4 * 3 );
+	GLfloat *vertex = &(Vertices[ 0 ]);
+	GLdouble *position = &(Positions[ 0 ]);
+	
+	for( std::vector<ParticleSort>::const_iterator sort_iter = Sorted.begin(); sort_iter != Sorted.end(); sort_iter ++ )
+	{
+		const ParticleEmitter *emitter = sort_iter->Emitter;
+		size_t i = sort_iter->Index;
+		size_t frame = emitter->FrameIndex( i, now );
+		GLuint texture = (frame < emitter->Anim.Frames.size()) ? emitter->Anim.Frames[ frame ] : 0;
+		
+		if( Batches.empty() || (Batches.back().Texture != texture) )
+		{
+			ParticleBatch batch;
+			batch.Dist = sort_iter->Dist;
+			batch.First = sort_iter - Sorted.begin();
+			batch.Count = 0;
+			batch.Texture = texture;
+			Batches.push_back( batch );
+		}
+		Batches.back().Count ++;
+		
+		double radians = Num::DegToRad( emitter->Rotation[ i ] );
+		double c = cos( radians ), s = sin( radians );
+		double half_size = emitter->Size[ i ] / 2., half_width = emitter->Width[ i ] / 2.;
+		
+		// a is the rotated half-height (up) vector, b the rotated half-width (right) vector.
+		double ax = (cam->Up.X * c + fwd_up.X * s) * half_size, ay = (cam->Up.Y * c + fwd_up.Y * s) * half_size, az = (cam->Up.Z * c + fwd_up.Z * s) * half_size;
+		double bx = (cam->Right.X * c + fwd_right.X * s) * half_width, by = (cam->Right.Y * c + fwd_right.Y * s) * half_width, bz = (cam->Right.Z * c + fwd_right.Z * s) * half_width;
+		
+		// Top-left, bottom-left, bottom-right, top-right; same winding as Effect::DrawQuad.
+		const double corner_a[ 4 ] = { 1., -1., -1., 1. };
+		const double corner_b[ 4 ] = { -1., -1., 1., 1. };
+		const GLfloat tex_u[ 4 ] = { 0.f, 0.f, 1.f, 1.f };
+		const GLfloat tex_v[ 4 ] = { 0.f, 1.f, 1.f, 0.f };
+		
+		for( int corner = 0; corner < 4; corner ++ )
+		{
+			vertex[ 0 ] = tex_u[ corner ];
+			vertex[ 1 ] = tex_v[ corner ];
+			vertex[ 2 ] = emitter->Red[ i ];
+			vertex[ 3 ] = emitter->Green[ i ];
+			vertex[ 4 ] = emitter->Blue[ i ];
+			vertex[ 5 ] = emitter->Alpha[ i ];
+			vertex += PARTICLE_VERTEX_FLOATS;
+			position[ 0 ] = emitter->X[ i ] + ax * corner_a[ corner ] + bx * corner_b[ corner ];
+			position[ 1 ] = emitter->Y[ i ] + ay * corner_a[ corner ] + by * corner_b[ corner ];
+			position[ 2 ] = emitter->Z[ i ] + az * corner_a[ corner ] + bz * corner_b[ corner ];
+			position += 3;
+		}
+	}
+}
+
+
+void ParticleSystem::DrawBatches( size_t first, size_t count )
+{
+	if( first + count > Batches.size() )
+		count = (first < Batches.size()) ? (Batches.size() - first) : 0;
+	if( ! count )
+		return;
+	
+	glEnable( GL_TEXTURE_2D );
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	glEnableClientState( GL_COLOR_ARRAY );
+	
+	const GLfloat *vertices = &(Vertices[ 0 ]);
+	glTexCoordPointer( 2, GL_FLOAT, PARTICLE_VERTEX_STRIDE, vertices );
+	glColorPointer( 4, GL_FLOAT, PARTICLE_VERTEX_STRIDE, vertices + 2 );
+	glVertexPointer( 3, GL_DOUBLE, 0, &(Positions[ 0 ]) );
+	
+	// Each batch is a run of quads that share a texture, so blending stays back-to-front.
+	for( size_t i = first; i < first + count; i ++ )
+	{
+		const ParticleBatch *batch = &(Batches[ i ]);
+		glBindTexture( GL_TEXTURE_2D, batch->Texture );
+		glDrawArrays( GL_QUADS, batch->First * 4, batch->Count * 4 );
+		DrawCalls ++;
+	}
+	
+	glDisableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+	glDisable( GL_TEXTURE_2D );
+	glColor4f( 1.f, 1.f, 1.f, 1.f );
+}
+
+
+void ParticleSystem::Draw( void )
+{
+	Prepare();
+	DrawBatches( 0, Batches.size() );
+}
+#endif
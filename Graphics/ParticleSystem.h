@@ -0,0 +1,106 @@
+/*
+ *  ParticleSystem.h
+ */
+
+#pragma once
+class ParticleSystem;
+class ParticleEmitter;
+class ParticleSort;
+class ParticleBatch;
+class Effect;
+struct Mix_Chunk;
+
+#include "PlatformSpecific.h"
+
+#include <vector>
+#include "RaptorGL.h"
+#include "Animation.h"
+#include "Pos.h"
+#include "SoundOutHandle.h"
+
+
+// All live particles that share one animation, stored as parallel arrays so updates are tight loops.
+// Finished particles are swapped with the last one, so the arrays stay dense and keep their capacity.
+class ParticleEmitter
+{
+public:
+	Animation Anim;
+	std::vector<double> FrameEnds;
+	size_t FastFrame;
+	double IdleSince;
+	
+	std::vector<double> X, Y, Z;
+	std::vector<double> MotionX, MotionY, MotionZ;
+	std::vector<double> Rotation, RotationSpeed;
+	std::vector<double> Size, Width;
+	std::vector<float> Red, Green, Blue, Alpha;
+	std::vector<double> Born, Delay, SecondsToLive, Speed;
+	std::vector<SoundOutHandle> AudioVoice;
+	
+	ParticleEmitter( const Animation *anim );
+	virtual ~ParticleEmitter();
+	
+	bool Matches( const Animation *anim ) const;
+	size_t Count( void ) const;
+	void Add( const Pos3D *pos, const Vec3D *motion_vec, double rotation_speed, double length, double width, double speed_scale, double seconds_to_live, SoundOutHandle audio_voice );
+	void Add( const Effect *effect );
+	void Remove( size_t index );
+	void Clear( void );
+	
+	bool Finished( size_t index, double now ) const;
+	size_t FrameIndex( size_t index, double now ) const;
+};
+
+
+class ParticleSort
+{
+public:
+	double Dist;
+	ParticleEmitter *Emitter;
+	size_t Index;
+	
+	bool operator < ( const ParticleSort &other ) const;
+};
+
+
+// A run of neighboring back-to-front quads that share a texture; Dist is its farthest particle.
+class ParticleBatch
+{
+public:
+	double Dist;
+	size_t First, Count;
+	GLuint Texture;
+};
+
+
+// Pooled alternative to a list of Effect objects: particles are grouped into one emitter per animation,
+// and neighboring billboards (after sorting back-to-front) that share a texture are drawn with one glDrawArrays call.
+// Prepare builds the batches for the current camera, so a RenderQueue can interleave them with other translucent items.
+class ParticleSystem
+{
+public:
+	std::vector<ParticleEmitter*> Emitters;
+	std::vector<ParticleBatch> Batches;
+	unsigned int DrawCalls;
+	
+	ParticleSystem( void );
+	virtual ~ParticleSystem();
+	
+	void Add( const Effect &effect );
+	void Add( const Animation *anim, double size, Mix_Chunk *sound, double loudness, const Pos3D *pos, const Vec3D *motion_vec = NULL, double rotation_speed = 0, double speed_scale = 1., double seconds_to_live = -1. );
+	void Add( const Animation *anim, double length, double width, Mix_Chunk *sound, double loudness, const Pos3D *pos, const Vec3D *motion_vec = NULL, double rotation_speed = 0, double speed_scale = 1., double seconds_to_live = -1. );
+	void Clear( void );
+	size_t Count( void ) const;
+	
+	void Update( double dt );
+	void Prepare( void );
+	void DrawBatches( size_t first, size_t count );
+	void Draw( void );
+
+private:
+	std::vector<ParticleSort> Sorted;
+	std::vector<GLfloat> Vertices;
+	std::vector<GLdouble> Positions;
+	
+	ParticleEmitter *GetEmitter( const Animation *anim );
+};
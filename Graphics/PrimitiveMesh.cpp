@@ -0,0 +1,161 @@
+/*
+ *  PrimitiveMesh.cpp
+ */
+
+#include "PrimitiveMesh.h"
+
+#include <cstddef>
+#include <cmath>
+#include "Graphics.h"
+
+
+PrimitiveMesh::PrimitiveMesh( void )
+{
+	VertexCount = 0;
+}
+
+
+PrimitiveMesh::~PrimitiveMesh()
+{
+}
+
+
+void PrimitiveMesh::AddVertex( double x, double y, double z, double nx, double ny, double nz, double tx, double ty )
+{
+	Data.push_back( x );
+	Data.push_back( y );
+	Data.push_back( z );
+	Data.push_back( nx );
+	Data.push_back( ny );
+	Data.push_back( nz );
+	Data.push_back( tx );
+	Data.push_back( ty );
+	VertexCount ++;
+}
+
+
+void PrimitiveMesh::MakeSphere( int res, uint32_t texture_mode )
+{
+	// Same quads, texture coordinates, and smooth normals Graphics::DrawSphere3D used to emit, with radius 1.
+	Data.clear();
+	VertexCount = 0;
+	
+	int res_vertical = res;
+	int res_around = res * 2;
+	double step_vertical = 1. / (double) res_vertical;
+	double step_around = 1. / (double) res_around;
+	
+	Data.reserve( res_vertical * res_around * 4 * PRIMITIVEMESH_FLOATS );
+	
+	for( int i = 0; i < res_vertical; i ++ )
+	{
+		double percent_vertical = ((double) i) / (double) res_vertical;
+		double z1 = cos( percent_vertical * M_PI );
+		double r1 = sin( percent_vertical * M_PI );
+		double z2 = cos( (percent_vertical + step_vertical) * M_PI );
+		double r2 = sin( (percent_vertical + step_vertical) * M_PI );
+		
+		for( int j = 0; j < res_around; j ++ )
+		{
+			double percent_around = ((double) j) / (double) res_around;
+			double x1 = cos( percent_around * 2. * M_PI );
+			double y1 = sin( percent_around * 2. * M_PI );
+			double x2 = cos( (percent_around + step_around) * 2. * M_PI );
+			double y2 = sin( (percent_around + step_around) * 2. * M_PI );
+			
+			// Texture coordinates.
+			double tc[ 4 ][ 2 ];
+			tc[ 0 ][ 0 ] = percent_around;
+			tc[ 0 ][ 1 ] = percent_vertical;
+			tc[ 1 ][ 0 ] = percent_around;
+			tc[ 1 ][ 1 ] = percent_vertical + step_vertical;
+			tc[ 2 ][ 0 ] = percent_around + step_around;
+			tc[ 2 ][ 1 ] = percent_vertical + step_vertical;
+			tc[ 3 ][ 0 ] = percent_around + step_around;
+			tc[ 3 ][ 1 ] = percent_vertical;
+			
+			// Experimental texture coordinate distortions.
+			if( texture_mode & Graphics::TEXTURE_MODE_Y_ASIN )
+			{
+				// Scale traversal of Y values to the radius of the current ring.
+				tc[ 0 ][ 1 ] = asin( percent_vertical * 2. - 1. ) / M_PI + 0.5;
+				tc[ 1 ][ 1 ] = asin( (percent_vertical + step_vertical) * 2. - 1. ) / M_PI + 0.5;
+				tc[ 2 ][ 1 ] = tc[ 1 ][ 1 ];
+				tc[ 3 ][ 1 ] = tc[ 0 ][ 1 ];
+			}
+			if( texture_mode & Graphics::TEXTURE_MODE_X_DIV_R )
+			{
+				// Remove corners of texture by reducing the X distance traversed at top and bottom.
+				tc[ 0 ][ 0 ] = percent_around * r1 + (1. - r1) / 2.;
+				tc[ 3 ][ 0 ] = tc[ 0 ][ 0 ] + r1 * step_around;
+				tc[ 1 ][ 0 ] = percent_around * r2 + (1. - r2) / 2.;
+				tc[ 2 ][ 0 ] = tc[ 1 ][ 0 ] + r2 * step_around;
+			}
+			
+			// On a unit sphere each vertex is its own normal.
+			AddVertex( r1*x1, r1*y1, z1, r1*x1, r1*y1, z1, tc[ 0 ][ 0 ], tc[ 0 ][ 1 ] );  // Top-left
+			AddVertex( r2*x1, r2*y1, z2, r2*x1, r2*y1, z2, tc[ 1 ][ 0 ], tc[ 1 ][ 1 ] );  // Bottom-left
+			AddVertex( r2*x2, r2*y2, z2, r2*x2, r2*y2, z2, tc[ 2 ][ 0 ], tc[ 2 ][ 1 ] );  // Bottom-right
+			AddVertex( r1*x2, r1*y2, z1, r1*x2, r1*y2, z1, tc[ 3 ][ 0 ], tc[ 3 ][ 1 ] );  // Top-right
+		}
+	}
+}
+
+
+void PrimitiveMesh::MakeCircle( int res )
+{
+	// Triangle fan: center, then res+1 points around the edge.  The edge alone is the outline's line strip.
+	Data.clear();
+	VertexCount = 0;
+	
+	Data.reserve( (res + 2) * PRIMITIVEMESH_FLOATS );
+	
+	AddVertex( 0., 0., 0., 0., 0., 1., 0.5, 0.5 );
+	
+	for( int i = 0; i <= res; i ++ )
+	{
+		double percent = ((double) i) / (double) res;
+		double unit_x = cos( percent * 2. * M_PI );
+		double unit_y = sin( percent * 2. * M_PI );
+		
+		AddVertex( unit_x, unit_y, 0., 0., 0., 1., (unit_x + 1.) / 2., (unit_y + 1.) / 2. );
+	}
+}
+
+
+void PrimitiveMesh::Draw( GLenum mode, GLint first, GLsizei count, bool tex_coords, bool normals, double x, double y, double z, double scale_x, double scale_y, double scale_z )
+{
+	if( (first < 0) || (count <= 0) || (first + count > VertexCount) )
+		return;
+	
+	// Normals and texture coordinates come straight from the unit mesh; only positions depend on placement.
+	WorldSpace.resize( VertexCount * 3 );
+	for( GLint i = first; i < first + count; i ++ )
+	{
+		const GLfloat *vertex = &(Data[ i * PRIMITIVEMESH_FLOATS ]);
+		WorldSpace[ i*3     ] = x + vertex[ 0 ] * scale_x;
+		WorldSpace[ i*3 + 1 ] = y + vertex[ 1 ] * scale_y;
+		WorldSpace[ i*3 + 2 ] = z + vertex[ 2 ] * scale_z;
+	}
+	
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 3, GL_DOUBLE, 0, &(WorldSpace[ 0 ]) );
+	if( tex_coords )
+	{
+		glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+		glTexCoordPointer( 2, GL_FLOAT, PRIMITIVEMESH_STRIDE, &(Data[ 6 ]) );
+	}
+	if( normals )
+	{
+		glEnableClientState( GL_NORMAL_ARRAY );
+		glNormalPointer( GL_FLOAT, PRIMITIVEMESH_STRIDE, &(Data[ 3 ]) );
+	}
+	
+	glDrawArrays( mode, first, count );
+	
+	if( normals )
+		glDisableClientState( GL_NORMAL_ARRAY );
+	if( tex_coords )
+		glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+}
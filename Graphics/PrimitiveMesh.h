@@ -0,0 +1,40 @@
+/*
+ *  PrimitiveMesh.h
+ */
+
+#pragma once
+class PrimitiveMesh;
+
+#include "PlatformSpecific.h"
+
+#include <stdint.h>
+#include <vector>
+#include "RaptorGL.h"
+
+
+// Per vertex: position 3, normal 3, texcoord 2 (same order as ModelArrays).
+#define PRIMITIVEMESH_FLOATS 8
+#define PRIMITIVEMESH_STRIDE (PRIMITIVEMESH_FLOATS * sizeof(GLfloat))
+
+
+// Unit-size sphere or circle built once per resolution, so drawing needs no trig.
+// Each draw places the vertices in world space, so shaders see the same gl_Vertex as glVertex3d calls would give them.
+class PrimitiveMesh
+{
+public:
+	std::vector<GLfloat> Data;
+	GLsizei VertexCount;
+	
+	PrimitiveMesh( void );
+	virtual ~PrimitiveMesh();
+	
+	void MakeSphere( int res, uint32_t texture_mode );
+	void MakeCircle( int res );
+	
+	void Draw( GLenum mode, GLint first, GLsizei count, bool tex_coords, bool normals, double x, double y, double z, double scale_x, double scale_y, double scale_z );
+
+private:
+	std::vector<GLdouble> WorldSpace;
+	
+	void AddVertex( double x, double y, double z, double nx, double ny, double nz, double tx, double ty );
+};
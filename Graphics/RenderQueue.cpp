@@ -0,0 +1,307 @@
+/*
+ *  RenderQueue.cpp
+ */
+
+#include "RenderQueue.h"
+
+#include <cstddef>
+#include <algorithm>
+#include "RaptorGame.h"
+#include "GameObject.h"
+#include "Effect.h"
+#include "ParticleSystem.h"
+
+
+// Sort key layout (opaque):      0 | shader slot:15 | texture:24 | depth:24
+// Sort key layout (translucent): 1 | far-to-near depth:24 | shader slot:15 | texture:24
+#define RENDERQUEUE_TRANSLUCENT   (1ULL << 63)
+#define RENDERQUEUE_DEPTH_MAX     0xFFFFFFULL
+#define RENDERQUEUE_TEXTURE_MASK  0xFFFFFFULL
+#define RENDERQUEUE_SLOT_MAX      0x7FFF
+
+
+RenderQueue::RenderQueue( void )
+{
+	Draws = 0;
+	ShaderChanges = 0;
+	TextureChanges = 0;
+	DepthMaskChanges = 0;
+	CurrentShader = NULL;
+	BoundTexture = 0;
+	TextureKnown = false;
+}
+
+
+RenderQueue::~RenderQueue()
+{
+}
+
+
+void RenderQueue::AddObject( GameObject *obj )
+{
+	if( obj )
+		Add( obj, NULL, obj->WantShader(), obj->WantTexture(), obj->IsTranslucent() );
+}
+
+
+void RenderQueue::AddObjects( std::map<uint32_t,GameObject*> *objects )
+{
+	for( std::map<uint32_t,GameObject*>::iterator obj_iter = objects->begin(); obj_iter != objects->end(); obj_iter ++ )
+		AddObject( obj_iter->second );
+}
+
+
+void RenderQueue::AddEffect( Effect *effect, Shader *shader )
+{
+	// Allow using Lifetime.CountUpToSecs to queue a future effect.
+	if( effect && (effect->Lifetime.FrameProgress() >= 1.) )
+		Add( NULL, effect, shader, effect->Anim.CurrentFrame(), true );
+}
+
+
+void RenderQueue::AddEffects( std::list<Effect> *effects, Shader *shader )
+{
+	for( std::list<Effect>::iterator effect_iter = effects->begin(); effect_iter != effects->end(); effect_iter ++ )
+		AddEffect( &*effect_iter, shader );
+}
+
+
+void RenderQueue::AddEffects( ParticleSystem *particles, Shader *shader )
+{
+	// Each back-to-front batch of same-texture particles is keyed by its farthest particle,
+	// so particles interleave with other translucent items instead of all drawing last.
+	if( ! (particles && particles->Count()) )
+		return;
+	
+	particles->Prepare();
+	uint64_t slot = ShaderSlot( shader );
+	
+	for( size_t i = 0; i < particles->Batches.size(); i ++ )
+	{
+		const ParticleBatch *batch = &(particles->Batches[ i ]);
+		uint64_t depth = Depth( batch->Dist );
+		
+		RenderQueueItem item;
+		item.Object = NULL;
+		item.Fx = NULL;
+		item.Particles = particles;
+		item.Batch = i;
+		item.ShaderPtr = shader;
+		item.Texture = batch->Texture;
+		item.Key = RENDERQUEUE_TRANSLUCENT | ((RENDERQUEUE_DEPTH_MAX - depth) << 39) | (slot << 24) | (batch->Texture & RENDERQUEUE_TEXTURE_MASK);
+		
+		Items.push_back( item );
+	}
+}
+
+
+void RenderQueue::Add( GameObject *obj, Effect *effect, Shader *shader, GLuint texture, bool translucent )
+{
+	const Pos3D *pos = obj ? (const Pos3D*) obj : (const Pos3D*) effect;
+	uint64_t depth = Depth( Raptor::Game->Cam.Dist( pos ) );
+	uint64_t slot = ShaderSlot( shader );
+	uint64_t tex = texture & RENDERQUEUE_TEXTURE_MASK;
+	
+	RenderQueueItem item;
+	item.Object = obj;
+	item.Fx = effect;
+	item.Particles = NULL;
+	item.Batch = 0;
+	item.ShaderPtr = shader;
+	item.Texture = texture;
+	
+	if( translucent )
+		item.Key = RENDERQUEUE_TRANSLUCENT | ((RENDERQUEUE_DEPTH_MAX - depth) << 39) | (slot << 24) | tex;
+	else
+		item.Key = (slot << 48) | (tex << 24) | depth;
+	
+	Items.push_back( item );
+}
+
+
+uint64_t RenderQueue::Depth( double dist ) const
+{
+	if( dist >= Raptor::Game->Gfx.ZFar )
+		return RENDERQUEUE_DEPTH_MAX;
+	return (dist > 0.) ? (uint64_t)( dist / Raptor::Game->Gfx.ZFar * RENDERQUEUE_DEPTH_MAX ) : 0;
+}
+
+
+uint16_t RenderQueue::ShaderSlot( Shader *shader )
+{
+	// Slot 0 is fixed-function; others are numbered in order of first use this frame.
+	if( ! shader )
+		return 0;
+	
+	std::map<Shader*,uint16_t>::iterator slot_iter = ShaderSlots.find( shader );
+	if( slot_iter != ShaderSlots.end() )
+		return slot_iter->second;
+	
+	uint16_t slot = std::min<size_t>( ShaderSlots.size() + 1, RENDERQUEUE_SLOT_MAX );
+	ShaderSlots[ shader ] = slot;
+	return slot;
+}
+
+
+void RenderQueue::SelectShader( Shader *shader )
+{
+	if( shader == CurrentShader )
+		return;
+	
+	if( shader )
+	{
+		Raptor::Game->ShaderMgr.Selected = shader;
+		Raptor::Game->ShaderMgr.ResumeShaders();
+	}
+	else
+		Raptor::Game->ShaderMgr.StopShaders();
+	
+	CurrentShader = shader;
+	ShaderChanges ++;
+}
+
+
+void RenderQueue::BindTexture( GLuint texture )
+{
+	if( TextureKnown && (texture == BoundTexture) )
+		return;
+	
+	glBindTexture( GL_TEXTURE_2D, texture );
+	BoundTexture = texture;
+	TextureKnown = true;
+	TextureChanges ++;
+}
+
+
+void RenderQueue::Draw( void )
+{
+	Draws = 0;
+	ShaderChanges = 0;
+	TextureChanges = 0;
+	DepthMaskChanges = 0;
+	
+	std::sort( Items.begin(), Items.end() );
+	
+	Shader *prev_shader = Raptor::Game->ShaderMgr.Selected;
+	bool prev_active = Raptor::Game->ShaderMgr.Active();
+	CurrentShader = prev_active ? prev_shader : NULL;
+	TextureKnown = false;
+	
+	bool translucent = false;
+	size_t count = Items.size();
+	size_t index = 0;
+	
+	while( index <= count )
+	{
+		if( (! translucent) && ((index == count) || Items[ index ].Translucent()) )
+		{
+			// Opaque objects may have queued model instances, which must land before anything blended.
+			Raptor::Game->Instances.Draw();
+			Draws += Raptor::Game->Instances.DrawCalls;
+			ShaderChanges += Raptor::Game->Instances.ShaderChanges;
+			CurrentShader = Raptor::Game->ShaderMgr.Active() ? Raptor::Game->ShaderMgr.Selected : NULL;
+			TextureKnown = false;
+			
+			translucent = true;
+			if( index < count )
+			{
+				glDepthMask( GL_FALSE );
+				DepthMaskChanges ++;
+			}
+		}
+		
+		if( index == count )
+			break;
+		
+		RenderQueueItem *item = &(Items[ index ]);
+		SelectShader( item->ShaderPtr );
+		
+		if( item->Fx )
+		{
+			// Consecutive effects with the same texture and shader share one glBegin/glEnd.
+			glEnable( GL_TEXTURE_2D );
+			BindTexture( item->Texture );
+			
+			glBegin( GL_QUADS );
+			
+			while( (index < count) && Items[ index ].Fx && (Items[ index ].Texture == item->Texture) && (Items[ index ].ShaderPtr == item->ShaderPtr) )
+			{
+				Items[ index ].Fx->DrawQuad();
+				index ++;
+			}
+			
+			glEnd();
+			
+			glDisable( GL_TEXTURE_2D );
+			glColor4f( 1.f, 1.f, 1.f, 1.f );
+			Draws ++;
+			continue;
+		}
+		
+		if( item->Particles )
+		{
+			// Batches of one system that stayed adjacent after sorting share the array setup.
+			size_t batches = 1;
+			while( (index + batches < count) && (Items[ index + batches ].Particles == item->Particles) && (Items[ index + batches ].Batch == item->Batch + batches) && (Items[ index + batches ].ShaderPtr == item->ShaderPtr) )
+				batches ++;
+			
+			unsigned int draw_calls = item->Particles->DrawCalls;
+			item->Particles->DrawBatches( item->Batch, batches );
+			Draws += item->Particles->DrawCalls - draw_calls;
+			TextureKnown = false;
+			index += batches;
+			continue;
+		}
+		
+		if( item->Texture )
+			BindTexture( item->Texture );
+		
+		item->Object->Draw();
+		Draws ++;
+		
+		// Objects that asked for a texture leave it bound; anything else may have changed it.
+		if( ! item->Texture )
+			TextureKnown = false;
+		
+		index ++;
+	}
+	
+	if( DepthMaskChanges )
+	{
+		glDepthMask( GL_TRUE );
+		DepthMaskChanges ++;
+	}
+	
+	if( (CurrentShader != (prev_active ? prev_shader : NULL)) || (Raptor::Game->ShaderMgr.Selected != prev_shader) )
+	{
+		Raptor::Game->ShaderMgr.Selected = prev_shader;
+		if( prev_active )
+			Raptor::Game->ShaderMgr.ResumeShaders();
+		else
+			Raptor::Game->ShaderMgr.StopShaders();
+	}
+	
+	Clear();
+}
+
+
+void RenderQueue::Clear( void )
+{
+	Items.clear();
+	ShaderSlots.clear();
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+bool RenderQueueItem::Translucent( void ) const
+{
+	return Key & RENDERQUEUE_TRANSLUCENT;
+}
+
+
+bool RenderQueueItem::operator < ( const RenderQueueItem &other ) const
+{
+	return Key < other.Key;
+}
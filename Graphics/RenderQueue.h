@@ -0,0 +1,69 @@
+/*
+ *  RenderQueue.h
+ */
+
+#pragma once
+class RenderQueue;
+class RenderQueueItem;
+class GameObject;
+class Effect;
+class ParticleSystem;
+
+#include "PlatformSpecific.h"
+
+#include <stdint.h>
+#include <vector>
+#include <map>
+#include <list>
+#include "RaptorGL.h"
+#include "Shader.h"
+
+
+class RenderQueueItem
+{
+public:
+	uint64_t Key;
+	GameObject *Object;
+	Effect *Fx;
+	ParticleSystem *Particles;
+	size_t Batch;
+	Shader *ShaderPtr;
+	GLuint Texture;
+	
+	bool Translucent( void ) const;
+	bool operator < ( const RenderQueueItem &other ) const;
+};
+
+
+// Collects a frame's object and effect draws, then executes them sorted to reduce state changes:
+// opaque items by shader, texture, then front-to-back; translucent items and effects back-to-front.
+class RenderQueue
+{
+public:
+	std::vector<RenderQueueItem> Items;
+	std::map<Shader*,uint16_t> ShaderSlots;
+	
+	unsigned int Draws, ShaderChanges, TextureChanges, DepthMaskChanges;
+	
+	RenderQueue( void );
+	virtual ~RenderQueue();
+	
+	void AddObject( GameObject *obj );
+	void AddObjects( std::map<uint32_t,GameObject*> *objects );
+	void AddEffect( Effect *effect, Shader *shader = NULL );
+	void AddEffects( std::list<Effect> *effects, Shader *shader = NULL );
+	void AddEffects( ParticleSystem *particles, Shader *shader = NULL );
+	void Draw( void );
+	void Clear( void );
+
+private:
+	Shader *CurrentShader;
+	GLuint BoundTexture;
+	bool TextureKnown;
+	
+	void Add( GameObject *obj, Effect *effect, Shader *shader, GLuint texture, bool translucent );
+	uint64_t Depth( double dist ) const;
+	uint16_t ShaderSlot( Shader *shader );
+	void SelectShader( Shader *shader );
+	void BindTexture( GLuint texture );
+};
@@ -5,6 +5,8 @@
 #include "Shader.h"
 
 #include <cstddef>
+#include <cstring>
+#include <deque>
 #include "File.h"
 #include "RaptorGame.h"
 
@@ -12,6 +14,25 @@
 // http://people.freedesktop.org/~idr/OpenGL_tutorials/02-GLSL-hello-world.html
 
 
+// Must match the order of the Shader::VAR_* enum.
+static const char *ShaderBuiltinVarNames[ Shader::VAR_BUILTIN_COUNT ] =
+{
+	"Pos", "XVec", "YVec", "ZVec",
+	"AmbientColor", "DiffuseColor", "SpecularColor", "Alpha", "Shininess",
+	"BumpScale", "GlowScale", "Texture", "BumpMap", "GlowMap",
+	"BumpTangent", "BumpBitangent",
+	"InstancePos", "InstanceXVec", "InstanceYVec", "InstanceZVec"
+};
+
+struct ShaderVarNameLess
+{
+	bool operator()( const char *a, const char *b ) const { return strcmp( a, b ) < 0; }
+};
+
+static std::deque<std::string> ShaderVarNames;
+static std::map<const char*,ShaderVarID,ShaderVarNameLess> ShaderVarIDs;
+
+
 Shader::Shader( std::string name, std::string filename, std::map<std::string,std::string> defs )
 {
 	ProgramHandle = 0;
@@ -38,6 +59,7 @@ void Shader::Clear( void )
 	Components.clear();
 	
 	Vars.clear();
+	VarsByID.clear();
 }
 
 
@@ -113,176 +135,131 @@ bool Shader::Active( void ) const
 }
 
 
-bool Shader::Set1f( const char *name, double value )
+bool Shader::Set1f( VarID id, double value )
 {
-	bool valid = false;
+	ShaderVar *var = Uniform( id );
+	if( ! var )
+		return false;
 	
-	if( ProgramHandle )
+	// Only tell the shader to change its value if the number is different.
+	if( value != var->Float1 )
 	{
-		ShaderVar *var = &(Vars[ std::string(name) ]);
-		
-		// Avoid repeated failed lookups.
-		if( var->Type == ShaderVar::TYPE_ERROR )
-			return false;
-		
-		// See if we already know the variable's loc.  If not, look it up in the shader.
-		if( var->Loc < 0 )
-			var->Loc = glGetUniformLocation( ProgramHandle, name );
-		
-		// Only operate on a valid shader variable.
-		if( var->Loc >= 0 )
-		{
-			// Only tell the shader to change its value if the number is different.
-			if( value != var->Float1 )
-			{
-				glUniform1f( var->Loc, value );
-				var->Float1 = value;
-				var->Type = ShaderVar::TYPE_1F;
-			}
-			valid = true;
-		}
-		else
-			var->Type = ShaderVar::TYPE_ERROR;
+		glUniform1f( var->Loc, value );
+		var->Float1 = value;
+		var->Type = ShaderVar::TYPE_1F;
 	}
 	
-	return valid;
+	return true;
 }
 
 
-bool Shader::Set3f( const char *name, double x, double y, double z )
+bool Shader::Set3f( VarID id, double x, double y, double z )
 {
-	bool valid = false;
+	ShaderVar *var = Uniform( id );
+	if( ! var )
+		return false;
 	
-	if( ProgramHandle )
+	// Only tell the shader to change its values if the numbers are different.
+	if( (x != var->Float1) || (y != var->Float2) || (z != var->Float3) )
 	{
-		ShaderVar *var = &(Vars[ std::string(name) ]);
-		
-		// Avoid repeated failed lookups.
-		if( var->Type == ShaderVar::TYPE_ERROR )
-			return false;
-		
-		// See if we already know the variable's loc.  If not, look it up in the shader.
-		if( var->Loc < 0 )
-			var->Loc = glGetUniformLocation( ProgramHandle, name );
-		
-		// Only operate on a valid shader variable.
-		if( var->Loc >= 0 )
-		{
-			// Only tell the shader to change its values if the numbers are different.
-			if( (x != var->Float1) || (y != var->Float2) || (z != var->Float3) )
-			{
-				glUniform3f( var->Loc, x, y, z );
-				var->Float1 = x;
-				var->Float2 = y;
-				var->Float3 = z;
-				var->Type = ShaderVar::TYPE_3F;
-			}
-			valid = true;
-		}
-		else
-			var->Type = ShaderVar::TYPE_ERROR;
+		glUniform3f( var->Loc, x, y, z );
+		var->Float1 = x;
+		var->Float2 = y;
+		var->Float3 = z;
+		var->Type = ShaderVar::TYPE_3F;
 	}
 	
-	return valid;
+	return true;
 }
 
 
-bool Shader::Set4f( const char *name, double x, double y, double z, double w )
+bool Shader::Set4f( VarID id, double x, double y, double z, double w )
 {
-	bool valid = false;
+	ShaderVar *var = Uniform( id );
+	if( ! var )
+		return false;
 	
-	if( ProgramHandle )
+	// Only tell the shader to change its values if the numbers are different.
+	if( (x != var->Float1) || (y != var->Float2) || (z != var->Float3) || (w != var->Float4) )
 	{
-		ShaderVar *var = &(Vars[ std::string(name) ]);
-		
-		// Avoid repeated failed lookups.
-		if( var->Type == ShaderVar::TYPE_ERROR )
-			return false;
-		
-		// See if we already know the variable's loc.  If not, look it up in the shader.
-		if( var->Loc < 0 )
-			var->Loc = glGetUniformLocation( ProgramHandle, name );
-		
-		// Only operate on a valid shader variable.
-		if( var->Loc >= 0 )
-		{
-			// Only tell the shader to change its values if the numbers are different.
-			if( (x != var->Float1) || (y != var->Float2) || (z != var->Float3) || (w != var->Float4) )
-			{
-				glUniform4f( var->Loc, x, y, z, w );
-				var->Float1 = x;
-				var->Float2 = y;
-				var->Float3 = z;
-				var->Float4 = w;
-				var->Type = ShaderVar::TYPE_4F;
-			}
-			valid = true;
-		}
-		else
-			var->Type = ShaderVar::TYPE_ERROR;
+		glUniform4f( var->Loc, x, y, z, w );
+		var->Float1 = x;
+		var->Float2 = y;
+		var->Float3 = z;
+		var->Float4 = w;
+		var->Type = ShaderVar::TYPE_4F;
 	}
 	
-	return valid;
+	return true;
 }
 
 
-bool Shader::Set1i( const char *name, int value )
+bool Shader::Set1i( VarID id, int value )
 {
-	bool valid = false;
+	ShaderVar *var = Uniform( id );
+	if( ! var )
+		return false;
 	
-	if( ProgramHandle )
+	// Only tell the shader to change its value if the number is different.
+	if( value != var->Int1 )
 	{
-		ShaderVar *var = &(Vars[ std::string(name) ]);
-		
-		// Avoid repeated failed lookups.
-		if( var->Type == ShaderVar::TYPE_ERROR )
-			return false;
-		
-		// See if we already know the variable's loc.  If not, look it up in the shader.
-		if( var->Loc < 0 )
-			var->Loc = glGetUniformLocation( ProgramHandle, name );
-		
-		// Only operate on a valid shader variable.
-		if( var->Loc >= 0 )
-		{
-			// Only tell the shader to change its value if the number is different.
-			if( value != var->Int1 )
-			{
-				glUniform1i( var->Loc, value );
-				var->Int1 = value;
-				var->Type = ShaderVar::TYPE_1I;
-			}
-			valid = true;
-		}
-		else
-			var->Type = ShaderVar::TYPE_ERROR;
+		glUniform1i( var->Loc, value );
+		var->Int1 = value;
+		var->Type = ShaderVar::TYPE_1I;
 	}
 	
-	return valid;
+	return true;
 }
 
 
-GLint Shader::AttribLoc( const char *name )
+GLint Shader::AttribLoc( VarID id )
 {
-	if( ProgramHandle )
+	ShaderVar *var = Var( id );
+	if( ! var )
+		return -1;
+	
+	// Avoid repeated failed lookups.
+	if( var->Type == ShaderVar::TYPE_ERROR )
+		return -1;
+	
+	// See if we already know the variable's loc.  If not, look it up in the shader.
+	if( var->Loc < 0 )
 	{
-		ShaderVar *var = &(Vars[ std::string(name) ]);
-		
-		// Avoid repeated failed lookups.
-		if( var->Type == ShaderVar::TYPE_ERROR )
-			return -1;
-		
-		// See if we already know the variable's loc.  If not, look it up in the shader.
-		if( var->Loc < 0 )
-		{
-			var->Loc = glGetAttribLocation( ProgramHandle, name );
-			var->Type = (var->Loc >= 0) ? ShaderVar::TYPE_ATTRIB : ShaderVar::TYPE_ERROR;
-		}
-		
-		return var->Loc;
+		var->Loc = glGetAttribLocation( ProgramHandle, VarName( id ) );
+		var->Type = (var->Loc >= 0) ? ShaderVar::TYPE_ATTRIB : ShaderVar::TYPE_ERROR;
 	}
 	
-	return -1;
+	return var->Loc;
+}
+
+
+bool Shader::Set1f( const char *name, double value )
+{
+	return Set1f( RegisterVar( name ), value );
+}
+
+
+bool Shader::Set3f( const char *name, double x, double y, double z )
+{
+	return Set3f( RegisterVar( name ), x, y, z );
+}
+
+
+bool Shader::Set4f( const char *name, double x, double y, double z, double w )
+{
+	return Set4f( RegisterVar( name ), x, y, z, w );
+}
+
+
+bool Shader::Set1i( const char *name, int value )
+{
+	return Set1i( RegisterVar( name ), value );
+}
+
+
+GLint Shader::AttribLoc( const char *name )
+{
+	return AttribLoc( RegisterVar( name ) );
 }
 
 
@@ -311,6 +288,82 @@ int Shader::CopyVarsFrom( const Shader *other )
 }
 
 
+Shader::VarID Shader::RegisterVar( const char *name )
+{
+	if( ShaderVarNames.empty() )
+		VarName( VAR_POS );
+	
+	std::map<const char*,ShaderVarID,ShaderVarNameLess>::const_iterator id_iter = ShaderVarIDs.find( name );
+	if( id_iter != ShaderVarIDs.end() )
+		return id_iter->second;
+	
+	// Deque elements never move, so the map can key on their c_str.
+	VarID id = (VarID) ShaderVarNames.size();
+	ShaderVarNames.push_back( std::string(name) );
+	ShaderVarIDs[ ShaderVarNames.back().c_str() ] = id;
+	return id;
+}
+
+
+const char *Shader::VarName( VarID id )
+{
+	if( ShaderVarNames.empty() )
+	{
+		for( int i = 0; i < VAR_BUILTIN_COUNT; i ++ )
+		{
+			ShaderVarNames.push_back( std::string(ShaderBuiltinVarNames[ i ]) );
+			ShaderVarIDs[ ShaderVarNames.back().c_str() ] = (VarID) i;
+		}
+	}
+	
+	return (id < ShaderVarNames.size()) ? ShaderVarNames[ id ].c_str() : "";
+}
+
+
+ShaderVar *Shader::Var( VarID id )
+{
+	if( ! ProgramHandle )
+		return NULL;
+	
+	// Each ID caches its entry in Vars; map nodes never move, so the pointer stays valid until Clear.
+	if( id >= VarsByID.size() )
+	{
+		if( id >= ShaderVarNames.size() )
+			return NULL;
+		VarsByID.resize( ShaderVarNames.size(), NULL );
+	}
+	if( ! VarsByID[ id ] )
+		VarsByID[ id ] = &(Vars[ ShaderVarNames[ id ] ]);
+	
+	return VarsByID[ id ];
+}
+
+
+ShaderVar *Shader::Uniform( VarID id )
+{
+	ShaderVar *var = Var( id );
+	if( ! var )
+		return NULL;
+	
+	// Avoid repeated failed lookups.
+	if( var->Type == ShaderVar::TYPE_ERROR )
+		return NULL;
+	
+	// See if we already know the variable's loc.  If not, look it up in the shader.
+	if( var->Loc < 0 )
+	{
+		var->Loc = glGetUniformLocation( ProgramHandle, VarName( id ) );
+		if( var->Loc < 0 )
+		{
+			var->Type = ShaderVar::TYPE_ERROR;
+			return NULL;
+		}
+	}
+	
+	return var;
+}
+
+
 // -----------------------------------------------------------------------------
 
 
@@ -17,9 +17,61 @@ typedef unsigned int ShaderComponentType;
 #include "RaptorGL.h"
 
 
+class ShaderVar
+{
+public:
+	GLint Loc;
+	uint8_t Type;
+	double Float1, Float2, Float3, Float4;
+	int Int1, Int2, Int3, Int4;
+	
+	ShaderVar( void );
+	virtual ~ShaderVar();
+	
+	enum
+	{
+		TYPE_UNKNOWN = 0,
+		TYPE_ERROR,
+		TYPE_1F,
+		TYPE_3F,
+		TYPE_4F,
+		TYPE_1I,
+		TYPE_ATTRIB
+	};
+};
+
+
 class Shader
 {
 public:
+	// Registered variable names; a distinct type, so a literal 0 still picks the name overloads.
+	// Variables the engine sets every draw have fixed IDs; others get theirs from RegisterVar.
+	enum VarID
+	{
+		VAR_POS = 0,
+		VAR_XVEC,
+		VAR_YVEC,
+		VAR_ZVEC,
+		VAR_AMBIENT_COLOR,
+		VAR_DIFFUSE_COLOR,
+		VAR_SPECULAR_COLOR,
+		VAR_ALPHA,
+		VAR_SHININESS,
+		VAR_BUMP_SCALE,
+		VAR_GLOW_SCALE,
+		VAR_TEXTURE,
+		VAR_BUMP_MAP,
+		VAR_GLOW_MAP,
+		VAR_BUMP_TANGENT,
+		VAR_BUMP_BITANGENT,
+		VAR_INSTANCE_POS,
+		VAR_INSTANCE_XVEC,
+		VAR_INSTANCE_YVEC,
+		VAR_INSTANCE_ZVEC,
+		VAR_BUILTIN_COUNT,
+		VAR_ID_MAX = 0xFFFF
+	};
+	
 	GLuint ProgramHandle;
 	std::string Name;
 	std::map<std::string,ShaderVar> Vars;
@@ -33,6 +85,12 @@ public:
 	bool Ready( void ) const;
 	bool Active( void ) const;
 	
+	bool Set1f( VarID id, double value );
+	bool Set3f( VarID id, double x, double y, double z );
+	bool Set4f( VarID id, double x, double y, double z, double w );
+	bool Set1i( VarID id, int value );
+	GLint AttribLoc( VarID id );
+	
 	bool Set1f( const char *name, double value );
 	bool Set3f( const char *name, double x, double y, double z );
 	bool Set4f( const char *name, double x, double y, double z, double w );
@@ -41,10 +99,20 @@ public:
 	
 	int CopyVarsFrom( const Shader *other );
 	
+	static VarID RegisterVar( const char *name );
+	static const char *VarName( VarID id );
+
 private:
 	std::vector<ShaderComponent*> Components;
+	
+	std::vector<ShaderVar*> VarsByID;
+	
+	ShaderVar *Var( VarID id );
+	ShaderVar *Uniform( VarID id );
 };
 
+typedef Shader::VarID ShaderVarID;
+
 
 class ShaderComponent
 {
@@ -57,31 +125,8 @@ public:
 	virtual ~ShaderComponent();
 	
 	bool Ready( void );
-	
+
 private:
 	bool Compiled;
 };
 
-
-class ShaderVar
-{
-public:
-	GLint Loc;
-	uint8_t Type;
-	double Float1, Float2, Float3, Float4;
-	int Int1, Int2, Int3, Int4;
-	
-	ShaderVar( void );
-	virtual ~ShaderVar();
-	
-	enum
-	{
-		TYPE_UNKNOWN = 0,
-		TYPE_ERROR,
-		TYPE_1F,
-		TYPE_3F,
-		TYPE_4F,
-		TYPE_1I,
-		TYPE_ATTRIB
-	};
-};
@@ -110,6 +110,51 @@ bool ShaderManager::Ready( void )
 }
 
 
+bool ShaderManager::Set1f( ShaderVarID id, double value )
+{
+	if( Selected )  // FIXME: Make sure shader is active?
+		return Selected->Set1f( id, value );
+	
+	return false;
+}
+
+
+bool ShaderManager::Set3f( ShaderVarID id, double x, double y, double z )
+{
+	if( Selected )  // FIXME: Make sure shader is active?
+		return Selected->Set3f( id, x, y, z );
+	
+	return false;
+}
+
+
+bool ShaderManager::Set4f( ShaderVarID id, double x, double y, double z, double w )
+{
+	if( Selected )  // FIXME: Make sure shader is active?
+		return Selected->Set4f( id, x, y, z, w );
+	
+	return false;
+}
+
+
+bool ShaderManager::Set1i( ShaderVarID id, int value )
+{
+	if( Selected )  // FIXME: Make sure shader is active?
+		return Selected->Set1i( id, value );
+	
+	return false;
+}
+
+
+GLint ShaderManager::AttribLoc( ShaderVarID id )
+{
+	if( Selected )  // FIXME: Make sure shader is active?
+		return Selected->AttribLoc( id );
+	
+	return -1;
+}
+
+
 bool ShaderManager::Set1f( const char *name, double value )
 {
 	if( Selected )  // FIXME: Make sure shader is active?
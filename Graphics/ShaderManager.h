@@ -33,6 +33,12 @@ public:
 	bool Active( void );
 	bool Ready( void );
 	
+	bool Set1f( ShaderVarID id, double value );
+	bool Set3f( ShaderVarID id, double x, double y, double z );
+	bool Set4f( ShaderVarID id, double x, double y, double z, double w );
+	bool Set1i( ShaderVarID id, int value );
+	GLint AttribLoc( ShaderVarID id );
+	
 	bool Set1f( const char *name, double value );
 	bool Set3f( const char *name, double x, double y, double z );
 	bool Set4f( const char *name, double x, double y, double z, double w );
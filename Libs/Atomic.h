@@ -0,0 +1,65 @@
+/*
+ *  Atomic.h
+ */
+
+#pragma once
+
+#include "PlatformSpecific.h"
+
+#include <stdint.h>
+
+
+// Minimal atomic operations for lock-free queues and counters.
+// These are full barriers; SDL1 has no atomics, so use the compiler intrinsics directly.
+
+namespace Atomic
+{
+#ifdef _MSC_VER
+
+	inline int32_t Add( volatile int32_t *value, int32_t add )
+	{
+		return InterlockedExchangeAdd( (volatile LONG*) value, add ) + add;
+	}
+	
+	inline bool CompareAndSwap( volatile int32_t *value, int32_t expected, int32_t desired )
+	{
+		return (InterlockedCompareExchange( (volatile LONG*) value, desired, expected ) == expected);
+	}
+	
+	inline void Barrier( void )
+	{
+		MemoryBarrier();
+	}
+
+#else
+
+	inline int32_t Add( volatile int32_t *value, int32_t add )
+	{
+		return __sync_add_and_fetch( value, add );
+	}
+	
+	inline bool CompareAndSwap( volatile int32_t *value, int32_t expected, int32_t desired )
+	{
+		return __sync_bool_compare_and_swap( value, expected, desired );
+	}
+	
+	inline void Barrier( void )
+	{
+		__sync_synchronize();
+	}
+
+#endif
+
+	inline int32_t Load( volatile int32_t *value )
+	{
+		int32_t result = *value;
+		Barrier();
+		return result;
+	}
+	
+	inline void Store( volatile int32_t *value, int32_t store )
+	{
+		Barrier();
+		*value = store;
+	}
+}
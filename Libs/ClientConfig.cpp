@@ -14,6 +14,7 @@
 #include "RaptorGame.h"
 
 #include "Math3D.h"
+#include "Profiler.h"
 #include <cfloat>
 
 
@@ -151,8 +152,10 @@ void ClientConfig::SetDefaults( void )
 	Settings[ "password" ] = "";
 	
 	Settings[ "netrate" ] = "30";
+	Settings[ "net_compress" ] = "true";
 	Settings[ "maxfps" ] = Num::ToString(refresh_rate);
 	Settings[ "showfps" ] = "false";
+	Settings[ "showprofile" ] = "true";
 	
 	Settings[ "screensaver_connect" ] = "false";
 	
@@ -576,6 +579,31 @@ void ClientConfig::Command( std::string str, bool show_in_console )
 					}
 				}
 				
+				else if( cmd == "profile" )
+				{
+					std::string profile_cmd = elements.size() ? elements.at(0) : "";
+					if( profile_cmd == "on" )
+					{
+						Profiler::Clear();
+						Profiler::Enable( true );
+					}
+					else if( profile_cmd == "off" )
+						Profiler::Enable( false );
+					else if( profile_cmd == "clear" )
+						Profiler::Clear();
+					else if( (profile_cmd == "save") && (elements.size() >= 2) )
+					{
+						if( Profiler::ExportTrace( elements.at(1).c_str() ) )
+							Raptor::Game->Console.Print( std::string("Saved trace: ") + elements.at(1) );
+						else
+							Raptor::Game->Console.Print( std::string("Couldn't save trace: ") + elements.at(1), TextConsole::MSG_ERROR );
+					}
+					else if( profile_cmd.empty() && Profiler::Enabled )
+						Raptor::Game->Console.Print( Profiler::Summary() );
+					else
+						Raptor::Game->Console.Print( "Usage: profile [on|off|clear|save <file>]", TextConsole::MSG_ERROR );
+				}
+				
 				else if( cmd == "model_info" )
 				{
 					if( elements.size() >= 1 )
@@ -720,238 +748,33 @@ void ClientConfig::Command( std::string str, bool show_in_console )
 						}
 						while( elements.size() && (sv_cmd == "sv") );
 						
-						if( Raptor::Server->HandleCommand( sv_cmd, elements.size() ? &elements : NULL ) )
-							;
-						
-						else if( sv_cmd == "set" )
-						{
-							if( elements.size() >= 2 )
-							{
-								Raptor::Server->SetProperty( elements.at(0), elements.at(1) );
-								
-								Packet info = Packet( Raptor::Packet::INFO );
-								info.AddUShort( 1 );
-								info.AddString( elements.at(0) );
-								info.AddString( elements.at(1) );
-								Raptor::Server->Net.SendAll( &info );
-							}
-							else
-								Raptor::Game->Console.Print( "Usage: sv set <variable> <value>", TextConsole::MSG_ERROR );
-						}
-						else if( sv_cmd == "unset" )
-						{
-							if( elements.size() >= 1 )
-							{
-								// FIXME: Remove the variable on clients instead of just setting to an empty string.
-								Packet info = Packet( Raptor::Packet::INFO );
-								info.AddUShort( 1 );
-								info.AddString( elements.at(0) );
-								info.AddString( "" );
-								Raptor::Server->Net.SendAll( &info );
-								
-								Raptor::Server->Data.Lock.Lock();
-								
-								std::map<std::string, std::string>::iterator setting_iter = Raptor::Server->Data.Properties.find( elements.at(0) );
-								if( setting_iter != Raptor::Server->Data.Properties.end() )
-									Raptor::Server->Data.Properties.erase( setting_iter );
-								else
-									Raptor::Game->Console.Print( elements.at(0) + " is not defined." );
-								
-								Raptor::Server->Data.Lock.Unlock();
-							}
-							else
-								Raptor::Game->Console.Print( "Usage: sv unset <variable>", TextConsole::MSG_ERROR );
-						}
-						else if( sv_cmd == "show" )
+						if( (sv_cmd == "port") && ! elements.size() )
 						{
-							if( elements.size() >= 1 )
-							{
-								int count = 0;
-								const char *cstr = elements.at(0).c_str();
-								int len = strlen(cstr);
-								
-								Raptor::Server->Data.Lock.Lock();
-								
-								for( std::map<std::string, std::string>::iterator property_iter = Raptor::Server->Data.Properties.begin(); property_iter != Raptor::Server->Data.Properties.end(); property_iter ++ )
-								{
-									if( strncmp( property_iter->first.c_str(), cstr, len ) == 0 )
-									{
-										Raptor::Game->Console.Print( property_iter->first + ": " + property_iter->second );
-										count ++;
-									}
-								}
-								
-								Raptor::Server->Data.Lock.Unlock();
-								
-								if( ! count )
-									Raptor::Game->Console.Print( elements.at(0) + " is not defined." );
-							}
-							else
-							{
-								Raptor::Server->Data.Lock.Lock();
-								
-								for( std::map<std::string, std::string>::iterator setting_iter = Raptor::Server->Data.Properties.begin(); setting_iter != Raptor::Server->Data.Properties.end(); setting_iter ++ )
-									Raptor::Game->Console.Print( setting_iter->first + ": " + setting_iter->second );
-								
-								Raptor::Server->Data.Lock.Unlock();
-							}
+							Raptor::Game->Console.Print( std::string("Server port: ") + Num::ToString( Raptor::Game->Server->Port ) );
+							int sv_port = SettingAsInt( "sv_port", Raptor::Game->DefaultPort );
+							if( sv_port != Raptor::Game->Server->Port )
+								Raptor::Game->Console.Print( std::string("(Will be ") + Num::ToString(sv_port) + std::string(" after restart.)") );
 						}
 						else if( sv_cmd == "port" )
 						{
-							if( elements.size() >= 1 )
-								Settings["sv_port"] = elements.at(0);
-							else
-							{
-								Raptor::Game->Console.Print( std::string("Server port: ") + Num::ToString( Raptor::Game->Server->Port ) );
-								int sv_port = SettingAsInt( "sv_port", Raptor::Game->DefaultPort );
-								if( sv_port != Raptor::Game->Server->Port )
-									Raptor::Game->Console.Print( std::string("(Will be ") + Num::ToString(sv_port) + std::string(" after restart.)") );
-							}
+							// Only remember the port here; a running server keeps listening where it is until restarted.
+							Settings["sv_port"] = elements.at(0);
 						}
-						else if( sv_cmd == "netrate" )
+						else
 						{
-							if( elements.size() >= 1 )
+							if( sv_cmd == "restart" )
 							{
-								Settings["sv_netrate"] = elements.at(0);
+								Raptor::Server->Port = SettingAsInt( "sv_port", Raptor::Game->DefaultPort );
 								Raptor::Server->NetRate = SettingAsDouble( "sv_netrate", 30. );
-								Raptor::Server->Net.SetNetRate( Raptor::Server->NetRate );
-							}
-							else
-								Raptor::Game->Console.Print( std::string("Server netrate: ") + Num::ToString( (int)( Raptor::Game->Server->Net.NetRate + 0.5 ) ) );
-						}
-						else if( sv_cmd == "maxfps" )
-						{
-							if( elements.size() >= 1 )
-							{
-								Settings["sv_maxfps"] = elements.at(0);
 								Raptor::Server->MaxFPS = SettingAsDouble( "sv_maxfps", 60. );
-							}
-							else
-								Raptor::Game->Console.Print( std::string("Server maxfps: ") + Num::ToString( (int)( Raptor::Game->Server->MaxFPS + 0.5 ) ) );
-						}
-						else if( sv_cmd == "threads" )
-						{
-							if( elements.size() >= 1 )
-							{
-								Settings["sv_threads"] = elements.at(0);
-								Raptor::Server->Data.ThreadCount = SettingAsInt("sv_threads");
-							}
-							else
-								Raptor::Game->Console.Print( std::string("Complex collision threads: ") + Num::ToString(Raptor::Server->Data.ThreadCount) );
-						}
-						else if( sv_cmd == "announce" )
-						{
-							if( elements.size() >= 1 )
-							{
-								Settings["sv_announce"] = elements.at(0);
 								Raptor::Server->Announce = SettingAsBool( "sv_announce", true );
+								Raptor::Server->Data.Properties["name"] = SettingAsString("name");
 							}
-							else
-								Raptor::Game->Console.Print( std::string("Server LAN announce: ") + (Raptor::Server->Announce ? "true" : "false") );
-						}
-						else if( sv_cmd == "restart" )
-						{
-							Raptor::Server->Port = SettingAsInt( "sv_port", Raptor::Game->DefaultPort );
-							Raptor::Server->NetRate = SettingAsDouble( "sv_netrate", 30. );
-							Raptor::Server->MaxFPS = SettingAsDouble( "sv_maxfps", 60. );
-							Raptor::Server->Announce = SettingAsBool( "sv_announce", true );
-							
-							Raptor::Server->Start( SettingAsString("name") );
-						}
-						else if( sv_cmd == "status" )
-						{
-							char cstr[ 1024 ] = "";
-							
-							Raptor::Game->Console.Print( Raptor::Game->Game + " " + Raptor::Game->Version );
-							snprintf( cstr, sizeof(cstr), "Architecture: %i-bit %s Endian", (int) sizeof(void*) * 8, Endian::Big() ? "Big" : "Little" );
-							Raptor::Game->Console.Print( cstr );
+							else if( elements.size() && ((sv_cmd == "netrate") || (sv_cmd == "maxfps") || (sv_cmd == "threads") || (sv_cmd == "announce")) )
+								Settings[ std::string("sv_") + sv_cmd ] = elements.at(0);
 							
-							snprintf( cstr, sizeof(cstr), "Players: %i", (int) Raptor::Server->Data.Players.size() );
-							Raptor::Game->Console.Print( cstr );
-							snprintf( cstr, sizeof(cstr), "Objects: %i", (int) Raptor::Server->Data.GameObjects.size() );
-							Raptor::Game->Console.Print( cstr );
-							snprintf( cstr, sizeof(cstr), "Server FPS: %.0f", 1. / Raptor::Server->FrameTime );
-							Raptor::Game->Console.Print( cstr );
+							Raptor::Server->Command( sv_cmd, elements.size() ? &elements : NULL );
 						}
-						else if( sv_cmd == "who" )
-						{
-							if( Raptor::Server->Data.Players.size() )
-							{
-								for( std::map<uint16_t,Player*>::const_iterator player_iter = Raptor::Server->Data.Players.begin(); player_iter != Raptor::Server->Data.Players.end(); player_iter ++ )
-								{
-									std::string name = player_iter->second->Name;
-									std::string version = player_iter->second->PropertyAsString( "version", Raptor::Server->Version.c_str(), Raptor::Server->Version.c_str() );
-									if( version != Raptor::Server->Version )
-										name += std::string(" [v") + version + std::string("]");
-									Raptor::Game->Console.Print( name );
-								}
-							}
-							else
-								Raptor::Game->Console.Print( "No players connected.", TextConsole::MSG_ERROR );
-						}
-						else if( sv_cmd == "say" )
-						{
-							if( elements.size() >= 1 )
-							{
-								Packet message = Packet( Raptor::Packet::MESSAGE );
-								message.AddString( (std::string("Server") + Raptor::Game->ChatSeparator + Str::Join( elements, " " )).c_str() );
-								message.AddUInt( TextConsole::MSG_CHAT );
-								Raptor::Server->ProcessPacket( &message, NULL );
-							}
-							else
-								Raptor::Game->Console.Print( "Usage: sv say <message>", TextConsole::MSG_ERROR );
-						}
-						else if( sv_cmd == "state" )
-						{
-							if( elements.size() >= 1 )
-							{
-								int new_state = Raptor::Server->State;
-								if( ((elements.at(0) == "+=") || (elements.at(0) == "+")) && (elements.size() >= 2) )
-									new_state += atoi( elements.at(1).c_str() );
-								else if( ((elements.at(0) == "-=") || (elements.at(0) == "-")) && (elements.size() >= 2) )
-									new_state -= atoi( elements.at(1).c_str() );
-								else if( (elements.at(0) == "++") || (elements.at(0) == "+") )
-									new_state ++;
-								else if( (elements.at(0) == "--") || (elements.at(0) == "-") )
-									new_state --;
-								else
-									new_state = atoi( elements.at(0).c_str() );
-								
-								if( new_state >= Raptor::State::CONNECTED )
-								{
-									char cstr[ 1024 ] = "";
-									snprintf( cstr, sizeof(cstr), "Changing server from state %i to %i.", Raptor::Server->State, new_state );
-									Raptor::Game->Console.Print( cstr );
-									
-									Raptor::Server->ChangeState( new_state );
-								}
-								else
-									Raptor::Game->Console.Print( "Invalid state requested: " + Num::ToString(new_state), TextConsole::MSG_ERROR );
-							}
-							else
-							{
-								char cstr[ 1024 ] = "";
-								snprintf( cstr, sizeof(cstr), "Current server state: %i", Raptor::Server->State );
-								Raptor::Game->Console.Print( cstr );
-							}
-						}
-						else if( Raptor::Server->Data.HasProperty(sv_cmd) )
-						{
-							if( elements.size() >= 1 )
-							{
-								Raptor::Server->SetProperty( sv_cmd, elements.at(0) );
-								
-								Packet info = Packet( Raptor::Packet::INFO );
-								info.AddUShort( 1 );
-								info.AddString( sv_cmd );
-								info.AddString( elements.at(0) );
-								Raptor::Server->Net.SendAll( &info );
-							}
-							else
-								Raptor::Game->Console.Print( sv_cmd + ": " + Raptor::Server->Data.PropertyAsString(sv_cmd) );
-						}
-						else
-							Raptor::Game->Console.Print( "Unknown sv command: " + sv_cmd, TextConsole::MSG_ERROR );
 					}
 					else
 						Raptor::Game->Console.Print( "Usage: sv <command>", TextConsole::MSG_ERROR );
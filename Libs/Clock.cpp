@@ -7,11 +7,73 @@
 #include <cstddef>
 #include <cmath>
 
+#ifdef WIN32
+	#include <windows.h>
+	#include <mmsystem.h>
+	#ifdef _MSC_VER
+		#pragma comment( lib, "winmm.lib" )
+	#endif
+#elif defined(__APPLE__)
+	#include <mach/mach_time.h>
+	#include <time.h>
+	#include <sched.h>
+#else
+	#include <time.h>
+	#include <sched.h>
+#endif
+
+#if defined(APPLE_POWERPC) && ! defined(WIN32)
+	#include <pthread.h>
+	#include <cstdlib>
+#endif
+
+
+// When sleeping, stop this far short of the target and yield the rest to absorb scheduler wake-up lag.
+#ifdef WIN32
+	#define CLOCK_SPIN_NS 2000000LL
+#else
+	#define CLOCK_SPIN_NS 200000LL
+#endif
+
+
+// Per-thread frame timestamp, so the client and server loops each cache their own.
+#if defined(APPLE_POWERPC) && ! defined(WIN32)
+// No compiler TLS here (THREAD_LOCAL is empty), and a shared 64-bit value could tear on 32-bit PowerPC.
+static pthread_key_t FrameTimeKey;
+static pthread_once_t FrameTimeOnce = PTHREAD_ONCE_INIT;
+
+static void FrameTimeKeyCreate( void )
+{
+	pthread_key_create( &FrameTimeKey, free );
+}
+
+static int64_t *FrameTimePtr( void )
+{
+	pthread_once( &FrameTimeOnce, FrameTimeKeyCreate );
+	int64_t *frame_time = (int64_t*) pthread_getspecific( FrameTimeKey );
+	if( ! frame_time )
+	{
+		frame_time = (int64_t*) calloc( 1, sizeof(int64_t) );
+		pthread_setspecific( FrameTimeKey, frame_time );
+	}
+	return frame_time;
+}
+#else
+static THREAD_LOCAL int64_t FrameTimeNS = 0;
+
+static int64_t *FrameTimePtr( void )
+{
+	return &FrameTimeNS;
+}
+#endif
+
+
+// ---------------------------------------------------------------------------
+
 
 Clock::Clock( void )
 {
-	TimeVal.tv_sec = 0;
-	TimeVal.tv_usec = 0;
+	TimeNS = 0;
 	CountUpToSecs = 0.;
 	TimeScale = 1.;
 	Reset();
@@ -20,8 +82,7 @@ Clock::Clock( void )
 
 Clock::Clock( double count_up_to_secs )
 {
-	TimeVal.tv_sec = 0;
-	TimeVal.tv_usec = 0;
+	TimeNS = 0;
 	CountUpToSecs = count_up_to_secs;
 	TimeScale = 1.;
 	Reset();
@@ -30,8 +91,7 @@ Clock::Clock( double count_up_to_secs )
 
 Clock::Clock( const Clock &c )
 {
-	TimeVal.tv_sec = c.TimeVal.tv_sec;
-	TimeVal.tv_usec = c.TimeVal.tv_usec;
+	TimeNS = c.TimeNS;
 	CountUpToSecs = c.CountUpToSecs;
 	TimeScale = c.TimeScale;
 }
@@ -44,21 +104,20 @@ Clock::~Clock()
 
 void Clock::Reset( void )
 {
-	gettimeofday( &TimeVal, NULL );
+	TimeNS = Now();
 }
 
 
 void Clock::Reset( double count_up_to_secs )
 {
-	gettimeofday( &TimeVal, NULL );
+	TimeNS = Now();
 	CountUpToSecs = count_up_to_secs;
 }
 
 
 void Clock::Sync( const Clock *c )
 {
-	TimeVal.tv_sec = c->TimeVal.tv_sec;
-	TimeVal.tv_usec = c->TimeVal.tv_usec;
+	TimeNS = c->TimeNS;
 	CountUpToSecs = c->CountUpToSecs;
 	TimeScale = c->TimeScale;
 }
@@ -66,20 +125,7 @@ void Clock::Sync( const Clock *c )
 
 void Clock::Advance( double secs )
 {
-	double s = 0.;
-	double us = modf( secs, &s );
-	TimeVal.tv_sec += s;
-	TimeVal.tv_usec += us * 1000000. + 0.5;
-	if( TimeVal.tv_usec > 1000000 )
-	{
-		TimeVal.tv_sec ++;
-		TimeVal.tv_usec -= 1000000;
-	}
-	else if( TimeVal.tv_usec < 0 )
-	{
-		TimeVal.tv_sec --;
-		TimeVal.tv_usec += 1000000;
-	}
+	TimeNS += (int64_t)( floor( secs * CLOCK_NS_PER_SEC + 0.5 ) );
 }
 
 
@@ -106,37 +152,19 @@ void Clock::SetProgress( double progress )
 
 double Clock::ElapsedSeconds( void ) const
 {
-	double scale = TimeScale;
-	double scale2 = scale / 1000000.;
-	
-	struct timeval current_time;
-	gettimeofday( &current_time, NULL );
-	
-	return ((double)( current_time.tv_sec - TimeVal.tv_sec )) * scale + ((double)( current_time.tv_usec - TimeVal.tv_usec )) * scale2;
+	return (double)( Now() - TimeNS ) * TimeScale / CLOCK_NS_PER_SEC;
 }
 
 
 double Clock::ElapsedMilliseconds( void ) const
 {
-	double scale = TimeScale * 1000.;
-	double scale2 = scale / 1000000.;
-	
-	struct timeval current_time;
-	gettimeofday( &current_time, NULL );
-	
-	return ((double)( current_time.tv_sec - TimeVal.tv_sec )) * scale + ((double)( current_time.tv_usec - TimeVal.tv_usec )) * scale2;
+	return (double)( Now() - TimeNS ) * TimeScale / 1000000.;
 }
 
 
 double Clock::ElapsedMicroseconds( void ) const
 {
-	double scale = TimeScale * 1000000.;
-	double scale2 = scale / 1000000.;
-	
-	struct timeval current_time;
-	gettimeofday( &current_time, NULL );
-	
-	return ((double)( current_time.tv_sec - TimeVal.tv_sec )) * scale + ((double)( current_time.tv_usec - TimeVal.tv_usec )) * scale2;
+	return (double)( Now() - TimeNS ) * TimeScale / 1000.;
 }
 
 
@@ -155,11 +183,148 @@ double Clock::Progress( void ) const
 }
 
 
+double Clock::FrameSeconds( void ) const
+{
+	// Elapsed time as of this thread's last NewFrame; no clock read, so it's cheap enough for per-object use.
+	return (double)( FrameNow() - TimeNS ) * TimeScale / CLOCK_NS_PER_SEC;
+}
+
+
+double Clock::FrameProgress( void ) const
+{
+	if( CountUpToSecs )
+		return FrameSeconds() / CountUpToSecs;
+	
+	return 1.;
+}
+
+
+bool Clock::Before( const Clock *other ) const
+{
+	// Compares start times directly, e.g. to see if something was loaded before the last GL context reset.
+	return TimeNS < other->TimeNS;
+}
+
+
+void Clock::SleepUntil( double elapsed_secs ) const
+{
+	// Sleep until ElapsedSeconds() would return elapsed_secs.
+	if( TimeScale )
+		SleepUntilNS( TimeNS + (int64_t)( floor( elapsed_secs / TimeScale * CLOCK_NS_PER_SEC + 0.5 ) ) );
+}
+
+
+struct timeval Clock::TimeVal( void ) const
+{
+	struct timeval tv;
+	tv.tv_sec = TimeNS / CLOCK_NS_PER_SEC;
+	tv.tv_usec = (TimeNS % CLOCK_NS_PER_SEC) / 1000;
+	if( tv.tv_usec < 0 )
+	{
+		tv.tv_sec --;
+		tv.tv_usec += 1000000;
+	}
+	return tv;
+}
+
+
+void Clock::SetTimeVal( const struct timeval *tv )
+{
+	TimeNS = (int64_t) tv->tv_sec * CLOCK_NS_PER_SEC + (int64_t) tv->tv_usec * 1000;
+}
+
+
 Clock &Clock::operator = ( const Clock &other )
 {
-	TimeVal.tv_sec  = other.TimeVal.tv_sec;
-	TimeVal.tv_usec = other.TimeVal.tv_usec;
-	CountUpToSecs   = other.CountUpToSecs;
-	TimeScale       = other.TimeScale;
+	TimeNS        = other.TimeNS;
+	CountUpToSecs = other.CountUpToSecs;
+	TimeScale     = other.TimeScale;
 	return *this;
 }
+
+
+// ---------------------------------------------------------------------------
+
+
+int64_t Clock::Now( void )
+{
+#ifdef WIN32
+	static LARGE_INTEGER freq = {0};
+	if( ! freq.QuadPart )
+		QueryPerformanceFrequency( &freq );
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter( &counter );
+	return (counter.QuadPart / freq.QuadPart) * CLOCK_NS_PER_SEC + (counter.QuadPart % freq.QuadPart) * CLOCK_NS_PER_SEC / freq.QuadPart;
+#elif defined(__APPLE__)
+	static mach_timebase_info_data_t timebase = {0,0};
+	if( ! timebase.denom )
+		mach_timebase_info( &timebase );
+	uint64_t ticks = mach_absolute_time();
+	return (int64_t)( (ticks / timebase.denom) * timebase.numer + (ticks % timebase.denom) * timebase.numer / timebase.denom );
+#else
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (int64_t) ts.tv_sec * CLOCK_NS_PER_SEC + ts.tv_nsec;
+#endif
+}
+
+
+int64_t Clock::FrameNow( void )
+{
+	// Threads that never called NewFrame get the precise time.
+	int64_t frame_time = *FrameTimePtr();
+	return frame_time ? frame_time : Now();
+}
+
+
+void Clock::NewFrame( void )
+{
+	*FrameTimePtr() = Now();
+}
+
+
+void Clock::SleepUntilNS( int64_t when )
+{
+#ifdef WIN32
+	// Sleep rounds up to the system timer tick (15.6ms by default), so ask for 1ms ticks once per process.
+	static bool timer_period_set = false;
+	if( ! timer_period_set )
+	{
+		timeBeginPeriod( 1 );
+		timer_period_set = true;
+	}
+#endif
+
+	for(;;)
+	{
+		int64_t remaining = when - Now();
+		if( remaining <= 0 )
+			return;
+		
+		if( remaining > CLOCK_SPIN_NS )
+		{
+#ifdef WIN32
+			Sleep( (DWORD)( (remaining - CLOCK_SPIN_NS) / 1000000 ) );
+#elif defined(__APPLE__)
+			struct timespec ts;
+			ts.tv_sec = (remaining - CLOCK_SPIN_NS) / CLOCK_NS_PER_SEC;
+			ts.tv_nsec = (remaining - CLOCK_SPIN_NS) % CLOCK_NS_PER_SEC;
+			nanosleep( &ts, NULL );
+#else
+			int64_t wake = when - CLOCK_SPIN_NS;
+			struct timespec ts;
+			ts.tv_sec = wake / CLOCK_NS_PER_SEC;
+			ts.tv_nsec = wake % CLOCK_NS_PER_SEC;
+			clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL );
+#endif
+		}
+		else
+		{
+#ifdef WIN32
+			SwitchToThread();
+#else
+			sched_yield();
+#endif
+		}
+	}
+}
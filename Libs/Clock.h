@@ -7,6 +7,8 @@ class Clock;
 
 #include "PlatformSpecific.h"
 
+#include <stdint.h>
+
 #ifndef WIN32
 #include <sys/time.h>
 #else
@@ -15,10 +17,14 @@ class Clock;
 #endif
 
 
+// Timestamps are nanoseconds from a monotonic source, so wall-clock adjustments never move them.
+#define CLOCK_NS_PER_SEC 1000000000LL
+
+
 class Clock
 {
 public:
-	struct timeval TimeVal;
+	int64_t TimeNS;
 	double CountUpToSecs;
 	double TimeScale;
 	
@@ -34,6 +40,10 @@ public:
 	void SetTimeScale( double time_scale );
 	void SetProgress( double progress );
 	
+	// For code written when the start time was a public timeval; only differences between clocks are meaningful.
+	struct timeval TimeVal( void ) const;
+	void SetTimeVal( const struct timeval *tv );
+	
 	double ElapsedSeconds( void ) const;
 	double ElapsedMilliseconds( void ) const;
 	double ElapsedMicroseconds( void ) const;
@@ -41,5 +51,16 @@ public:
 	double RemainingSeconds( void ) const;
 	double Progress( void ) const;
 	
+	double FrameSeconds( void ) const;
+	double FrameProgress( void ) const;
+	
+	bool Before( const Clock *other ) const;
+	void SleepUntil( double elapsed_secs ) const;
+	
 	Clock &operator = ( const Clock &other );
+	
+	static int64_t Now( void );
+	static int64_t FrameNow( void );
+	static void NewFrame( void );
+	static void SleepUntilNS( int64_t when );
 };
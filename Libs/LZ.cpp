@@ -0,0 +1,197 @@
+/*
+ *  LZ.cpp
+ */
+
+#include "LZ.h"
+
+#include <cstring>
+#include <algorithm>
+
+
+#define LZ_MIN_MATCH      4
+#define LZ_HASH_BITS      12
+#define LZ_LAST_LITERALS  5
+#define LZ_MATCH_LIMIT    12
+#define LZ_MAX_OFFSET     65535
+
+
+static inline uint32_t LZRead32( const uint8_t *ptr )
+{
+	uint32_t value = 0;
+	memcpy( &value, ptr, 4 );
+	return value;
+}
+
+
+static inline uint32_t LZHash( uint32_t value )
+{
+	return (value * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+
+// Write the 255-continued tail of a length that didn't fit in its 4-bit token field.
+static inline uint8_t *LZWriteLength( uint8_t *dest, size_t length )
+{
+	while( length >= 255 )
+	{
+		*(dest ++) = 255;
+		length -= 255;
+	}
+	*(dest ++) = (uint8_t) length;
+	return dest;
+}
+
+
+// Read the 255-continued tail of a length, or return false if the input runs out.
+static inline bool LZReadLength( const uint8_t **src, const uint8_t *src_end, size_t *length )
+{
+	uint8_t byte = 255;
+	while( byte == 255 )
+	{
+		if( *src >= src_end )
+			return false;
+		byte = *((*src) ++);
+		*length += byte;
+	}
+	return true;
+}
+
+
+// Worst-case output size for incompressible input.
+size_t LZ::Bound( size_t size )
+{
+	return size + size / 255 + 16;
+}
+
+
+// Returns the compressed size, or 0 if the output would not fit in dest_size.
+size_t LZ::Compress( const uint8_t *src, size_t size, uint8_t *dest, size_t dest_size )
+{
+	const uint8_t *src_end = src + size;
+	const uint8_t *match_start_limit = (size > LZ_MATCH_LIMIT) ? (src_end - LZ_MATCH_LIMIT) : src;
+	const uint8_t *match_end_limit = (size > LZ_LAST_LITERALS) ? (src_end - LZ_LAST_LITERALS) : src;
+	const uint8_t *ip = src;
+	const uint8_t *anchor = src;
+	uint8_t *op = dest;
+	uint8_t *dest_end = dest + dest_size;
+	
+	uint32_t table[ 1 << LZ_HASH_BITS ];
+	memset( table, 0, sizeof(table) );
+	
+	while( ip < match_start_limit )
+	{
+		uint32_t sequence = LZRead32( ip );
+		uint32_t hash = LZHash( sequence );
+		const uint8_t *ref = src + table[ hash ];
+		table[ hash ] = ip - src;
+		
+		if( (ref >= ip) || (ip - ref > LZ_MAX_OFFSET) || (LZRead32( ref ) != sequence) )
+		{
+			// Step further through data that isn't matching, so incompressible input stays cheap.
+			ip += 1 + ((ip - anchor) >> 6);
+			continue;
+		}
+		
+		// Extend the match backwards into pending literals, then forwards as far as allowed.
+		while( (ip > anchor) && (ref > src) && (ip[ -1 ] == ref[ -1 ]) )
+		{
+			ip --;
+			ref --;
+		}
+		const uint8_t *match_end = ip + LZ_MIN_MATCH;
+		const uint8_t *ref_end = ref + LZ_MIN_MATCH;
+		while( (match_end < match_end_limit) && (*match_end == *ref_end) )
+		{
+			match_end ++;
+			ref_end ++;
+		}
+		
+		size_t literals = ip - anchor;
+		size_t match_length = match_end - ip - LZ_MIN_MATCH;
+		if( (size_t)( dest_end - op ) < 1 + literals + literals / 255 + 1 + 2 + match_length / 255 + 1 )
+			return 0;
+		
+		uint8_t *token = op ++;
+		*token = (uint8_t)( (std::min<size_t>( literals, 15 ) << 4) | std::min<size_t>( match_length, 15 ) );
+		if( literals >= 15 )
+			op = LZWriteLength( op, literals - 15 );
+		memcpy( op, anchor, literals );
+		op += literals;
+		
+		size_t offset = ip - ref;
+		*(op ++) = (uint8_t)( offset & 0xFF );
+		*(op ++) = (uint8_t)( offset >> 8 );
+		if( match_length >= 15 )
+			op = LZWriteLength( op, match_length - 15 );
+		
+		ip = match_end;
+		anchor = ip;
+	}
+	
+	// The block always ends with a literal-only sequence.
+	size_t literals = src_end - anchor;
+	if( (size_t)( dest_end - op ) < 1 + literals + literals / 255 + 1 )
+		return 0;
+	*(op ++) = (uint8_t)( std::min<size_t>( literals, 15 ) << 4 );
+	if( literals >= 15 )
+		op = LZWriteLength( op, literals - 15 );
+	memcpy( op, anchor, literals );
+	op += literals;
+	
+	return op - dest;
+}
+
+
+// Returns the decompressed size, or 0 if the input is malformed or would overflow dest_size.
+size_t LZ::Decompress( const uint8_t *src, size_t size, uint8_t *dest, size_t dest_size )
+{
+	const uint8_t *ip = src;
+	const uint8_t *src_end = src + size;
+	uint8_t *op = dest;
+	uint8_t *dest_end = dest + dest_size;
+	
+	while( ip < src_end )
+	{
+		uint8_t token = *(ip ++);
+		
+		size_t literals = token >> 4;
+		if( (literals == 15) && ! LZReadLength( &ip, src_end, &literals ) )
+			return 0;
+		if( ((size_t)( src_end - ip ) < literals) || ((size_t)( dest_end - op ) < literals) )
+			return 0;
+		memcpy( op, ip, literals );
+		op += literals;
+		ip += literals;
+		
+		// The last sequence has no match part.
+		if( ip >= src_end )
+			break;
+		
+		if( src_end - ip < 2 )
+			return 0;
+		size_t offset = ip[ 0 ] | (ip[ 1 ] << 8);
+		ip += 2;
+		if( (! offset) || (offset > (size_t)( op - dest )) )
+			return 0;
+		
+		size_t match_length = token & 0x0F;
+		if( (match_length == 15) && ! LZReadLength( &ip, src_end, &match_length ) )
+			return 0;
+		match_length += LZ_MIN_MATCH;
+		if( (size_t)( dest_end - op ) < match_length )
+			return 0;
+		
+		// Overlapping matches repeat recent output, so they must be copied forward byte by byte.
+		const uint8_t *ref = op - offset;
+		if( offset >= match_length )
+			memcpy( op, ref, match_length );
+		else
+		{
+			for( size_t i = 0; i < match_length; i ++ )
+				op[ i ] = ref[ i ];
+		}
+		op += match_length;
+	}
+	
+	return op - dest;
+}
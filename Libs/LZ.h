@@ -0,0 +1,21 @@
+/*
+ *  LZ.h
+ */
+
+#pragma once
+
+#include "PlatformSpecific.h"
+
+#include <cstddef>
+#include <stdint.h>
+
+
+// Fast byte-oriented LZ77 in the LZ4 block layout: a token byte of literal/match lengths, the literals,
+// then a 16-bit little-endian offset.  Meant for speed over ratio, so it can run on every large packet.
+
+namespace LZ
+{
+	size_t Bound( size_t size );
+	size_t Compress( const uint8_t *src, size_t size, uint8_t *dest, size_t dest_size );
+	size_t Decompress( const uint8_t *src, size_t size, uint8_t *dest, size_t dest_size );
+}
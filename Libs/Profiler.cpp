@@ -0,0 +1,275 @@
+/*
+ *  Profiler.cpp
+ */
+
+#include "Profiler.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "Clock.h"
+#include "Mutex.h"
+#include "Atomic.h"
+#include "Num.h"
+
+
+volatile bool Profiler::Enabled = false;
+
+static THREAD_LOCAL ProfileThread *ProfilerThreadData = NULL;
+static THREAD_LOCAL const char *ProfilerThreadName = NULL;
+static std::vector<ProfileThread*> ProfilerThreads;
+static Mutex ProfilerThreadsLock;
+static int64_t ProfilerClearedNS = 0;
+
+
+void Profiler::Enable( bool enable )
+{
+	#ifndef NO_PROFILER
+		Enabled = enable;
+	#endif
+}
+
+
+// Ignore everything recorded so far; rings are owned by their threads, so they are not touched here.
+void Profiler::Clear( void )
+{
+	ProfilerClearedNS = Clock::Now();
+}
+
+
+void Profiler::SetThreadName( const char *name )
+{
+	ProfilerThreadName = name;
+	
+	if( ProfilerThreadData )
+	{
+		ProfilerThreadsLock.Lock();
+		ProfilerThreadData->Name = name;
+		ProfilerThreadsLock.Unlock();
+	}
+}
+
+
+// Call before a profiled thread exits, so its ring can be reused by the next new thread.
+void Profiler::ThreadDone( void )
+{
+	if( ProfilerThreadData )
+	{
+		ProfilerThreadsLock.Lock();
+		ProfilerThreadData->InUse = false;
+		ProfilerThreadsLock.Unlock();
+	}
+	
+	ProfilerThreadData = NULL;
+	ProfilerThreadName = NULL;
+}
+
+
+ProfileThread *Profiler::CurrentThread( void )
+{
+	if( ProfilerThreadData )
+		return ProfilerThreadData;
+	
+	ProfilerThreadsLock.Lock();
+	
+	for( std::vector<ProfileThread*>::iterator thread_iter = ProfilerThreads.begin(); thread_iter != ProfilerThreads.end(); thread_iter ++ )
+	{
+		if( ! (*thread_iter)->InUse )
+		{
+			ProfilerThreadData = *thread_iter;
+			break;
+		}
+	}
+	if( ! ProfilerThreadData )
+	{
+		ProfilerThreadData = new ProfileThread( ProfilerThreads.size() + 1 );
+		ProfilerThreads.push_back( ProfilerThreadData );
+	}
+	
+	ProfilerThreadData->InUse = true;
+	ProfilerThreadData->Depth = 0;
+	if( ProfilerThreadName )
+		ProfilerThreadData->Name = ProfilerThreadName;
+	else
+		ProfilerThreadData->Name = std::string("Thread ") + Num::ToString(ProfilerThreadData->ID);
+	Atomic::Store( &(ProfilerThreadData->Written), 0 );
+	
+	ProfilerThreadsLock.Unlock();
+	
+	return ProfilerThreadData;
+}
+
+
+// Per-zone duration percentiles over the most recent seconds, one line per thread and zone.
+std::string Profiler::Summary( double seconds )
+{
+	int64_t since = std::max<int64_t>( ProfilerClearedNS, Clock::Now() - (int64_t)( seconds * CLOCK_NS_PER_SEC ) );
+	std::map< std::pair<int,const char*>, std::vector<double> > zone_times;
+	std::map<int,std::string> thread_names;
+	std::vector<ProfileEvent> events( PROFILER_RING_SIZE );
+	
+	ProfilerThreadsLock.Lock();
+	
+	for( std::vector<ProfileThread*>::iterator thread_iter = ProfilerThreads.begin(); thread_iter != ProfilerThreads.end(); thread_iter ++ )
+	{
+		size_t count = (*thread_iter)->Copy( &(events[ 0 ]) );
+		for( size_t i = 0; i < count; i ++ )
+		{
+			if( events[ i ].StartNS >= since )
+				zone_times[ std::pair<int,const char*>( (*thread_iter)->ID, events[ i ].Name ) ].push_back( (events[ i ].EndNS - events[ i ].StartNS) / 1000000. );
+		}
+		thread_names[ (*thread_iter)->ID ] = (*thread_iter)->Name;
+	}
+	
+	ProfilerThreadsLock.Unlock();
+	
+	// Identical zone names from different files may be different pointers, so merge them by text.
+	std::map< std::string, std::vector<double> > merged;
+	for( std::map< std::pair<int,const char*>, std::vector<double> >::const_iterator zone_iter = zone_times.begin(); zone_iter != zone_times.end(); zone_iter ++ )
+	{
+		std::vector<double> *times = &(merged[ thread_names[ zone_iter->first.first ] + std::string(": ") + std::string(zone_iter->first.second) ]);
+		times->insert( times->end(), zone_iter->second.begin(), zone_iter->second.end() );
+	}
+	
+	std::string summary = "Zone: count, 50% 95% 99% max (ms)";
+	for( std::map< std::string, std::vector<double> >::iterator zone_iter = merged.begin(); zone_iter != merged.end(); zone_iter ++ )
+	{
+		std::vector<double> *times = &(zone_iter->second);
+		std::sort( times->begin(), times->end() );
+		size_t last = times->size() - 1;
+		
+		char cstr[ 1024 ] = "";
+		snprintf( cstr, sizeof(cstr), "\n%s: %i, %.2f %.2f %.2f %.2f", zone_iter->first.c_str(), (int) times->size(), times->at( last / 2 ), times->at( last * 95 / 100 ), times->at( last * 99 / 100 ), times->back() );
+		summary += cstr;
+	}
+	
+	return summary;
+}
+
+
+static void ProfilerWriteJSONString( FILE *out, const char *str )
+{
+	fputc( '"', out );
+	for( const char *c = str; *c; c ++ )
+	{
+		if( (*c == '"') || (*c == '\\') )
+			fputc( '\\', out );
+		if( (unsigned char) *c >= ' ' )
+			fputc( *c, out );
+	}
+	fputc( '"', out );
+}
+
+
+// Write recorded zones as Chrome trace-event JSON (load in chrome://tracing or Perfetto).
+bool Profiler::ExportTrace( const char *filename )
+{
+	FILE *out = fopen( filename, "wb" );
+	if( ! out )
+	{
+		fprintf( stderr, "Profiler::ExportTrace: Couldn't open %s\n", filename );
+		return false;
+	}
+	
+	fprintf( out, "{\"traceEvents\":[" );
+	bool first = true;
+	std::vector<ProfileEvent> events( PROFILER_RING_SIZE );
+	
+	ProfilerThreadsLock.Lock();
+	
+	for( std::vector<ProfileThread*>::iterator thread_iter = ProfilerThreads.begin(); thread_iter != ProfilerThreads.end(); thread_iter ++ )
+	{
+		fprintf( out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":", first ? "" : ",", (*thread_iter)->ID );
+		ProfilerWriteJSONString( out, (*thread_iter)->Name.c_str() );
+		fprintf( out, "}}" );
+		first = false;
+		
+		size_t count = (*thread_iter)->Copy( &(events[ 0 ]) );
+		for( size_t i = 0; i < count; i ++ )
+		{
+			if( events[ i ].StartNS < ProfilerClearedNS )
+				continue;
+			
+			fprintf( out, ",\n{\"name\":" );
+			ProfilerWriteJSONString( out, events[ i ].Name );
+			fprintf( out, ",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%.3f,\"dur\":%.3f}", (*thread_iter)->ID, events[ i ].StartNS / 1000., (events[ i ].EndNS - events[ i ].StartNS) / 1000. );
+		}
+	}
+	
+	ProfilerThreadsLock.Unlock();
+	
+	fprintf( out, "\n],\"displayTimeUnit\":\"ms\"}\n" );
+	fclose( out );
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+void ProfileZone::Begin( const char *name )
+{
+	Thread = Profiler::CurrentThread();
+	Name = name;
+	Thread->Depth ++;
+	StartNS = Clock::Now();
+}
+
+
+void ProfileZone::End( void )
+{
+	if( ! Thread )
+		return;
+	
+	int64_t end_ns = Clock::Now();
+	
+	// Only the owning thread writes, so the slot can be filled before publishing the new count.
+	uint32_t index = (uint32_t) Thread->Written;
+	ProfileEvent *event = &(Thread->Events[ index & (PROFILER_RING_SIZE - 1) ]);
+	event->Name = Name;
+	event->StartNS = StartNS;
+	event->EndNS = end_ns;
+	Thread->Depth --;
+	event->Depth = Thread->Depth;
+	Atomic::Store( &(Thread->Written), (int32_t)( index + 1 ) );
+	
+	Thread = NULL;
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+ProfileThread::ProfileThread( int id )
+{
+	ID = id;
+	InUse = false;
+	Depth = 0;
+	Written = 0;
+	memset( Events, 0, sizeof(Events) );
+}
+
+
+// Copy the ring oldest-first into events (room for PROFILER_RING_SIZE) and return how many are valid.
+size_t ProfileThread::Copy( ProfileEvent *events )
+{
+	uint32_t end = (uint32_t) Atomic::Load( &Written );
+	uint32_t count = std::min<uint32_t>( end, PROFILER_RING_SIZE );
+	uint32_t start = end - count;
+	for( uint32_t i = 0; i < count; i ++ )
+		events[ i ] = Events[ (start + i) & (PROFILER_RING_SIZE - 1) ];
+	
+	// Drop the oldest entries if the writer lapped them while we were copying.
+	uint32_t age = (uint32_t) Atomic::Load( &Written ) - start;
+	if( age >= PROFILER_RING_SIZE )
+	{
+		uint32_t drop = std::min<uint32_t>( count, age - PROFILER_RING_SIZE + 1 );
+		memmove( events, events + drop, (count - drop) * sizeof(ProfileEvent) );
+		count -= drop;
+	}
+	
+	return count;
+}
@@ -0,0 +1,99 @@
+/*
+ *  Profiler.h
+ */
+
+#pragma once
+class ProfileZone;
+class ProfileEvent;
+class ProfileThread;
+
+#include "PlatformSpecific.h"
+
+#include <string>
+#include <stdint.h>
+
+
+// Older Apple GCC for PowerPC has no thread-local storage, so zones compile out there.
+#if defined(APPLE_POWERPC) && ! defined(NO_PROFILER)
+	#define NO_PROFILER
+#endif
+
+#ifdef NO_PROFILER
+	#define PROFILE_ZONE( name )
+#else
+	#define PROFILE_ZONE_CONCAT2( a, b ) a##b
+	#define PROFILE_ZONE_CONCAT( a, b ) PROFILE_ZONE_CONCAT2( a, b )
+	#define PROFILE_ZONE( name ) ProfileZone PROFILE_ZONE_CONCAT( profile_zone_, __LINE__ )( name )
+#endif
+
+// Events kept per thread; must be a power of two.
+#define PROFILER_RING_SIZE 16384
+
+
+namespace Profiler
+{
+	extern volatile bool Enabled;
+	
+	void Enable( bool enable );
+	void Clear( void );
+	
+	void SetThreadName( const char *name );
+	void ThreadDone( void );
+	ProfileThread *CurrentThread( void );
+	
+	std::string Summary( double seconds = 2. );
+	bool ExportTrace( const char *filename );
+}
+
+
+// Times the enclosing scope (or until End) on the calling thread.  Names must be string literals.
+// When the profiler is disabled this costs one branch.
+class ProfileZone
+{
+public:
+	ProfileThread *Thread;
+	const char *Name;
+	int64_t StartNS;
+	
+	ProfileZone( const char *name )
+	{
+		Thread = NULL;
+		if( Profiler::Enabled )
+			Begin( name );
+	}
+	
+	~ProfileZone()
+	{
+		if( Thread )
+			End();
+	}
+	
+	void Begin( const char *name );
+	void End( void );
+};
+
+
+class ProfileEvent
+{
+public:
+	const char *Name;
+	int64_t StartNS, EndNS;
+	int Depth;
+};
+
+
+// One thread's ring of completed zones.  Only the owning thread writes; readers copy and discard anything overwritten meanwhile.
+class ProfileThread
+{
+public:
+	std::string Name;
+	int ID;
+	bool InUse;
+	int Depth;
+	volatile int32_t Written;
+	ProfileEvent Events[ PROFILER_RING_SIZE ];
+	
+	ProfileThread( int id );
+	
+	size_t Copy( ProfileEvent *events );
+};
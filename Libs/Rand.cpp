@@ -4,34 +4,57 @@
 
 #include "Rand.h"
 
-#include <stdlib.h>
-#include <algorithm>
+#include "RandomEngine.h"
 
 
-int Rand::Max = std::min<int>( RAND_MAX, 0x7FFF );
+// Each thread draws from its own generator state, so callers on different threads never contend.
+// Threads seed lazily from the most recent Rand::Seed value mixed with their own state address.
+
+int Rand::Max = 0x7FFFFFFF;
+
+static volatile uint64_t SeedBase = 0;
+static THREAD_LOCAL uint64_t ThreadState[ 4 ];
+static THREAD_LOCAL bool ThreadSeeded = false;
+
+
+static inline uint64_t *State( void )
+{
+	if( ! ThreadSeeded )
+	{
+		RandomEngine::SeedState( ThreadState, SeedBase ^ ((uint64_t)( (size_t) ThreadState ) * 0x9E3779B97F4A7C15ULL) ^ (uint64_t) time(NULL) );
+		ThreadSeeded = true;
+	}
+	
+	return ThreadState;
+}
 
 
 void Rand::Seed( unsigned int seed )
 {
-	srand( seed );
+	// Seeding exactly reproduces this thread's sequence; other threads derive distinct streams from it.
+	SeedBase = seed;
+	RandomEngine::SeedState( ThreadState, seed );
+	ThreadSeeded = true;
 }
 
 
 int Rand::Int( void )
 {
-	return rand() & Max;
+	return (RandomEngine::Next( State() ) >> 33) & Max;
 }
 
 
 int Rand::Int( int min, int max )
 {
-	return Int() % (1 + max - min) + min;
+	// Multiply-shift maps the full 32-bit output onto the range without modulo bias.
+	uint32_t range = 1 + max - min;
+	return (int)( ((RandomEngine::Next( State() ) >> 32) * range) >> 32 ) + min;
 }
 
 
 double Rand::Double( void )
 {
-	return Int() / (double) Max;
+	return RandomEngine::ToDouble( RandomEngine::Next( State() ) );
 }
 
 
@@ -51,3 +74,35 @@ bool Rand::Bool( double chance )
 {
 	return Double() <= chance;
 }
+
+
+uint32_t Rand::UInt32( void )
+{
+	return RandomEngine::Next( State() ) >> 32;
+}
+
+
+uint64_t Rand::UInt64( void )
+{
+	return RandomEngine::Next( State() );
+}
+
+
+void Rand::Fill( uint32_t *into, size_t count )
+{
+	uint64_t *state = State();
+	for( size_t i = 0; i < count; i ++ )
+		into[ i ] = RandomEngine::Next( state ) >> 32;
+}
+
+
+void Rand::Fill( uint64_t *into, size_t count )
+{
+	RandomEngine::FillState( State(), into, count );
+}
+
+
+void Rand::FillBytes( void *into, size_t bytes )
+{
+	RandomEngine::FillStateBytes( State(), into, bytes );
+}
@@ -6,7 +6,9 @@
 
 #include "PlatformSpecific.h"
 
+#include <cstddef>
 #include <ctime>
+#include <stdint.h>
 
 
 namespace Rand
@@ -19,4 +21,10 @@ namespace Rand
 	double Double( double max );
 	double Double( double min, double max );
 	bool Bool( double chance = 0.5 );
+	
+	uint32_t UInt32( void );
+	uint64_t UInt64( void );
+	void Fill( uint32_t *into, size_t count );
+	void Fill( uint64_t *into, size_t count );
+	void FillBytes( void *into, size_t bytes );
 }
@@ -0,0 +1,167 @@
+/*
+ *  RandomEngine.cpp
+ */
+
+#include "RandomEngine.h"
+
+#include <cstring>
+
+
+RandomEngine::RandomEngine( uint64_t seed )
+{
+	Seed( seed );
+}
+
+
+RandomEngine::RandomEngine( const RandomEngine &other )
+{
+	memcpy( State, other.State, sizeof(State) );
+}
+
+
+RandomEngine::~RandomEngine()
+{
+}
+
+
+void RandomEngine::Seed( uint64_t seed )
+{
+	SeedState( State, seed );
+}
+
+
+void RandomEngine::Jump( void )
+{
+	JumpState( State );
+}
+
+
+uint32_t RandomEngine::UInt32( void )
+{
+	// The upper bits of xoshiro256** are the strongest.
+	return Next( State ) >> 32;
+}
+
+
+uint64_t RandomEngine::UInt64( void )
+{
+	return Next( State );
+}
+
+
+double RandomEngine::Double( void )
+{
+	return ToDouble( Next( State ) );
+}
+
+
+void RandomEngine::Fill( uint32_t *into, size_t count )
+{
+	// Each 64-bit result provides two 32-bit values.
+	size_t pairs = count / 2;
+	for( size_t i = 0; i < pairs; i ++ )
+	{
+		uint64_t bits = Next( State );
+		into[ i * 2     ] = bits >> 32;
+		into[ i * 2 + 1 ] = bits & 0xFFFFFFFF;
+	}
+	
+	if( count % 2 )
+		into[ count - 1 ] = Next( State ) >> 32;
+}
+
+
+void RandomEngine::Fill( uint64_t *into, size_t count )
+{
+	FillState( State, into, count );
+}
+
+
+void RandomEngine::FillBytes( void *into, size_t bytes )
+{
+	FillStateBytes( State, into, bytes );
+}
+
+
+RandomEngine &RandomEngine::operator = ( const RandomEngine &other )
+{
+	memcpy( State, other.State, sizeof(State) );
+	return *this;
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+void RandomEngine::SeedState( uint64_t *state, uint64_t seed )
+{
+	// Expand the seed with splitmix64, which never produces the invalid all-zero state.
+	for( int i = 0; i < 4; i ++ )
+	{
+		seed += 0x9E3779B97F4A7C15ULL;
+		uint64_t z = seed;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		state[ i ] = z ^ (z >> 31);
+	}
+}
+
+
+void RandomEngine::JumpState( uint64_t *state )
+{
+	// Advance by 2^128 steps, giving a non-overlapping stream (for example one per worker thread).
+	static const uint64_t jump[ 4 ] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+	uint64_t s[ 4 ] = { 0, 0, 0, 0 };
+	
+	for( int i = 0; i < 4; i ++ )
+	{
+		for( int b = 0; b < 64; b ++ )
+		{
+			if( jump[ i ] & (1ULL << b) )
+			{
+				s[ 0 ] ^= state[ 0 ];
+				s[ 1 ] ^= state[ 1 ];
+				s[ 2 ] ^= state[ 2 ];
+				s[ 3 ] ^= state[ 3 ];
+			}
+			Next( state );
+		}
+	}
+	
+	memcpy( state, s, sizeof(s) );
+}
+
+
+void RandomEngine::FillState( uint64_t *state, uint64_t *into, size_t count )
+{
+	// Work on a local copy so the compiler can keep the state in registers.
+	uint64_t s[ 4 ] = { state[ 0 ], state[ 1 ], state[ 2 ], state[ 3 ] };
+	
+	for( size_t i = 0; i < count; i ++ )
+		into[ i ] = Next( s );
+	
+	memcpy( state, s, sizeof(s) );
+}
+
+
+void RandomEngine::FillStateBytes( uint64_t *state, void *into, size_t bytes )
+{
+	uint8_t *dest = (uint8_t*) into;
+	uint64_t s[ 4 ] = { state[ 0 ], state[ 1 ], state[ 2 ], state[ 3 ] };
+	
+	while( bytes >= 8 )
+	{
+		uint64_t bits = Next( s );
+		memcpy( dest, &bits, 8 );
+		dest += 8;
+		bytes -= 8;
+	}
+	
+	if( bytes )
+	{
+		uint64_t bits = Next( s );
+		memcpy( dest, &bits, bytes );
+	}
+	
+	memcpy( state, s, sizeof(s) );
+}
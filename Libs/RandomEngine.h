@@ -0,0 +1,66 @@
+/*
+ *  RandomEngine.h
+ */
+
+#pragma once
+class RandomEngine;
+
+#include "PlatformSpecific.h"
+
+#include <cstddef>
+#include <stdint.h>
+
+
+// Seedable xoshiro256** generator.  Each instance has its own state, so it needs no locking and
+// produces the same sequence for the same seed on every platform (useful for deterministic replays).
+class RandomEngine
+{
+public:
+	uint64_t State[ 4 ];
+	
+	RandomEngine( uint64_t seed = 0 );
+	RandomEngine( const RandomEngine &other );
+	virtual ~RandomEngine();
+	
+	void Seed( uint64_t seed );
+	void Jump( void );
+	
+	uint32_t UInt32( void );
+	uint64_t UInt64( void );
+	double Double( void );
+	void Fill( uint32_t *into, size_t count );
+	void Fill( uint64_t *into, size_t count );
+	void FillBytes( void *into, size_t bytes );
+	
+	RandomEngine &operator = ( const RandomEngine &other );
+	
+	static void SeedState( uint64_t *state, uint64_t seed );
+	static void JumpState( uint64_t *state );
+	static void FillState( uint64_t *state, uint64_t *into, size_t count );
+	static void FillStateBytes( uint64_t *state, void *into, size_t bytes );
+	
+	static inline uint64_t Next( uint64_t *state )
+	{
+		uint64_t result = Rotate( state[ 1 ] * 5, 7 ) * 9;
+		uint64_t t = state[ 1 ] << 17;
+		state[ 2 ] ^= state[ 0 ];
+		state[ 3 ] ^= state[ 1 ];
+		state[ 1 ] ^= state[ 2 ];
+		state[ 0 ] ^= state[ 3 ];
+		state[ 2 ] ^= t;
+		state[ 3 ] = Rotate( state[ 3 ], 45 );
+		return result;
+	}
+	
+	static inline double ToDouble( uint64_t bits )
+	{
+		// Use the top 53 bits for a double in the inclusive range [0,1].
+		return (bits >> 11) * (1. / 9007199254740991.);
+	}
+
+private:
+	static inline uint64_t Rotate( uint64_t x, int k )
+	{
+		return (x << k) | (x >> (64 - k));
+	}
+};
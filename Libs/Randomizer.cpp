@@ -4,9 +4,6 @@
 
 #include "Randomizer.h"
 
-#include <cmath>
-#include "Num.h"
-
 
 Randomizer::Randomizer( unsigned int seed )
 {
@@ -16,7 +13,7 @@ Randomizer::Randomizer( unsigned int seed )
 
 Randomizer::Randomizer( const Randomizer &other )
 {
-	Internal = other.Internal;
+	Engine = other.Engine;
 }
 
 
@@ -27,28 +24,26 @@ Randomizer::~Randomizer()
 
 void Randomizer::Seed( unsigned int seed )
 {
-	Internal = seed;
+	Engine.Seed( seed );
 }
 
 
 int Randomizer::Int( void )
 {
-	double next = 1.49 + cos( Internal );
-	Internal = (fabs( next - Internal ) < 0.1) ? (next + 1.51) : next;
-	uint32_t mantissa = Num::Mantissa32( Internal );
-	return (mantissa >> 9) & Max;
+	return (Engine.UInt64() >> 33) & Max;
 }
 
 
 int Randomizer::Int( int min, int max )
 {
-	return Int() % (1 + max - min) + min;
+	uint32_t range = 1 + max - min;
+	return (int)( (((uint64_t) Engine.UInt32()) * range) >> 32 ) + min;
 }
 
 
 double Randomizer::Double( void )
 {
-	return Int() / (double) Max;
+	return Engine.Double();
 }
 
 
@@ -8,13 +8,14 @@ class Randomizer;
 #include "PlatformSpecific.h"
 
 #include <ctime>
+#include "RandomEngine.h"
 
 
 class Randomizer
 {
 public:
-	double Internal;
-	const static int Max = 0x7fff;
+	RandomEngine Engine;
+	const static int Max = 0x7fffffff;
 	
 	Randomizer( unsigned int seed = time(NULL) );
 	Randomizer( const Randomizer &other );
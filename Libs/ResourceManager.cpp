@@ -285,6 +285,12 @@ void ResourceManager::ReloadGraphics( void )
 		}
 	}
 	
+	for( std::map<std::string, Model*>::iterator iter = Models.begin(); iter != Models.end(); iter ++ )
+	{
+		if( iter->second )
+			iter->second->ReloadBuffers();
+	}
+	
 	Lock.Unlock();
 }
 
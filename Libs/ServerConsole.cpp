@@ -6,7 +6,15 @@
 #include "ServerConsole.h"
 
 #include <iostream>
-#include "RaptorGame.h"
+#include <cstring>
+#include <vector>
+#include <list>
+#include "Str.h"
+#ifdef NO_CLIENT
+	#include "RaptorServer.h"
+#else
+	#include "RaptorGame.h"
+#endif
 
 
 ServerConsole::~ServerConsole()
@@ -26,7 +34,22 @@ void ServerConsole::Run( void )
 		if( strcmp( input, "quit" ) == 0 )
 			running = false;
 		else if( strlen(input) )
-			// FIXME
+		{
+#ifdef NO_CLIENT
+			// Without a client config, commands go straight to the server (an "sv" prefix is optional).
+			std::list<std::string> parsed = Str::ParseCommand( input );
+			std::vector<std::string> elements( parsed.begin(), parsed.end() );
+			while( elements.size() && Str::EqualsInsensitive( elements.front(), "sv" ) )
+				elements.erase( elements.begin() );
+			if( elements.size() && Raptor::Server )
+			{
+				std::string cmd = Str::LowercaseCopy( elements.front() );
+				elements.erase( elements.begin() );
+				Raptor::Server->Command( cmd, elements.size() ? &elements : NULL );
+			}
+#else
 			Raptor::Game->Cfg.Command( std::string("sv ") + input );
+#endif
+		}
 	}
 }
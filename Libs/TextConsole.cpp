@@ -5,22 +5,101 @@
 #include "TextConsole.h"
 
 #include <cstddef>
+#include "Atomic.h"
+#include "Num.h"
+
+
+std::vector<TextConsole*> TextConsole::WriterConsoles;
+SDL_mutex *TextConsole::WriterLock = NULL;
+SDL_Thread *TextConsole::WriterThread = NULL;
+volatile bool TextConsole::WriterRunning = false;
 
 
 TextConsole::TextConsole( void )
 {
 	OutFile = NULL;
+	MaxMessages = 2000;
+	RepeatWindow = 1.;
+	Dropped = 0;
+	
+	RepeatType = MSG_NORMAL;
+	RepeatCount = 0;
+	
+	// Each ring slot's sequence tells producers and the writer whether it is free or filled.
+	for( int32_t i = 0; i < TEXTCONSOLE_QUEUE_SIZE; i ++ )
+		Queue[ i ].Sequence = i;
+	QueueIn = 0;
+	QueueOut = 0;
 	
 	Lock = SDL_CreateMutex();
+	DrainLock = SDL_CreateMutex();
+	
+	// Register with the shared writer thread, starting it for the first console.
+	// If it can't be started, Print handles file output synchronously.
+	if( ! WriterLock )
+		WriterLock = SDL_CreateMutex();
+	if( WriterLock )
+	{
+		SDL_mutexP( WriterLock );
+		
+		WriterConsoles.push_back( this );
+		
+		if( ! WriterThread )
+		{
+			WriterRunning = true;
+			#if SDL_VERSION_ATLEAST(2,0,0)
+				WriterThread = SDL_CreateThread( TextConsoleWriterThread, "TextConsole", NULL );
+			#else
+				WriterThread = SDL_CreateThread( TextConsoleWriterThread, NULL );
+			#endif
+			if( ! WriterThread )
+				WriterRunning = false;
+		}
+		
+		SDL_mutexV( WriterLock );
+	}
 }
 
 
 TextConsole::~TextConsole()
 {
+	SDL_Thread *stop_thread = NULL;
+	
+	// Once unregistered, the writer thread can no longer be draining this console.
+	if( WriterLock )
+	{
+		SDL_mutexP( WriterLock );
+		
+		for( std::vector<TextConsole*>::iterator console_iter = WriterConsoles.begin(); console_iter != WriterConsoles.end(); console_iter ++ )
+		{
+			if( *console_iter == this )
+			{
+				WriterConsoles.erase( console_iter );
+				break;
+			}
+		}
+		
+		if( WriterConsoles.empty() && WriterThread )
+		{
+			WriterRunning = false;
+			stop_thread = WriterThread;
+			WriterThread = NULL;
+		}
+		
+		SDL_mutexV( WriterLock );
+	}
+	
+	if( stop_thread )
+		SDL_WaitThread( stop_thread, NULL );
+	
+	// Write out anything still queued.
+	Flush();
+	Clear();
+	
+	SDL_DestroyMutex( DrainLock );
+	DrainLock = NULL;
 	SDL_DestroyMutex( Lock );
 	Lock = NULL;
-
-	Clear();
 }
 
 
@@ -32,31 +111,192 @@ void TextConsole::Print( std::string text, uint32_t type )
 			fprintf( stderr, "TextConsole::Print: SDL_mutexP(Lock): %s\n", SDL_GetError() );
 	}
 	
-	if( OutFile )
+	// Messages is updated right away; only file output is deferred to the writer thread.
+	Messages.push_back( new TextConsoleMessage( text, type ) );
+	
+	// Forget the oldest messages beyond the retention cap.
+	while( MaxMessages && (Messages.size() > MaxMessages) )
 	{
-		const char *cstr = text.c_str();
-		fwrite( cstr, 1, strlen(cstr), OutFile );
-		fprintf( OutFile, "\n" );
-		fflush( OutFile );
+		delete Messages.front();
+		Messages.pop_front();
 	}
 	
-	Messages.push_back( new TextConsoleMessage( text, type ) );
-	
 	if( Lock )
 	{
 		if( SDL_mutexV( Lock ) )
 			fprintf( stderr, "TextConsole::Print: SDL_mutexV(Lock): %s\n", SDL_GetError() );
 	}
+	
+	if( ! OutFile )
+		return;
+	
+	// Claim a ring slot without locking, so network and server threads never wait on file I/O.
+	int32_t pos = Atomic::Load( &QueueIn );
+	for(;;)
+	{
+		QueuedMessage *slot = &(Queue[ pos & (TEXTCONSOLE_QUEUE_SIZE - 1) ]);
+		int32_t diff = (int32_t)( (uint32_t) Atomic::Load( &(slot->Sequence) ) - (uint32_t) pos );
+		
+		if( diff == 0 )
+		{
+			int32_t next = (int32_t)( (uint32_t) pos + 1 );
+			if( Atomic::CompareAndSwap( &QueueIn, pos, next ) )
+			{
+				slot->Text = text;
+				slot->Type = type;
+				Atomic::Store( &(slot->Sequence), next );
+				break;
+			}
+		}
+		else if( diff < 0 )
+		{
+			// The ring is full; count the loss instead of blocking the caller.
+			Atomic::Add( &Dropped, 1 );
+			break;
+		}
+		
+		pos = Atomic::Load( &QueueIn );
+	}
+	
+	if( ! WriterRunning )
+		Flush();
+}
+
+
+void TextConsole::Flush( void )
+{
+	if( DrainLock )
+	{
+		if( SDL_mutexP( DrainLock ) )
+			fprintf( stderr, "TextConsole::Flush: SDL_mutexP(DrainLock): %s\n", SDL_GetError() );
+	}
+	
+	Drain();
+	
+	if( DrainLock )
+	{
+		if( SDL_mutexV( DrainLock ) )
+			fprintf( stderr, "TextConsole::Flush: SDL_mutexV(DrainLock): %s\n", SDL_GetError() );
+	}
 }
 
 
 void TextConsole::Clear( void )
 {
+	if( Lock )
+		SDL_mutexP( Lock );
+	
 	while( Messages.size() )
 	{
 		delete Messages.front();
 		Messages.pop_front();
 	}
+	
+	if( Lock )
+		SDL_mutexV( Lock );
+}
+
+
+bool TextConsole::Drain( void )
+{
+	// NOTE: Only one thread may drain at a time (see Flush).
+	bool wrote = false;
+	
+	for(;;)
+	{
+		QueuedMessage *slot = &(Queue[ QueueOut & (TEXTCONSOLE_QUEUE_SIZE - 1) ]);
+		int32_t next = (int32_t)( (uint32_t) QueueOut + 1 );
+		if( Atomic::Load( &(slot->Sequence) ) != next )
+			break;
+		
+		std::string text;
+		text.swap( slot->Text );
+		uint32_t type = slot->Type;
+		
+		// Release the slot for reuse by producers one lap later.
+		Atomic::Store( &(slot->Sequence), (int32_t)( (uint32_t) QueueOut + TEXTCONSOLE_QUEUE_SIZE ) );
+		QueueOut = next;
+		wrote = true;
+		
+		// Collapse bursts of identical lines in the log file into a single repeat count.
+		if( RepeatWindow && (type == RepeatType) && (text == RepeatText) && (RepeatClock.ElapsedSeconds() < RepeatWindow) )
+		{
+			RepeatCount ++;
+			continue;
+		}
+		
+		WriteRepeats();
+		Write( text );
+		RepeatText = text;
+		RepeatType = type;
+		RepeatClock.Reset();
+	}
+	
+	if( RepeatCount && (RepeatClock.ElapsedSeconds() >= RepeatWindow) )
+	{
+		WriteRepeats();
+		wrote = true;
+	}
+	
+	int32_t dropped = Atomic::Load( &Dropped );
+	if( dropped )
+	{
+		Atomic::Add( &Dropped, -dropped );
+		Write( std::string("(") + Num::ToString(dropped) + std::string(" console messages dropped)") );
+		wrote = true;
+	}
+	
+	// Flush the file once per batch rather than once per line.
+	if( wrote && OutFile )
+		fflush( OutFile );
+	
+	return wrote;
+}
+
+
+void TextConsole::Write( const std::string &text )
+{
+	if( OutFile )
+	{
+		fwrite( text.c_str(), 1, text.length(), OutFile );
+		fputc( '\n', OutFile );
+	}
+}
+
+
+void TextConsole::WriteRepeats( void )
+{
+	if( ! RepeatCount )
+		return;
+	
+	if( RepeatCount == 1 )
+		Write( RepeatText );
+	else
+		Write( std::string("(previous message repeated ") + Num::ToString(RepeatCount) + std::string(" times)") );
+	
+	RepeatCount = 0;
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+int TextConsole::TextConsoleWriterThread( void *unused )
+{
+	while( WriterRunning )
+	{
+		SDL_mutexP( WriterLock );
+		
+		for( std::vector<TextConsole*>::iterator console_iter = WriterConsoles.begin(); console_iter != WriterConsoles.end(); console_iter ++ )
+			(*console_iter)->Flush();
+		
+		SDL_mutexV( WriterLock );
+		
+		// Let the thread rest a bit; messages queued meanwhile are written as one batch.
+		SDL_Delay( 10 );
+	}
+	
+	return 0;
 }
 
 
@@ -10,11 +10,14 @@ class TextConsoleMessage;
 
 #include <stdint.h>
 #include <deque>
+#include <vector>
 #include "Layer.h"
 #include "Clock.h"
 #include "Font.h"
 #include "TextBox.h"
 
+#define TEXTCONSOLE_QUEUE_SIZE 1024
+
 
 class TextConsole
 {
@@ -22,11 +25,15 @@ public:
 	std::deque<TextConsoleMessage*> Messages;
 	SDL_mutex *Lock;
 	FILE *OutFile;
+	size_t MaxMessages;
+	double RepeatWindow;
+	volatile int32_t Dropped;
 	
 	TextConsole( void );
 	virtual ~TextConsole();
 	
 	virtual void Print( std::string text, uint32_t type = MSG_NORMAL );
+	void Flush( void );
 	void Clear( void );
 	
 	enum
@@ -37,6 +44,36 @@ public:
 		MSG_CHAT = 'Chat',
 		MSG_TEAM = 'Team'
 	};
+	
+	static int TextConsoleWriterThread( void *unused );
+
+private:
+	struct QueuedMessage
+	{
+		volatile int32_t Sequence;
+		std::string Text;
+		uint32_t Type;
+	};
+	
+	QueuedMessage Queue[ TEXTCONSOLE_QUEUE_SIZE ];
+	volatile int32_t QueueIn;
+	int32_t QueueOut;
+	SDL_mutex *DrainLock;
+	
+	std::string RepeatText;
+	uint32_t RepeatType;
+	int RepeatCount;
+	Clock RepeatClock;
+	
+	bool Drain( void );
+	void Write( const std::string &text );
+	void WriteRepeats( void );
+	
+	// One writer thread is shared by every console.
+	static std::vector<TextConsole*> WriterConsoles;
+	static SDL_mutex *WriterLock;
+	static SDL_Thread *WriterThread;
+	static volatile bool WriterRunning;
 };
 
 
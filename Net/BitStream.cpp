@@ -0,0 +1,363 @@
+/*
+ *  BitStream.cpp
+ */
+
+#include "BitStream.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+
+// Smallest-three quaternion components are within +/- 1/sqrt(2).
+#define BITSTREAM_QUAT_RANGE 0.70710678118654752
+
+
+static inline uint32_t BitMask( int bits )
+{
+	return (bits >= 32) ? 0xFFFFFFFF : ((1U << bits) - 1);
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+BitWriter::BitWriter( uint8_t *buffer, size_t bytes )
+{
+	Buffer = buffer;
+	Capacity = buffer ? bytes : 0;
+	BitPos = 0;
+	Overflow = false;
+	Target = NULL;
+	Scratch = 0;
+	ScratchBits = 0;
+	ByteIndex = 0;
+	Finished = false;
+}
+
+
+BitWriter::BitWriter( Packet *packet, size_t max_bytes )
+{
+	Buffer = NULL;
+	Capacity = 0;
+	BitPos = 0;
+	Overflow = false;
+	Target = packet;
+	Scratch = 0;
+	ScratchBits = 0;
+	ByteIndex = 0;
+	Finished = false;
+	
+	// Reserve everything up front so individual writes never touch the packet header.
+	if( packet->MakeRoom( max_bytes ) )
+	{
+		Buffer = packet->Data + packet->Size();
+		Capacity = max_bytes;
+	}
+}
+
+
+BitWriter::~BitWriter()
+{
+	Finish();
+}
+
+
+void BitWriter::WriteBits( uint32_t value, int bits )
+{
+	if( bits <= 0 )
+		return;
+	if( BitPos + bits > Capacity * 8 )
+	{
+		Overflow = true;
+		return;
+	}
+	
+	Scratch = (Scratch << bits) | (value & BitMask( bits ));
+	ScratchBits += bits;
+	BitPos += bits;
+	
+	while( ScratchBits >= 8 )
+	{
+		ScratchBits -= 8;
+		Buffer[ ByteIndex ++ ] = (uint8_t)( Scratch >> ScratchBits );
+	}
+}
+
+
+void BitWriter::WriteBool( bool value )
+{
+	WriteBits( value ? 1 : 0, 1 );
+}
+
+
+void BitWriter::WriteFloat( float value )
+{
+	uint32_t bits = 0;
+	memcpy( &bits, &value, 4 );
+	WriteBits( bits, 32 );
+}
+
+
+void BitWriter::WriteDouble( double value )
+{
+	uint64_t bits = 0;
+	memcpy( &bits, &value, 8 );
+	WriteBits( (uint32_t)( bits >> 32 ), 32 );
+	WriteBits( (uint32_t)( bits ), 32 );
+}
+
+
+void BitWriter::WriteRanged( double value, double min, double max, int bits )
+{
+	double unit = (max > min) ? (value - min) / (max - min) : 0.;
+	unit = std::max<double>( 0., std::min<double>( 1., unit ) );
+	WriteBits( (uint32_t)( unit * BitMask( bits ) + 0.5 ), bits );
+}
+
+
+void BitWriter::WriteUnitVector( const Vec3D *vec, int bits )
+{
+	// Octahedral mapping: two components of bits each, nearly uniform error over the sphere.
+	double sum = fabs(vec->X) + fabs(vec->Y) + fabs(vec->Z);
+	double x = sum ? (vec->X / sum) : 0.;
+	double y = sum ? (vec->Y / sum) : 0.;
+	if( vec->Z < 0. )
+	{
+		double fold_x = (1. - fabs(y)) * ((x >= 0.) ? 1. : -1.);
+		double fold_y = (1. - fabs(x)) * ((y >= 0.) ? 1. : -1.);
+		x = fold_x;
+		y = fold_y;
+	}
+	
+	WriteRanged( x, -1., 1., bits );
+	WriteRanged( y, -1., 1., bits );
+}
+
+
+void BitWriter::WriteOrientation( const Vec3D *fwd, const Vec3D *up, int bits )
+{
+	// Rotation matrix columns are Fwd, Up, and Fwd x Up; convert to a quaternion (w,x,y,z).
+	Vec3D third = fwd->Cross( *up );
+	double m[ 3 ][ 3 ] = { { fwd->X, up->X, third.X }, { fwd->Y, up->Y, third.Y }, { fwd->Z, up->Z, third.Z } };
+	double q[ 4 ] = { 1., 0., 0., 0. };
+	
+	double trace = m[ 0 ][ 0 ] + m[ 1 ][ 1 ] + m[ 2 ][ 2 ];
+	if( trace > 0. )
+	{
+		double s = 0.5 / sqrt( trace + 1. );
+		q[ 0 ] = 0.25 / s;
+		q[ 1 ] = (m[ 2 ][ 1 ] - m[ 1 ][ 2 ]) * s;
+		q[ 2 ] = (m[ 0 ][ 2 ] - m[ 2 ][ 0 ]) * s;
+		q[ 3 ] = (m[ 1 ][ 0 ] - m[ 0 ][ 1 ]) * s;
+	}
+	else if( (m[ 0 ][ 0 ] > m[ 1 ][ 1 ]) && (m[ 0 ][ 0 ] > m[ 2 ][ 2 ]) )
+	{
+		double s = 2. * sqrt( std::max<double>( 0., 1. + m[ 0 ][ 0 ] - m[ 1 ][ 1 ] - m[ 2 ][ 2 ] ) );
+		q[ 0 ] = (m[ 2 ][ 1 ] - m[ 1 ][ 2 ]) / s;
+		q[ 1 ] = 0.25 * s;
+		q[ 2 ] = (m[ 0 ][ 1 ] + m[ 1 ][ 0 ]) / s;
+		q[ 3 ] = (m[ 0 ][ 2 ] + m[ 2 ][ 0 ]) / s;
+	}
+	else if( m[ 1 ][ 1 ] > m[ 2 ][ 2 ] )
+	{
+		double s = 2. * sqrt( std::max<double>( 0., 1. + m[ 1 ][ 1 ] - m[ 0 ][ 0 ] - m[ 2 ][ 2 ] ) );
+		q[ 0 ] = (m[ 0 ][ 2 ] - m[ 2 ][ 0 ]) / s;
+		q[ 1 ] = (m[ 0 ][ 1 ] + m[ 1 ][ 0 ]) / s;
+		q[ 2 ] = 0.25 * s;
+		q[ 3 ] = (m[ 1 ][ 2 ] + m[ 2 ][ 1 ]) / s;
+	}
+	else
+	{
+		double s = 2. * sqrt( std::max<double>( 0., 1. + m[ 2 ][ 2 ] - m[ 0 ][ 0 ] - m[ 1 ][ 1 ] ) );
+		q[ 0 ] = (m[ 1 ][ 0 ] - m[ 0 ][ 1 ]) / s;
+		q[ 1 ] = (m[ 0 ][ 2 ] + m[ 2 ][ 0 ]) / s;
+		q[ 2 ] = (m[ 1 ][ 2 ] + m[ 2 ][ 1 ]) / s;
+		q[ 3 ] = 0.25 * s;
+	}
+	
+	// Smallest three: send the index of the largest component, then the other three.
+	int largest = 0;
+	for( int i = 1; i < 4; i ++ )
+	{
+		if( fabs(q[ i ]) > fabs(q[ largest ]) )
+			largest = i;
+	}
+	double sign = (q[ largest ] < 0.) ? -1. : 1.;
+	
+	WriteBits( largest, 2 );
+	for( int i = 0; i < 4; i ++ )
+	{
+		if( i != largest )
+			WriteRanged( q[ i ] * sign, -BITSTREAM_QUAT_RANGE, BITSTREAM_QUAT_RANGE, bits );
+	}
+}
+
+
+size_t BitWriter::Bytes( void ) const
+{
+	return (BitPos + 7) / 8;
+}
+
+
+void BitWriter::Finish( void )
+{
+	if( Finished )
+		return;
+	Finished = true;
+	
+	// Flush the partial byte, zero-padded.
+	if( ScratchBits )
+	{
+		Buffer[ ByteIndex ++ ] = (uint8_t)( Scratch << (8 - ScratchBits) );
+		ScratchBits = 0;
+	}
+	
+	if( Target && Buffer )
+		Target->SetSize( Target->Size() + ByteIndex );
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+BitReader::BitReader( const uint8_t *buffer, size_t bytes )
+{
+	Buffer = buffer;
+	Capacity = buffer ? bytes : 0;
+	BitPos = 0;
+	Overflow = false;
+	Source = NULL;
+	Finished = false;
+}
+
+
+BitReader::BitReader( Packet *packet )
+{
+	Buffer = packet->Data + packet->Offset;
+	Capacity = std::max<int>( 0, packet->Remaining() );
+	BitPos = 0;
+	Overflow = false;
+	Source = packet;
+	Finished = false;
+}
+
+
+BitReader::~BitReader()
+{
+	Finish();
+}
+
+
+uint32_t BitReader::ReadBits( int bits )
+{
+	if( bits <= 0 )
+		return 0;
+	if( BitPos + bits > Capacity * 8 )
+	{
+		Overflow = true;
+		BitPos = Capacity * 8;
+		if( Source && Source->ThrowExceptions )
+			throw PacketSmall();
+		return 0;
+	}
+	
+	uint32_t value = 0;
+	while( bits )
+	{
+		int available = 8 - (int)( BitPos & 7 );
+		int take = std::min<int>( available, bits );
+		uint32_t chunk = (Buffer[ BitPos >> 3 ] >> (available - take)) & BitMask( take );
+		value = (value << take) | chunk;
+		bits -= take;
+		BitPos += take;
+	}
+	return value;
+}
+
+
+bool BitReader::ReadBool( void )
+{
+	return ReadBits( 1 );
+}
+
+
+float BitReader::ReadFloat( void )
+{
+	uint32_t bits = ReadBits( 32 );
+	float value = 0.f;
+	memcpy( &value, &bits, 4 );
+	return value;
+}
+
+
+double BitReader::ReadDouble( void )
+{
+	uint64_t bits = ReadBits( 32 );
+	bits = (bits << 32) | ReadBits( 32 );
+	double value = 0.;
+	memcpy( &value, &bits, 8 );
+	return value;
+}
+
+
+double BitReader::ReadRanged( double min, double max, int bits )
+{
+	uint32_t steps = BitMask( bits );
+	return steps ? (min + (max - min) * ReadBits( bits ) / (double) steps) : min;
+}
+
+
+void BitReader::ReadUnitVector( Vec3D *vec, int bits )
+{
+	double x = ReadRanged( -1., 1., bits );
+	double y = ReadRanged( -1., 1., bits );
+	double z = 1. - fabs(x) - fabs(y);
+	if( z < 0. )
+	{
+		double unfold_x = (1. - fabs(y)) * ((x >= 0.) ? 1. : -1.);
+		double unfold_y = (1. - fabs(x)) * ((y >= 0.) ? 1. : -1.);
+		x = unfold_x;
+		y = unfold_y;
+	}
+	
+	vec->Set( x, y, z );
+	vec->ScaleTo( 1. );
+}
+
+
+void BitReader::ReadOrientation( Vec3D *fwd, Vec3D *up, int bits )
+{
+	int largest = ReadBits( 2 );
+	double q[ 4 ] = { 0., 0., 0., 0. };
+	double sum = 0.;
+	for( int i = 0; i < 4; i ++ )
+	{
+		if( i == largest )
+			continue;
+		q[ i ] = ReadRanged( -BITSTREAM_QUAT_RANGE, BITSTREAM_QUAT_RANGE, bits );
+		sum += q[ i ] * q[ i ];
+	}
+	q[ largest ] = sqrt( std::max<double>( 0., 1. - sum ) );
+	
+	double w = q[ 0 ], x = q[ 1 ], y = q[ 2 ], z = q[ 3 ];
+	fwd->Set( 1. - 2. * (y*y + z*z), 2. * (x*y + w*z), 2. * (x*z - w*y) );
+	up->Set( 2. * (x*y - w*z), 1. - 2. * (x*x + z*z), 2. * (y*z + w*x) );
+}
+
+
+size_t BitReader::Bytes( void ) const
+{
+	return (BitPos + 7) / 8;
+}
+
+
+void BitReader::Finish( void )
+{
+	if( Finished )
+		return;
+	Finished = true;
+	
+	if( Source )
+		Source->Offset += Bytes();
+}
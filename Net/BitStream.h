@@ -0,0 +1,78 @@
+/*
+ *  BitStream.h
+ */
+
+#pragma once
+class BitWriter;
+class BitReader;
+
+#include "PlatformSpecific.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include "Packet.h"
+#include "Vec.h"
+
+
+// Bit-level serialization over a pre-sized buffer, most significant bit first.
+// When attached to a Packet, room is reserved once and the packet size is written once by Finish.
+
+class BitWriter
+{
+public:
+	uint8_t *Buffer;
+	size_t Capacity;
+	size_t BitPos;
+	bool Overflow;
+	
+	BitWriter( uint8_t *buffer, size_t bytes );
+	BitWriter( Packet *packet, size_t max_bytes );
+	~BitWriter();
+	
+	void WriteBits( uint32_t value, int bits );
+	void WriteBool( bool value );
+	void WriteFloat( float value );
+	void WriteDouble( double value );
+	void WriteRanged( double value, double min, double max, int bits );
+	void WriteUnitVector( const Vec3D *vec, int bits );
+	void WriteOrientation( const Vec3D *fwd, const Vec3D *up, int bits );
+	
+	size_t Bytes( void ) const;
+	void Finish( void );
+
+private:
+	Packet *Target;
+	uint64_t Scratch;
+	int ScratchBits;
+	size_t ByteIndex;
+	bool Finished;
+};
+
+
+class BitReader
+{
+public:
+	const uint8_t *Buffer;
+	size_t Capacity;
+	size_t BitPos;
+	bool Overflow;
+	
+	BitReader( const uint8_t *buffer, size_t bytes );
+	BitReader( Packet *packet );
+	~BitReader();
+	
+	uint32_t ReadBits( int bits );
+	bool ReadBool( void );
+	float ReadFloat( void );
+	double ReadDouble( void );
+	double ReadRanged( double min, double max, int bits );
+	void ReadUnitVector( Vec3D *vec, int bits );
+	void ReadOrientation( Vec3D *fwd, Vec3D *up, int bits );
+	
+	size_t Bytes( void ) const;
+	void Finish( void );
+
+private:
+	Packet *Source;
+	bool Finished;
+};
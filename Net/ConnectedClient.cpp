@@ -4,6 +4,7 @@
 
 #include "ConnectedClient.h"
 
+#include <cstdio>
 #include <cmath>
 #include "RaptorDefs.h"
 #include "RaptorServer.h"
@@ -11,9 +12,11 @@
 #include "Rand.h"
 #include "Num.h"
 #include "RaptorServer.h"
+#include "Profiler.h"
+#include "NetReactor.h"
 
 
-ConnectedClient::ConnectedClient( TCPsocket socket, double net_rate, int8_t precision )
+ConnectedClient::ConnectedClient( TCPsocket socket, double net_rate, int8_t precision, RaptorServer *server, NetReactor *reactor )
 {
 	Connected = false;
 	
@@ -26,6 +29,7 @@ ConnectedClient::ConnectedClient( TCPsocket socket, double net_rate, int8_t prec
 	Precision = precision;
 	BytesSent = 0;
 	BytesReceived = 0;
+	CompressThreshold = 0;
 	InThread = NULL;
 	OutThread = NULL;
 	CleanupThread = NULL;
@@ -33,18 +37,28 @@ ConnectedClient::ConnectedClient( TCPsocket socket, double net_rate, int8_t prec
 	PlayerID = 0;
 	DropPlayerID = 0;
 	
+	Server = server ? server : Raptor::Server;
+	Reactor = reactor;
+	ReceiveBuffer = new PacketBuffer();
+	ReceiveBuffer->MaxPacketSize = 0x0007FFFF;
+	ReceiveBuffer->DecompressStats = &DecompressStats;
+	
 	Connected = true;
 	
-	// Start the listener thread.
-	#if SDL_VERSION_ATLEAST(2,0,0)
-		InThread = SDL_CreateThread( ConnectedClientInThread, "ConnectedClientIn", this );
-	#else
-		InThread = SDL_CreateThread( ConnectedClientInThread, this );
-	#endif
-	if( ! InThread )
+	// The reactor does the reading for its clients, but each still sends from its own thread.
+	if( ! Reactor )
 	{
-		fprintf( stderr, "ConnectedClient::ConnectedClient: SDL_CreateThread(ConnectedClientInThread): %s\n", SDLNet_GetError() );
-		Connected = false;
+		// Start the listener thread.
+		#if SDL_VERSION_ATLEAST(2,0,0)
+			InThread = SDL_CreateThread( ConnectedClientInThread, "ConnectedClientIn", this );
+		#else
+			InThread = SDL_CreateThread( ConnectedClientInThread, this );
+		#endif
+		if( ! InThread )
+		{
+			fprintf( stderr, "ConnectedClient::ConnectedClient: SDL_CreateThread(ConnectedClientInThread): %s\n", SDLNet_GetError() );
+			Connected = false;
+		}
 	}
 	
 	// Start the sender thread.
@@ -71,8 +85,11 @@ ConnectedClient::~ConnectedClient()
 	{
 		Packet *packet = OutBuffer.front();
 		OutBuffer.pop();
-		delete packet;
+		Packet::Release( packet );
 	}
+	
+	delete ReceiveBuffer;
+	ReceiveBuffer = NULL;
 }
 
 
@@ -130,9 +147,9 @@ void ConnectedClient::Disconnect( void )
 	{
 		char cstr[ 1024 ] = "";
 		snprintf( cstr, 1024, "Client dropped: %i.%i.%i.%i:%i", (IP & 0xFF000000) >> 24, (IP & 0x00FF0000) >> 16, (IP & 0x0000FF00) >> 8, IP & 0x000000FF, Port );
-		Raptor::Server->ConsolePrint( cstr );
+		Server->ConsolePrint( cstr );
 		
-		Raptor::Server->DroppedClient( this );
+		Server->DroppedClient( this );
 		
 		DropPlayerID = 0;
 	}
@@ -190,7 +207,7 @@ bool ConnectedClient::ProcessPacket( Packet *packet )
 	packet->Rewind();
 	PacketType type = packet->Type();
 	
-	if( Raptor::Server->ProcessPacket( packet, this ) )
+	if( Server->ProcessPacket( packet, this ) )
 		return true;
 	
 	else if( type == Raptor::Packet::PING )
@@ -223,13 +240,13 @@ bool ConnectedClient::ProcessPacket( Packet *packet )
 		
 		if( ! player_id )
 		{
-			Player *my_temp_player = Raptor::Server->Data.GetPlayer( PlayerID );
+			Player *my_temp_player = Server->Data.GetPlayer( PlayerID );
 			if( my_temp_player )
 			{
-				Raptor::Server->Data.Lock.Lock();
+				Server->Data.Lock.Lock();
 				
 				// The client doesn't know their old PlayerID.  Search by Name.
-				for( std::map<uint16_t,Player*>::const_iterator player_iter = Raptor::Server->Data.Players.begin(); player_iter != Raptor::Server->Data.Players.end(); player_iter ++ )
+				for( std::map<uint16_t,Player*>::const_iterator player_iter = Server->Data.Players.begin(); player_iter != Server->Data.Players.end(); player_iter ++ )
 				{
 					if( (player_iter->second != my_temp_player) && (player_iter->second->Name == my_temp_player->Name) )
 					{
@@ -238,21 +255,21 @@ bool ConnectedClient::ProcessPacket( Packet *packet )
 					}
 				}
 				
-				Raptor::Server->Data.Lock.Unlock();
+				Server->Data.Lock.Unlock();
 			}
 			// FIXME: If not found, could also search for clients with high PingClock.Elapsed and/or matching IP address.
 		}
 		
-		if( player_id && (player_id != PlayerID) && Raptor::Server->Data.GetPlayer(player_id) )
+		if( player_id && (player_id != PlayerID) && Server->Data.GetPlayer(player_id) )
 		{
 			DropPlayerID = PlayerID;
 			PlayerID = player_id;
 			
-			if( ! Raptor::Server->Net.Lock.Lock() )
-				fprintf( stderr, "ConnectedClient::ProcessPacket: Raptor::Server->Net.Lock.Lock: %s\n", SDL_GetError() );
+			if( ! Server->Net.Lock.Lock() )
+				fprintf( stderr, "ConnectedClient::ProcessPacket: Server->Net.Lock.Lock: %s\n", SDL_GetError() );
 			
 			// Get rid of player's old client(s) that lost connection.
-			for( std::list<ConnectedClient*>::iterator client_iter = Raptor::Server->Net.Clients.begin(); client_iter != Raptor::Server->Net.Clients.end(); client_iter ++ )
+			for( std::list<ConnectedClient*>::iterator client_iter = Server->Net.Clients.begin(); client_iter != Server->Net.Clients.end(); client_iter ++ )
 			{
 				if( (*client_iter != this) && ((*client_iter)->PlayerID == player_id) )
 				{
@@ -261,14 +278,14 @@ bool ConnectedClient::ProcessPacket( Packet *packet )
 					(*client_iter)->Disconnect();
 				}
 			}
-			for( std::list<ConnectedClient*>::iterator client_iter = Raptor::Server->Net.DisconnectedClients.begin(); client_iter != Raptor::Server->Net.DisconnectedClients.end(); client_iter ++ )
+			for( std::list<ConnectedClient*>::iterator client_iter = Server->Net.DisconnectedClients.begin(); client_iter != Server->Net.DisconnectedClients.end(); client_iter ++ )
 			{
 				if( (*client_iter)->DropPlayerID == player_id )
 					(*client_iter)->DropPlayerID = 0;
 			}
 			
-			if( ! Raptor::Server->Net.Lock.Unlock() )
-				fprintf( stderr, "ConnectedClient::ProcessPacket: Raptor::Server->Net.Lock.Unlock: %s\n", SDL_GetError() );
+			if( ! Server->Net.Lock.Unlock() )
+				fprintf( stderr, "ConnectedClient::ProcessPacket: Server->Net.Lock.Unlock: %s\n", SDL_GetError() );
 			
 			// Give old PlayerID to new client.
 			Packet login( Raptor::Packet::LOGIN );
@@ -277,10 +294,10 @@ bool ConnectedClient::ProcessPacket( Packet *packet )
 			Send( &login );
 			
 			// Get rid of the temporary player.
-			Raptor::Server->Data.RemovePlayer( DropPlayerID );
+			Server->Data.RemovePlayer( DropPlayerID );
 			Packet player_remove( Raptor::Packet::PLAYER_REMOVE );
 			player_remove.AddUShort( DropPlayerID );
-			Raptor::Server->Net.SendAll( &player_remove );
+			Server->Net.SendAll( &player_remove );
 			DropPlayerID = 0;
 		}
 	}
@@ -297,14 +314,25 @@ bool ConnectedClient::ProcessPacket( Packet *packet )
 		std::string version = packet->NextString();
 		std::string name = packet->NextString();
 		std::string password = packet->NextString();
+		uint8_t compression = packet->Remaining() ? packet->NextUChar() : 0;
+		uint8_t protocol = packet->Remaining() ? packet->NextUChar() : 1;
+		
+		// Only compress for clients that asked for it; older clients don't send this field.
+		CompressThreshold = (compression & Raptor::Compression::LZ) ? Server->Net.CompressThreshold : 0;
 		
-		if( game == Raptor::Server->Game )
+		if( game == Server->Game )
 		{
 			Version = version;
-			if( Raptor::Server->CompatibleVersion( Version ) )
+			if( protocol != Raptor::Protocol::VERSION )
+			{
+				char cstr[ 128 ] = "";
+				snprintf( cstr, sizeof(cstr), "Network protocol %i is not compatible with server protocol %i.", protocol, Raptor::Protocol::VERSION );
+				DisconnectNice( cstr );
+			}
+			else if( Server->CompatibleVersion( Version ) )
 				Login( name, password );
 			else
-				DisconnectNice( (std::string("Version ") + Version + std::string(" is not compatible with server version ") + Raptor::Server->Version + std::string(".")).c_str() );
+				DisconnectNice( (std::string("Version ") + Version + std::string(" is not compatible with server version ") + Server->Version + std::string(".")).c_str() );
 		}
 		else
 			DisconnectNice( "Wrong game or application." );
@@ -335,27 +363,27 @@ void ConnectedClient::Login( std::string name, std::string password )
 {
 	PlayerID = 0;
 	
-	bool valid_login = Raptor::Server->ValidateLogin( name, password );
+	bool valid_login = Server->ValidateLogin( name, password );
 	if( valid_login )
 	{
 		Player *player = new Player();
-		PlayerID = Raptor::Server->Data.AddPlayer( player );
+		PlayerID = Server->Data.AddPlayer( player );
 		if( ! PlayerID )
 			delete player;
 	}
 	
 	if( PlayerID )
 	{
-		Raptor::Server->Data.Lock.Lock();
-		Raptor::Server->Data.Players[ PlayerID ]->Name = name;
-		Raptor::Server->Data.Players[ PlayerID ]->Properties[ "version" ] = Version;
-		Raptor::Server->Data.Lock.Unlock();
+		Server->Data.Lock.Lock();
+		Server->Data.Players[ PlayerID ]->Name = name;
+		Server->Data.Players[ PlayerID ]->Properties[ "version" ] = Version;
+		Server->Data.Lock.Unlock();
 		
 		Packet accept( Raptor::Packet::LOGIN );
 		accept.AddUShort( PlayerID );
 		Send( &accept );
 		
-		Raptor::Server->AcceptedClient( this );
+		Server->AcceptedClient( this );
 	}
 	else
 		DisconnectNice( "Login failed." );
@@ -364,7 +392,7 @@ void ConnectedClient::Login( std::string name, std::string password )
 
 bool ConnectedClient::Send( Packet *packet )
 {
-	if( OutThread )
+	if( OutThread || Reactor )
 	{
 		SendToOutBuffer( packet );
 		return true;
@@ -374,13 +402,52 @@ bool ConnectedClient::Send( Packet *packet )
 }
 
 
+// Queue a packet that may also be queued for other clients; it must not be modified afterwards.
+bool ConnectedClient::SendShared( Packet *packet )
+{
+	if( ! (OutThread || Reactor) )
+		return SendNow( packet );
+	
+	if( ! Connected )
+		return false;
+	
+	if( ! OutLock.Lock() )
+		fprintf( stderr, "ConnectedClient::SendShared: OutLock.Lock: %s\n", SDL_GetError() );
+	
+	OutBuffer.push( packet->Share() );
+	
+	if( ! OutLock.Unlock() )
+		fprintf( stderr, "ConnectedClient::SendShared: OutLock.Unlock: %s\n", SDL_GetError() );
+	
+	return true;
+}
+
+
 bool ConnectedClient::SendNow( Packet *packet )
 {
 	if( ! Connected )
 		return false;
 	
+	// Large reliable packets are compressed, but latency-critical types are always sent as-is.
+	if( CompressThreshold && (packet->Size() >= CompressThreshold) && ! packet->Compressed() )
+	{
+		PacketType type = packet->Type();
+		if( (type != Raptor::Packet::UPDATE) && (type != Raptor::Packet::VOICE) )
+		{
+			Clock compress_clock;
+			Packet *compressed = packet->Compress();
+			CompressStats.Add( packet->Size(), compressed ? compressed->Size() : packet->Size(), compress_clock.ElapsedSeconds() );
+			if( compressed )
+			{
+				bool sent = SendNow( compressed );
+				delete compressed;
+				return sent;
+			}
+		}
+	}
+	
 	int sent = 0;
-	int retries = OutThread ? 1 : 0;
+	int retries = (OutThread || Reactor) ? 1 : 0;
 	
 	while( sent < (int) packet->Size() )
 	{
@@ -389,7 +456,7 @@ bool ConnectedClient::SendNow( Packet *packet )
 		{
 			sent      += sent_now;
 			BytesSent += sent_now;
-			retries = OutThread ? 1 : 0;
+			retries = (OutThread || Reactor) ? 1 : 0;
 		}
 		else if( retries )
 			retries --;
@@ -404,6 +471,62 @@ bool ConnectedClient::SendNow( Packet *packet )
 }
 
 
+// Read what is waiting on the socket (data must hold PACKET_BUFFER_SIZE) and queue any complete packets.
+int ConnectedClient::Receive( char *data )
+{
+	int size = SDLNet_TCP_Recv( Socket, data, PACKET_BUFFER_SIZE );
+	
+	// If the main server thread has dropped this client, don't try to process the incoming packet.
+	if( (size > 0) && Connected )
+	{
+		PROFILE_ZONE( "Receive" );
+		BytesReceived += size;
+		ReceiveBuffer->AddData( data, size );
+		
+		while( Packet *packet = ReceiveBuffer->Pop() )
+		{
+			if( ! InLock.Lock() )
+				fprintf( stderr, "ConnectedClient::Receive: InLock.Lock: %s\n", SDL_GetError() );
+			
+			// While locked, add an incoming packet to the input buffer.
+			InBuffer.push( packet );
+			
+			if( ! InLock.Unlock() )
+				fprintf( stderr, "ConnectedClient::Receive: InLock.Unlock: %s\n", SDL_GetError() );
+		}
+	}
+	
+	return size;
+}
+
+
+void ConnectedClient::FlushOut( void )
+{
+	if( OutBuffer.empty() )
+		return;
+	
+	PROFILE_ZONE( "Send" );
+	
+	if( ! OutLock.Lock() )
+		fprintf( stderr, "ConnectedClient::FlushOut: OutLock.Lock: %s\n", SDL_GetError() );
+	
+	// While locked, snag a copy of the entire output buffer and clear the original.
+	std::queue< Packet*, std::list<Packet*> > prev_out_buffer = OutBuffer;
+	OutBuffer = std::queue< Packet*, std::list<Packet*> >();
+	
+	if( ! OutLock.Unlock() )
+		fprintf( stderr, "ConnectedClient::FlushOut: OutLock.Unlock: %s\n", SDL_GetError() );
+	
+	while( ! prev_out_buffer.empty() )
+	{
+		Packet *packet = prev_out_buffer.front();
+		prev_out_buffer.pop();
+		SendNow( packet );
+		Packet::Release( packet );
+	}
+}
+
+
 void ConnectedClient::SendToOutBuffer( Packet *packet )
 {
 	if( ! Connected )
@@ -425,7 +548,7 @@ void ConnectedClient::SendToOutBuffer( Packet *packet )
 
 void ConnectedClient::SendOthers( Packet *packet )
 {
-	return Raptor::Server->Net.SendAllExcept( packet, this );
+	return Server->Net.SendAllExcept( packet, this );
 }
 
 
@@ -463,7 +586,7 @@ bool ConnectedClient::SendResync( void )
 	
 	char cstr[ 1024 ] = "";
 	snprintf( cstr, 1024, "Sending resync to: %i.%i.%i.%i:%i", (IP & 0xFF000000) >> 24, (IP & 0x00FF0000) >> 16, (IP & 0x0000FF00) >> 8, IP & 0x000000FF, Port );
-	Raptor::Server->ConsolePrint( cstr );
+	Server->ConsolePrint( cstr );
 	
 	Packet resync( Raptor::Packet::RESYNC );
 	resync.AddUShort( PlayerID );
@@ -496,9 +619,8 @@ int ConnectedClient::ConnectedClientInThread( void *client )
 {
 	ConnectedClient *connected_client = (ConnectedClient*) client;
 	char data[ PACKET_BUFFER_SIZE ] = "";
-	PacketBuffer Buffer;
-	Buffer.MaxPacketSize = 0x0007FFFF;
 	int retries = 3;
+	Profiler::SetThreadName( "ConnectedClientIn" );
 	
 	SDLNet_SocketSet socket_set = SDLNet_AllocSocketSet( 1 );
 	SDLNet_TCP_AddSocket( socket_set, connected_client->Socket );
@@ -523,30 +645,9 @@ int ConnectedClient::ConnectedClientInThread( void *client )
 		}
 		
 		// Check for packets.
-		int size = SDLNet_TCP_Recv( connected_client->Socket, data, PACKET_BUFFER_SIZE );
+		int size = connected_client->Receive( data );
 		if( size > 0 )
-		{
-			// If the main server thread has dropped this client, don't try to process the incoming packet.
-			if( ! connected_client->Connected )
-				break;
-			
-			connected_client->BytesReceived += size;
-			Buffer.AddData( data, size );
-			
-			while( Packet *packet = Buffer.Pop() )
-			{
-				if( ! connected_client->InLock.Lock() )
-					fprintf( stderr, "ConnectedClientInThread: connected_client->InLock.Lock: %s\n", SDL_GetError() );
-				
-				// While locked, add an incoming packet to the input buffer.
-				connected_client->InBuffer.push( packet );
-				
-				if( ! connected_client->InLock.Unlock() )
-					fprintf( stderr, "ConnectedClientInThread: connected_client->InLock.Unlock: %s\n", SDL_GetError() );
-			}
-			
 			retries = 3;
-		}
 		else if( (size < 0) && retries )
 			retries --;
 		else if( connected_client->Connected )
@@ -561,6 +662,7 @@ int ConnectedClient::ConnectedClientInThread( void *client )
 	}
 	
 	// Set the thread pointer to NULL so we can delete this client.
+	Profiler::ThreadDone();
 	connected_client->InThread = NULL;
 	
 	SDLNet_FreeSocketSet( socket_set );
@@ -572,35 +674,18 @@ int ConnectedClient::ConnectedClientInThread( void *client )
 int ConnectedClient::ConnectedClientOutThread( void *client )
 {
 	ConnectedClient *connected_client = (ConnectedClient*) client;
+	Profiler::SetThreadName( "ConnectedClientOut" );
 	
 	while( connected_client->Connected )
 	{
-		if( ! connected_client->OutBuffer.empty() )
-		{
-			if( ! connected_client->OutLock.Lock() )
-				fprintf( stderr, "ConnectedClientOutThread: connected_client->OutLock.Lock: %s\n", SDL_GetError() );
-			
-			// While locked, snag a copy of the entire output buffer and clear the original.
-			std::queue< Packet*, std::list<Packet*> > prev_out_buffer = connected_client->OutBuffer;
-			connected_client->OutBuffer = std::queue< Packet*, std::list<Packet*> >();
-			
-			if( ! connected_client->OutLock.Unlock() )
-				fprintf( stderr, "ConnectedClientOutThread: connected_client->OutLock.Unlock: %s\n", SDL_GetError() );
-			
-			while( ! prev_out_buffer.empty() )
-			{
-				Packet *packet = prev_out_buffer.front();
-				prev_out_buffer.pop();
-				connected_client->SendNow( packet );
-				delete packet;
-			}
-		}
+		connected_client->FlushOut();
 		
 		// Let the thread rest a bit.
 		SDL_Delay( 1 );
 	}
 	
 	// Set the thread pointer to NULL so we can delete this client.
+	Profiler::ThreadDone();
 	connected_client->OutThread = NULL;
 	
 	return 0;
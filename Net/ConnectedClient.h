@@ -4,6 +4,9 @@
 
 #pragma once
 class ConnectedClient;
+class RaptorServer;
+class NetReactor;
+class PacketBuffer;
 
 #include "PlatformSpecific.h"
 #include <cstddef>
@@ -49,13 +52,18 @@ public:
 	int8_t Precision;
 	uint64_t BytesSent;
 	uint64_t BytesReceived;
+	PacketSize CompressThreshold;
+	PacketCompressionStats CompressStats, DecompressStats;
 	std::list<double> PingTimes;
 	std::map<uint8_t,Clock> SentPings;
 	Clock ResyncClock;
 	uint16_t PlayerID, DropPlayerID;
+	RaptorServer *Server;
+	NetReactor *Reactor;
+	PacketBuffer *ReceiveBuffer;
 	
 	
-	ConnectedClient( TCPsocket socket, double net_rate = 30., int8_t precision = 0 );
+	ConnectedClient( TCPsocket socket, double net_rate = 30., int8_t precision = 0, RaptorServer *server = NULL, NetReactor *reactor = NULL );
 	virtual ~ConnectedClient();
 	
 	void Cleanup( double wait_for_threads = 0.5 );
@@ -70,10 +78,15 @@ public:
 	void Login( std::string name, std::string password );
 	
 	bool Send( Packet *packet );
+	bool SendShared( Packet *packet );
 	
-	// This should ONLY be called by Send() or ConnectedClientOutThread!
+	// This should ONLY be called by Send() or FlushOut()!
 	bool SendNow( Packet *packet );
 	
+	// These are called by the in/out threads, or by the reactor when one is set.
+	int Receive( char *data );
+	void FlushOut( void );
+	
 	void SendOthers( Packet *packet );
 	
 	bool SendPing( void );
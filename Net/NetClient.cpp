@@ -164,6 +164,7 @@ bool NetClient::Connect( const char *hostname, int port, const char *name, const
 	
 	BytesSent = 0;
 	BytesReceived = 0;
+	DecompressStats = PacketCompressionStats();
 	
 	// Start the listener thread.
 	Connected = true;
@@ -193,6 +194,8 @@ bool NetClient::Connect( const char *hostname, int port, const char *name, const
 	packet.AddString( Raptor::Game->Version );
 	packet.AddString( name );
 	packet.AddString( password );  // FIXME: This assumes every game requires a password!
+	packet.AddUChar( Raptor::Game->Cfg.SettingAsBool( "net_compress", true ) ? Raptor::Compression::LZ : Raptor::Compression::NONE );
+	packet.AddUChar( Raptor::Protocol::VERSION );
 	Send( &packet );
 	
 	// If we connected successfully, don't try to reconnect.
@@ -580,7 +583,10 @@ std::string NetClient::Status( void )
 	#else
 		snprintf( cstr, 1024, "Bytes sent as client: %llu\nBytes received as client: %llu\nPing: %.0f", (unsigned long long) BytesSent, (unsigned long long) BytesReceived, MedianPing() );
 	#endif
-	return std::string(cstr);
+	std::string status = std::string(cstr);
+	if( DecompressStats.Packets )
+		status += std::string("\n") + DecompressStats.Status( "decompressed" );
+	return status;
 }
 
 
@@ -592,6 +598,7 @@ int NetClientThread( void *client )
 	NetClient *net_client = (NetClient*) client;
 	char data[ PACKET_BUFFER_SIZE ] = "";
 	PacketBuffer Buffer;
+	Buffer.DecompressStats = &(net_client->DecompressStats);
 	int retries = 3;
 	
 	SDLNet_SocketSet socket_set = SDLNet_AllocSocketSet( 1 );
@@ -45,6 +45,7 @@ public:
 	int8_t Precision;
 	uintmax_t BytesSent;
 	uintmax_t BytesReceived;
+	PacketCompressionStats DecompressStats;
 	std::list<double> PingTimes;
 	std::map<uint8_t,Clock> SentPings;
 	
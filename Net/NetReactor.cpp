@@ -0,0 +1,245 @@
+/*
+ *  NetReactor.cpp
+ */
+
+#include "NetReactor.h"
+
+#include <cstddef>
+#include <algorithm>
+#include "Clock.h"
+#include "Profiler.h"
+
+
+NetReactor::NetReactor( void )
+{
+	Running = false;
+	Thread = NULL;
+	WaitMilliseconds = 1;
+	Passes = 0;
+}
+
+
+NetReactor::~NetReactor()
+{
+	Stop();
+	DeleteReleased();
+}
+
+
+bool NetReactor::Start( void )
+{
+	if( Thread )
+		return true;
+	
+	Running = true;
+	#if SDL_VERSION_ATLEAST(2,0,0)
+		Thread = SDL_CreateThread( NetReactorThread, "NetReactor", this );
+	#else
+		Thread = SDL_CreateThread( NetReactorThread, this );
+	#endif
+	if( ! Thread )
+	{
+		fprintf( stderr, "NetReactor::Start: SDL_CreateThread: %s\n", SDL_GetError() );
+		Running = false;
+		return false;
+	}
+	
+	return true;
+}
+
+
+void NetReactor::Stop( void )
+{
+	Running = false;
+	
+	if( Thread )
+	{
+		SDL_WaitThread( Thread, NULL );
+		Thread = NULL;
+	}
+}
+
+
+void NetReactor::Add( NetServer *server )
+{
+	if( ! Lock.Lock() )
+		fprintf( stderr, "NetReactor::Add: Lock.Lock: %s\n", SDL_GetError() );
+	
+	if( std::find( Servers.begin(), Servers.end(), server ) == Servers.end() )
+		Servers.push_back( server );
+	
+	if( ! Lock.Unlock() )
+		fprintf( stderr, "NetReactor::Add: Lock.Unlock: %s\n", SDL_GetError() );
+}
+
+
+// Blocks until the current pass is done, so the server's listen socket can be closed afterwards.
+void NetReactor::Remove( NetServer *server )
+{
+	if( ! Lock.Lock() )
+		fprintf( stderr, "NetReactor::Remove: Lock.Lock: %s\n", SDL_GetError() );
+	
+	Servers.remove( server );
+	uint32_t pass = Passes;
+	
+	if( ! Lock.Unlock() )
+		fprintf( stderr, "NetReactor::Remove: Lock.Unlock: %s\n", SDL_GetError() );
+	
+	// A pass that gathered this server before it was removed finishes before Passes changes.
+	while( (Passes == pass) && Running && Thread )
+		SDL_Delay( 1 );
+}
+
+
+// Takes ownership of a disconnected client; it is closed and deleted before the next pass.
+void NetReactor::Release( ConnectedClient *client )
+{
+	if( ! ReleasedLock.Lock() )
+		fprintf( stderr, "NetReactor::Release: ReleasedLock.Lock: %s\n", SDL_GetError() );
+	
+	Released.push_back( client );
+	
+	if( ! ReleasedLock.Unlock() )
+		fprintf( stderr, "NetReactor::Release: ReleasedLock.Unlock: %s\n", SDL_GetError() );
+}
+
+
+void NetReactor::DeleteReleased( void )
+{
+	if( ! ReleasedLock.Lock() )
+		fprintf( stderr, "NetReactor::DeleteReleased: ReleasedLock.Lock: %s\n", SDL_GetError() );
+	
+	std::list<ConnectedClient*> released;
+	released.swap( Released );
+	
+	if( ! ReleasedLock.Unlock() )
+		fprintf( stderr, "NetReactor::DeleteReleased: ReleasedLock.Unlock: %s\n", SDL_GetError() );
+	
+	std::list<ConnectedClient*> sending;
+	for( std::list<ConnectedClient*>::iterator client_iter = released.begin(); client_iter != released.end(); client_iter ++ )
+	{
+		// A client whose out thread is still stuck in a send keeps its socket until the thread is done.
+		if( (*client_iter)->OutThread )
+		{
+			sending.push_back( *client_iter );
+			continue;
+		}
+		
+		(*client_iter)->Cleanup( 0. );
+		delete *client_iter;
+	}
+	
+	if( sending.size() )
+	{
+		if( ! ReleasedLock.Lock() )
+			fprintf( stderr, "NetReactor::DeleteReleased: ReleasedLock.Lock: %s\n", SDL_GetError() );
+		
+		Released.splice( Released.end(), sending );
+		
+		if( ! ReleasedLock.Unlock() )
+			fprintf( stderr, "NetReactor::DeleteReleased: ReleasedLock.Unlock: %s\n", SDL_GetError() );
+	}
+}
+
+
+// -----------------------------------------------------------------------------
+
+
+int NetReactor::NetReactorThread( void *reactor )
+{
+	NetReactor *net_reactor = (NetReactor*) reactor;
+	char data[ PACKET_BUFFER_SIZE ] = "";
+	std::vector<NetServer*> listeners;
+	std::vector<ConnectedClient*> clients;
+	std::vector<TCPsocket> sockets;
+	int socket_set_size = 16;
+	SDLNet_SocketSet socket_set = SDLNet_AllocSocketSet( socket_set_size );
+	Profiler::SetThreadName( "NetReactor" );
+	
+	while( net_reactor->Running )
+	{
+		// Only this thread deletes clients, so anything gathered below stays valid until the next pass.
+		net_reactor->DeleteReleased();
+		
+		if( ! net_reactor->Lock.Lock() )
+			fprintf( stderr, "NetReactorThread: net_reactor->Lock.Lock: %s\n", SDL_GetError() );
+		
+		listeners.clear();
+		clients.clear();
+		for( std::list<NetServer*>::iterator server_iter = net_reactor->Servers.begin(); server_iter != net_reactor->Servers.end(); server_iter ++ )
+		{
+			NetServer *net_server = *server_iter;
+			
+			if( ! net_server->Lock.Lock() )
+				fprintf( stderr, "NetReactorThread: net_server->Lock.Lock: %s\n", SDL_GetError() );
+			
+			if( net_server->Listening && net_server->Socket )
+				listeners.push_back( net_server );
+			
+			for( std::list<ConnectedClient*>::iterator client_iter = net_server->Clients.begin(); client_iter != net_server->Clients.end(); client_iter ++ )
+			{
+				if( ((*client_iter)->Reactor == net_reactor) && (*client_iter)->Connected )
+					clients.push_back( *client_iter );
+			}
+			
+			if( ! net_server->Lock.Unlock() )
+				fprintf( stderr, "NetReactorThread: net_server->Lock.Unlock: %s\n", SDL_GetError() );
+		}
+		
+		// Nothing below needs the lock: gathered clients are only deleted by this thread, and Remove waits for Passes.
+		if( ! net_reactor->Lock.Unlock() )
+			fprintf( stderr, "NetReactorThread: net_reactor->Lock.Unlock: %s\n", SDL_GetError() );
+		
+		// Rebuild the socket set, growing it if needed.
+		for( std::vector<TCPsocket>::iterator socket_iter = sockets.begin(); socket_iter != sockets.end(); socket_iter ++ )
+			SDLNet_TCP_DelSocket( socket_set, *socket_iter );
+		sockets.clear();
+		for( std::vector<NetServer*>::iterator server_iter = listeners.begin(); server_iter != listeners.end(); server_iter ++ )
+			sockets.push_back( (*server_iter)->Socket );
+		for( std::vector<ConnectedClient*>::iterator client_iter = clients.begin(); client_iter != clients.end(); client_iter ++ )
+			sockets.push_back( (*client_iter)->Socket );
+		if( (int) sockets.size() > socket_set_size )
+		{
+			SDLNet_FreeSocketSet( socket_set );
+			while( socket_set_size < (int) sockets.size() )
+				socket_set_size *= 2;
+			socket_set = SDLNet_AllocSocketSet( socket_set_size );
+		}
+		for( std::vector<TCPsocket>::iterator socket_iter = sockets.begin(); socket_iter != sockets.end(); socket_iter ++ )
+			SDLNet_TCP_AddSocket( socket_set, *socket_iter );
+		
+		if( sockets.size() )
+			SDLNet_CheckSockets( socket_set, net_reactor->WaitMilliseconds );
+		else
+			SDL_Delay( net_reactor->WaitMilliseconds );
+		
+		for( std::vector<NetServer*>::iterator server_iter = listeners.begin(); server_iter != listeners.end(); server_iter ++ )
+		{
+			if( SDLNet_SocketReady( (*server_iter)->Socket ) )
+				(*server_iter)->Accept();
+		}
+		
+		for( std::vector<ConnectedClient*>::iterator client_iter = clients.begin(); client_iter != clients.end(); client_iter ++ )
+		{
+			ConnectedClient *connected_client = *client_iter;
+			
+			if( connected_client->Connected && SDLNet_SocketReady( connected_client->Socket ) )
+			{
+				// The socket is ready, so 0 means they hung up and -1 is an error.
+				if( (connected_client->Receive( data ) <= 0) && connected_client->Connected )
+					connected_client->Disconnect();
+			}
+			
+			// Only clients whose out thread couldn't be started are sent to from here.
+			if( ! connected_client->OutThread )
+				connected_client->FlushOut();
+		}
+		
+		net_reactor->Passes ++;
+	}
+	
+	Profiler::ThreadDone();
+	SDLNet_FreeSocketSet( socket_set );
+	
+	return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ *  NetReactor.h
+ */
+
+#pragma once
+class NetReactor;
+
+#include "PlatformSpecific.h"
+
+#include <list>
+#include <vector>
+#include <stdint.h>
+
+#ifdef SDL2
+	#include <SDL2/SDL.h>
+	#include <SDL2/SDL_thread.h>
+	#include <SDL2/SDL_net.h>
+#else
+	#include <SDL/SDL.h>
+	#include <SDL/SDL_thread.h>
+	#ifdef __APPLE__
+		#include <SDL_net/SDL_net.h>
+	#else
+		#include <SDL/SDL_net.h>
+	#endif
+#endif
+
+#include "NetServer.h"
+#include "ConnectedClient.h"
+#include "Mutex.h"
+
+
+// One thread that accepts and receives for every NetServer added to it, instead of a listener
+// thread per server and an in thread per client.  Each client keeps its own out thread, so a slow
+// client's blocking sends and compression never hold up the others.  Sockets of released clients
+// are only closed by this thread, so they are never checked after being freed.
+class NetReactor
+{
+public:
+	volatile bool Running;
+	SDL_Thread *Thread;
+	Mutex Lock;
+	std::list<NetServer*> Servers;
+	int WaitMilliseconds;
+	volatile uint32_t Passes;
+	
+	
+	NetReactor( void );
+	virtual ~NetReactor();
+	
+	bool Start( void );
+	void Stop( void );
+	
+	void Add( NetServer *server );
+	void Remove( NetServer *server );
+	void Release( ConnectedClient *client );
+	
+	static int NetReactorThread( void *reactor );
+
+private:
+	Mutex ReleasedLock;
+	std::list<ConnectedClient*> Released;
+	
+	void DeleteReleased( void );
+};
@@ -0,0 +1,257 @@
+/*
+ *  NetSchema.h
+ */
+
+#pragma once
+template <typename T> class NetSchema;
+template <typename T> class NetField;
+
+#include "PlatformSpecific.h"
+
+#include <vector>
+#include <stdint.h>
+#include "BitStream.h"
+#include "Vec.h"
+
+
+// Declarative list of a class's networked members, so one table drives both encode and decode.
+// Bits are chosen by precision (below 0, 0, above 0); a field with MinPrecision above the current precision is skipped.
+
+namespace NetFieldKind
+{
+	enum
+	{
+		DOUBLE = 1,
+		FLOAT,
+		RANGED,
+		VECTOR,
+		UNIT_VECTOR,
+		ORIENTATION,
+		USHORT
+	};
+}
+
+
+template <typename T>
+class NetField
+{
+public:
+	int Kind;
+	int8_t MinPrecision;
+	int Bits[ 3 ];
+	double Min, Max;
+	double T::*DoubleMember;
+	Vec3D T::*VecMember;
+	Vec3D T::*UpMember;
+	uint16_t T::*UShortMember;
+	
+	NetField( int kind, int8_t min_precision = -128 )
+	{
+		Kind = kind;
+		MinPrecision = min_precision;
+		Bits[ 0 ] = Bits[ 1 ] = Bits[ 2 ] = 0;
+		Min = Max = 0.;
+		DoubleMember = NULL;
+		VecMember = NULL;
+		UpMember = NULL;
+		UShortMember = NULL;
+	}
+	
+	int BitsAt( int8_t precision ) const
+	{
+		return Bits[ (precision < 0) ? 0 : ((precision > 0) ? 2 : 1) ];
+	}
+	
+	int Size( int8_t precision ) const
+	{
+		if( precision < MinPrecision )
+			return 0;
+		
+		switch( Kind )
+		{
+			case NetFieldKind::DOUBLE:      return 64;
+			case NetFieldKind::FLOAT:       return 32;
+			case NetFieldKind::RANGED:      return BitsAt( precision );
+			case NetFieldKind::VECTOR:      return 96;
+			case NetFieldKind::UNIT_VECTOR: return BitsAt( precision ) * 2;
+			case NetFieldKind::ORIENTATION: return 2 + BitsAt( precision ) * 3;
+			case NetFieldKind::USHORT:      return 16;
+		}
+		return 0;
+	}
+	
+	void Write( const T *obj, BitWriter *writer, int8_t precision ) const
+	{
+		if( precision < MinPrecision )
+			return;
+		
+		switch( Kind )
+		{
+			case NetFieldKind::DOUBLE:
+				writer->WriteDouble( obj->*DoubleMember );
+				break;
+			case NetFieldKind::FLOAT:
+				writer->WriteFloat( obj->*DoubleMember );
+				break;
+			case NetFieldKind::RANGED:
+				writer->WriteRanged( obj->*DoubleMember, Min, Max, BitsAt( precision ) );
+				break;
+			case NetFieldKind::VECTOR:
+				writer->WriteFloat( (obj->*VecMember).X );
+				writer->WriteFloat( (obj->*VecMember).Y );
+				writer->WriteFloat( (obj->*VecMember).Z );
+				break;
+			case NetFieldKind::UNIT_VECTOR:
+				writer->WriteUnitVector( &(obj->*VecMember), BitsAt( precision ) );
+				break;
+			case NetFieldKind::ORIENTATION:
+				writer->WriteOrientation( &(obj->*VecMember), &(obj->*UpMember), BitsAt( precision ) );
+				break;
+			case NetFieldKind::USHORT:
+				writer->WriteBits( obj->*UShortMember, 16 );
+				break;
+		}
+	}
+	
+	void Read( T *obj, BitReader *reader, int8_t precision ) const
+	{
+		if( precision < MinPrecision )
+			return;
+		
+		switch( Kind )
+		{
+			case NetFieldKind::DOUBLE:
+				obj->*DoubleMember = reader->ReadDouble();
+				break;
+			case NetFieldKind::FLOAT:
+				obj->*DoubleMember = reader->ReadFloat();
+				break;
+			case NetFieldKind::RANGED:
+				obj->*DoubleMember = reader->ReadRanged( Min, Max, BitsAt( precision ) );
+				break;
+			case NetFieldKind::VECTOR:
+				(obj->*VecMember).X = reader->ReadFloat();
+				(obj->*VecMember).Y = reader->ReadFloat();
+				(obj->*VecMember).Z = reader->ReadFloat();
+				break;
+			case NetFieldKind::UNIT_VECTOR:
+				reader->ReadUnitVector( &(obj->*VecMember), BitsAt( precision ) );
+				break;
+			case NetFieldKind::ORIENTATION:
+				reader->ReadOrientation( &(obj->*VecMember), &(obj->*UpMember), BitsAt( precision ) );
+				break;
+			case NetFieldKind::USHORT:
+				obj->*UShortMember = reader->ReadBits( 16 );
+				break;
+		}
+	}
+};
+
+
+template <typename T>
+class NetSchema
+{
+public:
+	std::vector< NetField<T> > Fields;
+	
+	
+	NetSchema( void )
+	{
+	}
+	
+	~NetSchema()
+	{
+	}
+	
+	NetSchema<T> &Double( double T::*member, int8_t min_precision = -128 )
+	{
+		NetField<T> field( NetFieldKind::DOUBLE, min_precision );
+		field.DoubleMember = member;
+		Fields.push_back( field );
+		return *this;
+	}
+	
+	NetSchema<T> &Float( double T::*member, int8_t min_precision = -128 )
+	{
+		NetField<T> field( NetFieldKind::FLOAT, min_precision );
+		field.DoubleMember = member;
+		Fields.push_back( field );
+		return *this;
+	}
+	
+	NetSchema<T> &Ranged( double T::*member, double min, double max, int low_bits, int bits, int high_bits, int8_t min_precision = -128 )
+	{
+		NetField<T> field( NetFieldKind::RANGED, min_precision );
+		field.DoubleMember = member;
+		field.Min = min;
+		field.Max = max;
+		field.Bits[ 0 ] = low_bits;
+		field.Bits[ 1 ] = bits;
+		field.Bits[ 2 ] = high_bits;
+		Fields.push_back( field );
+		return *this;
+	}
+	
+	NetSchema<T> &Vector( Vec3D T::*member, int8_t min_precision = -128 )
+	{
+		NetField<T> field( NetFieldKind::VECTOR, min_precision );
+		field.VecMember = member;
+		Fields.push_back( field );
+		return *this;
+	}
+	
+	NetSchema<T> &UnitVector( Vec3D T::*member, int low_bits, int bits, int high_bits, int8_t min_precision = -128 )
+	{
+		NetField<T> field( NetFieldKind::UNIT_VECTOR, min_precision );
+		field.VecMember = member;
+		field.Bits[ 0 ] = low_bits;
+		field.Bits[ 1 ] = bits;
+		field.Bits[ 2 ] = high_bits;
+		Fields.push_back( field );
+		return *this;
+	}
+	
+	NetSchema<T> &Orientation( Vec3D T::*fwd, Vec3D T::*up, int low_bits, int bits, int high_bits, int8_t min_precision = -128 )
+	{
+		NetField<T> field( NetFieldKind::ORIENTATION, min_precision );
+		field.VecMember = fwd;
+		field.UpMember = up;
+		field.Bits[ 0 ] = low_bits;
+		field.Bits[ 1 ] = bits;
+		field.Bits[ 2 ] = high_bits;
+		Fields.push_back( field );
+		return *this;
+	}
+	
+	NetSchema<T> &UShort( uint16_t T::*member, int8_t min_precision = -128 )
+	{
+		NetField<T> field( NetFieldKind::USHORT, min_precision );
+		field.UShortMember = member;
+		Fields.push_back( field );
+		return *this;
+	}
+	
+	size_t Bytes( int8_t precision ) const
+	{
+		size_t bits = 0;
+		for( typename std::vector< NetField<T> >::const_iterator field_iter = Fields.begin(); field_iter != Fields.end(); field_iter ++ )
+			bits += field_iter->Size( precision );
+		return (bits + 7) / 8;
+	}
+	
+	void Write( const T *obj, Packet *packet, int8_t precision ) const
+	{
+		BitWriter writer( packet, Bytes( precision ) );
+		for( typename std::vector< NetField<T> >::const_iterator field_iter = Fields.begin(); field_iter != Fields.end(); field_iter ++ )
+			field_iter->Write( obj, &writer, precision );
+		writer.Finish();
+	}
+	
+	void Read( T *obj, Packet *packet, int8_t precision ) const
+	{
+		BitReader reader( packet );
+		for( typename std::vector< NetField<T> >::const_iterator field_iter = Fields.begin(); field_iter != Fields.end(); field_iter ++ )
+			field_iter->Read( obj, &reader, precision );
+		reader.Finish();
+	}
+};
@@ -5,9 +5,10 @@
 #include "NetServer.h"
 
 #include <cstddef>
+#include <algorithm>
 #include "RaptorDefs.h"
 #include "RaptorServer.h"
-#include "RaptorGame.h"
+#include "NetReactor.h"
 
 
 NetServer::NetServer( void )
@@ -20,6 +21,9 @@ NetServer::NetServer( void )
 	DisconnectTime = 30.;
 	ResyncTime = 0.;  // Send RESYNC packet after this long without response.  Disabled because the updated netcode should no longer lose sync.
 	Precision = 0;
+	CompressThreshold = 1024;  // Reliable packets at least this large are compressed for clients that support it.
+	Server = NULL;
+	Reactor = NULL;
 }
 
 
@@ -50,12 +54,12 @@ NetServer::~NetServer()
 
 bool NetServer::Initialize( int port )
 {
-	if( ! port )
-		port = Raptor::Server->Port;
+	if( ! port && Server )
+		port = Server->Port;
 	
-	if( ! ( Initialized || Raptor::Game->Net.Initialized ) )
+	if( ! Initialized )
 	{
-		// Dedicated server initializes SDL_net here.
+		// SDL_net counts Init/Quit pairs, so this is safe whether or not a client already initialized it.
 		if( SDLNet_Init() < 0 )
 		{
 			fprintf( stderr, "SDLNet_Init: %s\n", SDLNet_GetError() );
@@ -80,8 +84,16 @@ bool NetServer::Initialize( int port )
 		return false;
 	}
 	
-	// Start the listener thread.
 	Listening = true;
+	
+	// A shared reactor accepts for this server, so it doesn't need its own listener thread.
+	if( Reactor )
+	{
+		Reactor->Add( this );
+		return true;
+	}
+	
+	// Start the listener thread.
 	#if SDL_VERSION_ATLEAST(2,0,0)
 		Thread = SDL_CreateThread( NetServerThread, "NetServer", this );
 	#else
@@ -121,6 +133,10 @@ void NetServer::Disconnect( void )
 {
 	Listening = false;
 	
+	// Wait for the reactor to finish its current pass before the listen socket is closed.
+	if( Reactor )
+		Reactor->Remove( this );
+	
 	// Sleep until the other thread has finished (max 3 sec).
 	Clock wait_for_thread;
 	while( Thread && (wait_for_thread.ElapsedSeconds() < 3.) )
@@ -160,6 +176,40 @@ void NetServer::Disconnect( void )
 }
 
 
+void NetServer::Accept( void )
+{
+	TCPsocket client_socket = SDLNet_TCP_Accept( Socket );
+	if( ! client_socket )
+		return;
+	
+	if( ! Lock.Lock() )
+		fprintf( stderr, "NetServer::Accept: Lock.Lock: %s\n", SDL_GetError() );
+	
+	ConnectedClient *connected_client = new ConnectedClient( client_socket, NetRate, Precision, Server, Reactor );
+	
+	IPaddress *remote_ip = SDLNet_TCP_GetPeerAddress( client_socket );
+	if( remote_ip )
+	{
+		connected_client->IP = Endian::ReadBig32(&(remote_ip->host));
+		connected_client->Port = Endian::ReadBig16(&(remote_ip->port));
+		
+		char cstr[ 1024 ] = "";
+		snprintf( cstr, 1024, "Client connected: %i.%i.%i.%i:%i", (connected_client->IP & 0xFF000000) >> 24, (connected_client->IP & 0x00FF0000) >> 16, (connected_client->IP & 0x0000FF00) >> 8, connected_client->IP & 0x000000FF, connected_client->Port );
+		Server->ConsolePrint( cstr );
+	}
+	else
+	{
+		fprintf( stderr, "SDLNet_TCP_GetPeerAddress: %s\n", SDLNet_GetError() );
+		Server->ConsolePrint( "Client connected from unknown IP!\n" );
+	}
+	
+	Clients.push_back( connected_client );
+	
+	if( ! Lock.Unlock() )
+		fprintf( stderr, "NetServer::Accept: Lock.Unlock: %s\n", SDL_GetError() );
+}
+
+
 void NetServer::RemoveDisconnectedClients( void )
 {
 	if( ! Lock.Lock() )
@@ -196,6 +246,15 @@ void NetServer::RemoveDisconnectedClients( void )
 		
 		if( client && (( (! client->InThread) && (! client->OutThread) && (client->ResyncClock.Progress() >= 1.) ) || (client->ResyncClock.ElapsedSeconds() >= 10.)) )
 		{
+			// Reactor clients have no in thread; the reactor closes the socket between passes, once the out thread is done.
+			if( client->Reactor )
+			{
+				client->Reactor->Release( client );
+				DisconnectedClients.erase( iter );
+				iter = next;
+				continue;
+			}
+			
 			// Start the cleanup thread.
 			#if SDL_VERSION_ATLEAST(2,0,0)
 				client->CleanupThread = SDL_CreateThread( ConnectedClient::ConnectedClientCleanupThread, "ConnectedClientCleanup", client );
@@ -280,6 +339,36 @@ void NetServer::SendToPlayer( Packet *packet, uint32_t player_id )
 }
 
 
+// Send one shared copy of the packet to each synchronized client whose player is in the sorted list (or all, if NULL).
+void NetServer::SendToPlayers( Packet *packet, const std::vector<uint16_t> *player_ids, uint16_t except_player_id )
+{
+	if( player_ids && player_ids->empty() )
+		return;
+	
+	Packet *shared = new Packet( packet );
+	
+	if( ! Lock.Lock() )
+		fprintf( stderr, "NetServer::SendToPlayers: Lock.Lock: %s\n", SDL_GetError() );
+	
+	for( std::list<ConnectedClient*>::iterator iter = Clients.begin(); iter != Clients.end(); iter ++ )
+	{
+		ConnectedClient *client = *iter;
+		if( ! (client->Synchronized && client->PlayerID) )
+			continue;
+		if( client->PlayerID == except_player_id )
+			continue;
+		if( player_ids && ! std::binary_search( player_ids->begin(), player_ids->end(), client->PlayerID ) )
+			continue;
+		client->SendShared( shared );
+	}
+	
+	if( ! Lock.Unlock() )
+		fprintf( stderr, "NetServer::SendToPlayers: Lock.Unlock: %s\n", SDL_GetError() );
+	
+	Packet::Release( shared );
+}
+
+
 void NetServer::SendAll( Packet *packet, bool send_to_unsynced )
 {
 	if( ! Lock.Lock() )
@@ -348,21 +437,21 @@ void NetServer::SendUpdates( void )
 			double temp_netrate = client->NetRate;
 			temp_netrate /= ((int) client->LatestPing() / 100) + 1;
 			
-			// Send an update if it's time to do so.
-			double elapsed = client->NetClock.ElapsedSeconds();
+			// Send an update if it's time to do so.  This runs once per server tick, so use the tick's timestamp.
+			double elapsed = client->NetClock.FrameSeconds();
 			if( elapsed >= (1. / temp_netrate) )
 			{
 				client->NetClock.Advance( elapsed );
-				Raptor::Server->SendUpdate( client );
+				Server->SendUpdate( client );
 				
-				double ping_elapsed = client->PingClock.ElapsedSeconds();
+				double ping_elapsed = client->PingClock.FrameSeconds();
 				if( (ping_elapsed >= (1. / client->PingRate)) && client->SendPing() )
 					client->PingClock.Advance( ping_elapsed );
 				else if( DisconnectTime && (ping_elapsed >= DisconnectTime) )  // Kick clients that have lost connection.
 					client->Disconnect();
 				else if( ResyncTime && (ping_elapsed >= ResyncTime) )
 				{
-					double resync_elapsed = client->ResyncClock.ElapsedSeconds();
+					double resync_elapsed = client->ResyncClock.FrameSeconds();
 					if( resync_elapsed >= ResyncTime )
 					{
 						// Sometimes clients with flaky connections can receive data but not send replies; ask them to reconnect and resync.
@@ -402,8 +491,6 @@ void NetServer::SetNetRate( double netrate )
 int NetServer::NetServerThread( void *server )
 {
 	NetServer *net_server = (NetServer*) server;
-	TCPsocket client_socket;
-	IPaddress *remote_ip;
 	
 	SDLNet_SocketSet socket_set = SDLNet_AllocSocketSet( 1 );
 	SDLNet_TCP_AddSocket( socket_set, net_server->Socket );
@@ -418,34 +505,7 @@ int NetServer::NetServerThread( void *server )
 			continue;
 		}
 		
-		// Check for new connections.
-		if( (client_socket = SDLNet_TCP_Accept(net_server->Socket)) )
-		{
-			if( ! net_server->Lock.Lock() )
-				fprintf( stderr, "NetServerThread: net_server->Lock.Lock: %s\n", SDL_GetError() );
-			
-			ConnectedClient *connected_client = new ConnectedClient( client_socket, net_server->NetRate, net_server->Precision );
-			
-			if( (remote_ip = SDLNet_TCP_GetPeerAddress(client_socket)) )
-			{
-				connected_client->IP = Endian::ReadBig32(&(remote_ip->host));
-				connected_client->Port = Endian::ReadBig16(&(remote_ip->port));
-				
-				char cstr[ 1024 ] = "";
-				snprintf( cstr, 1024, "Client connected: %i.%i.%i.%i:%i", (connected_client->IP & 0xFF000000) >> 24, (connected_client->IP & 0x00FF0000) >> 16, (connected_client->IP & 0x0000FF00) >> 8, connected_client->IP & 0x000000FF, connected_client->Port );
-				Raptor::Server->ConsolePrint( cstr );
-			}
-			else
-			{
-				fprintf( stderr, "SDLNet_TCP_GetPeerAddress: %s\n", SDLNet_GetError() );
-				Raptor::Server->ConsolePrint( "Client connected from unknown IP!\n" );
-			}
-			
-			net_server->Clients.push_back( connected_client );
-			
-			if( ! net_server->Lock.Unlock() )
-				fprintf( stderr, "NetServerThread: net_server->Lock.Unlock: %s\n", SDL_GetError() );
-		}
+		net_server->Accept();
 		
 		// Let the thread rest a bit.  This thread only handles new connections, so it can be a long delay.
 		SDL_Delay( 100 );
@@ -4,11 +4,14 @@
 
 #pragma once
 class NetServer;
+class RaptorServer;
+class NetReactor;
 
 #include "PlatformSpecific.h"
 
 #include <list>
 #include <queue>
+#include <vector>
 #include <stdexcept>
 
 #ifdef SDL2
@@ -42,6 +45,9 @@ public:
 	double NetRate;
 	double ResyncTime, DisconnectTime;
 	int8_t Precision;
+	PacketSize CompressThreshold;
+	RaptorServer *Server;
+	NetReactor *Reactor;
 	
 	
 	NetServer( void );
@@ -51,11 +57,13 @@ public:
 	void DisconnectNice( const char *message );
 	void Disconnect( void );
 	
+	void Accept( void );
 	void RemoveDisconnectedClients( void );
 	void ProcessIn( void );
 	void ProcessTop( void );
 	
 	void SendToPlayer( Packet *packet, uint32_t player_id );
+	void SendToPlayers( Packet *packet, const std::vector<uint16_t> *player_ids, uint16_t except_player_id = 0 );
 	void SendAll( Packet *packet, bool send_to_unsynced = false );
 	void SendAllExcept( Packet *packet, ConnectedClient *except, bool send_to_unsynced = false );
 	void SendAllReconnect( uint8_t seconds_to_wait = 3 );
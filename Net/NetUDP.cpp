@@ -39,6 +39,9 @@ bool NetUDP::Initialize( void )
 {
 	// NOTE: SDL_net must be initialized prior to this!
 	
+	if( SDLPacket )
+		return true;
+	
 	// Initialize a packet buffer that will be utilized for both incoming and outgoing packets.
 	SDLPacket = SDLNet_AllocPacket( PACKET_BUFFER_SIZE );
 	if( ! SDLPacket )
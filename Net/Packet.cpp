@@ -8,6 +8,8 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include "Atomic.h"
+#include "LZ.h"
 
 
 // Allocate for outgoing data.
@@ -15,6 +17,7 @@ Packet::Packet( PacketType packet_type )
 {
 	AllocationChunkSize = PACKET_OUTGOING_ALLOCATION_CHUNK_SIZE;
 	ThrowExceptions = false;
+	References = 1;
 	
 	Data = NULL;
 	Allocated = 0;
@@ -32,6 +35,7 @@ Packet::Packet( const void *data, int size )
 {
 	AllocationChunkSize = PACKET_INCOMING_ALLOCATION_CHUNK_SIZE;
 	ThrowExceptions = false;
+	References = 1;
 	
 	Data = NULL;
 	Allocated = 0;
@@ -50,6 +54,7 @@ Packet::Packet( const void *data, int size )
 Packet::Packet( const Packet *other )
 {
 	ThrowExceptions = other->ThrowExceptions;
+	References = 1;
 	AllocationChunkSize = 1;
 	Data = NULL;
 	Allocated = 0;
@@ -98,6 +103,8 @@ void Packet::SetData( const void *data, PacketSize size )
 	
 	// Set up the size; use the received size, so fragmented packets can append the rest later.
 	SetSize( size );
+	if( size >= PACKET_HEADER_SIZE )
+		SetCompressed( FirstPacketCompressed(data) );
 	
 	// Copy the packet's non-header data.
 	for( size_t i = PACKET_HEADER_SIZE; i < size; i ++ )
@@ -118,8 +125,11 @@ void Packet::AddData( const void *data, PacketSize size )
 	PacketSize old_size = Size();
 	memcpy( Data + old_size, data, size );
 	
-	// Increase the stored size.
+	// Increase the stored size, keeping the compressed flag of fragmented incoming packets.
+	bool compressed = Compressed();
 	SetSize( old_size + size );
+	if( compressed )
+		SetCompressed( true );
 }
 
 
@@ -144,11 +154,12 @@ void Packet::SetType( PacketType type )
 PacketSize Packet::Size( void )
 {
 	if( Data )
-		return PACKET_READ_SIZE( Data + sizeof(PacketType) );
+		return PACKET_READ_SIZE( Data + sizeof(PacketType) ) & PACKET_SIZE_MASK;
 	return 0;
 }
 
 
+// NOTE: This clears the compressed flag, which shares the size field.
 void Packet::SetSize( PacketSize size )
 {
 	if( Data )
@@ -186,7 +197,94 @@ void Packet::Skip( int bytes )
 
 int Packet::Remaining( void )
 {
-	return Offset - Size();
+	return (int) Size() - (int) Offset;
+}
+
+
+// -----------------------------------------------------------------------------
+
+
+bool Packet::Compressed( void )
+{
+	if( Data )
+		return PACKET_READ_SIZE( Data + sizeof(PacketType) ) & PACKET_COMPRESSED;
+	return false;
+}
+
+
+void Packet::SetCompressed( bool compressed )
+{
+	if( Data )
+		PACKET_WRITE_SIZE( Size() | (compressed ? PACKET_COMPRESSED : 0), Data + sizeof(PacketType) );
+}
+
+
+// Returns a new packet holding the raw data size and the LZ-compressed contents, or NULL if that wouldn't be smaller.
+// The type stays uncompressed in the header, so receivers can still see what kind of packet it is.
+Packet *Packet::Compress( void )
+{
+	if( Compressed() )
+		return NULL;
+	
+	PacketSize raw_size = Size() - PACKET_HEADER_SIZE;
+	if( raw_size <= sizeof(PacketSize) + 1 )
+		return NULL;
+	
+	Packet *compressed = new Packet( Type() );
+	compressed->AddUInt( raw_size );
+	if( ! compressed->MakeRoom( raw_size ) )
+	{
+		delete compressed;
+		return NULL;
+	}
+	
+	PacketSize header_size = compressed->Size();
+	size_t packed_size = LZ::Compress( Data + PACKET_HEADER_SIZE, raw_size, compressed->Data + header_size, raw_size - sizeof(PacketSize) - 1 );
+	if( ! packed_size )
+	{
+		delete compressed;
+		return NULL;
+	}
+	
+	compressed->SetSize( header_size + packed_size );
+	compressed->SetCompressed( true );
+	return compressed;
+}
+
+
+// Replace compressed contents with the original data.  Returns false if the data is malformed or larger than max_size.
+bool Packet::Decompress( PacketSize max_size )
+{
+	if( ! Compressed() )
+		return true;
+	
+	PacketSize packed_size = Size();
+	if( packed_size < PACKET_HEADER_SIZE + sizeof(PacketSize) )
+		return false;
+	
+	PacketSize raw_size = Endian::ReadBig32( Data + PACKET_HEADER_SIZE );
+	if( (raw_size > PACKET_SIZE_MASK - PACKET_HEADER_SIZE) || (max_size && (raw_size + PACKET_HEADER_SIZE > max_size)) )
+		return false;
+	
+	uint8_t *raw_data = (uint8_t *) malloc( PACKET_HEADER_SIZE + raw_size );
+	if( ! raw_data )
+		return false;
+	
+	const uint8_t *packed = Data + PACKET_HEADER_SIZE + sizeof(PacketSize);
+	if( LZ::Decompress( packed, packed_size - PACKET_HEADER_SIZE - sizeof(PacketSize), raw_data + PACKET_HEADER_SIZE, raw_size ) != raw_size )
+	{
+		free( raw_data );
+		return false;
+	}
+	
+	memcpy( raw_data, Data, sizeof(PacketType) );
+	PACKET_WRITE_SIZE( PACKET_HEADER_SIZE + raw_size, raw_data + sizeof(PacketType) );
+	
+	free( Data );
+	Data = raw_data;
+	Allocated = PACKET_HEADER_SIZE + raw_size;
+	Rewind();
+	return true;
 }
 
 
@@ -241,8 +339,9 @@ void Packet::AddChar( int8_t addition )
 {
 	if( ! MakeRoom(1) )
 		return;
-	Data[ Size() ] = addition;
-	SetSize( Size() + 1 );
+	PacketSize size = Size();
+	Data[ size ] = addition;
+	SetSize( size + 1 );
 }
 
 
@@ -250,8 +349,9 @@ void Packet::AddUChar( uint8_t addition )
 {
 	if( ! MakeRoom(1) )
 		return;
-	Data[ Size() ] = addition;
-	SetSize( Size() + 1 );
+	PacketSize size = Size();
+	Data[ size ] = addition;
+	SetSize( size + 1 );
 }
 
 
@@ -259,9 +359,10 @@ void Packet::AddShort( int16_t addition )
 {
 	if( ! MakeRoom(2) )
 		return;
+	PacketSize size = Size();
 	// Store as network-endian.
-	Endian::WriteBig16( addition, Data + Size() );
-	SetSize( Size() + 2 );
+	Endian::WriteBig16( addition, Data + size );
+	SetSize( size + 2 );
 }
 
 
@@ -269,9 +370,10 @@ void Packet::AddUShort( uint16_t addition )
 {
 	if( ! MakeRoom(2) )
 		return;
+	PacketSize size = Size();
 	// Store as network-endian.
-	Endian::WriteBig16( addition, Data + Size() );
-	SetSize( Size() + 2 );
+	Endian::WriteBig16( addition, Data + size );
+	SetSize( size + 2 );
 }
 
 
@@ -279,9 +381,10 @@ void Packet::AddInt( int32_t addition )
 {
 	if( ! MakeRoom(4) )
 		return;
+	PacketSize size = Size();
 	// Store as network-endian.
-	Endian::WriteBig32( addition, Data + Size() );
-	SetSize( Size() + 4 );
+	Endian::WriteBig32( addition, Data + size );
+	SetSize( size + 4 );
 }
 
 
@@ -289,9 +392,10 @@ void Packet::AddUInt( uint32_t addition )
 {
 	if( ! MakeRoom(4) )
 		return;
+	PacketSize size = Size();
 	// Store as network-endian.
-	Endian::WriteBig32( addition, Data + Size() );
-	SetSize( Size() + 4 );
+	Endian::WriteBig32( addition, Data + size );
+	SetSize( size + 4 );
 }
 
 
@@ -299,9 +403,10 @@ void Packet::AddInt64( int64_t addition )
 {
 	if( ! MakeRoom(8) )
 		return;
+	PacketSize size = Size();
 	// Store as network-endian.
-	Endian::WriteBig64( addition, Data + Size() );
-	SetSize( Size() + 8 );
+	Endian::WriteBig64( addition, Data + size );
+	SetSize( size + 8 );
 }
 
 
@@ -309,9 +414,10 @@ void Packet::AddUInt64( uint64_t addition )
 {
 	if( ! MakeRoom(8) )
 		return;
+	PacketSize size = Size();
 	// Store as network-endian.
-	Endian::WriteBig64( addition, Data + Size() );
-	SetSize( Size() + 8 );
+	Endian::WriteBig64( addition, Data + size );
+	SetSize( size + 8 );
 }
 
 
@@ -319,12 +425,13 @@ void Packet::AddFloat( float addition )
 {
 	if( ! MakeRoom(4) )
 		return;
+	PacketSize size = Size();
 	#ifdef ENDIAN_BIG
-		*((float *)( Data + Size() )) = addition;
+		*((float *)( Data + size )) = addition;
 	#else
-		Endian::ByteSwapCopy( &addition, Data + Size(), 4 );
+		Endian::ByteSwapCopy( &addition, Data + size, 4 );
 	#endif
-	SetSize( Size() + 4 );
+	SetSize( size + 4 );
 }
 
 
@@ -332,12 +439,13 @@ void Packet::AddDouble( double addition )
 {
 	if( ! MakeRoom(8) )
 		return;
+	PacketSize size = Size();
 	#ifdef ENDIAN_BIG
-		*((double *)( Data + Size() )) = addition;
+		*((double *)( Data + size )) = addition;
 	#else
-		Endian::ByteSwapCopy( &addition, Data + Size(), 8 );
+		Endian::ByteSwapCopy( &addition, Data + size, 8 );
 	#endif
-	SetSize( Size() + 8 );
+	SetSize( size + 8 );
 }
 
 
@@ -581,9 +689,73 @@ const char *Packet::NextString( void )
 // -----------------------------------------------------------------------------
 
 
+// Add a reference so one packet can sit in several clients' outgoing buffers without copying.
+Packet *Packet::Share( void )
+{
+	Atomic::Add( &References, 1 );
+	return this;
+}
+
+
+// Drop a reference, deleting the packet when it was the last one.
+void Packet::Release( Packet *packet )
+{
+	if( packet && (Atomic::Add( &(packet->References), -1 ) <= 0) )
+		delete packet;
+}
+
+
+// -----------------------------------------------------------------------------
+
+
 PacketSize Packet::FirstPacketSize( const void *data )
 {
-	return PACKET_READ_SIZE( ((uint8_t*)( data )) + sizeof(PacketType) );
+	return PACKET_READ_SIZE( ((uint8_t*)( data )) + sizeof(PacketType) ) & PACKET_SIZE_MASK;
+}
+
+
+bool Packet::FirstPacketCompressed( const void *data )
+{
+	return PACKET_READ_SIZE( ((uint8_t*)( data )) + sizeof(PacketType) ) & PACKET_COMPRESSED;
+}
+
+
+// -----------------------------------------------------------------------------
+
+
+PacketCompressionStats::PacketCompressionStats( void )
+{
+	Packets = 0;
+	RawBytes = 0;
+	PackedBytes = 0;
+	Seconds = 0.;
+}
+
+
+void PacketCompressionStats::Add( PacketSize raw_bytes, PacketSize packed_bytes, double seconds )
+{
+	Packets ++;
+	RawBytes += raw_bytes;
+	PackedBytes += packed_bytes;
+	Seconds += seconds;
+}
+
+
+double PacketCompressionStats::Ratio( void ) const
+{
+	return PackedBytes ? ((double) RawBytes / (double) PackedBytes) : 1.;
+}
+
+
+std::string PacketCompressionStats::Status( const char *direction ) const
+{
+	char cstr[ 1024 ] = "";
+	#ifdef WIN32
+		snprintf( cstr, 1024, "Packets %s: %I64u, %I64u bytes as %I64u (%.2f:1), %.1fms", direction, (unsigned long long) Packets, (unsigned long long) RawBytes, (unsigned long long) PackedBytes, Ratio(), Seconds * 1000. );
+	#else
+		snprintf( cstr, 1024, "Packets %s: %llu, %llu bytes as %llu (%.2f:1), %.1fms", direction, (unsigned long long) Packets, (unsigned long long) RawBytes, (unsigned long long) PackedBytes, Ratio(), Seconds * 1000. );
+	#endif
+	return std::string(cstr);
 }
 
 
@@ -10,6 +10,7 @@ class Packet;
 #include <list>
 #include <exception>
 #include <string>
+#include <stdint.h>
 #include "Endian.h"
 
 #define PACKET_OUTGOING_ALLOCATION_CHUNK_SIZE  1024
@@ -23,6 +24,8 @@ typedef uint32_t PacketSize;
 #define PACKET_READ_SIZE    Endian::ReadBig32
 #define PACKET_WRITE_SIZE   Endian::WriteBig32
 #define PACKET_HEADER_SIZE  (sizeof(PacketType) + sizeof(PacketSize))
+#define PACKET_SIZE_MASK    0x7FFFFFFF
+#define PACKET_COMPRESSED   0x80000000
 #define PACKET_DEFAULT_TYPE '    '
 
 
@@ -35,6 +38,7 @@ public:
 	
 	int AllocationChunkSize;
 	bool ThrowExceptions;
+	volatile int32_t References;
 	
 	
 	Packet( PacketType packet_type );
@@ -55,6 +59,11 @@ public:
 	void Skip( int bytes );
 	int Remaining( void );
 	
+	bool Compressed( void );
+	void SetCompressed( bool compressed );
+	Packet *Compress( void );
+	bool Decompress( PacketSize max_size = 0 );
+	
 	bool MakeRoom( PacketSize addition_size );
 	void AddChar( int8_t addition );
 	void AddUChar( uint8_t addition );
@@ -81,7 +90,28 @@ public:
 	double NextDouble( void );
 	const char *NextString( void );
 	
+	Packet *Share( void );
+	static void Release( Packet *packet );
+	
 	static PacketSize FirstPacketSize( const void *data );
+	static bool FirstPacketCompressed( const void *data );
+};
+
+
+// Running totals for packets passed through Compress or Decompress.
+class PacketCompressionStats
+{
+public:
+	uint64_t Packets;
+	uint64_t RawBytes;
+	uint64_t PackedBytes;
+	double Seconds;
+	
+	PacketCompressionStats( void );
+	
+	void Add( PacketSize raw_bytes, PacketSize packed_bytes, double seconds );
+	double Ratio( void ) const;
+	std::string Status( const char *direction ) const;
 };
 
 
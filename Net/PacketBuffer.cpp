@@ -8,11 +8,13 @@
 #include <cstddef>
 #include <cstring>
 #include "Num.h"
+#include "Clock.h"
 
 
 PacketBuffer::PacketBuffer( void )
 {
 	MaxPacketSize = 0x00FFFFFF;
+	DecompressStats = NULL;
 	Unfinished = NULL;
 	UnfinishedSizeRemaining = 0;
 	PartialHeaderSize = 0;
@@ -140,6 +142,25 @@ void PacketBuffer::AddData( void *data, PacketSize size )
 
 void PacketBuffer::Push( Packet *packet )
 {
+	// Expand compressed packets here so everything downstream only sees raw data.
+	if( packet->Compressed() )
+	{
+		Clock decompress_clock;
+		PacketSize packed_size = packet->Size();
+		
+		if( packet->Decompress( MaxPacketSize ) )
+		{
+			if( DecompressStats )
+				DecompressStats->Add( packet->Size(), packed_size, decompress_clock.ElapsedSeconds() );
+		}
+		else
+		{
+			delete packet;
+			packet = new Packet( Raptor::Packet::DISCONNECT );
+			packet->AddString( "Packet decompression error." );
+		}
+	}
+	
 	Lock.Lock();
 	
 	Complete.push( packet );
@@ -14,6 +14,7 @@ class PacketBuffer
 {
 public:
 	size_t MaxPacketSize;
+	PacketCompressionStats *DecompressStats;
 	
 	PacketBuffer( void );
 	virtual ~PacketBuffer();
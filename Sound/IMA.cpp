@@ -21,6 +21,16 @@ static int16_t StepSizeTable[] = {
 	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
 };
 
+// Lookup tables for the block encoder/decoder, filled by BuildTables.
+static int32_t DiffTable[ 89 ][ 16 ];
+static uint8_t IndexNext[ 89 ][ 16 ];
+
+static inline uint8_t EncodeNibble( int value, int *valpred, int *index );
+static void BuildTables( void );
+
+// Fill the tables during static initialization, before any thread can encode or decode.
+static struct IMATableInit { IMATableInit( void ) { BuildTables(); } } TableInit;
+
 
 uint8_t IMA::Encode( int16_t value, int16_t *prev, int8_t *idx )
 {
@@ -123,28 +133,84 @@ int16_t IMA::Decode( uint8_t nibble, int16_t *prev, int8_t *idx )
 
 void IMA::EncodeSegment( int16_t *from, uint8_t *into, size_t samples, int16_t *prev, int8_t *idx )
 {
+	EncodeSegment( from, into, samples, prev, idx, 1. );
+}
+
+
+void IMA::EncodeSegment( const int16_t *from, uint8_t *into, size_t samples, int16_t *prev, int8_t *idx, double volume )
+{
+	// Keep the codec state in locals for the whole block instead of going through pointers per sample.
+	int valpred = *prev;
+	int index = *idx;
+	
+	// Volume reduction is applied as 16.16 fixed-point while encoding, avoiding a separate scaling pass.
+	int32_t gain = 0x10000;
+	if( (volume >= 0.) && (volume < 1.) )
+		gain = volume * 0x10000 + 0.5;
+	
 	for( size_t i = 0; i < samples; i += 2 )
 	{
-		uint8_t encoded = Encode( from[ i ], prev, idx ) << 4;
+		int value = from[ i ];
+		if( gain != 0x10000 )
+			value = (value * gain + ((value < 0) ? -0x8000 : 0x8000)) / 0x10000;
+		uint8_t nibble = EncodeNibble( value, &valpred, &index );
+		uint8_t encoded = nibble << 4;
 		
 		if( (i + 1) < samples )
-			encoded |= Encode( from[ i + 1 ], prev, idx );
+		{
+			value = from[ i + 1 ];
+			if( gain != 0x10000 )
+				value = (value * gain + ((value < 0) ? -0x8000 : 0x8000)) / 0x10000;
+			encoded |= EncodeNibble( value, &valpred, &index );
+		}
 		
 		into[ i / 2 ] = encoded;
 	}
+	
+	*prev = valpred;
+	*idx = index;
 }
 
 
 void IMA::DecodeSegment( uint8_t *from, int16_t *into, size_t samples, int16_t *prev, int8_t *idx )
 {
-	for( size_t i = 0; i < samples; i += 2 )
+	DecodeSegment( (const uint8_t*) from, into, samples, prev, idx );
+}
+
+
+void IMA::DecodeSegment( const uint8_t *from, int16_t *into, size_t samples, int16_t *prev, int8_t *idx )
+{
+	int valpred = *prev;
+	int index = *idx;
+	
+	// Decode whole bytes first, then the trailing high nibble of an odd-length segment.
+	size_t pairs = samples / 2;
+	for( size_t i = 0; i < pairs; i ++ )
 	{
-		uint8_t encoded = from[ i / 2 ];
-		into[ i ] = Decode( (encoded & 0xF0) << 4, prev, idx );
+		uint8_t encoded = from[ i ];
 		
-		if( (i + 1) < samples )
-			into[ i + 1 ] = Decode( encoded & 0x0F, prev, idx );
+		valpred += DiffTable[ index ][ encoded >> 4 ];
+		valpred = (valpred > 32767) ? 32767 : ((valpred < -32768) ? -32768 : valpred);
+		index = IndexNext[ index ][ encoded >> 4 ];
+		into[ i * 2 ] = valpred;
+		
+		valpred += DiffTable[ index ][ encoded & 0x0F ];
+		valpred = (valpred > 32767) ? 32767 : ((valpred < -32768) ? -32768 : valpred);
+		index = IndexNext[ index ][ encoded & 0x0F ];
+		into[ i * 2 + 1 ] = valpred;
+	}
+	
+	if( samples % 2 )
+	{
+		uint8_t nibble = from[ pairs ] >> 4;
+		valpred += DiffTable[ index ][ nibble ];
+		valpred = (valpred > 32767) ? 32767 : ((valpred < -32768) ? -32768 : valpred);
+		index = IndexNext[ index ][ nibble ];
+		into[ samples - 1 ] = valpred;
 	}
+	
+	*prev = valpred;
+	*idx = index;
 }
 
 
@@ -163,3 +229,64 @@ void IMA::DecodeBuffer( uint8_t *from, int16_t *into, size_t samples )
 	int8_t index = 0;
 	DecodeSegment( from, into, samples, &prev, &index );
 }
+
+
+// ---------------------------------------------------------------------------
+
+
+static inline uint8_t EncodeNibble( int value, int *valpred, int *index )
+{
+	int step = StepSizeTable[ *index ];
+	int diff = value - *valpred;
+	uint8_t nibble = 0;
+	
+	if( diff < 0 )
+	{
+		nibble = 8;
+		diff = -diff;
+	}
+	
+	// Same successive approximation as IMA::Encode, so the output is bit-identical.
+	if( diff >= step )
+	{
+		nibble |= 4;
+		diff -= step;
+	}
+	if( diff >= (step >> 1) )
+	{
+		nibble |= 2;
+		diff -= (step >> 1);
+	}
+	if( diff >= (step >> 2) )
+		nibble |= 1;
+	
+	*valpred += DiffTable[ *index ][ nibble ];
+	*valpred = (*valpred > 32767) ? 32767 : ((*valpred < -32768) ? -32768 : *valpred);
+	*index = IndexNext[ *index ][ nibble ];
+	
+	return nibble;
+}
+
+
+static void BuildTables( void )
+{
+	// Precompute the signed prediction delta and next step index for every (index,nibble) pair.
+	for( int index = 0; index <= 88; index ++ )
+	{
+		int step = StepSizeTable[ index ];
+		for( int nibble = 0; nibble < 16; nibble ++ )
+		{
+			int diff = step >> 3;
+			if( nibble & 1 )
+				diff += step >> 2;
+			if( nibble & 2 )
+				diff += step >> 1;
+			if( nibble & 4 )
+				diff += step;
+			DiffTable[ index ][ nibble ] = (nibble & 8) ? -diff : diff;
+			
+			int next = index + IndexTable[ nibble ];
+			IndexNext[ index ][ nibble ] = (next < 0) ? 0 : ((next > 88) ? 88 : next);
+		}
+	}
+}
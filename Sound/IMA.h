@@ -13,7 +13,9 @@ namespace IMA
 	uint8_t Encode( int16_t value, int16_t *prev, int8_t *idx );
 	int16_t Decode( uint8_t nibble, int16_t *prev, int8_t *idx );
 	void EncodeSegment( int16_t *from, uint8_t *into, size_t samples, int16_t *prev, int8_t *idx );
+	void EncodeSegment( const int16_t *from, uint8_t *into, size_t samples, int16_t *prev, int8_t *idx, double volume );
 	void DecodeSegment( uint8_t *from, int16_t *into, size_t samples, int16_t *prev, int8_t *idx );
+	void DecodeSegment( const uint8_t *from, int16_t *into, size_t samples, int16_t *prev, int8_t *idx );
 	void EncodeBuffer( int16_t *from, uint8_t *into, size_t samples );
 	void DecodeBuffer( uint8_t *from, int16_t *into, size_t samples );
 }
@@ -0,0 +1,50 @@
+/*
+ *  IMACodec.cpp
+ */
+
+#include "IMACodec.h"
+
+#include "IMA.h"
+
+
+IMACodec::IMACodec( void ) : VoiceCodec( CODEC_IMA )
+{
+	Reset();
+}
+
+
+IMACodec::~IMACodec()
+{
+}
+
+
+void IMACodec::Reset( void )
+{
+	Prev = 0;
+	Index = 0;
+}
+
+
+size_t IMACodec::MaxEncodedBytes( size_t samples ) const
+{
+	return (samples + 1) / 2;
+}
+
+
+size_t IMACodec::Encode( const int16_t *from, size_t samples, uint8_t *into, double volume )
+{
+	// NOTE: Odd-length chunks end mid-byte, so only the last chunk of a stream should have an odd sample count.
+	IMA::EncodeSegment( from, into, samples, &Prev, &Index, volume );
+	return (samples + 1) / 2;
+}
+
+
+size_t IMACodec::Decode( const uint8_t *from, size_t bytes, int16_t *into, size_t samples )
+{
+	size_t needed = (samples + 1) / 2;
+	if( bytes < needed )
+		return 0;
+	
+	IMA::DecodeSegment( from, into, samples, &Prev, &Index );
+	return needed;
+}
@@ -0,0 +1,26 @@
+/*
+ *  IMACodec.h
+ */
+
+#pragma once
+class IMACodec;
+
+#include "PlatformSpecific.h"
+#include "VoiceCodec.h"
+
+
+// IMA ADPCM at 4 bits per sample (two samples per byte, high nibble first).
+class IMACodec : public VoiceCodec
+{
+public:
+	int16_t Prev;
+	int8_t Index;
+	
+	IMACodec( void );
+	virtual ~IMACodec();
+	
+	void Reset( void );
+	size_t MaxEncodedBytes( size_t samples ) const;
+	size_t Encode( const int16_t *from, size_t samples, uint8_t *into, double volume = 1. );
+	size_t Decode( const uint8_t *from, size_t bytes, int16_t *into, size_t samples );
+};
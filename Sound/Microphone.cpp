@@ -4,7 +4,6 @@
 
 #include "Microphone.h"
 
-#include "IMA.h"
 #include "Num.h"
 #include "RaptorGame.h"
 
@@ -43,6 +42,9 @@ Microphone::Microphone( void )
 #elif defined(MACOSX_MICROPHONE)
 	Device = NULL;
 	memset( Buffers, 0, sizeof(Buffers) );
+	
+	// The audio queue thread fills Recorded, so it must not grow; this holds about 3 seconds at 22KHz mono.
+	Recorded.Capacity = Recorded.MaxCapacity = 131072;
 #else
 	Device = false;
 #endif
@@ -55,6 +57,7 @@ Microphone::Microphone( void )
 	VoiceChannel = Raptor::VoiceChannel::ALL;
 	Transmitting = Raptor::VoiceChannel::NONE;
 	FromObject = 0;
+	Codec = VoiceCodec::Create( VoiceCodec::CODEC_IMA );
 }
 
 
@@ -73,6 +76,9 @@ Microphone::~Microphone()
 		Device = NULL;
 	}
 #endif
+
+	delete Codec;
+	Codec = NULL;
 }
 
 
@@ -197,7 +203,7 @@ bool Microphone::Transmit( double min_secs, double max_secs, uint8_t flags )
 #if SDL_VERSION_ATLEAST(2,0,0)
 	Uint32 ready_bytes = SDL_GetQueuedAudioSize( Device );
 #elif defined(MACOSX_MICROPHONE)
-	Uint32 ready_bytes = Recorded.Filled;
+	Uint32 ready_bytes = Recorded.ReadyBytes();
 #else
 	Uint32 ready_bytes = 0;
 #endif
@@ -218,17 +224,19 @@ bool Microphone::Transmit( double min_secs, double max_secs, uint8_t flags )
 	voice.AddUShort( Raptor::Game->PlayerID );
 	voice.AddUInt( FromObject );
 	voice.AddUChar( VoiceChannel | flags );
-	voice.AddUInt( 22050 );  // Sample Rate
+	voice.AddUInt( VoiceCodec::PackRate( Codec->ID, 22050 ) );  // Codec and Sample Rate
 	voice.AddUInt( ready_bytes / bpf );  // Samples
 	
 	int16_t buffer[ 2048 ] = {0};
-	uint8_t imabuf[ 1024 ] = {0};
-	int16_t ima_prev = 0;
-	int8_t ima_index = 0;
+	uint8_t encoded[ 4096 ] = {0};
 	Uint32 total_samples = 0;
 	Uint32 loops = (ready_bytes + sizeof(buffer) - 1) / sizeof(buffer);
 	double volume = Raptor::Game->Cfg.SettingAsDouble( "s_mic_volume", 1., 1. );
 	
+	// IMA doesn't handle clipping well, so only volume reduction is applied before encoding.
+	double encode_volume = ((volume > 0.) && (volume < 1.)) ? volume : 1.;
+	Codec->Reset();
+	
 	for( Uint32 loop = 0; loop < loops; loop ++ )
 	{
 #if SDL_VERSION_ATLEAST(2,0,0)
@@ -239,15 +247,10 @@ bool Microphone::Transmit( double min_secs, double max_secs, uint8_t flags )
 		Uint32 bytes = 0;
 #endif
 		Uint32 samples = std::min<Uint32>( bytes, sizeof(buffer) ) / bpf;
-		if( ! samples )
+		if( (! samples) || (Codec->MaxEncodedBytes( samples ) > sizeof(encoded)) )
 			break;
-		if( (volume > 0.) && (volume < 1.) )  // IMA doesn't handle clipping well, so only volume reduction is allowed before encoding.
-		{
-			for( Uint32 sample = 0; sample < samples; sample ++ )
-				buffer[ sample ] = Num::ScaleInt16( buffer[ sample ], volume );
-		}
-		IMA::EncodeSegment( buffer, imabuf, samples, &ima_prev, &ima_index );
-		voice.AddData( imabuf, (samples + 1) / 2 );  // IMA encodes 2 samples per byte.
+		size_t encoded_bytes = Codec->Encode( buffer, samples, encoded, encode_volume );
+		voice.AddData( encoded, encoded_bytes );
 		total_samples += samples;
 	}
 	
@@ -11,6 +11,7 @@ class Microphone;
 #include <stdint.h>
 #include "Packet.h"
 #include "PlaybackBuffer.h"
+#include "VoiceCodec.h"
 
 #ifdef SDL2
 	#include <SDL2/SDL.h>
@@ -40,6 +41,7 @@ public:
 	SDL_AudioSpec Spec;
 	uint8_t VoiceChannel, Transmitting;
 	uint32_t FromObject;
+	VoiceCodec *Codec;
 	
 	Microphone( void );
 	virtual ~Microphone();
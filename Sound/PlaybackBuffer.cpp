@@ -6,144 +6,195 @@
 
 #include <stdio.h>
 #include <algorithm>
+#include "Atomic.h"
+#include "Num.h"
 #include "RaptorGame.h"
 
 
-PlaybackBuffer::PlaybackBuffer( void )
+PlaybackBuffer::PlaybackBuffer( size_t capacity, size_t max_capacity )
 {
 	SampleRate = 22050;
 	Channels = 1;
 	BytesPerSample = 2;
-	Allocated = Filled = 0;
 	Data = NULL;
-	AllocationChunkSize = 32768;
+	WritePos = ReadPos = 0;
+	Underruns = Overruns = 0;
 	AudioChannel = -1;
 	VoiceChannel = Raptor::VoiceChannel::NONE;
+	
+	// Positions wrap with 32-bit arithmetic, so capacity must be a power of two.
+	Capacity = Num::NextPowerOfTwo( std::min<size_t>( std::max<size_t>( capacity, 1024 ), 0x40000000 ) );
+	MaxCapacity = std::max<size_t>( Capacity, Num::NextPowerOfTwo( std::min<size_t>( max_capacity, 0x40000000 ) ) );
 }
 
 
 PlaybackBuffer::~PlaybackBuffer()
 {
-	if( Allocated )
-		free( Data );
+	free( Data );
 	Data = NULL;
-	Allocated = 0;
-	Filled = 0;
+	WritePos = ReadPos = 0;
 	AudioChannel = -1;
 }
 
 
+bool PlaybackBuffer::Allocate( void )
+{
+	// Memory is allocated on first use and only moves by Grow, so the consumer can read it without locking.
+	if( ! Data )
+		Data = (uint8_t *) malloc( Capacity );
+	return Data;
+}
+
+
+// Producer side: double the ring until it can hold the needed bytes, keeping what is ready to play.
+// Only called when MaxCapacity allows growth, which means the consumer is on this same thread.
+bool PlaybackBuffer::Grow( size_t needed )
+{
+	if( Capacity >= MaxCapacity )
+		return false;
+	
+	size_t capacity = Capacity;
+	while( (capacity < needed) && (capacity < MaxCapacity) )
+		capacity *= 2;
+	
+	uint8_t *data = (uint8_t *) malloc( capacity );
+	if( ! data )
+		return false;
+	
+	// Unwrap the ready audio to the start of the new ring.
+	size_t ready = ConsumeBytes( data, ReadyBytes() );
+	free( Data );
+	Data = data;
+	Capacity = capacity;
+	ReadPos = 0;
+	WritePos = ready;
+	return true;
+}
+
+
+// Producer side: append audio, dropping whatever does not fit.
 void PlaybackBuffer::AddBytes( const void *data, size_t add_bytes )
 {
 	if( !( data && add_bytes ) )
 		return;
 	
-	Lock.Lock();
+	if( ! Allocate() )
+		return;
+	
+	uint32_t write = WritePos;
+	uint32_t read = Atomic::Load( &ReadPos );
+	size_t space = Capacity - (size_t)( write - read );
 	
-	if( MakeRoom(add_bytes) )
+	if( (add_bytes > space) && Grow( (size_t)( write - read ) + add_bytes ) )
 	{
-		memcpy( Data + Filled, data, add_bytes );
-		Filled += add_bytes;
+		write = WritePos;
+		read = ReadPos;
+		space = Capacity - (size_t)( write - read );
 	}
 	
-	Lock.Unlock();
+	if( add_bytes > space )
+	{
+		Atomic::Add( &Overruns, 1 );
+		add_bytes = space;
+		if( ! add_bytes )
+			return;
+	}
+	
+	size_t index = write & (Capacity - 1);
+	size_t first = std::min<size_t>( add_bytes, Capacity - index );
+	memcpy( Data + index, data, first );
+	if( first < add_bytes )
+		memcpy( Data, ((const uint8_t*) data) + first, add_bytes - first );
+	
+	// Publish the new data only after it has been copied in.
+	Atomic::Store( &WritePos, (int32_t)( write + add_bytes ) );
 }
 
 
+// Consumer side: copy out (or discard, if dest is NULL) up to the requested bytes.
 size_t PlaybackBuffer::ConsumeBytes( void *dest, size_t bytes )
 {
-	Lock.Lock();
+	uint32_t read = ReadPos;
+	uint32_t write = Atomic::Load( &WritePos );
+	size_t available = (size_t)( write - read );
+	
+	if( ! available )
+	{
+		if( bytes )
+			Atomic::Add( &Underruns, 1 );
+		return 0;
+	}
 	
-	if( bytes > Filled )
-		bytes = Filled;
+	if( bytes > available )
+		bytes = available;
 	
 	if( dest )
-		memcpy( dest, Data, bytes );
-	Filled -= bytes;
-	
-	// Scoot any audio we still have.
-	if( Filled )
-		memmove( Data, Data + bytes, Filled );
+	{
+		size_t index = read & (Capacity - 1);
+		size_t first = std::min<size_t>( bytes, Capacity - index );
+		memcpy( dest, Data + index, first );
+		if( first < bytes )
+			memcpy( ((uint8_t*) dest) + first, Data, bytes - first );
+	}
 	
-	Lock.Unlock();
+	// Release the space back to the producer.
+	Atomic::Store( &ReadPos, (int32_t)( read + bytes ) );
 	
 	return bytes;
 }
 
 
-bool PlaybackBuffer::MakeRoom( size_t add_bytes )
+size_t PlaybackBuffer::ReadyBytes( void ) const
 {
-	// If we've never allocated, do so!
-	if( ! Data )
-	{
-		// Determine how much to allocate.
-		size_t add_mem = add_bytes;
-		if( AllocationChunkSize > 1 )
-			add_mem = std::max<size_t>( 1, (add_bytes + AllocationChunkSize - 1) / AllocationChunkSize ) * AllocationChunkSize;
-		
-		// Create data allocation for this packet.
-		Data = (uint8_t *) malloc( add_mem );
-		if( Data )
-			Allocated = add_mem;
-		else
-		{
-			Allocated = 0;
-			return false;
-		}
-	}
-	
-	// If we don't have enough memory yet, allocate more!
-	else if( Filled + add_bytes > Allocated )
-	{
-		// Determine how much to add.
-		size_t add_mem = add_bytes;
-		if( AllocationChunkSize > 1 )
-			add_mem = std::max<size_t>( 1, (Filled + add_bytes - Allocated + AllocationChunkSize - 1) / AllocationChunkSize ) * AllocationChunkSize;
-		
-		// Increase allocation for this packet.
-		uint8_t *new_data = (uint8_t *) realloc( Data, Allocated + add_mem );
-		if( new_data )
-		{
-			Data = new_data;
-			Allocated += add_mem;
-		}
-		else
-			return false;
-	}
-	
-	return true;
+	return (uint32_t) WritePos - (uint32_t) ReadPos;
 }
 
 
 int PlaybackBuffer::PlayAvailable( void )
 {
-	if( ! Filled )
+	size_t bytes = ReadyBytes();
+	if( ! bytes )
 		return -1;
 	
-	Lock.Lock();
+	uint32_t read = ReadPos;
+	size_t index = read & (Capacity - 1);
+	const uint8_t *pcm = Data + index;
+	uint8_t *unwrapped = NULL;
 	
-	Mix_Chunk *chunk = Raptor::Game->Snd.AllocatePCM( Data, Filled / (BytesPerSample * Channels), SampleRate, BytesPerSample, Channels );
+	// Audio that wraps past the end of the ring must be made contiguous for the mixer.
+	if( index + bytes > Capacity )
+	{
+		unwrapped = (uint8_t*) malloc( bytes );
+		if( ! unwrapped )
+			return -1;
+		memcpy( unwrapped, pcm, Capacity - index );
+		memcpy( unwrapped + Capacity - index, Data, bytes - (Capacity - index) );
+		pcm = unwrapped;
+	}
+	
+	SoundOutPCM *chunk = Raptor::Game->Snd.AllocatePooledPCM( pcm, bytes / (BytesPerSample * Channels), SampleRate, BytesPerSample, Channels );
+	free( unwrapped );
+	if( ! chunk )
+		return -1;
 	
-	AudioChannel = Raptor::Game->Snd.Play( chunk, AudioChannel );
+	AudioChannel = Raptor::Game->Snd.Play( &(chunk->Chunk), AudioChannel );
 	
 	if( AudioChannel >= 0 )
 	{
-		Mix_Chunk *garbage = Raptor::Game->Snd.Allocated[ AudioChannel ];
-		Raptor::Game->Snd.Allocated[ AudioChannel ] = chunk;
+		SoundOutPCM *garbage = Raptor::Game->Snd.AllocatedPCM[ AudioChannel ];
+		Raptor::Game->Snd.AllocatedPCM[ AudioChannel ] = chunk;
 		if( garbage )
-			Mix_FreeChunk( garbage );
+			Raptor::Game->Snd.FreePooledPCM( garbage );
 		
 		PlaybackBuffer *prev_buffer = Raptor::Game->Snd.PlayingBuffers[ AudioChannel ];
 		if( prev_buffer && (prev_buffer != this) )
 			prev_buffer->AudioChannel = -1;
 		Raptor::Game->Snd.PlayingBuffers[ AudioChannel ] = this;
 		
-		Filled = 0;
+		ConsumeBytes( NULL, bytes );
 	}
 	else
-		Mix_FreeChunk( chunk );
-	
-	Lock.Unlock();
+		Raptor::Game->Snd.FreePooledPCM( chunk );
 	
 	return AudioChannel;
 }
@@ -158,5 +209,5 @@ int PlaybackBuffer::PlayAvailable( int snd_channel )
 
 double PlaybackBuffer::ReadySeconds( void ) const
 {
-	return Filled / (double) (SampleRate * BytesPerSample * Channels);
+	return ReadyBytes() / (double) (SampleRate * BytesPerSample * Channels);
 }
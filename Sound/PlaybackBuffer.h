@@ -8,28 +8,38 @@ class PlaybackBuffer;
 #include "PlatformSpecific.h"
 #include <stdio.h>
 #include <stdint.h>
-#include "Mutex.h"
 
+#define PLAYBACKBUFFER_DEFAULT_CAPACITY 32768
+#define PLAYBACKBUFFER_MAX_CAPACITY 2097152
 
+
+// Ring of PCM audio for one producer and one consumer, with no locks.  It starts around the latency target
+// and doubles when full, up to MaxCapacity.  Growing moves the data, so a ring whose producer and consumer
+// are different threads must be fixed-size (max_capacity no larger than capacity).
 class PlaybackBuffer
 {
 public:
 	uint32_t SampleRate;
 	uint8_t Channels;
 	uint8_t BytesPerSample;
-	size_t Allocated, Filled, AllocationChunkSize;
+	size_t Capacity, MaxCapacity;
 	uint8_t *Data;
-	Mutex Lock;
+	volatile int32_t WritePos, ReadPos;
+	volatile int32_t Underruns, Overruns;
 	int AudioChannel;
 	uint8_t VoiceChannel;
 	
-	PlaybackBuffer( void );
+	PlaybackBuffer( size_t capacity = PLAYBACKBUFFER_DEFAULT_CAPACITY, size_t max_capacity = PLAYBACKBUFFER_MAX_CAPACITY );
 	virtual ~PlaybackBuffer();
 	
 	void AddBytes( const void *data, size_t bytes );
 	size_t ConsumeBytes( void *dest, size_t bytes );
-	bool MakeRoom( size_t add_bytes );
+	size_t ReadyBytes( void ) const;
 	int PlayAvailable( void );
 	int PlayAvailable( int snd_channel );
 	double ReadySeconds( void ) const;
+
+private:
+	bool Allocate( void );
+	bool Grow( size_t needed );
 };
@@ -31,6 +31,13 @@ SoundOut::SoundOut( void )
 	SoundAttenuate = 1.f;
 	MusicAttenuate = 1.f;
 	AttenuateFor = -1;
+	
+	// Voices are never reallocated, because the mixer may be playing their Remainder chunks.
+	Voices.reserve( SOUNDOUT_MAX_VOICES );
+	VoicesReal = 0;
+	VoicesVirtual = 0;
+	MixRate = 0;
+	MixBytesPerFrame = 0;
 }
 
 
@@ -38,6 +45,10 @@ SoundOut::~SoundOut()
 {
 	StopMusic();
 	
+	for( std::map<uint8_t, VoiceCodec*>::iterator codec_iter = VoiceDecoders.begin(); codec_iter != VoiceDecoders.end(); codec_iter ++ )
+		delete codec_iter->second;
+	VoiceDecoders.clear();
+	
 	if( Initialized )
 	{
 		Mix_CloseAudio();
@@ -45,6 +56,14 @@ SoundOut::~SoundOut()
 	}
 	
 	Initialized = false;
+	
+	// The mixer is closed, so no channel can still be reading these.
+	for( std::map<int, SoundOutPCM*>::iterator pcm_iter = AllocatedPCM.begin(); pcm_iter != AllocatedPCM.end(); pcm_iter ++ )
+		delete pcm_iter->second;
+	AllocatedPCM.clear();
+	for( std::vector<SoundOutPCM*>::iterator pcm_iter = PCMPool.begin(); pcm_iter != PCMPool.end(); pcm_iter ++ )
+		delete *pcm_iter;
+	PCMPool.clear();
 }
 
 
@@ -122,6 +141,13 @@ void SoundOut::Initialize( int channels, int rate, int depth, int buffer, int mi
 	
 	// Get the number of actual mixing channels available.
 	Channels = Mix_AllocateChannels( -1 );
+	ChannelVoices.assign( std::max<int>( 0, Channels ), -1 );
+	
+	// Remember the output format so virtual voices can resume partway through a chunk.
+	int output_channels = 0;
+	Uint16 output_format = 0;
+	Mix_QuerySpec( &MixRate, &output_format, &output_channels );
+	MixBytesPerFrame = (output_format & 0xFF) / 8 * output_channels;
 	
 	// Done initializing.
 	Initialized = true;
@@ -143,10 +169,35 @@ int SoundOut::Play( Mix_Chunk *sound, int channel )
 	if( ! sound )
 		return -1;
 	
+	bool continuing = (channel >= 0);
 	channel = Mix_PlayChannelTimed( channel, sound, 0, -1 );
 	
+	// Non-positional sounds (interface, voice chat) take priority over the least audible effect.
+	if( (channel < 0) && ! continuing )
+	{
+		int weakest = WeakestVoice();
+		if( weakest >= 0 )
+		{
+			channel = Voices[ weakest ].AudioChannel;
+			StopVoice( weakest, true );
+			channel = Mix_PlayChannelTimed( channel, sound, 0, -1 );
+		}
+	}
+	
 	if( channel >= 0 )
+	{
 		ActiveChannels.insert( channel );
+		
+		// Anything playing here before was replaced, but keep panning streams that continue on their own channel.
+		int index = ((size_t) channel < ChannelVoices.size()) ? ChannelVoices[ channel ] : -1;
+		if( (index >= 0) && !( continuing && Voices[ index ].Locked ) )
+		{
+			if( Voices[ index ].Locked )
+				FreeVoice( index, false );
+			else
+				StopVoice( index, false );
+		}
+	}
 	
 	UpdateVolumes();
 	
@@ -198,19 +249,151 @@ int SoundOut::PlayBuffer( PlaybackBuffer *buffer, int16_t angle, uint8_t dist )
 }
 
 
+// Returns the mixer channel, or -1 if it couldn't get one; use PlayVoiceAt to keep a handle to a virtual voice.
 int SoundOut::PlayAt( Mix_Chunk *sound, double x, double y, double z, double loudness )
 {
-	if( loudness <= 0. )
-		return -1;
-	return Pan3D( Play(sound), x, y, z, loudness );
+	return VoiceChannel( PlayVoice( sound, x, y, z, 0, loudness ) );
+}
+
+
+VoiceCodec *SoundOut::GetVoiceDecoder( uint8_t codec_id )
+{
+	// Keep one decoder per codec; returns NULL for codecs this build doesn't support.
+	std::map<uint8_t, VoiceCodec*>::iterator codec_iter = VoiceDecoders.find( codec_id );
+	if( codec_iter != VoiceDecoders.end() )
+		return codec_iter->second;
+	
+	VoiceCodec *codec = VoiceCodec::Create( codec_id );
+	VoiceDecoders[ codec_id ] = codec;
+	return codec;
 }
 
 
 Mix_Chunk *SoundOut::AllocatePCM( const void *data, size_t samples, uint32_t sample_rate, uint8_t bytes_per_sample, uint8_t channels )
+{
+	// The caller owns the result and frees it with Mix_FreeChunk, so it can't come from the pool.
+	SoundOutPCM pcm;
+	if( ! ConvertPCM( &pcm, data, samples, sample_rate, bytes_per_sample, channels ) )
+		return AllocateWAV( data, samples, sample_rate, bytes_per_sample, channels );
+	
+	Mix_Chunk *chunk = (Mix_Chunk*) SDL_malloc( sizeof(Mix_Chunk) );
+	Uint8 *abuf = (Uint8*) SDL_malloc( std::max<size_t>( 1, pcm.Chunk.alen ) );
+	if( ! (chunk && abuf) )
+	{
+		Raptor::Game->Console.Print( "SoundOut::AllocatePCM: malloc failed!", TextConsole::MSG_ERROR );
+		SDL_free( chunk );
+		SDL_free( abuf );
+		return NULL;
+	}
+	
+	memcpy( abuf, pcm.Buffer, pcm.Chunk.alen );
+	chunk->allocated = 1;
+	chunk->abuf = abuf;
+	chunk->alen = pcm.Chunk.alen;
+	chunk->volume = MIX_MAX_VOLUME;
+	return chunk;
+}
+
+
+SoundOutPCM *SoundOut::AllocatePooledPCM( const void *data, size_t samples, uint32_t sample_rate, uint8_t bytes_per_sample, uint8_t channels )
 {
 	if( ! (data && bytes_per_sample && sample_rate && channels) )
 		return NULL;
 	
+	SoundOutPCM *pcm = NULL;
+	if( PCMPool.size() )
+	{
+		pcm = PCMPool.back();
+		PCMPool.pop_back();
+	}
+	else
+		pcm = new SoundOutPCM();
+	
+	if( ConvertPCM( pcm, data, samples, sample_rate, bytes_per_sample, channels ) )
+		return pcm;
+	
+	// Anything SDL can't convert directly is decoded through a WAV wrapper, then copied into the pooled buffer.
+	Mix_Chunk *wav = AllocateWAV( data, samples, sample_rate, bytes_per_sample, channels );
+	if( wav && pcm->MakeRoom( wav->alen ) )
+	{
+		memcpy( pcm->Buffer, wav->abuf, wav->alen );
+		pcm->Chunk.allocated = 0;
+		pcm->Chunk.abuf = pcm->Buffer;
+		pcm->Chunk.alen = wav->alen;
+		pcm->Chunk.volume = MIX_MAX_VOLUME;
+		Mix_FreeChunk( wav );
+		return pcm;
+	}
+	
+	if( wav )
+		Mix_FreeChunk( wav );
+	FreePooledPCM( pcm );
+	return NULL;
+}
+
+
+void SoundOut::FreePooledPCM( SoundOutPCM *pcm )
+{
+	if( ! pcm )
+		return;
+	
+	if( PCMPool.size() < SOUNDOUT_PCM_POOL_SIZE )
+		PCMPool.push_back( pcm );
+	else
+		delete pcm;
+}
+
+
+bool SoundOut::ConvertPCM( SoundOutPCM *pcm, const void *data, size_t samples, uint32_t sample_rate, uint8_t bytes_per_sample, uint8_t channels )
+{
+	if( ! (pcm && data && bytes_per_sample && sample_rate && channels) )
+		return false;
+	
+	int mix_rate = 0, mix_channels = 0;
+	Uint16 mix_format = 0;
+	if( ! Mix_QuerySpec( &mix_rate, &mix_format, &mix_channels ) )
+		return false;
+	
+	Uint16 format = 0;
+	if( bytes_per_sample == 1 )
+		format = AUDIO_U8;
+	else if( bytes_per_sample == 2 )
+		format = AUDIO_S16SYS;
+	
+	// Build the conversion to the mixer's output format.
+	SDL_AudioCVT cvt;
+	if( (! format) || (SDL_BuildAudioCVT( &cvt, format, channels, sample_rate, mix_format, mix_channels, mix_rate ) < 0) )
+		return false;
+	
+	size_t bytes = samples * bytes_per_sample * channels;
+	if( ! pcm->MakeRoom( bytes * std::max<int>( 1, cvt.len_mult ) ) )
+	{
+		Raptor::Game->Console.Print( "SoundOut::ConvertPCM: malloc failed!", TextConsole::MSG_ERROR );
+		return false;
+	}
+	
+	// Convert in place within the buffer, then point the chunk straight at the result.
+	memcpy( pcm->Buffer, data, bytes );
+	size_t converted_bytes = bytes;
+	if( cvt.needed )
+	{
+		cvt.buf = pcm->Buffer;
+		cvt.len = bytes;
+		if( SDL_ConvertAudio( &cvt ) < 0 )
+			return false;
+		converted_bytes = cvt.len_cvt;
+	}
+	
+	pcm->Chunk.allocated = 0;
+	pcm->Chunk.abuf = pcm->Buffer;
+	pcm->Chunk.alen = converted_bytes;
+	pcm->Chunk.volume = MIX_MAX_VOLUME;
+	return true;
+}
+
+
+Mix_Chunk *SoundOut::AllocateWAV( const void *data, size_t samples, uint32_t sample_rate, uint8_t bytes_per_sample, uint8_t channels )
+{
 	uint8_t  bytes_per_frame = channels * bytes_per_sample;
 	uint32_t byte_rate = sample_rate * bytes_per_frame;
 	uint32_t size2 = samples * bytes_per_frame;
@@ -251,6 +434,12 @@ void SoundOut::StopSounds( void )
 {
 	Mix_HaltChannel( -1 );
 	Delayed.clear();
+	
+	for( size_t index = 0; index < Voices.size(); index ++ )
+	{
+		if( Voices[ index ].Active )
+			FreeVoice( index, false );
+	}
 }
 
 
@@ -285,34 +474,73 @@ int SoundOut::Pan2D( int channel, int16_t angle, uint8_t dist )
 
 
 int SoundOut::Pan3D( int channel, double x, double y, double z, double loudness )
+{
+	double angle = 0.;
+	double dist = PanDist( x, y, z, loudness, &angle );
+	return Pan2D( channel, angle, dist );
+}
+
+
+double SoundOut::PanDist( double x, double y, double z, double loudness, double *angle ) const
 {
 	Vec3D cam_to_pt( x - Cam.X, y - Cam.Y, z - Cam.Z );
 	double fwd_dot   = Cam.Fwd.Dot(   &cam_to_pt );
 	double right_dot = Cam.Right.Dot( &cam_to_pt );
 	
-	double angle = Num::RadToDeg( atan2( right_dot, fwd_dot ) );
-	if( angle < 0. )
-		angle += 360.;
+	*angle = Num::RadToDeg( atan2( right_dot, fwd_dot ) );
+	if( *angle < 0. )
+		*angle += 360.;
 	
 	double real_dist = sqrt( (Cam.X-x)*(Cam.X-x) + (Cam.Y-y)*(Cam.Y-y) + (Cam.Z-z)*(Cam.Z-z) ) * DistScale;
 	double dist = loudness ? (real_dist / loudness) : 255.1;
 	if( dist > 255.1 )
 		dist = 255.1;
 	else if( real_dist < 0.1 )  // Prevent jittery sound direction when extremely close to camera.
-		angle = 0.;
+		*angle = 0.;
 	
-	return Pan2D( channel, angle, dist );
+	return dist;
 }
 
 
 int SoundOut::PanWithObject( int channel, uint32_t object_id, double loudness )
 {
-	if( channel >= 0 )
+	if( (channel < 0) || ((size_t) channel >= ChannelVoices.size()) )
+		return channel;
+	
+	// Attach a locked voice to a channel that was already started (such as voice chat), so it follows the object.
+	int index = ChannelVoices[ channel ];
+	if( (index >= 0) && ! Voices[ index ].Locked )
+	{
+		StopVoice( index, false );
+		index = -1;
+	}
+	
+	if( index < 0 )
+	{
+		index = AllocateVoice();
+		if( index < 0 )
+			return channel;
+		Voices[ index ].Locked = true;
+		Voices[ index ].AudioChannel = channel;
+		ChannelVoices[ channel ] = index;
+	}
+	
+	SoundOutVoice *voice = &(Voices[ index ]);
+	HidePan( index );
+	voice->ObjectID = object_id;
+	voice->Loudness = loudness;
+	
+	const GameObject *obj = Raptor::Game->Data.GetObject( object_id );
+	if( obj )
 	{
-		ActivePans[ channel ] = PanningSound( channel, object_id, loudness );
-		ObjectPans[ object_id ] = channel;
-		RecentPans[ object_id ].Reset();
+		voice->X = obj->X;
+		voice->Y = obj->Y;
+		voice->Z = obj->Z;
 	}
+	Pan3D( channel, voice->X, voice->Y, voice->Z, loudness );
+	
+	ShowPan( index );
+	MarkRecentPan( object_id );
 	
 	return channel;
 }
@@ -320,53 +548,44 @@ int SoundOut::PanWithObject( int channel, uint32_t object_id, double loudness )
 
 int SoundOut::PlayPanned( Mix_Chunk *sound, double x, double y, double z, double loudness )
 {
-	int channel = PlayAt( sound, x, y, z, loudness );
-	
-	if( channel >= 0 )
-		ActivePans[ channel ] = PanningSound( channel, x, y, z, loudness );
-	
-	return channel;
+	return VoiceChannel( PlayVoice( sound, x, y, z, 0, loudness ) );
 }
 
 
 int SoundOut::PlayFromObject( Mix_Chunk *sound, const GameObject *obj, double loudness )
 {
-	int channel = -1;
-	
-	if( obj )
-	{
-		channel = PlayAt( sound, obj->X, obj->Y, obj->Z, loudness );
-		
-		if( channel >= 0 )
-		{
-			ActivePans[ channel ] = PanningSound( channel, obj->ID, loudness );
-			ObjectPans[ obj->ID ] = channel;
-			RecentPans[ obj->ID ].Reset();
-		}
-	}
-	
-	return channel;
+	return VoiceChannel( PlayVoiceFromObject( sound, obj, loudness ) );
 }
 
 
 int SoundOut::PlayFromObject( Mix_Chunk *sound, uint32_t object_id, double loudness )
 {
-	int channel = -1;
+	return VoiceChannel( PlayVoiceFromObject( sound, object_id, loudness ) );
+}
+
+
+SoundOutHandle SoundOut::PlayVoiceAt( Mix_Chunk *sound, double x, double y, double z, double loudness )
+{
+	return PlayVoice( sound, x, y, z, 0, loudness );
+}
+
+
+SoundOutHandle SoundOut::PlayVoiceFromObject( Mix_Chunk *sound, const GameObject *obj, double loudness )
+{
+	if( ! obj )
+		return SoundOutHandle();
 	
-	GameObject *obj = Raptor::Game->Data.GetObject( object_id );
-	if( obj )
-	{
-		channel = PlayAt( sound, obj->X, obj->Y, obj->Z, loudness );
-		
-		if( channel >= 0 )
-		{
-			ActivePans[ channel ] = PanningSound( channel, object_id, loudness );
-			ObjectPans[ object_id ] = channel;
-			RecentPans[ object_id ].Reset();
-		}
-	}
+	SoundOutHandle handle = PlayVoice( sound, obj->X, obj->Y, obj->Z, obj->ID, loudness );
+	if( handle.Valid() )
+		MarkRecentPan( obj->ID );
 	
-	return channel;
+	return handle;
+}
+
+
+SoundOutHandle SoundOut::PlayVoiceFromObject( Mix_Chunk *sound, uint32_t object_id, double loudness )
+{
+	return PlayVoiceFromObject( sound, Raptor::Game->Data.GetObject( object_id ), loudness );
 }
 
 
@@ -376,24 +595,87 @@ void SoundOut::PlayDelayedFromObject( Mix_Chunk *sound, double delay, uint32_t o
 }
 
 
+// Moves whatever positional sound is playing on this channel; returns -1 if there isn't one.
 int SoundOut::SetPos( int channel, double x, double y, double z )
 {
-	if( ! Initialized )
+	if( (channel < 0) || ((size_t) channel >= ChannelVoices.size()) || ! IsPlaying( channel ) )
 		return -1;
 	
-	if( channel >= 0 )
+	int index = ChannelVoices[ channel ];
+	if( index < 0 )
+		return -1;
+	
+	Voices[ index ].X = x;
+	Voices[ index ].Y = y;
+	Voices[ index ].Z = z;
+	
+	return channel;
+}
+
+
+// Returns false if the voice has finished, even if its slot was reused since.
+bool SoundOut::SetVoicePos( SoundOutHandle handle, double x, double y, double z )
+{
+	SoundOutVoice *voice = GetVoice( handle );
+	if( ! voice )
+		return false;
+	
+	voice->X = x;
+	voice->Y = y;
+	voice->Z = z;
+	
+	return true;
+}
+
+
+// The mixer channel currently playing this voice, or -1 if it's virtual or finished.
+int SoundOut::VoiceChannel( SoundOutHandle handle )
+{
+	SoundOutVoice *voice = GetVoice( handle );
+	return voice ? voice->AudioChannel : -1;
+}
+
+
+SoundOutVoice *SoundOut::GetVoice( SoundOutHandle handle )
+{
+	if( ! handle.Valid() )
+		return NULL;
+	
+	// Handles combine the slot index with a generation, so stale handles from finished sounds are rejected.
+	size_t index = handle.Index();
+	if( (index >= Voices.size()) || ! Voices[ index ].Active || (Voices[ index ].Generation != handle.Generation()) )
+		return NULL;
+	
+	return &(Voices[ index ]);
+}
+
+
+const Clock *SoundOut::RecentPan( uint32_t object_id ) const
+{
+	for( size_t i = 0; i < RecentPanObjects.size(); i ++ )
 	{
-		if( ! IsPlaying(channel) )
-			return -1;
-		
-		std::map<int, PanningSound>::iterator this_pan = ActivePans.find(channel);
-		if( this_pan == ActivePans.end() )
-			return -1;
-		else
-			this_pan->second.Set( x, y, z );
+		if( RecentPanObjects[ i ] == object_id )
+			return &(RecentPanClocks[ i ]);
 	}
 	
-	return channel;
+	return NULL;
+}
+
+
+void SoundOut::MarkRecentPan( uint32_t object_id )
+{
+	// Only objects that made a sound lately are listed, so a linear search of the flat arrays is quick.
+	for( size_t i = 0; i < RecentPanObjects.size(); i ++ )
+	{
+		if( RecentPanObjects[ i ] == object_id )
+		{
+			RecentPanClocks[ i ].Reset();
+			return;
+		}
+	}
+	
+	RecentPanObjects.push_back( object_id );
+	RecentPanClocks.push_back( Clock() );
 }
 
 
@@ -417,10 +699,17 @@ void SoundOut::Update( const Pos3D *cam )
 				Allocated.erase( alloc_iter );
 			}
 			
+			std::map<int, SoundOutPCM*>::iterator pcm_iter = AllocatedPCM.find( channel );
+			if( pcm_iter != AllocatedPCM.end() )
+			{
+				FreePooledPCM( pcm_iter->second );
+				AllocatedPCM.erase( pcm_iter );
+			}
+			
 			std::map<int, PlaybackBuffer*>::iterator buffer_iter = PlayingBuffers.find( channel );
 			if( buffer_iter != PlayingBuffers.end() )
 			{
-				if( buffer_iter->second->Filled )
+				if( buffer_iter->second->ReadyBytes() )
 					ended = (buffer_iter->second->PlayAvailable() < 0);
 				
 				if( ended )
@@ -441,49 +730,23 @@ void SoundOut::Update( const Pos3D *cam )
 	
 	
 	if( cam )
-	{
-		// Pan sound effects.
-		
 		Cam = *cam;
-		
-		for( std::map<int, PanningSound>::iterator this_pan = ActivePans.begin(); this_pan != ActivePans.end(); )
-		{
-			std::map<int, PanningSound>::iterator next_pan = this_pan;
-			next_pan ++;
-			
-			this_pan->second.Update();
-			
-			if( IsPlaying( this_pan->first ) )
-				Pan3D( this_pan->first, this_pan->second.X, this_pan->second.Y, this_pan->second.Z, this_pan->second.Loudness );
-			else
-			{
-				if( this_pan->second.ObjectID )
-				{
-					std::map<uint32_t, int>::iterator obj_pan_iter = ObjectPans.find( this_pan->second.ObjectID );
-					if( obj_pan_iter != ObjectPans.end() )
-						ObjectPans.erase( obj_pan_iter );
-				}
-				
-				ActivePans.erase( this_pan );
-				// Remember: Don't delete from RecentPans here so we can know how long ago a sound last played for any object.
-			}
-			
-			this_pan = next_pan;
-		}
-	}
+	
+	// Pan sound effects and give the most audible ones real channels.
+	UpdateVoices();
 	
 	
 	// Forget last sound time of any objects that no longer exist.
 	
-	for( std::map<uint32_t, Clock>::iterator this_pan = RecentPans.begin(); this_pan != RecentPans.end(); )
+	for( size_t i = RecentPanObjects.size(); i --; )
 	{
-		std::map<uint32_t, Clock>::iterator next_pan = this_pan;
-		next_pan ++;
-		
-		if( ! Raptor::Game->Data.GetObject( this_pan->first ) )
-			RecentPans.erase( this_pan );
+		if( Raptor::Game->Data.GetObject( RecentPanObjects[ i ] ) )
+			continue;
 		
-		this_pan = next_pan;
+		RecentPanObjects[ i ] = RecentPanObjects.back();
+		RecentPanObjects.pop_back();
+		RecentPanClocks[ i ] = RecentPanClocks.back();
+		RecentPanClocks.pop_back();
 	}
 	
 	
@@ -494,7 +757,7 @@ void SoundOut::Update( const Pos3D *cam )
 		std::list<SoundOutDelayed>::iterator next_delayed = this_delayed;
 		next_delayed ++;
 		
-		if( this_delayed->Delay.Progress() >= 1. )
+		if( this_delayed->Delay.FrameProgress() >= 1. )
 		{
 			if( this_delayed->ObjectID )
 				PlayFromObject( this_delayed->Sound, this_delayed->ObjectID, this_delayed->Loudness );
@@ -560,6 +823,328 @@ void SoundOut::Update( const Pos3D *cam )
 }
 
 
+// -----------------------------------------------------------------------------
+
+
+SoundOutHandle SoundOut::PlayVoice( Mix_Chunk *sound, double x, double y, double z, uint32_t object_id, double loudness )
+{
+	if( ! (Initialized && sound && MixRate && MixBytesPerFrame) )
+		return SoundOutHandle();
+	if( loudness <= 0. )
+		return SoundOutHandle();
+	
+	int index = AllocateVoice();
+	if( index < 0 )
+		return SoundOutHandle();
+	
+	SoundOutVoice *voice = &(Voices[ index ]);
+	voice->Sound = sound;
+	voice->ObjectID = object_id;
+	voice->X = x;
+	voice->Y = y;
+	voice->Z = z;
+	voice->Loudness = loudness;
+	voice->Duration = sound->alen / (double)( MixRate * MixBytesPerFrame );
+	
+	// Start right away if it's audible; otherwise it waits as a virtual voice until it matters.
+	double angle = 0.;
+	voice->Audibility = 255. - PanDist( x, y, z, loudness, &angle );
+	if( voice->Audibility > 0. )
+		StartVoice( index );
+	
+	return SoundOutHandle( index, voice->Generation );
+}
+
+
+int SoundOut::AllocateVoice( void )
+{
+	int index = -1;
+	if( FreeVoices.size() )
+	{
+		index = FreeVoices.back();
+		FreeVoices.pop_back();
+	}
+	else if( Voices.size() < SOUNDOUT_MAX_VOICES )
+	{
+		index = Voices.size();
+		Voices.push_back( SoundOutVoice() );
+	}
+	else
+		return -1;
+	
+	SoundOutVoice *voice = &(Voices[ index ]);
+	voice->Sound = NULL;
+	voice->ObjectID = 0;
+	voice->Loudness = 1.;
+	voice->Duration = 0.;
+	voice->Audibility = 0.;
+	voice->Started.Reset();
+	voice->AudioChannel = -1;
+	voice->Locked = false;
+	voice->Active = true;
+	voice->Generation = (voice->Generation + 1) & 0x7FFF;
+	
+	return index;
+}
+
+
+int SoundOut::StartVoice( int index )
+{
+	SoundOutVoice *voice = &(Voices[ index ]);
+	
+	// Skip ahead by however long the voice has been virtual, keeping whole sample frames.
+	// This reads the clock rather than the frame time, since a voice may start after this frame began.
+	size_t offset = 0;
+	if( MixBytesPerFrame )
+		offset = (size_t)( voice->Started.ElapsedSeconds() * MixRate ) * MixBytesPerFrame;
+	if( offset + MixBytesPerFrame * MixRate / 50 >= voice->Sound->alen )
+	{
+		// Less than 20ms left, so it isn't worth a channel.
+		FreeVoice( index, false );
+		return -2;
+	}
+	
+	voice->Remainder = *(voice->Sound);
+	voice->Remainder.allocated = 0;
+	voice->Remainder.abuf += offset;
+	voice->Remainder.alen -= offset;
+	
+	int channel = Mix_PlayChannelTimed( -1, &(voice->Remainder), 0, -1 );
+	if( channel < 0 )
+	{
+		// All channels are busy, so steal the least audible one if this voice matters more.
+		int weakest = WeakestVoice();
+		if( (weakest < 0) || (Voices[ weakest ].Audibility >= voice->Audibility) )
+			return -1;
+		
+		channel = Voices[ weakest ].AudioChannel;
+		StopVoice( weakest, true );
+		channel = Mix_PlayChannelTimed( channel, &(voice->Remainder), 0, -1 );
+		if( channel < 0 )
+			return -1;
+	}
+	
+	if( (size_t) channel >= ChannelVoices.size() )
+		ChannelVoices.resize( channel + 1, -1 );
+	
+	// Clear any voice or locked stream that still thought it owned this channel.
+	int previous = ChannelVoices[ channel ];
+	if( (previous >= 0) && (previous != index) )
+	{
+		HidePan( previous );
+		Voices[ previous ].AudioChannel = -1;
+		if( Voices[ previous ].Locked )
+			FreeVoice( previous, false );
+	}
+	
+	ChannelVoices[ channel ] = index;
+	voice->AudioChannel = channel;
+	ActiveChannels.insert( channel );
+	ShowPan( index );
+	
+	double angle = 0.;
+	double dist = PanDist( voice->X, voice->Y, voice->Z, voice->Loudness, &angle );
+	if( ! Mix_SetPosition( channel, angle, dist ) )
+		fprintf( stderr, "Mix_SetPosition: %s\n", Mix_GetError() );
+	
+	return channel;
+}
+
+
+// Find the least audible voice holding a real channel, other than locked streams.
+int SoundOut::WeakestVoice( void ) const
+{
+	int weakest = -1;
+	for( size_t i = 0; i < ChannelVoices.size(); i ++ )
+	{
+		int index = ChannelVoices[ i ];
+		if( (index >= 0) && ! Voices[ index ].Locked && ((weakest < 0) || (Voices[ index ].Audibility < Voices[ weakest ].Audibility)) )
+			weakest = index;
+	}
+	return weakest;
+}
+
+
+// Release the voice's real channel, leaving it virtual.  Locked streams are never halted here.
+void SoundOut::StopVoice( int index, bool halt )
+{
+	HidePan( index );
+	
+	SoundOutVoice *voice = &(Voices[ index ]);
+	int channel = voice->AudioChannel;
+	voice->AudioChannel = -1;
+	
+	if( (channel >= 0) && ((size_t) channel < ChannelVoices.size()) && (ChannelVoices[ channel ] == index) )
+	{
+		ChannelVoices[ channel ] = -1;
+		if( halt && ! voice->Locked )
+			Mix_HaltChannel( channel );
+	}
+}
+
+
+void SoundOut::FreeVoice( int index, bool halt )
+{
+	StopVoice( index, halt );
+	Voices[ index ].Active = false;
+	Voices[ index ].Sound = NULL;
+	FreeVoices.push_back( index );
+}
+
+
+// Mirror a voice that just got a real channel into ActivePans and ObjectPans.
+void SoundOut::ShowPan( int index )
+{
+	SoundOutVoice *voice = &(Voices[ index ]);
+	int channel = voice->AudioChannel;
+	if( channel < 0 )
+		return;
+	
+	// Map nodes never move, so the voice can keep updating its entry without looking it up each frame.
+	PanningSound *pan = &(ActivePans[ channel ]);
+	*pan = PanningSound( channel, voice->X, voice->Y, voice->Z, voice->Loudness );
+	pan->ObjectID = voice->ObjectID;
+	voice->Pan = pan;
+	
+	if( voice->ObjectID )
+		ObjectPans[ voice->ObjectID ] = channel;
+}
+
+
+void SoundOut::HidePan( int index )
+{
+	SoundOutVoice *voice = &(Voices[ index ]);
+	PanningSound *pan = voice->Pan;
+	voice->Pan = NULL;
+	if( ! pan )
+		return;
+	
+	int channel = pan->AudioChannel;
+	if( pan->ObjectID )
+	{
+		std::map<uint32_t, int>::iterator obj_pan_iter = ObjectPans.find( pan->ObjectID );
+		if( (obj_pan_iter != ObjectPans.end()) && (obj_pan_iter->second == channel) )
+			ObjectPans.erase( obj_pan_iter );
+	}
+	
+	std::map<int, PanningSound>::iterator pan_iter = ActivePans.find( channel );
+	if( (pan_iter != ActivePans.end()) && (&(pan_iter->second) == pan) )
+		ActivePans.erase( pan_iter );
+}
+
+
+// Sort voice indices by descending audibility.
+class SoundOutVoiceOrder
+{
+public:
+	const std::vector<SoundOutVoice> *Voices;
+	SoundOutVoiceOrder( const std::vector<SoundOutVoice> *voices ) { Voices = voices; }
+	bool operator()( int a, int b ) const { return (*Voices)[ a ].Audibility > (*Voices)[ b ].Audibility; }
+};
+
+
+void SoundOut::UpdateVoices( void )
+{
+	VoicesReal = 0;
+	VoicesVirtual = 0;
+	VoiceOrder.clear();
+	
+	for( size_t index = 0; index < Voices.size(); index ++ )
+	{
+		SoundOutVoice *voice = &(Voices[ index ]);
+		if( ! voice->Active )
+			continue;
+		
+		// Notice when the mixer finished or another sound took the channel.
+		int channel = voice->AudioChannel;
+		bool playing = (channel >= 0) && ((size_t) channel < ChannelVoices.size()) && (ChannelVoices[ channel ] == (int) index) && IsPlaying( channel );
+		if( (channel >= 0) && ! playing )
+			StopVoice( index, false );
+		
+		// Let finished clips drain from the mixer rather than cutting off its buffered tail.
+		if( voice->Locked ? (! playing) : (voice->Started.FrameSeconds() >= voice->Duration) )
+		{
+			FreeVoice( index, false );
+			continue;
+		}
+		
+		if( voice->ObjectID )
+		{
+			const GameObject *obj = Raptor::Game->Data.GetObject( voice->ObjectID );
+			if( obj )
+			{
+				voice->X = obj->X;
+				voice->Y = obj->Y;
+				voice->Z = obj->Z;
+			}
+			else
+				voice->ObjectID = 0;  // Keep playing where the object was last seen.
+		}
+		
+		if( voice->Pan )
+			voice->Pan->Set( voice->X, voice->Y, voice->Z );
+		
+		double angle = 0.;
+		double dist = PanDist( voice->X, voice->Y, voice->Z, voice->Loudness, &angle );
+		voice->Audibility = 255. - dist;
+		
+		if( voice->Locked )
+		{
+			if( Pan2D( channel, angle, dist ) >= 0 )
+				VoicesReal ++;
+		}
+		else if( playing && (voice->Audibility > 0.) )
+		{
+			if( ! Mix_SetPosition( channel, angle, dist ) )
+				fprintf( stderr, "Mix_SetPosition: %s\n", Mix_GetError() );
+			VoicesReal ++;
+		}
+		else
+		{
+			if( playing )
+				StopVoice( index, true );
+			if( voice->Audibility > 0. )
+				VoiceOrder.push_back( index );
+			VoicesVirtual ++;
+		}
+	}
+	
+	if( VoiceOrder.empty() )
+		return;
+	
+	// Promote the most audible virtual voices to real channels, stealing from quieter ones when full.
+	std::sort( VoiceOrder.begin(), VoiceOrder.end(), SoundOutVoiceOrder( &Voices ) );
+	bool changed = false;
+	for( std::vector<int>::const_iterator order_iter = VoiceOrder.begin(); order_iter != VoiceOrder.end(); order_iter ++ )
+	{
+		if( StartVoice( *order_iter ) == -1 )
+			break;
+		changed = true;
+	}
+	
+	if( ! changed )
+		return;
+	
+	// Promotions may have stolen channels from voices counted as real, so count again.
+	VoicesReal = 0;
+	VoicesVirtual = 0;
+	for( size_t index = 0; index < Voices.size(); index ++ )
+	{
+		if( ! Voices[ index ].Active )
+			continue;
+		if( Voices[ index ].AudioChannel >= 0 )
+			VoicesReal ++;
+		else
+			VoicesVirtual ++;
+	}
+	
+	UpdateVolumes();
+}
+
+
+// -----------------------------------------------------------------------------
+
+
 void SoundOut::UpdateVolumes( void )
 {
 	if( MasterVolume > 1.f )
@@ -801,3 +1386,64 @@ SoundOutDelayed::SoundOutDelayed( const SoundOutDelayed &other )
 SoundOutDelayed::~SoundOutDelayed()
 {
 }
+
+
+// -----------------------------------------------------------------------------
+
+
+SoundOutPCM::SoundOutPCM( void )
+{
+	memset( &Chunk, 0, sizeof(Chunk) );
+	Buffer = NULL;
+	Allocated = 0;
+}
+
+
+SoundOutPCM::~SoundOutPCM()
+{
+	free( Buffer );
+	Buffer = NULL;
+	Allocated = 0;
+}
+
+
+bool SoundOutPCM::MakeRoom( size_t bytes )
+{
+	if( bytes <= Allocated )
+		return true;
+	
+	// Round up so clips of similar length can keep reusing the same buffer.
+	size_t new_size = ((bytes + 32767) / 32768) * 32768;
+	uint8_t *new_buffer = (uint8_t*) realloc( Buffer, new_size );
+	if( ! new_buffer )
+		return false;
+	
+	Buffer = new_buffer;
+	Allocated = new_size;
+	return true;
+}
+
+
+// -----------------------------------------------------------------------------
+
+
+SoundOutVoice::SoundOutVoice( void )
+{
+	Sound = NULL;
+	memset( &Remainder, 0, sizeof(Remainder) );
+	ObjectID = 0;
+	X = Y = Z = 0.;
+	Loudness = 1.;
+	Duration = 0.;
+	Audibility = 0.;
+	AudioChannel = -1;
+	Pan = NULL;
+	Generation = 0;
+	Active = false;
+	Locked = false;
+}
+
+
+SoundOutVoice::~SoundOutVoice()
+{
+}
@@ -5,12 +5,15 @@
 #pragma once
 class SoundOut;
 class SoundOutDelayed;
+class SoundOutPCM;
+class SoundOutVoice;
 
 #include "PlatformSpecific.h"
 #include <cstddef>
 #include <string>
 #include <map>
 #include <queue>
+#include <vector>
 #include <stdint.h>
 #include "Clock.h"
 
@@ -28,8 +31,13 @@ class SoundOutDelayed;
 
 #include "PanningSound.h"
 #include "PlaybackBuffer.h"
+#include "VoiceCodec.h"
+#include "SoundOutHandle.h"
 #include "GameObject.h"
 
+#define SOUNDOUT_PCM_POOL_SIZE 16
+#define SOUNDOUT_MAX_VOICES 1024
+
 
 class SoundOut
 {
@@ -42,11 +50,19 @@ public:
 	std::set<int> ActiveChannels;
 	std::map<int, Mix_Chunk*> Allocated;
 	std::map<int, PlaybackBuffer*> PlayingBuffers;
-	std::map<int, PanningSound> ActivePans;
+	std::vector<SoundOutVoice> Voices;
+	std::vector<int> FreeVoices;
+	std::vector<int> ChannelVoices;
+	std::map<int, PanningSound> ActivePans;  // Read-only view of the voices holding real channels.
 	std::map<uint32_t, int> ObjectPans;
-	std::map<uint32_t, Clock> RecentPans;
+	std::vector<uint32_t> RecentPanObjects;
+	std::vector<Clock> RecentPanClocks;
+	int VoicesReal, VoicesVirtual;
 	std::map<uint16_t, PlaybackBuffer*> VoiceBuffers;
+	std::map<uint8_t, VoiceCodec*> VoiceDecoders;
 	std::list<SoundOutDelayed> Delayed;
+	std::map<int, SoundOutPCM*> AllocatedPCM;
+	std::vector<SoundOutPCM*> PCMPool;
 	float SoundAttenuate, MusicAttenuate;
 	int AttenuateFor;
 	
@@ -69,8 +85,16 @@ public:
 	int PlayBuffer( PlaybackBuffer *buffer, int16_t angle, uint8_t dist );
 	int PlayAt( Mix_Chunk *sound, double x, double y, double z, double loudness = 1. );
 	
+	VoiceCodec *GetVoiceDecoder( uint8_t codec_id );
+	
+	// The caller owns the returned chunk and frees it with Mix_FreeChunk.
 	Mix_Chunk *AllocatePCM( const void *data, size_t samples, uint32_t sample_rate, uint8_t bytes_per_sample = 2, uint8_t channels = 1 );
 	
+	// Pooled PCM belongs to SoundOut: play &(pcm->Chunk), then give it back with FreePooledPCM (never Mix_FreeChunk).
+	// Storing it in AllocatedPCM[ channel ] instead hands it back automatically when that channel finishes.
+	SoundOutPCM *AllocatePooledPCM( const void *data, size_t samples, uint32_t sample_rate, uint8_t bytes_per_sample = 2, uint8_t channels = 1 );
+	void FreePooledPCM( SoundOutPCM *pcm );
+	
 	void StopSounds( void );
 	
 	bool IsPlaying( int channel );
@@ -85,6 +109,17 @@ public:
 	void PlayDelayedFromObject( Mix_Chunk *sound, double delay, uint32_t object_id, double loudness = 1. );
 	int SetPos( int channel, double x, double y, double z );
 	
+	// Positional voices keep playing virtually when they lose their channel, so these return handles instead.
+	SoundOutHandle PlayVoiceAt( Mix_Chunk *sound, double x, double y, double z, double loudness = 1. );
+	SoundOutHandle PlayVoiceFromObject( Mix_Chunk *sound, const GameObject *obj, double loudness = 1. );
+	SoundOutHandle PlayVoiceFromObject( Mix_Chunk *sound, uint32_t object_id, double loudness = 1. );
+	bool SetVoicePos( SoundOutHandle handle, double x, double y, double z );
+	int VoiceChannel( SoundOutHandle handle );
+	SoundOutVoice *GetVoice( SoundOutHandle handle );
+	
+	// When this object last started a sound, or NULL if not since it was created.
+	const Clock *RecentPan( uint32_t object_id ) const;
+	
 	void Update( const Pos3D *cam = NULL );
 	void UpdateVolumes( void );
 	
@@ -100,7 +135,24 @@ public:
 	void QueueMusicSubdir( std::string dir );
 	
 private:
+	int MixRate, MixBytesPerFrame;
+	std::vector<int> VoiceOrder;
+	
+	double PanDist( double x, double y, double z, double loudness, double *angle ) const;
+	SoundOutHandle PlayVoice( Mix_Chunk *sound, double x, double y, double z, uint32_t object_id, double loudness );
+	int AllocateVoice( void );
+	int StartVoice( int index );
+	void StopVoice( int index, bool halt );
+	void FreeVoice( int index, bool halt );
+	int WeakestVoice( void ) const;
+	void UpdateVoices( void );
+	void ShowPan( int index );
+	void HidePan( int index );
+	void MarkRecentPan( uint32_t object_id );
+	
 	void PlayMusicWithRetries( Mix_Music *music );
+	bool ConvertPCM( SoundOutPCM *pcm, const void *data, size_t samples, uint32_t sample_rate, uint8_t bytes_per_sample, uint8_t channels );
+	Mix_Chunk *AllocateWAV( const void *data, size_t samples, uint32_t sample_rate, uint8_t bytes_per_sample, uint8_t channels );
 };
 
 
@@ -116,3 +168,40 @@ public:
 	SoundOutDelayed( const SoundOutDelayed &other );
 	virtual ~SoundOutDelayed();
 };
+
+
+// Reusable sample buffer wrapped by a Mix_Chunk that SDL_mixer does not own.
+class SoundOutPCM
+{
+public:
+	Mix_Chunk Chunk;
+	uint8_t *Buffer;
+	size_t Allocated;
+	
+	SoundOutPCM( void );
+	virtual ~SoundOutPCM();
+	
+	bool MakeRoom( size_t bytes );
+};
+
+
+// A logical positional sound, which only holds a real mixer channel while it is among the most audible.
+class SoundOutVoice
+{
+public:
+	Mix_Chunk *Sound;
+	Mix_Chunk Remainder;
+	uint32_t ObjectID;
+	double X, Y, Z;
+	double Loudness;
+	double Duration;
+	Clock Started;
+	double Audibility;
+	int AudioChannel;
+	PanningSound *Pan;
+	uint16_t Generation;
+	bool Active, Locked;
+	
+	SoundOutVoice( void );
+	virtual ~SoundOutVoice();
+};
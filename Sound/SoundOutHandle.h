@@ -0,0 +1,33 @@
+/*
+ *  SoundOutHandle.h
+ */
+
+#pragma once
+class SoundOutHandle;
+
+#include "PlatformSpecific.h"
+
+#include <cstddef>
+#include <stdint.h>
+
+#define SOUNDOUT_VOICE_INDEX_BITS 10
+
+
+// Identifies a positional voice started by SoundOut::PlayVoiceAt or PlayVoiceFromObject.
+// This is not a mixer channel: the voice may be virtual or move between channels, so ask
+// SoundOut::VoiceChannel when a channel is needed.  The generation makes stale handles harmless.
+class SoundOutHandle
+{
+public:
+	int32_t Value;
+	
+	SoundOutHandle( void ) { Value = -1; }
+	SoundOutHandle( size_t index, uint16_t generation ) { Value = (generation << SOUNDOUT_VOICE_INDEX_BITS) | index; }
+	
+	bool Valid( void ) const { return (Value >= 0); }
+	size_t Index( void ) const { return Value & ((1 << SOUNDOUT_VOICE_INDEX_BITS) - 1); }
+	uint16_t Generation( void ) const { return Value >> SOUNDOUT_VOICE_INDEX_BITS; }
+	
+	bool operator == ( const SoundOutHandle &other ) const { return (Value == other.Value); }
+	bool operator != ( const SoundOutHandle &other ) const { return (Value != other.Value); }
+};
@@ -0,0 +1,48 @@
+/*
+ *  VoiceCodec.cpp
+ */
+
+#include "VoiceCodec.h"
+
+#include "IMACodec.h"
+
+
+VoiceCodec::VoiceCodec( uint8_t id )
+{
+	ID = id;
+}
+
+
+VoiceCodec::~VoiceCodec()
+{
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+VoiceCodec *VoiceCodec::Create( uint8_t id )
+{
+	if( id == CODEC_IMA )
+		return new IMACodec();
+	
+	return NULL;
+}
+
+
+uint32_t VoiceCodec::PackRate( uint8_t codec_id, uint32_t sample_rate )
+{
+	return (((uint32_t) codec_id) << 24) | (sample_rate & 0x00FFFFFF);
+}
+
+
+uint8_t VoiceCodec::UnpackCodec( uint32_t packed_rate )
+{
+	return packed_rate >> 24;
+}
+
+
+uint32_t VoiceCodec::UnpackRate( uint32_t packed_rate )
+{
+	return packed_rate & 0x00FFFFFF;
+}
@@ -0,0 +1,42 @@
+/*
+ *  VoiceCodec.h
+ */
+
+#pragma once
+class VoiceCodec;
+
+#include "PlatformSpecific.h"
+#include <cstddef>
+#include <stdint.h>
+
+
+// Interface for compressing microphone audio into VOICE packets.
+// The codec ID travels in the top byte of the packet's sample rate field, so IMA (0) stays compatible with older clients.
+class VoiceCodec
+{
+public:
+	uint8_t ID;
+	
+	VoiceCodec( uint8_t id );
+	virtual ~VoiceCodec();
+	
+	// Begin a new stream; each VOICE packet is encoded and decoded independently.
+	virtual void Reset( void ) = 0;
+	virtual size_t MaxEncodedBytes( size_t samples ) const = 0;
+	
+	// Continue the current stream, returning bytes written.  Volume below 1 is applied before encoding.
+	virtual size_t Encode( const int16_t *from, size_t samples, uint8_t *into, double volume = 1. ) = 0;
+	
+	// Continue the current stream, returning bytes consumed (0 if there was not enough data).
+	virtual size_t Decode( const uint8_t *from, size_t bytes, int16_t *into, size_t samples ) = 0;
+	
+	enum
+	{
+		CODEC_IMA = 0
+	};
+	
+	static VoiceCodec *Create( uint8_t id );
+	static uint32_t PackRate( uint8_t codec_id, uint32_t sample_rate );
+	static uint8_t UnpackCodec( uint32_t packed_rate );
+	static uint32_t UnpackRate( uint32_t packed_rate );
+};
@@ -6,6 +6,7 @@
 
 #include <cstddef>
 #include "Str.h"
+#include "Num.h"
 #include "Graphics.h"
 #include "ResourceManager.h"
 #include "RaptorGame.h"
@@ -30,6 +31,10 @@ Font::~Font()
 {
 	Initialized = false;
 	
+	if( AtlasPages.size() )
+		glDeleteTextures( AtlasPages.size(), &(AtlasPages[ 0 ]) );
+	AtlasPages.clear();
+	
 	if( TTFont )
 		TTF_CloseFont( TTFont );
 	TTFont = NULL;
@@ -56,8 +61,17 @@ void Font::InitFont( void )
 	Descent = TTF_FontDescent( TTFont );
 	LineSkip = TTF_FontLineSkip( TTFont );
 	
+	// This is also called after the GL context is reset, so the old atlas names are no longer ours to delete.
+	AtlasPages.clear();
+	AtlasSize = 0;
+	AtlasX = 0;
+	AtlasY = 0;
+	AtlasRowHeight = 0;
 	for( int i = 0; i < 256; i ++ )
-		Glyphs[ i ].Tex = 0;
+		Glyphs[ i ].InAtlas = false;
+	
+	MeasureCache.clear();
+	MeasureOrder.clear();
 	
 	LoadedTime.Reset();
 	
@@ -79,16 +93,104 @@ void Font::LoadChar( char c )
 		SDL_Color foreground = { 255, 255, 255, 255 };
 		Glyphs[ (unsigned char) c ].Pic = TTF_RenderText_Blended( TTFont, letter, foreground );
 	}
+}
+
+
+void Font::CreateAtlasPage( void )
+{
+	if( AtlasPages.empty() )
+	{
+		// Room for a 16x16 grid of full-height cells, which holds the whole 8-bit character set.
+		AtlasSize = Num::NextPowerOfTwo( 16 * (Height + FONT_ATLAS_PADDING * 2) );
+		
+		GLint tex_max = 0;
+		glGetIntegerv( GL_MAX_TEXTURE_SIZE, &tex_max );
+		if( (tex_max > 0) && (AtlasSize > tex_max) )
+			AtlasSize = tex_max;
+	}
 	
-	if( (! Glyphs[ (unsigned char) c ].Tex ) && Glyphs[ (unsigned char) c ].Pic )
+	AtlasX = 0;
+	AtlasY = 0;
+	AtlasRowHeight = 0;
+	
+	GLuint page = 0;
+	glGenTextures( 1, &page );
+	AtlasPages.push_back( page );
+	glBindTexture( GL_TEXTURE_2D, page );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, AtlasSize, AtlasSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+}
+
+
+bool Font::PackChar( char c )
+{
+	Glyph *glyph = &(Glyphs[ (unsigned char) c ]);
+	if( glyph->InAtlas )
+		return true;
+	
+	LoadChar( c );
+	SDL_Surface *pic = glyph->Pic;
+	if( ! pic )
+		return false;
+	
+	if( AtlasPages.empty() )
+		CreateAtlasPage();
+	
+	// Each glyph gets a transparent border so linear filtering never samples its neighbours.
+	int w = pic->w + FONT_ATLAS_PADDING * 2;
+	int h = pic->h + FONT_ATLAS_PADDING * 2;
+	if( (w > AtlasSize) || (h > AtlasSize) )
+	{
+		fprintf( stderr, "Font::PackChar: Glyph too large for the atlas in %s at %ipt.\n", Name.c_str(), PointSize );
+		return false;
+	}
+	if( AtlasX + w > AtlasSize )
 	{
-		GLfloat texcoord[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
-		Glyphs[ (unsigned char) c ].Tex = Raptor::Game->Gfx.MakeTexture( Glyphs[ (unsigned char) c ].Pic, GL_LINEAR, GL_CLAMP, texcoord );
-		Glyphs[ (unsigned char) c ].TexMinX = texcoord[ 0 ];
-		Glyphs[ (unsigned char) c ].TexMinY = texcoord[ 1 ];
-		Glyphs[ (unsigned char) c ].TexMaxX = texcoord[ 2 ];
-		Glyphs[ (unsigned char) c ].TexMaxY = texcoord[ 3 ];
+		AtlasX = 0;
+		AtlasY += AtlasRowHeight;
+		AtlasRowHeight = 0;
 	}
+	if( AtlasY + h > AtlasSize )
+		CreateAtlasPage();
+	
+	std::vector<uint8_t> pixels( w * h * 4, 0 );
+	
+	if( SDL_MUSTLOCK( pic ) )
+		SDL_LockSurface( pic );
+	
+	// TTF_RenderText_Blended always returns 32-bit pixels, but the channel order varies.
+	for( int y = 0; y < pic->h; y ++ )
+	{
+		const Uint32 *row = (const Uint32*)( ((const uint8_t*) pic->pixels) + y * pic->pitch );
+		uint8_t *dest = &(pixels[ ((y + FONT_ATLAS_PADDING) * w + FONT_ATLAS_PADDING) * 4 ]);
+		for( int x = 0; x < pic->w; x ++ )
+		{
+			SDL_GetRGBA( row[ x ], pic->format, dest, dest + 1, dest + 2, dest + 3 );
+			dest += 4;
+		}
+	}
+	
+	if( SDL_MUSTLOCK( pic ) )
+		SDL_UnlockSurface( pic );
+	
+	glBindTexture( GL_TEXTURE_2D, AtlasPages.back() );
+	glTexSubImage2D( GL_TEXTURE_2D, 0, AtlasX, AtlasY, w, h, GL_RGBA, GL_UNSIGNED_BYTE, &(pixels[ 0 ]) );
+	
+	glyph->TexMinX = (AtlasX + FONT_ATLAS_PADDING) / (GLfloat) AtlasSize;
+	glyph->TexMinY = (AtlasY + FONT_ATLAS_PADDING) / (GLfloat) AtlasSize;
+	glyph->TexMaxX = (AtlasX + FONT_ATLAS_PADDING + pic->w) / (GLfloat) AtlasSize;
+	glyph->TexMaxY = (AtlasY + FONT_ATLAS_PADDING + pic->h) / (GLfloat) AtlasSize;
+	glyph->Page = AtlasPages.size() - 1;
+	glyph->InAtlas = true;
+	
+	AtlasX += w;
+	if( h > AtlasRowHeight )
+		AtlasRowHeight = h;
+	
+	return true;
 }
 
 
@@ -116,11 +218,18 @@ int Font::GetDescent( void )
 }
 
 
-void Font::TextSize( std::string text, SDL_Rect *r )
+void Font::TextSize( const std::string &text, SDL_Rect *r )
 {
 	if( ! Initialized )
 		return;
 	
+	Measured *cached = CachedMeasure( text );
+	if( cached->HasSize )
+	{
+		*r = cached->Size;
+		return;
+	}
+	
 	int advance = 0;
 	int w_largest = 0;
 	char lastchar = 0;
@@ -162,10 +271,13 @@ void Font::TextSize( std::string text, SDL_Rect *r )
 	
 	if( w_largest > r->w )
 		r->w = w_largest;
+	
+	cached->Size = *r;
+	cached->HasSize = true;
 }
 
 
-int Font::TextHeight( std::string text )
+int Font::TextHeight( const std::string &text )
 {
 	if( ! Initialized )
 		return 0;
@@ -183,14 +295,53 @@ int Font::TextHeight( std::string text )
 }
 
 
-int Font::LineWidth( std::string text )
+int Font::LineWidth( const std::string &text )
 {
 	if( ! Initialized )
 		return 0;
 	
+	Measured *cached = CachedMeasure( text );
+	if( ! cached->HasWidth )
+	{
+		cached->Width = MeasureLine( text.c_str() );
+		cached->HasWidth = true;
+	}
+	
+	return cached->Width;
+}
+
+
+Font::Measured *Font::CachedMeasure( const std::string &text )
+{
+	std::map<std::string,Measured>::iterator cached = MeasureCache.find( text );
+	if( cached != MeasureCache.end() )
+	{
+		// Move to the front of the recently used list.
+		MeasureOrder.splice( MeasureOrder.begin(), MeasureOrder, cached->second.Used );
+		return &(cached->second);
+	}
+	
+	// Make room by forgetting only the least recently used string, so busy UI text stays measured.
+	if( MeasureCache.size() >= FONT_MEASURE_CACHE_SIZE )
+	{
+		MeasureCache.erase( MeasureOrder.back() );
+		MeasureOrder.pop_back();
+	}
+	
+	MeasureOrder.push_front( text );
+	Measured *measured = &(MeasureCache[ text ]);
+	measured->HasSize = false;
+	measured->HasWidth = false;
+	measured->Used = MeasureOrder.begin();
+	return measured;
+}
+
+
+int Font::MeasureLine( const char *text )
+{
 	int w = 0;
 	
-	const char *text_ptr = text.c_str();
+	const char *text_ptr = text;
 	while( (*text_ptr != '\0') && (*text_ptr != '\n') )
 	{
 		LoadChar( *text_ptr );
@@ -202,19 +353,11 @@ int Font::LineWidth( std::string text )
 }
 
 
-void Font::DrawText( std::string text, int x, int y, uint8_t align, float scale )
-{
-	DrawText( text, x, y, align, 1.f, 1.f, 1.f, 1.f, scale );
-}
-
-
-void Font::DrawText( std::string text, int x, int y, uint8_t align, float r, float g, float b, float a, float scale )
+int Font::LayoutQuads( const std::string &text, int x, int y, uint8_t align, float scale )
 {
-	if( ! Initialized )
-		return;
-	
-	if( LoadedTime.ElapsedSeconds() > Raptor::Game->Res.ResetTime.ElapsedSeconds() )
-		InitFont();
+	VertexArray.clear();
+	TexCoordArray.clear();
+	QuadPages.clear();
 	
 	// Adjust for text vertical alignment.
 	int text_height = TextHeight( text ) * scale;
@@ -237,111 +380,137 @@ void Font::DrawText( std::string text, int x, int y, uint8_t align, float r, flo
 			break;
 	}
 	
-	GLfloat left = 0.0f, right = 0.0f;
-	GLfloat top = 0.0f, bottom = 0.0f;
-	GLfloat tex_min_x = 0.0f, tex_min_y = 0.0f;
-	GLfloat tex_max_x = 0.0f, tex_max_y = 0.0f;
-	GLfloat min_x = 0.0f;
-	GLfloat base_left = x;
-	
-	glPushAttrib( GL_ALL_ATTRIB_BITS );
-	
-	glEnable( GL_BLEND );
-	glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
-	
-	glEnable( GL_TEXTURE_2D );
-	glColor4f( r, g, b, a );
-	
-	// Adjust for text horizontal alignment.
-	int line_width = LineWidth( text ) * scale;
-	switch( align )
-	{
-		case ALIGN_TOP_CENTER:
-		case ALIGN_MIDDLE_CENTER:
-		case ALIGN_BASELINE_CENTER:
-		case ALIGN_BOTTOM_CENTER:
-			x -= line_width / 2;
-			break;
-		case ALIGN_TOP_RIGHT:
-		case ALIGN_MIDDLE_RIGHT:
-		case ALIGN_BASELINE_RIGHT:
-		case ALIGN_BOTTOM_RIGHT:
-			x -= line_width;
-			break;
-	}
-	
-	GLfloat xf = x;
+	int base_left = x;
 	const char *text_ptr = text.c_str();
-	while( *text_ptr != '\0' )
+	const char *line_ptr = text_ptr;
+	
+	while( true )
 	{
-		if( *text_ptr == '\n' )
+		// Adjust for text horizontal alignment.
+		int line_width = MeasureLine( line_ptr ) * scale;
+		x = base_left;
+		switch( align )
 		{
-			x = base_left;
-			y += LineSkip * scale;
-			
-			// Adjust for text horizontal alignment.
-			line_width = LineWidth( text_ptr + 1 ) * scale;
-			switch( align )
-			{
-				case ALIGN_TOP_CENTER:
-				case ALIGN_MIDDLE_CENTER:
-				case ALIGN_BASELINE_CENTER:
-				case ALIGN_BOTTOM_CENTER:
-					x -= line_width / 2;
-					break;
-				case ALIGN_TOP_RIGHT:
-				case ALIGN_MIDDLE_RIGHT:
-				case ALIGN_BASELINE_RIGHT:
-				case ALIGN_BOTTOM_RIGHT:
-					x -= line_width;
-					break;
-			}
-			
-			xf = x;
+			case ALIGN_TOP_CENTER:
+			case ALIGN_MIDDLE_CENTER:
+			case ALIGN_BASELINE_CENTER:
+			case ALIGN_BOTTOM_CENTER:
+				x -= line_width / 2;
+				break;
+			case ALIGN_TOP_RIGHT:
+			case ALIGN_MIDDLE_RIGHT:
+			case ALIGN_BASELINE_RIGHT:
+			case ALIGN_BOTTOM_RIGHT:
+				x -= line_width;
+				break;
 		}
-		else
+		
+		GLfloat xf = x;
+		GLfloat top = y;
+		
+		for( text_ptr = line_ptr; (*text_ptr != '\0') && (*text_ptr != '\n'); text_ptr ++ )
 		{
-			LoadChar( *text_ptr );
-			
-			tex_min_x = Glyphs[ (unsigned char) *text_ptr ].TexMinX;
-			tex_min_y = Glyphs[ (unsigned char) *text_ptr ].TexMinY;
-			tex_max_x = Glyphs[ (unsigned char) *text_ptr ].TexMaxX;
-			tex_max_y = Glyphs[ (unsigned char) *text_ptr ].TexMaxY;
-			
-			min_x = Glyphs[ (unsigned char) *text_ptr ].MinX;
+			const Glyph *glyph = &(Glyphs[ (unsigned char) *text_ptr ]);
 			
-			left = xf + min_x * scale;
-			right = xf + (Glyphs[ (unsigned char) *text_ptr ].Pic->w + min_x) * scale;
-			top = y;
-			bottom = y + Glyphs[ (unsigned char) *text_ptr ].Pic->h * scale;
-			
-			glBindTexture( GL_TEXTURE_2D, Glyphs[ (unsigned char) *text_ptr ].Tex );
-			
-			glBegin( GL_QUADS );
-				glTexCoord2f( tex_min_x, tex_min_y ); glVertex2f( left, top );
-				glTexCoord2f( tex_max_x, tex_min_y ); glVertex2f( right, top );
-				glTexCoord2f( tex_max_x, tex_max_y ); glVertex2f( right, bottom );
-				glTexCoord2f( tex_min_x, tex_max_y ); glVertex2f( left, bottom );
-			glEnd();
+			if( PackChar( *text_ptr ) )
+			{
+				GLfloat left = xf + glyph->MinX * scale;
+				GLfloat right = xf + (glyph->Pic->w + glyph->MinX) * scale;
+				GLfloat bottom = top + glyph->Pic->h * scale;
+				
+				GLfloat vertices[ 8 ] = { left, top, right, top, right, bottom, left, bottom };
+				GLfloat texcoords[ 8 ] = { glyph->TexMinX, glyph->TexMinY, glyph->TexMaxX, glyph->TexMinY, glyph->TexMaxX, glyph->TexMaxY, glyph->TexMinX, glyph->TexMaxY };
+				VertexArray.insert( VertexArray.end(), vertices, vertices + 8 );
+				TexCoordArray.insert( TexCoordArray.end(), texcoords, texcoords + 8 );
+				QuadPages.push_back( glyph->Page );
+			}
 			
-			xf += Glyphs[ (unsigned char) *text_ptr ].Advance * scale;
-			x = xf;
+			xf += glyph->Advance * scale;
 		}
 		
-		text_ptr ++;
+		if( *text_ptr == '\0' )
+			break;
+		
+		line_ptr = text_ptr + 1;
+		y += LineSkip * scale;
+	}
+	
+	return VertexArray.size() / 2;
+}
+
+
+void Font::DrawQuads( int vertex_count, GLint vertex_size, GLenum vertex_type, const GLvoid *vertices )
+{
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	
+	glVertexPointer( vertex_size, vertex_type, 0, vertices );
+	glTexCoordPointer( 2, GL_FLOAT, 0, &(TexCoordArray[ 0 ]) );
+	
+	// Draw each run of quads from the same atlas page together.
+	size_t quad_count = vertex_count / 4;
+	for( size_t first = 0; first < quad_count; )
+	{
+		size_t last = first + 1;
+		while( (last < quad_count) && (QuadPages[ last ] == QuadPages[ first ]) )
+			last ++;
+		
+		glBindTexture( GL_TEXTURE_2D, AtlasPages[ QuadPages[ first ] ] );
+		glDrawArrays( GL_QUADS, first * 4, (last - first) * 4 );
+		first = last;
+	}
+	
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+}
+
+
+void Font::DrawText( const std::string &text, int x, int y, uint8_t align, float scale )
+{
+	DrawText( text, x, y, align, 1.f, 1.f, 1.f, 1.f, scale );
+}
+
+
+void Font::DrawText( const std::string &text, int x, int y, uint8_t align, float r, float g, float b, float a, float scale )
+{
+	if( ! Initialized )
+		return;
+	
+	if( LoadedTime.Before( &(Raptor::Game->Res.ResetTime) ) )
+		InitFont();
+	
+	glPushAttrib( GL_ALL_ATTRIB_BITS );
+	
+	// Build the quads before setting draw state, since packing new glyphs may bind the atlas.
+	int vertex_count = LayoutQuads( text, x, y, align, scale );
+	
+	if( vertex_count )
+	{
+		glEnable( GL_BLEND );
+#ifndef NO_GLEW
+		// Separate alpha keeps coverage correct when drawing into a transparent layer cache.
+		glBlendFuncSeparate( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+#else
+		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+#endif
+		
+		glEnable( GL_TEXTURE_2D );
+		glColor4f( r, g, b, a );
+		
+		DrawQuads( vertex_count, 2, GL_FLOAT, &(VertexArray[ 0 ]) );
 	}
 	
 	glPopAttrib();
 }
 
 
-void Font::DrawText( std::string text, int x1, int y1, int w, int h, uint8_t align, float scale )
+void Font::DrawText( const std::string &text, int x1, int y1, int w, int h, uint8_t align, float scale )
 {
 	DrawText( text, x1, y1, w, h, align, 1.f, 1.f, 1.f, 1.f, scale );
 }
 
 
-void Font::DrawText( std::string text, int x1, int y1, int w, int h, uint8_t align, float r, float g, float b, float a, float scale )
+void Font::DrawText( const std::string &text, int x1, int y1, int w, int h, uint8_t align, float r, float g, float b, float a, float scale )
 {
 	int x = 0, y = 0;
 	
@@ -395,157 +564,65 @@ void Font::DrawText( std::string text, int x1, int y1, int w, int h, uint8_t ali
 }
 
 
-void Font::DrawText( std::string text, const SDL_Rect *rect, uint8_t align, float scale )
+void Font::DrawText( const std::string &text, const SDL_Rect *rect, uint8_t align, float scale )
 {
 	DrawText( text, rect->x, rect->y, rect->w, rect->h, align, 1.f, 1.f, 1.f, 1.f, scale );
 }
 
 
-void Font::DrawText( std::string text, const SDL_Rect *rect, uint8_t align, float r, float g, float b, float a, float scale )
+void Font::DrawText( const std::string &text, const SDL_Rect *rect, uint8_t align, float r, float g, float b, float a, float scale )
 {
 	DrawText( text, rect->x, rect->y, rect->w, rect->h, align, r, g, b, a, scale );
 }
 
 
-void Font::DrawText3D( std::string text, const Pos3D *pos, uint8_t align, double scale )
+void Font::DrawText3D( const std::string &text, const Pos3D *pos, uint8_t align, double scale )
 {
 	DrawText3D( text, pos, align, 1.f, 1.f, 1.f, 1.f, scale );
 }
 
 
-void Font::DrawText3D( std::string text, const Pos3D *pos, uint8_t align, float r, float g, float b, float a, double scale )
+void Font::DrawText3D( const std::string &text, const Pos3D *pos, uint8_t align, float r, float g, float b, float a, double scale )
 {
 	if( ! Initialized )
 		return;
 	
-	if( LoadedTime.ElapsedSeconds() > Raptor::Game->Res.ResetTime.ElapsedSeconds() )
+	if( LoadedTime.Before( &(Raptor::Game->Res.ResetTime) ) )
 		InitFont();
 	
-	GLdouble x = 0., y = 0.;
-	Pos3D tl, tr, br, bl;
-	
-	// Adjust for text vertical alignment.
-	int text_height = TextHeight( text );
-	switch( align )
-	{
-		case ALIGN_MIDDLE_LEFT:
-		case ALIGN_MIDDLE_CENTER:
-		case ALIGN_MIDDLE_RIGHT:
-			y -= text_height / 2;
-			break;
-		case ALIGN_BASELINE_LEFT:
-		case ALIGN_BASELINE_CENTER:
-		case ALIGN_BASELINE_RIGHT:
-			y -= Ascent;
-			break;
-		case ALIGN_BOTTOM_LEFT:
-		case ALIGN_BOTTOM_CENTER:
-		case ALIGN_BOTTOM_RIGHT:
-			y -= text_height;
-			break;
-	}
-	
-	GLdouble left = 0., right = 0.;
-	GLdouble top = 0., bottom = 0.;
-	GLfloat tex_min_x = 0.f, tex_min_y = 0.f;
-	GLfloat tex_max_x = 0.f, tex_max_y = 0.f;
-	GLdouble min_x = 0.;
-	GLdouble base_left = x;
-	
 	glPushAttrib( GL_ALL_ATTRIB_BITS );
 	
-	glEnable( GL_BLEND );
-	glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
-	
-	glEnable( GL_TEXTURE_2D );
-	glColor4f( r, g, b, a );
-	
-	// Adjust for text horizontal alignment.
-	int line_width = LineWidth( text );
-	switch( align )
-	{
-		case ALIGN_TOP_CENTER:
-		case ALIGN_MIDDLE_CENTER:
-		case ALIGN_BASELINE_CENTER:
-		case ALIGN_BOTTOM_CENTER:
-			x -= line_width / 2;
-			break;
-		case ALIGN_TOP_RIGHT:
-		case ALIGN_MIDDLE_RIGHT:
-		case ALIGN_BASELINE_RIGHT:
-		case ALIGN_BOTTOM_RIGHT:
-			x -= line_width;
-			break;
-	}
+	// Lay out in unscaled font pixels, then project each corner onto the plane of pos.
+	int vertex_count = LayoutQuads( text, 0, 0, align, 1.f );
 	
-	const char *text_ptr = text.c_str();
-	while( *text_ptr != '\0' )
+	if( vertex_count )
 	{
-		if( *text_ptr == '\n' )
-		{
-			x = base_left;
-			y += LineSkip;
-			
-			// Adjust for text horizontal alignment.
-			line_width = LineWidth( text_ptr + 1 );
-			switch( align )
-			{
-				case ALIGN_TOP_CENTER:
-				case ALIGN_MIDDLE_CENTER:
-				case ALIGN_BASELINE_CENTER:
-				case ALIGN_BOTTOM_CENTER:
-					x -= line_width / 2;
-					break;
-				case ALIGN_TOP_RIGHT:
-				case ALIGN_MIDDLE_RIGHT:
-				case ALIGN_BASELINE_RIGHT:
-				case ALIGN_BOTTOM_RIGHT:
-					x -= line_width;
-					break;
-			}
-		}
-		else
+		Vec3D right = pos->Right;
+		Vec3D up = pos->Up;
+		right.ScaleTo( scale );
+		up.ScaleTo( -scale );
+		
+		VertexArray3D.resize( vertex_count * 3 );
+		for( int i = 0; i < vertex_count; i ++ )
 		{
-			LoadChar( *text_ptr );
-			
-			tex_min_x = Glyphs[ (unsigned char) *text_ptr ].TexMinX;
-			tex_min_y = Glyphs[ (unsigned char) *text_ptr ].TexMinY;
-			tex_max_x = Glyphs[ (unsigned char) *text_ptr ].TexMaxX;
-			tex_max_y = Glyphs[ (unsigned char) *text_ptr ].TexMaxY;
-			
-			min_x = Glyphs[ (unsigned char) *text_ptr ].MinX;
-			
-			left = x + min_x;
-			right = x + Glyphs[ (unsigned char) *text_ptr ].Pic->w + min_x;
-			top = y;
-			bottom = y + Glyphs[ (unsigned char) *text_ptr ].Pic->h;
-			
-			tl.Copy( pos );
-			tl.MoveAlong( &(pos->Right), left * scale );
-			tl.MoveAlong( &(pos->Up), -top * scale );
-			tr.Copy( pos );
-			tr.MoveAlong( &(pos->Right), right * scale );
-			tr.MoveAlong( &(pos->Up), -top * scale );
-			br.Copy( pos );
-			br.MoveAlong( &(pos->Right), right * scale );
-			br.MoveAlong( &(pos->Up), -bottom * scale );
-			bl.Copy( pos );
-			bl.MoveAlong( &(pos->Right), left * scale );
-			bl.MoveAlong( &(pos->Up), -bottom * scale );
-			
-			glBindTexture( GL_TEXTURE_2D, Glyphs[ (unsigned char) *text_ptr ].Tex );
-			
-			glBegin( GL_QUADS );
-				glTexCoord2f( tex_min_x, tex_min_y ); glVertex3d( tl.X, tl.Y, tl.Z );
-				glTexCoord2f( tex_max_x, tex_min_y ); glVertex3d( tr.X, tr.Y, tr.Z );
-				glTexCoord2f( tex_max_x, tex_max_y ); glVertex3d( br.X, br.Y, br.Z );
-				glTexCoord2f( tex_min_x, tex_max_y ); glVertex3d( bl.X, bl.Y, bl.Z );
-			glEnd();
-			
-			x += Glyphs[ (unsigned char) *text_ptr ].Advance;
+			GLdouble vx = VertexArray[ i * 2 ];
+			GLdouble vy = VertexArray[ i * 2 + 1 ];
+			VertexArray3D[ i * 3     ] = pos->X + right.X * vx + up.X * vy;
+			VertexArray3D[ i * 3 + 1 ] = pos->Y + right.Y * vx + up.Y * vy;
+			VertexArray3D[ i * 3 + 2 ] = pos->Z + right.Z * vx + up.Z * vy;
 		}
 		
-		text_ptr ++;
+		glEnable( GL_BLEND );
+#ifndef NO_GLEW
+		glBlendFuncSeparate( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+#else
+		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+#endif
+		
+		glEnable( GL_TEXTURE_2D );
+		glColor4f( r, g, b, a );
+		
+		DrawQuads( vertex_count, 3, GL_DOUBLE, &(VertexArray3D[ 0 ]) );
 	}
 	
 	glPopAttrib();
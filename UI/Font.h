@@ -9,6 +9,9 @@ class FontID;
 #include "PlatformSpecific.h"
 
 #include <string>
+#include <map>
+#include <list>
+#include <vector>
 #include "RaptorGL.h"
 
 #ifdef SDL2
@@ -26,6 +29,9 @@ class FontID;
 #include "Clock.h"
 #include "Pos.h"
 
+#define FONT_ATLAS_PADDING 2
+#define FONT_MEASURE_CACHE_SIZE 1024
+
 
 class Font
 {
@@ -44,17 +50,17 @@ public:
 	int GetAscent( void );
 	int GetDescent( void );
 	
-	void TextSize( std::string text, SDL_Rect *r );
-	int TextHeight( std::string text );
-	int LineWidth( std::string text );
-	void DrawText( std::string text, int x, int y, uint8_t align, float scale = 1. );
-	void DrawText( std::string text, int x, int y, uint8_t align, float r, float g, float b, float a, float scale = 1. );
-	void DrawText( std::string text, int x1, int y1, int w, int h, uint8_t align, float scale = 1. );
-	void DrawText( std::string text, int x1, int y1, int w, int h, uint8_t align, float r, float g, float b, float a, float scale = 1. );
-	void DrawText( std::string text, const SDL_Rect *rect, uint8_t align, float scale = 1. );
-	void DrawText( std::string text, const SDL_Rect *rect, uint8_t align, float r, float g, float b, float a, float scale = 1. );
-	void DrawText3D( std::string text, const Pos3D *pos, uint8_t align, double scale = 1. );
-	void DrawText3D( std::string text, const Pos3D *pos, uint8_t align, float r, float g, float b, float a, double scale = 1. );
+	void TextSize( const std::string &text, SDL_Rect *r );
+	int TextHeight( const std::string &text );
+	int LineWidth( const std::string &text );
+	void DrawText( const std::string &text, int x, int y, uint8_t align, float scale = 1. );
+	void DrawText( const std::string &text, int x, int y, uint8_t align, float r, float g, float b, float a, float scale = 1. );
+	void DrawText( const std::string &text, int x1, int y1, int w, int h, uint8_t align, float scale = 1. );
+	void DrawText( const std::string &text, int x1, int y1, int w, int h, uint8_t align, float r, float g, float b, float a, float scale = 1. );
+	void DrawText( const std::string &text, const SDL_Rect *rect, uint8_t align, float scale = 1. );
+	void DrawText( const std::string &text, const SDL_Rect *rect, uint8_t align, float r, float g, float b, float a, float scale = 1. );
+	void DrawText3D( const std::string &text, const Pos3D *pos, uint8_t align, double scale = 1. );
+	void DrawText3D( const std::string &text, const Pos3D *pos, uint8_t align, float r, float g, float b, float a, double scale = 1. );
 	
 	enum
 	{
@@ -79,7 +85,8 @@ private:
 		int MinY, MaxY;
 		int Advance;
 		SDL_Surface *Pic;
-		GLuint Tex;
+		bool InAtlas;
+		int Page;
 		GLfloat TexMinX, TexMinY;
 		GLfloat TexMaxX, TexMaxY;
 	};
@@ -94,7 +101,37 @@ private:
 	TTF_Font *TTFont;
 	Clock LoadedTime;
 	
+	// Glyphs are packed into rows of atlas textures as they are first drawn; usually one page holds them all.
+	std::vector<GLuint> AtlasPages;
+	int AtlasSize;
+	int AtlasX, AtlasY;
+	int AtlasRowHeight;
+	
+	// Quads for the current DrawText call, reused so each call is one draw per atlas page without reallocating.
+	std::vector<GLfloat> VertexArray;
+	std::vector<GLfloat> TexCoordArray;
+	std::vector<GLdouble> VertexArray3D;
+	std::vector<int> QuadPages;
+	
+	struct Measured
+	{
+		SDL_Rect Size;
+		int Width;
+		bool HasSize, HasWidth;
+		std::list<std::string>::iterator Used;
+	};
+	
+	// TextSize and LineWidth results, evicting the least recently used string when full.
+	std::map<std::string,Measured> MeasureCache;
+	std::list<std::string> MeasureOrder;
+	
 	void LoadChar( char c );
+	bool PackChar( char c );
+	void CreateAtlasPage( void );
+	Measured *CachedMeasure( const std::string &text );
+	int MeasureLine( const char *text );
+	int LayoutQuads( const std::string &text, int x, int y, uint8_t align, float scale );
+	void DrawQuads( int vertex_count, GLint vertex_size, GLenum vertex_type, const GLvoid *vertices );
 };
 
 
@@ -4,6 +4,7 @@
 
 #include "Layer.h"
 
+#include <cstring>
 #include "Math2D.h"
 #include "RaptorGame.h"
 
@@ -49,6 +50,12 @@ Layer::Layer( SDL_Rect *rect )
 	Alpha = 1.f;
 	
 	ReadControls = false;
+	
+	CacheRender = false;
+	Redraw = true;
+	RenderCache = NULL;
+	memset( &RenderCacheRect, 0, sizeof(RenderCacheRect) );
+	RenderCacheUIScale = 0.f;
 }
 
 
@@ -61,6 +68,10 @@ Layer::~Layer()
 	Container = NULL;
 	Selected = NULL;
 	
+	if( RenderCache )
+		delete RenderCache;
+	RenderCache = NULL;
+	
 	for( std::list<Layer*>::iterator layer_iter = Elements.begin(); layer_iter != Elements.end(); )
 	{
 		std::list<Layer*>::iterator layer_iter_next = layer_iter;
@@ -167,6 +178,19 @@ void Layer::DrawElements( void )
 }
 
 
+bool Layer::Animating( void )
+{
+	// Layers that change appearance on their own (without events) should return true so cached parents keep redrawing.
+	for( std::list<Layer*>::iterator layer_iter = Elements.begin(); layer_iter != Elements.end(); layer_iter ++ )
+	{
+		if( (*layer_iter)->Visible && (*layer_iter)->Animating() )
+			return true;
+	}
+	
+	return false;
+}
+
+
 bool Layer::WithinCalcRect( int x, int y )
 {
 	return Math2D::WithinRect( x, y, CalcRect.x, CalcRect.y, CalcRect.x + CalcRect.w, CalcRect.y + CalcRect.h );
@@ -367,6 +391,7 @@ void Layer::Remove( void )
 void Layer::SetDirty( void )
 {
 	Dirty = true;
+	Redraw = true;
 
 	if( Container )
 		Container->SetDirty();
@@ -375,10 +400,20 @@ void Layer::SetDirty( void )
 }
 
 
+void Layer::SetRedraw( void )
+{
+	Redraw = true;
+	
+	if( Container )
+		Container->SetRedraw();
+}
+
+
 void Layer::AddElement( Layer *element )
 {
 	element->Container = this;
 	Elements.push_back( element );
+	SetRedraw();
 }
 
 
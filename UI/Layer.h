@@ -17,6 +17,8 @@ class Layer;
 	#include <SDL/SDL.h>
 #endif
 
+#include "Framebuffer.h"
+
 
 class Layer
 {
@@ -39,6 +41,13 @@ public:
 	
 	float Red, Green, Blue, Alpha;
 	
+	// Top-level layers may opt in to drawing through a cached framebuffer, redrawn only when needed.
+	bool CacheRender;
+	bool Redraw;
+	Framebuffer *RenderCache;
+	SDL_Rect RenderCacheRect;
+	float RenderCacheUIScale;
+	
 	
 	Layer( SDL_Rect *rect = NULL );
 	virtual ~Layer();
@@ -49,6 +58,8 @@ public:
 	virtual void Draw( void );
 	virtual void DrawElements( void );
 	
+	virtual bool Animating( void );
+	
 	virtual bool WithinCalcRect( int x, int y );
 	virtual bool IsSelected( void );
 	
@@ -65,6 +76,7 @@ public:
 	
 	void Remove( void );
 	void SetDirty( void );
+	void SetRedraw( void );
 	
 	void AddElement( Layer *element );
 	void RemoveElement( Layer *element );
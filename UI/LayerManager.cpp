@@ -6,12 +6,15 @@
 
 #include <cstddef>
 #include <stdexcept>
+#include <cstring>
 #include "RaptorGame.h"
 
 
 LayerManager::LayerManager( void )
 {
 	Dirty = false;
+	CacheHits = 0;
+	CacheRedraws = 0;
 }
 
 
@@ -27,17 +30,120 @@ void LayerManager::Draw( void )
 	for( std::list<Layer*>::iterator layer_iter = Layers.begin(); layer_iter != Layers.end(); layer_iter ++ )
 	{
 		// Draw all Layers, from bottom to top.
-		(*layer_iter)->UpdateCalcRects();
-		if( (*layer_iter)->Visible )
+		// Cached layers are skipped when already drawing to a framebuffer (VR eyes), since each eye would need its own cache.
+		if( (*layer_iter)->CacheRender && (*layer_iter)->Visible && ! Raptor::Game->Gfx.DrawTo )
+			DrawCached( *layer_iter );
+		else
 		{
-			(*layer_iter)->DrawSetup();
-			(*layer_iter)->Draw();
-			(*layer_iter)->DrawElements();
+			(*layer_iter)->UpdateCalcRects();
+			if( (*layer_iter)->Visible )
+				DrawLayer( *layer_iter );
 		}
 	}
 }
 
 
+void LayerManager::DrawLayer( Layer *layer )
+{
+	layer->DrawSetup();
+	layer->Draw();
+	layer->DrawElements();
+}
+
+
+void LayerManager::DrawCached( Layer *layer )
+{
+	Graphics *gfx = &(Raptor::Game->Gfx);
+	Framebuffer *cache = layer->RenderCache;
+	
+	bool redraw = layer->Redraw || ! cache || (cache->W != gfx->W) || (cache->H != gfx->H)
+		|| cache->LoadedTime.Before( &(Raptor::Game->Res.ResetTime) )
+		|| (layer->RenderCacheUIScale != Raptor::Game->UIScale)
+		|| memcmp( &(layer->RenderCacheRect), &(layer->Rect), sizeof(SDL_Rect) )
+		|| layer->Animating();
+	
+	if( redraw )
+	{
+		layer->UpdateCalcRects();
+		
+		if( cache && ((cache->W != gfx->W) || (cache->H != gfx->H)) )
+		{
+			delete cache;
+			cache = NULL;
+		}
+		if( ! cache )
+		{
+			// The cache covers the whole screen rather than just layer->Rect, because DrawSetup and any elements
+			// (like open dropdowns) draw in screen coordinates and may spill outside the layer.  That costs a
+			// screen-sized color texture and depth buffer per cached layer (about 16MB at 1920x1080, 64MB at 4K),
+			// so only opt in for a few large layers whose contents rarely change.
+			cache = new Framebuffer( gfx->W, gfx->H );
+			layer->RenderCache = cache;
+		}
+		
+		// If framebuffers are unavailable, draw this layer directly every frame.
+		if( ! cache->Select() )
+		{
+			DrawLayer( layer );
+			return;
+		}
+		
+		// Clear the flag before drawing, so a SetRedraw during the draw is kept for next frame.
+		layer->Redraw = false;
+		
+		gfx->DrawTo = cache;
+		gfx->Clear( 0.f, 0.f, 0.f, 0.f );
+#ifndef NO_GLEW
+		// Keep the cache's alpha as coverage (1-(1-a)(1-b)) instead of squaring it, so the composite below is correct.
+		glBlendFuncSeparate( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+#else
+		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+#endif
+		DrawLayer( layer );
+		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+		gfx->DrawTo = NULL;
+		gfx->SelectDefaultFramebuffer();
+		
+		layer->RenderCacheRect = layer->Rect;
+		layer->RenderCacheUIScale = Raptor::Game->UIScale;
+		CacheRedraws ++;
+	}
+	else
+		CacheHits ++;
+	
+	// Composite the cached layer as one textured quad.  Its contents were blended onto transparent black, so they are premultiplied.
+	gfx->Setup2D();
+	glPushAttrib( GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_TEXTURE_BIT );
+	glEnable( GL_TEXTURE_2D );
+	glEnable( GL_BLEND );
+	glBlendFunc( GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+	glColor4f( 1.f, 1.f, 1.f, 1.f );
+	glBindTexture( GL_TEXTURE_2D, cache->Texture );
+	glBegin( GL_QUADS );
+		glTexCoord2f( 0.f, 1.f );
+		glVertex2d( 0, 0 );
+		glTexCoord2f( 1.f, 1.f );
+		glVertex2d( gfx->W, 0 );
+		glTexCoord2f( 1.f, 0.f );
+		glVertex2d( gfx->W, gfx->H );
+		glTexCoord2f( 0.f, 0.f );
+		glVertex2d( 0, gfx->H );
+	glEnd();
+	glPopAttrib();
+}
+
+
+void LayerManager::InvalidateCached( SDL_Event *event )
+{
+	// Mouse motion only matters to layers it moves within (hover highlights); anything else may change any cached layer.
+	for( std::list<Layer*>::iterator layer_iter = Layers.begin(); layer_iter != Layers.end(); layer_iter ++ )
+	{
+		if( (*layer_iter)->CacheRender && ((event->type != SDL_MOUSEMOTION) || (*layer_iter)->MouseIsWithin || (*layer_iter)->WithinCalcRect( event->motion.x - event->motion.xrel, event->motion.y - event->motion.yrel )) )
+			(*layer_iter)->Redraw = true;
+	}
+}
+
+
 void LayerManager::TrackEvent( SDL_Event *event )
 {
 	Cleanup();
@@ -45,6 +151,8 @@ void LayerManager::TrackEvent( SDL_Event *event )
 	// Pass the event down the stack so all layers can see it.
 	for( std::list<Layer*>::reverse_iterator layer_iter = Layers.rbegin(); layer_iter != Layers.rend(); layer_iter ++ )
 		(*layer_iter)->TrackEvent( event );
+	
+	InvalidateCached( event );
 }
 
 
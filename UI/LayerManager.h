@@ -16,6 +16,7 @@ class LayerManager
 public:
 	std::list<Layer*> Layers;
 	bool Dirty;
+	unsigned int CacheHits, CacheRedraws;
 	
 	LayerManager( void );
 	virtual ~LayerManager();
@@ -36,4 +37,9 @@ public:
 	void MoveToTop( Layer *layer );
 	
 	Layer *Find( const std::string &name, bool recursive = false );
+
+private:
+	void DrawLayer( Layer *layer );
+	void DrawCached( Layer *layer );
+	void InvalidateCached( SDL_Event *event );
 };
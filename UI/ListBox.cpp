@@ -11,6 +11,7 @@
 ListBox::ListBox( SDL_Rect *rect, Font *font, int scroll_bar_size ) : Layer( rect )
 {
 	Selected = NULL;
+	SelectedIndex = -1;
 	AllowDeselect = true;
 	TextAlign = Font::ALIGN_TOP_LEFT;
 	TextFont = font;
@@ -51,6 +52,7 @@ ListBox::ListBox( SDL_Rect *rect, Font *font, int scroll_bar_size ) : Layer( rec
 ListBox::ListBox( SDL_Rect *rect, Font *font, int scroll_bar_size, std::vector<ListBoxItem> items ) : Layer( rect )
 {
 	Selected = NULL;
+	SelectedIndex = -1;
 	AllowDeselect = true;
 	TextAlign = Font::ALIGN_TOP_LEFT;
 	TextFont = font;
@@ -97,8 +99,14 @@ ListBox::~ListBox()
 
 void ListBox::AddItem( std::string value, std::string text, const Color *color )
 {
+	// Appending may reallocate Items, so keep Selected pointing at the same row.
+	SyncSelected();
+	
 	Items.push_back( ListBoxItem( value, text ) );
 	
+	if( Selected )
+		Selected = &(Items[ SelectedIndex ]);
+	
 	if( color )
 		Items.back().SetColor( color->Red, color->Green, color->Blue, color->Alpha );
 }
@@ -106,18 +114,11 @@ void ListBox::AddItem( std::string value, std::string text, const Color *color )
 
 int ListBox::FindItem( std::string value )
 {
-	int size = Items.size();
+	int size = ItemCount();
 	for( int i = 0; i < size; i ++ )
 	{
-		try
-		{
-			if( Items.at( i ).Value == value )
-				return i;
-		}
-		catch( std::out_of_range &exception )
-		{
-			fprintf( stderr, "ListBox::FindItem: std::out_of_range\n" );
-		}
+		if( ItemValue( i ) == value )
+			return i;
 	}
 
 	return -1;
@@ -133,18 +134,19 @@ void ListBox::RemoveItem( std::string value )
 
 void ListBox::RemoveItem( int index )
 {
-	if( index >= 0 )
+	if( (index >= 0) && ((size_t) index < Items.size()) )
 	{
-		try
-		{
-			// Create an iterator so the vector::erase method will work properly.
-			std::vector<ListBoxItem>::iterator iter = Items.begin() + index;
-			Items.erase( iter );
-		}
-		catch( std::out_of_range &exception )
-		{
-			fprintf( stderr, "ListBox::RemoveItem: std::out_of_range\n" );
-		}
+		SyncSelected();
+		
+		// Create an iterator so the vector::erase method will work properly.
+		std::vector<ListBoxItem>::iterator iter = Items.begin() + index;
+		Items.erase( iter );
+		
+		if( SelectedIndex == index )
+			SelectedIndex = -1;
+		else if( SelectedIndex > index )
+			SelectedIndex --;
+		Selected = ((SelectedIndex >= 0) && ((size_t) SelectedIndex < Items.size())) ? &(Items[ SelectedIndex ]) : NULL;
 	}
 }
 
@@ -153,6 +155,30 @@ void ListBox::Clear( void )
 {
 	Items.clear();
 	Selected = NULL;
+	SelectedIndex = -1;
+}
+
+
+size_t ListBox::ItemCount( void )
+{
+	// Subclasses can override this, ItemValue, ItemText, and DrawIndex to supply rows from their own storage instead of Items.
+	return Items.size();
+}
+
+
+std::string ListBox::ItemValue( size_t index )
+{
+	if( index < Items.size() )
+		return Items[ index ].Value;
+	return "";
+}
+
+
+std::string ListBox::ItemText( size_t index )
+{
+	if( index < Items.size() )
+		return Items[ index ].Text;
+	return "";
 }
 
 
@@ -170,7 +196,28 @@ int ListBox::MaxScroll( void )
 	if( UIScaleMode == Raptor::ScaleMode::IN_PLACE )
 		h /= Raptor::Game->UIScale;
 	
-	return std::max<int>( 0, Items.size() * LineScroll() - h );
+	return std::max<int>( 0, ItemCount() * LineScroll() - h );
+}
+
+
+void ListBox::VisibleRange( size_t *first, size_t *count )
+{
+	// Rows are a fixed height, so the visible window comes straight from the scroll position.
+	int line_scroll = std::max<int>( 1, LineScroll() );
+	size_t item_count = ItemCount();
+	float ui_scale = UIScaleMode ? Raptor::Game->UIScale : 1.f;
+	
+	*first = std::max<int>( 0, Scroll ) / line_scroll;
+	if( *first >= item_count )
+	{
+		*first = item_count;
+		*count = 0;
+		return;
+	}
+	
+	*count = CalcRect.h / (line_scroll * ui_scale) + 2;
+	if( *first + *count > item_count )
+		*count = item_count - *first;
 }
 
 
@@ -195,14 +242,9 @@ void ListBox::ScrollDown( int lines )
 
 void ListBox::ScrollTo( std::string value, int at )
 {
-	for( size_t i = 0; i < Items.size(); i ++ )
-	{
-		if( Items[ i ].Value == value )
-		{
-			ScrollTo( (int) i, at );
-			break;
-		}
-	}
+	int index = FindItem( value );
+	if( index >= 0 )
+		ScrollTo( index, at );
 }
 
 
@@ -223,7 +265,9 @@ void ListBox::ScrollTo( int index, int at )
 
 void ListBox::ScrollToSelected( int at )
 {
-	ScrollTo( SelectedValue(), at );
+	SyncSelected();
+	if( SelectedIndex >= 0 )
+		ScrollTo( SelectedIndex, at );
 }
 
 
@@ -265,7 +309,7 @@ void ListBox::Draw( void )
 	if( max_scroll > 0 )
 	{
 		int rect_h = (UIScaleMode == Raptor::ScaleMode::IN_PLACE) ? (Rect.h / Raptor::Game->UIScale) : Rect.h;
-		double percent_displayed = rect_h / (double)( LineScroll() * Items.size() );
+		double percent_displayed = rect_h / (double)( LineScroll() * ItemCount() );
 		double scroll_start = (Scroll / (double) max_scroll) * (1. - percent_displayed);
 		int h = CalcRect.h - scaled_scroll_bar * 2;
 		Raptor::Game->Gfx.DrawRect2D( CalcRect.w + x_offset - scaled_scroll_bar, (int)( scaled_scroll_bar + h * scroll_start ), CalcRect.w + x_offset, (int)( scaled_scroll_bar + h * (scroll_start + percent_displayed) ), 0, ScrollBarRed, ScrollBarGreen, ScrollBarBlue, ScrollBarAlpha );
@@ -280,18 +324,21 @@ void ListBox::Draw( void )
 	
 	if( TextFont )
 	{
+		size_t first = 0, count = 0;
+		VisibleRange( &first, &count );
+		
 		SDL_Rect text_rect;
 		text_rect.x = PadX * ui_scale;
-		text_rect.y = -Scroll * ui_scale;
 		text_rect.w = CalcRect.w - scaled_scroll_bar;
 		text_rect.h = TextFont->GetHeight() * ui_scale;
 		
-		for( std::vector<ListBoxItem>::iterator iter = Items.begin(); iter != Items.end(); iter ++ )
+		for( size_t index = first; index < first + count; index ++ )
 		{
-			if( (text_rect.y < CalcRect.h) && ((text_rect.y + LineScroll() * ui_scale) >= 0) )
-				DrawItem( &(*iter), &text_rect );
-			
-			text_rect.y += LineScroll() * ui_scale;
+			text_rect.y = ((int)( index * LineScroll() ) - Scroll) * ui_scale;
+			if( text_rect.y >= CalcRect.h )
+				break;
+			if( (text_rect.y + LineScroll() * ui_scale) >= 0 )
+				DrawIndex( index, &text_rect );
 		}
 	}
 	
@@ -301,6 +348,13 @@ void ListBox::Draw( void )
 }
 
 
+void ListBox::DrawIndex( size_t index, const SDL_Rect *rect )
+{
+	if( index < Items.size() )
+		DrawItem( &(Items[ index ]), rect );
+}
+
+
 void ListBox::DrawItem( const ListBoxItem *item, const SDL_Rect *rect )
 {
 	if( Selected == item )
@@ -325,7 +379,7 @@ void ListBox::TrackEvent( SDL_Event *event )
 		int y = Raptor::Game->Mouse.Y - CalcRect.y - scaled_scroll_bar;
 		int h = CalcRect.h - scaled_scroll_bar * 2;
 		
-		int line = h ? (y / (float) h) * Items.size() - CalcRect.h * 0.5f / LineScroll() : 0;
+		int line = h ? (y / (float) h) * ItemCount() - CalcRect.h * 0.5f / LineScroll() : 0;
 		if( line < 0 )
 			line = 0;
 		
@@ -378,7 +432,7 @@ bool ListBox::MouseDown( Uint8 button )
 			int y = Raptor::Game->Mouse.Y - CalcRect.y - scaled_scroll_bar;
 			int h = CalcRect.h - scaled_scroll_bar * 2;
 			
-			int line = h ? (y / (float) h) * Items.size() - CalcRect.h * 0.5f / LineScroll() : 0;
+			int line = h ? (y / (float) h) * ItemCount() - CalcRect.h * 0.5f / LineScroll() : 0;
 			if( line < 0 )
 				line = 0;
 			
@@ -406,7 +460,7 @@ bool ListBox::MouseUp( Uint8 button )
 		int y = Raptor::Game->Mouse.Y - CalcRect.y - scaled_scroll_bar;
 		int h = CalcRect.h - scaled_scroll_bar * 2;
 		
-		int line = h ? (y / (float) h) * Items.size() - CalcRect.h * 0.5f / LineScroll() : 0;
+		int line = h ? (y / (float) h) * ItemCount() - CalcRect.h * 0.5f / LineScroll() : 0;
 		if( line < 0 )
 			line = 0;
 		
@@ -418,23 +472,10 @@ bool ListBox::MouseUp( Uint8 button )
 		int y = (Raptor::Game->Mouse.Y - CalcRect.y) / (UIScaleMode ? Raptor::Game->UIScale : 1.f) + 0.5f;
 		int index = (y + Scroll) / LineScroll();
 		
-		if( (size_t) index < Items.size() )
-		{
-			try
-			{
-				Selected = &(Items.at( index ));
-				Changed();
-			}
-			catch( std::out_of_range &exception )
-			{
-				fprintf( stderr, "ListBox::MouseUp: std::out_of_range\n" );
-			}
-		}
+		if( (index >= 0) && ((size_t) index < ItemCount()) )
+			SelectIndex( index );
 		else if( AllowDeselect )
-		{
-			Selected = NULL;
-			Changed();
-		}
+			Deselect();
 	}
 	
 	return true;
@@ -448,43 +489,72 @@ void ListBox::Changed( void )
 
 std::string ListBox::SelectedValue( void )
 {
-	if( Selected )
-		return Selected->Value;
+	SyncSelected();
+	if( SelectedIndex >= 0 )
+		return ItemValue( SelectedIndex );
 	return "";
 }
 
 
 std::string ListBox::SelectedText( void )
 {
-	if( Selected )
-		return Selected->Text;
+	SyncSelected();
+	if( SelectedIndex >= 0 )
+		return ItemText( SelectedIndex );
 	return "";
 }
 
 
 void ListBox::Select( std::string value )
 {
-	for( std::vector<ListBoxItem>::iterator iter = Items.begin(); iter != Items.end(); iter ++ )
-	{
-		if( (*iter).Value == value )
-		{
-			Selected = &(*iter);
-			Changed();
-			break;
-		}
-	}
+	int index = FindItem( value );
+	if( index >= 0 )
+		SelectIndex( index );
 }
 
 
 void ListBox::Select( int index )
 {
 	if( index < 0 )
+		Deselect();
+	else if( (size_t) index < ItemCount() )
+		SelectIndex( index );
+}
+
+
+void ListBox::SelectIndex( size_t index )
+{
+	if( index >= ItemCount() )
+		return;
+	
+	// Rows supplied by a subclass have no ListBoxItem, so only SelectedIndex refers to them.
+	SelectedIndex = index;
+	Selected = (index < Items.size()) ? &(Items[ index ]) : NULL;
+	Changed();
+}
+
+
+void ListBox::Deselect( void )
+{
+	SelectedIndex = -1;
+	Selected = NULL;
+	Changed();
+}
+
+
+void ListBox::SyncSelected( void )
+{
+	// Pick up changes made by assigning Selected directly, as older code does.
+	if( Selected && Items.size() && (Selected >= &(Items[ 0 ])) && (Selected <= &(Items.back())) )
+		SelectedIndex = Selected - &(Items[ 0 ]);
+	else if( Selected || ((SelectedIndex >= 0) && ((size_t) SelectedIndex < Items.size())) )
 	{
 		Selected = NULL;
-		Changed();
+		SelectedIndex = -1;
 	}
-	else if( (size_t) index < Items.size() )
-		Select( Items[ index ].Value );
+	
+	if( (SelectedIndex >= 0) && ((size_t) SelectedIndex >= ItemCount()) )
+		SelectedIndex = -1;
 }
 
 
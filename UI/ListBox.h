@@ -30,6 +30,7 @@ class ListBox : public Layer
 public:
 	std::vector<ListBoxItem> Items;
 	ListBoxItem *Selected;
+	int SelectedIndex;
 	bool AllowDeselect;
 	uint8_t TextAlign;
 	Font *TextFont;
@@ -53,8 +54,13 @@ public:
 	void RemoveItem( int index );
 	void Clear( void );
 	
+	virtual size_t ItemCount( void );
+	virtual std::string ItemValue( size_t index );
+	virtual std::string ItemText( size_t index );
+	
 	int LineScroll( void );
 	int MaxScroll( void );
+	void VisibleRange( size_t *first, size_t *count );
 	void ScrollUp( int lines = 1 );
 	void ScrollDown( int lines = 1 );
 	void ScrollTo( std::string value, int at = 0 );
@@ -63,6 +69,7 @@ public:
 	
 	void UpdateRects( void );
 	void Draw( void );
+	virtual void DrawIndex( size_t index, const SDL_Rect *rect );
 	virtual void DrawItem( const ListBoxItem *item, const SDL_Rect *rect );
 	
 	void TrackEvent( SDL_Event *event );
@@ -77,6 +84,9 @@ public:
 	std::string SelectedText( void );
 	void Select( std::string value );
 	void Select( int index );
+	virtual void SelectIndex( size_t index );
+	void Deselect( void );
+	void SyncSelected( void );
 	
 	enum
 	{
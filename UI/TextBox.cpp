@@ -210,6 +210,13 @@ void TextBox::Draw( void )
 }
 
 
+bool TextBox::Animating( void )
+{
+	// The cursor blinks while selected.
+	return IsSelected() || Layer::Animating();
+}
+
+
 void TextBox::TrackEvent( SDL_Event *event )
 {
 	Layer::TrackEvent( event );
@@ -41,6 +41,7 @@ public:
 	virtual ~TextBox();
 	
 	void Draw( void );
+	bool Animating( void );
 	void TrackEvent( SDL_Event *event );
 	virtual bool HandleEvent( SDL_Event *event );
 	void MouseEnter( void );
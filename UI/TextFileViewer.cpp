@@ -54,25 +54,19 @@ TextFileViewer::TextFileViewer( SDL_Rect *window_rect, const char *filename, Fon
 	rect.h = rect.y - 70;
 	rect.x = 10;
 	rect.y = 60;
-	Contents = new ListBox( &rect, font ? font : Raptor::Game->Res.GetFont( "ProFont.ttf", 14 ), 16 );
-	Contents->SelectedRed = Contents->TextRed;
-	Contents->SelectedGreen = Contents->TextGreen;
-	Contents->SelectedBlue = Contents->TextBlue;
-	Contents->SelectedAlpha = Contents->TextAlpha;
+	Contents = new TextFileViewerLines( &rect, font ? font : Raptor::Game->Res.GetFont( "ProFont.ttf", 14 ), 16 );
 	AddElement( Contents );
 	
 	std::ifstream input( filename );
 	if( input.is_open() )
 	{
-		int line = 0;
 		char buffer[ 1024 ] = "";
 		while( ! input.eof() )
 		{
 			buffer[ 0 ] = '\0';
 			input.getline( buffer, 1024 );
 			CStr::ReplaceChars( buffer, "\r\n\t", "   " );
-			Contents->AddItem( Num::ToString(line), std::string(buffer) );
-			line ++;
+			Contents->Lines.push_back( std::string(buffer) );
 		}
 		
 		input.close();
@@ -99,16 +93,12 @@ bool TextFileViewer::KeyUp( SDLKey key )
 	}
 	else if( key == SDLK_PAGEDOWN )
 	{
-		int lines = Contents->Rect.h / Contents->TextFont->GetLineSkip();
-		for( int i = 0; i < lines; i ++ )
-			Contents->ScrollDown();
+		Contents->ScrollDown( Contents->Rect.h / Contents->LineScroll() );
 		return true;
 	}
 	else if( key == SDLK_PAGEUP )
 	{
-		int lines = Contents->Rect.h / Contents->TextFont->GetLineSkip();
-		for( int i = 0; i < lines; i ++ )
-			Contents->ScrollUp();
+		Contents->ScrollUp( Contents->Rect.h / Contents->LineScroll() );
 		return true;
 	}
 	else if( key == SDLK_ESCAPE )
@@ -151,6 +141,56 @@ void TextFileViewer::Draw( void )
 // ---------------------------------------------------------------------------
 
 
+TextFileViewerLines::TextFileViewerLines( SDL_Rect *rect, Font *font, int scroll_bar_size ) : ListBox( rect, font, scroll_bar_size )
+{
+	AllowDeselect = false;
+	SelectedRed = TextRed;
+	SelectedGreen = TextGreen;
+	SelectedBlue = TextBlue;
+	SelectedAlpha = TextAlpha;
+}
+
+
+TextFileViewerLines::~TextFileViewerLines()
+{
+}
+
+
+size_t TextFileViewerLines::ItemCount( void )
+{
+	return Lines.size();
+}
+
+
+std::string TextFileViewerLines::ItemValue( size_t index )
+{
+	// Values are line numbers, as they were when each line was a ListBoxItem.
+	return (index < Lines.size()) ? Num::ToString( (int) index ) : std::string("");
+}
+
+
+std::string TextFileViewerLines::ItemText( size_t index )
+{
+	return (index < Lines.size()) ? Lines[ index ] : std::string("");
+}
+
+
+void TextFileViewerLines::DrawIndex( size_t index, const SDL_Rect *rect )
+{
+	// Lines are drawn straight from the file contents, without a ListBoxItem per row.
+	if( index >= Lines.size() )
+		return;
+	
+	if( (SelectedIndex >= 0) && (index == (size_t) SelectedIndex) )
+		TextFont->DrawText( Lines[ index ], rect, TextAlign, SelectedRed, SelectedGreen, SelectedBlue, SelectedAlpha, UIScaleMode ? Raptor::Game->UIScale : 1.f );
+	else
+		TextFont->DrawText( Lines[ index ], rect, TextAlign, TextRed, TextGreen, TextBlue, TextAlpha, UIScaleMode ? Raptor::Game->UIScale : 1.f );
+}
+
+
+// ---------------------------------------------------------------------------
+
+
 TextFileViewerCloseButton::TextFileViewerCloseButton( SDL_Rect *rect, Font *button_font ) : LabelledButton( rect, button_font, "Close", Font::ALIGN_MIDDLE_CENTER, Raptor::Game->Res.GetAnimation("button.ani"), Raptor::Game->Res.GetAnimation("button_mdown.ani") )
 {
 	Red = 1.f;
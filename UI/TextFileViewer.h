@@ -4,11 +4,14 @@
 
 #pragma once
 class TextFileViewer;
+class TextFileViewerLines;
 class TextFileViewerCloseButton;
 
 #include "PlatformSpecific.h"
 #include "Window.h"
 #include <cstddef>
+#include <string>
+#include <vector>
 
 #ifdef SDL2
 	#include <SDL2/SDL.h>
@@ -26,7 +29,7 @@ class TextFileViewer : public Window
 public:
 	std::string Title;
 	Font *TitleFont;
-	ListBox *Contents;
+	TextFileViewerLines *Contents;
 	TextFileViewerCloseButton *CloseButton;
 	bool AutoPosition;
 	
@@ -40,6 +43,21 @@ public:
 };
 
 
+class TextFileViewerLines : public ListBox
+{
+public:
+	std::vector<std::string> Lines;
+	
+	TextFileViewerLines( SDL_Rect *rect, Font *font, int scroll_bar_size );
+	virtual ~TextFileViewerLines();
+	
+	size_t ItemCount( void );
+	std::string ItemValue( size_t index );
+	std::string ItemText( size_t index );
+	void DrawIndex( size_t index, const SDL_Rect *rect );
+};
+
+
 class TextFileViewerCloseButton : public LabelledButton
 {
 public:
@@ -160,9 +160,9 @@ void HeadState::Draw( void )
 		return;
 	
 	// Make sure the OpenGL context is still valid.
-	if( EyeL->LoadedTime.ElapsedSeconds() > Raptor::Game->Res.ResetTime.ElapsedSeconds() )
+	if( EyeL->LoadedTime.Before( &(Raptor::Game->Res.ResetTime) ) )
 		EyeL->Reload();
-	if( EyeR->LoadedTime.ElapsedSeconds() > Raptor::Game->Res.ResetTime.ElapsedSeconds() )
+	if( EyeR->LoadedTime.Before( &(Raptor::Game->Res.ResetTime) ) )
 		EyeR->Reload();
 	
 	// For now, just clear the VR event queue without acting on anything.